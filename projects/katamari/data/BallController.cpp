@@ -1,6 +1,5 @@
 #include "BallController.h"
 #include "src/events/key.h"
-#include "Follow.h"
 
 
 void BallController::init(DynamicCharacterController* controller, Events::Key left, Events::Key right, Events::Key up, Events::Key down, std::string prefix) {
@@ -59,10 +58,6 @@ MaybeError BallController::update(float delta) {
     glm::vec3 PYR = glm::vec3(_orient.z, _orient.x, 0.f);
     // fmt::println("P: {} {} {}", PYR.x, PYR.y, PYR.z);
     _controller->getObject().getComponent<TransformComponent>()->setEulerOrientation(PYR);
-    Level* lvl = _controller->getObject().getLevel();
-    for (auto &&[entity, follow]: lvl->_registry.view<Follow>().each()) {
-		follow.update(delta);
-	}
     // glm::vec3 impulse = glm::vec3(_direction.x, 0.f, _direction.y);
     // glm::vec3 impulsePos = impulse + _controller->GetPosition();
     // fmt::println("{} {} {}", impulse.x, impulse.y, impulse.z);
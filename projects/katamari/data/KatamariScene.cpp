@@ -2,7 +2,6 @@
 #include <Jolt/Physics/Collision/Shape/MutableCompoundShape.h>
 
 #include "KatamariScene.h"
-#include "Follow.h"
 #include "glm/gtx/transform.hpp"
 #include <glm/gtx/string_cast.hpp>
 #include "src/error.h"
@@ -11,6 +10,7 @@
 #include "src/vk_engine.h"
 #include "src/meshes/sphere.h"
 #include "src/objects/components/tag.h"
+#include "src/physics/shapecooker.h"
 
 tl::expected<int, Error*> KatamariScene::init(VulkanEngine* engine) {
     auto initResult = loadMeshes(engine)
@@ -43,7 +43,9 @@ tl::expected<int, Error*> KatamariScene::loadMeshes(VulkanEngine* engine) {
 	planeMesh._vertices[3].color = { 0.2f,0.2f, 0.2f }; // almost black
 	planeMesh._vertices[4].color = { 0.2f,0.2f, 0.2f }; // almost black
 	planeMesh._vertices[5].color = { 0.2f,0.2f, 0.2f }; // almost black
-	//we dont care about the vertex normals atm
+
+	// Normals are needed for sun lighting
+	for (Vertex& vertex: planeMesh._vertices) vertex.normal = { 0.f, 1.f, 0.f };
 
 	// Load some objects
 	auto loadMesh = meshFromOBJ("../assets/monkey_smooth.obj");
@@ -253,6 +255,15 @@ tl::expected<int, Error*> KatamariScene::initScene(VulkanEngine* engine) {
 		glm::vec2(1280, 1040), 
 		CameraPurpose::RenderTarget);
 
+	// Sun only provides the light direction for shadows
+	Object sunObject = addEmptyObject();
+	sunObject.addComponent<TagComponent>("SUN");
+	sunObject.addComponent<Camera>(
+		glm::vec3(0.f, 0.f, 0.f),
+		glm::vec3(0.5f, -1.f, 0.f),
+		glm::vec2(2048, 2048),
+		CameraPurpose::LightTarget);
+
 	auto meshResult = getMesh("plane");
 	if (!meshResult) {
 		return tl::unexpected(new Error(ErrorMessage("Could not get default material (TODO: hardcoding a default would be nice)")));
@@ -289,19 +300,29 @@ tl::expected<int, Error*> KatamariScene::initScene(VulkanEngine* engine) {
 	ballCollision->createAndAdd();
 	ballController->createAndAdd();
     _controller.init(ballController.get(), Events::kKeyA, Events::kKeyD, Events::kKeyW, Events::kKeyS, "LEFT");
-    Physics::ContactCallback ballCall = [this](const JPH::Body &inBody1, const JPH::Body &inBody2, const JPH::ContactManifold &inManifold, const JPH::ContactSettings &ioSettings) {
+    Physics::ContactCallback ballCall = [this](const JPH::Body &inBody1, const JPH::Body &inBody2, const Physics::Contact &contact) {
 		if (inBody2.GetUserData() == 0) return;
         Physics::PhysicalCallbacks* callbacks1 = reinterpret_cast<Physics::PhysicalCallbacks*>(inBody1.GetUserData());
         Physics::PhysicalCallbacks* callbacks2 = reinterpret_cast<Physics::PhysicalCallbacks*>(inBody2.GetUserData());
 		if (!callbacks2->caller.hasComponent<TagComponent>() && callbacks2->caller.hasComponent<RigidBodyComponent>()) {
-			callbacks2->caller.getComponent<RigidBodyComponent>()->scheduleRemove();
-			callbacks2->caller.addComponent<Follow>(callbacks1->caller.getComponent<TransformComponent>());
+			// Stick to the ball where it was hit, the hierarchy moves it from then on. The
+			// prop itself goes back to its pool, only a copy without a body stays on the ball
+			const glm::mat4 ballMatrix = callbacks1->caller.getComponent<TransformComponent>()->getMatrix();
+			const glm::mat4 stuckMatrix = callbacks2->caller.getComponent<TransformComponent>()->getMatrix();
+			_spawner.absorb(callbacks2->caller, callbacks1->caller, glm::inverse(ballMatrix) * stuckMatrix);
 		}
 	};
 	ballController->setContactAddedCallback(ballCall);
 
     Object theLight = addRenderObject("lighthouse").value();
-    theLight.addComponent<TransformComponent>(transformMatrix);
+    watch_ptr<TransformComponent> lightTransform = theLight.addComponent<TransformComponent>(transformMatrix);
+	// Tagged, so the ball does not pick it up
+	theLight.addComponent<TagComponent>("LEVEL");
+	auto lightShape = ShapeCookerMan.cook(_meshes["lighthouse"]);
+	if (!lightShape.has_value())
+		return tl::unexpected(new Error(lightShape.error(), ErrorMessage("Could not cook lighthouse collision")));
+	watch_ptr<RigidBodyComponent> lightRigid = theLight.addComponent<RigidBodyComponent>(lightShape.value(), lightTransform, RigidBodyType::Static);
+	lightRigid->createAndAdd();
 
 	transformMatrix = glm::translate(glm::mat4{1.0f}, glm::vec3(5.f, 0.f, -3.f));
 
@@ -312,6 +333,7 @@ tl::expected<int, Error*> KatamariScene::initScene(VulkanEngine* engine) {
 
     Object theDome = addRenderObject("skydome").value();
     theDome.addComponent<TransformComponent>(transformMatrix);
+	theDome.addComponent<ShadowCaster>(false);
 
 	transformMatrix = glm::translate(glm::mat4{1.0f}, glm::vec3(40.f, 1.f, 0.f));
 	glm::mat4 rotation = glm::mat4_cast(glm::angleAxis(glm::pi<float>() / 2, glm::vec3(1, 0, 0)));
@@ -323,31 +345,27 @@ tl::expected<int, Error*> KatamariScene::initScene(VulkanEngine* engine) {
     // Attach camera to the ball
 	cameraObject.addComponent<OrbitalCamera>(_camera, ballTransform);
 
+	auto spawnerResult = _spawner.init(engine->_settings.objectPoolSize, engine->_settings.objectPoolLimit);
+	if (spawnerResult.has_value()) {
+		return tl::unexpected(new Error(spawnerResult.value(), ErrorMessage("Could not set up the prop spawner")));
+	}
+	// A new prop every second for as long as the scene runs
+	_timerStorage.addRepeatingTimer(1.f, [this]() {
+		return _spawner.spawn();
+	});
+
 	return 0;
 }
 
 MaybeError KatamariScene::update(float delta) {
-    Scene::update(delta);
-	for (auto & entity: getHierarchyOrderedObjects()) {
-		Object item = getObject(entity);
-		if (item.hasComponent<FreeCamera>()) {
-			item.getComponent<FreeCamera>()->update(delta);
-		}
-		if (item.hasComponent<OrbitalCamera>()) {
-			item.getComponent<OrbitalCamera>()->update(delta);
-		}
-		// if (item.hasComponent<Follow>()) {
-			// item.getComponent<Follow>()->update(delta);
-		// }
+    MaybeError sceneResult = Scene::update(delta);
+    if (sceneResult.has_value()) return sceneResult;
+	for (auto &&[entity, camera]: _level._registry.view<FreeCamera>().each()) {
+		camera.update(delta);
+	}
+	for (auto &&[entity, camera]: _level._registry.view<OrbitalCamera>().each()) {
+		camera.update(delta);
 	}
-    if (_cycle > 1.f) {
-        _timerStorage.addTimer(2.f, [this]() {
-            _spawner.spawn();
-            return std::nullopt;
-        });
-        _cycle = 0.f;
-    }
-    _cycle += delta;
     _controller.update(delta);
     return std::nullopt;
 }
@@ -14,7 +14,6 @@ public:
     virtual tl::expected<int, Error*> init(VulkanEngine *engine) override;
 
 private:
-    float _cycle = 0.f;
     watch_ptr<Camera> _camera;
     Spawner _spawner;
     BallController _controller;
@@ -1,22 +1,61 @@
 #include "Spawner.h"
 
+#include <glm/gtx/transform.hpp>
+
+#include "src/physics/shapecache.h"
 #include "src/random.h"
 
-void Spawner::spawn() {
-    float x = randFloat(-150.f, 150.f);
-    float z = randFloat(-150.f, 150.f);
-    float y = 7.5f;
+MaybeError Spawner::init(size_t poolSize, size_t poolLimit) {
+    JPH::ShapeRefC shape = ShapeCacheMan.box(glm::vec3(1.f, 1.f, 1.f));
+    for (size_t i = 0; i < ITEMS.size(); i++) {
+        auto spawnTemplate = _scene->makeSpawnTemplate(ITEMS[i]);
+        if (!spawnTemplate.has_value())
+            return new Error(spawnTemplate.error(), ErrorMessage("Could not prepare spawner item {}", ITEMS[i]));
+        spawnTemplate->shape = shape;
+        _pools[i].emplace(_scene, spawnTemplate.value(), poolLimit);
+        auto prewarm = _pools[i]->prewarm(poolSize);
+        if (prewarm.has_value())
+            return new Error(prewarm.value(), ErrorMessage("Could not fill the pool of spawner item {}", ITEMS[i]));
+    }
+    return std::nullopt;
+}
+
+MaybeError Spawner::spawn(uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        const size_t item = _index;
+        _index = (_index + 1) % ITEMS.size();
+        if (_pools[item]->exhausted()) continue;
+
+        float x = randFloat(-150.f, 150.f);
+        float z = randFloat(-150.f, 150.f);
+        float y = 7.5f;
+
+        auto prop = _pools[item]->acquire(glm::translate(glm::mat4{1.0f}, glm::vec3(x, y, z)));
+        if (!prop.has_value())
+            return new Error(prop.error(), ErrorMessage("Could not spawn {}", ITEMS[item]));
+    }
+    return std::nullopt;
+}
 
-    glm::mat4 transformMatrix = glm::translate(glm::mat4{1.0f}, glm::vec3(x, y, z));
+bool Spawner::absorb(Object prop, Object ball, const glm::mat4& localTransform) {
+    // Contacts of the same step may report the prop again after it went back to the pool
+    watch_ptr<RigidBodyComponent> body = prop.getComponent<RigidBodyComponent>();
+    watch_ptr<RenderObject> render = prop.getComponent<RenderObject>();
+    if (!body || !render || !body->isSimulated()) return false;
 
-    std::string name = items[_index];
-    _index = (_index + 1) % 3;
-    fmt::println("New obj {}: {} {} {}", name, x, y, z);
+    for (std::optional<ObjectPool>& pool: _pools) {
+        const SpawnTemplate& spawn = pool->getTemplate();
+        if (spawn.mesh != render->mesh || spawn.material != render->material) continue;
 
-    Object plane = _scene->addRenderObject(name).value();
-    watch_ptr<TransformComponent> planeTransform = plane.addComponent<TransformComponent>(transformMatrix);
-    JPH::ShapeRefC planeShape = JPH::BoxShapeSettings(JPH::Vec3(1.f, 1.f, 1.f)).Create().Get();
-    watch_ptr<RigidBodyComponent> backRigid = plane.addComponent<RigidBodyComponent>(planeShape, planeTransform, RigidBodyType::Dynamic);
-    backRigid->createAndAdd();
+        Object proxy = _scene->addEmptyObject();
+        proxy.addComponent<TransformComponent>(prop.getComponent<TransformComponent>()->getMatrix());
+        proxy.addComponent<RenderObject>(spawn.mesh, spawn.material);
+        watch_ptr<HierarchyComponent> hierarchy = proxy.getComponent<HierarchyComponent>();
+        hierarchy->setLocalTransform(localTransform);
+        hierarchy->setParent(ball);
 
-}
\ No newline at end of file
+        pool->release(prop.getID());
+        return true;
+    }
+    return false;
+}
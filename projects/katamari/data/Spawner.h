@@ -1,27 +1,33 @@
 #pragma once
 
+#include <array>
+#include <optional>
+
 #include "src/vector.h"
 #include "src/scene.h"
+#include "src/objects/objectpool.h"
 
 class Spawner {
 public:
-    Spawner(Scene* scene): _scene(scene) {
-        items[0] = LIGHT;
-        // items[1] = WOLF;
-        items[1] = TREE;
-        items[2] = MAIL;
-    };
+    Spawner(Scene* scene): _scene(scene) {};
 
-    const char* LIGHT = "lighthouse";
-    // const char* WOLF = "wolf";
-    const char* TREE = "tree";
-    const char* MAIL = "mailbox";
+    static constexpr const char* LIGHT = "lighthouse";
+    // static constexpr const char* WOLF = "wolf";
+    static constexpr const char* TREE = "tree";
+    static constexpr const char* MAIL = "mailbox";
 
-    void spawn();
+    // Fills a pool per item, call after the scene loaded its assets
+    MaybeError init(size_t poolSize, size_t poolLimit);
+    // Drops count props at random spots, cycling through the items. Items whose pool
+    // has every prop out in the level are skipped
+    MaybeError spawn(uint32_t count = 1);
+    // Sticks a copy of the prop without a body to the ball and puts the prop back into
+    // its pool. False if the prop is not one of the spawner's or was already absorbed
+    bool absorb(Object prop, Object ball, const glm::mat4& localTransform);
 private:
-    void createObject(const char* name, glm::vec3 position);
+    static constexpr std::array<const char*, 3> ITEMS = { LIGHT, TREE, MAIL };
 
-    int _index = 0;
+    size_t _index = 0;
     Scene* _scene;
-    const char* items[3];
+    std::array<std::optional<ObjectPool>, ITEMS.size()> _pools;
 };
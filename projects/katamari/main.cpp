@@ -5,6 +5,7 @@
 
 int main(int argc, char* argv[]) {
 	VulkanEngine engine;
+	engine.setSettings(EngineSettings::fromArgs(argc, argv));
 
 	KatamariScene scene;
 	engine.setScene(&scene);
@@ -0,0 +1,44 @@
+#include <cstdlib>
+#include <iostream>
+#include <string_view>
+
+#include "src/vk_engine.h"
+#include "scenes/LightsScene.h"
+
+int main(int argc, char* argv[]) {
+	VulkanEngine engine;
+	engine.setSettings(EngineSettings::fromArgs(argc, argv));
+
+	// --lights <count> sets the number of moving point lights
+	uint32_t lightCount = 4096;
+	for (int i = 1; i + 1 < argc; i++) {
+		if (std::string_view(argv[i]) == "--lights")
+			lightCount = std::strtoul(argv[i + 1], nullptr, 10);
+	}
+
+	LightsScene scene(lightCount);
+	engine.setScene(&scene);
+
+	Physics::prepareJolt();
+
+	auto init = engine.init();
+
+	if (init.has_value()) {
+		std::cerr << "Engine initialization failed:\n" << init.value()->what() << "\n";
+		delete init.value();
+		return 1;
+	}
+
+	auto run = engine.run();
+
+	if (run.has_value()) {
+		std::cerr << "Engine runtime error:\n" << run.value()->what() << "\n";
+		delete run.value();
+	}
+	
+	engine.cleanup();	
+
+	PhysicsMan.destroy();
+
+	return 0;
+}
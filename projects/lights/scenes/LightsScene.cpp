@@ -0,0 +1,131 @@
+#include "LightsScene.h"
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#include "src/error.h"
+#include "src/meshes/sphere.h"
+#include "src/objects/components/freecamera.h"
+#include "src/objects/components/tag.h"
+#include "src/random.h"
+#include "src/vk_engine.h"
+
+constexpr int FIELD_SIZE = 20;
+constexpr float FIELD_SPACING = 8.f;
+constexpr float LIGHT_RADIUS = 8.f;
+constexpr float LIGHT_INTENSITY = 4.f;
+
+tl::expected<int, Error*> LightsScene::loadMeshes(VulkanEngine* engine) {
+	Mesh planeMesh{};
+	planeMesh._vertices.resize(6);
+	planeMesh._vertices[0].position = {  200.f, 0.f,  200.f };
+	planeMesh._vertices[1].position = { -200.f, 0.f,  200.f };
+	planeMesh._vertices[2].position = { -200.f, 0.f, -200.f };
+	planeMesh._vertices[3].position = {  200.f, 0.f,  200.f };
+	planeMesh._vertices[4].position = { -200.f, 0.f, -200.f };
+	planeMesh._vertices[5].position = {  200.f, 0.f, -200.f };
+	for (Vertex& vertex: planeMesh._vertices) {
+		vertex.normal = { 0.f, 1.f, 0.f };
+		vertex.color = { 0.6f, 0.6f, 0.6f };
+	}
+
+	SphereCreator sphereFactory;
+	Mesh sphere = sphereFactory.create(2);
+	for (Vertex& vertex: sphere._vertices) vertex.color = { 0.8f, 0.8f, 0.8f };
+
+	auto uploadResult = engine->upload_mesh(planeMesh)
+	.and_then([&](int x) { return engine->upload_mesh(sphere); });
+
+	VK_UNEXPECTED_ERROR(uploadResult, "Failed to upload all used meshes")
+
+	_meshes["plane"] = planeMesh;
+	_meshes["sphere"] = sphere;
+
+	_onSceneDestruction.push_function([&]() {
+		for (auto& item: _meshes) item.second._vertexBuffer.destroy();
+	});
+
+	return 0;
+}
+
+tl::expected<int, Error*> LightsScene::initScene(VulkanEngine* engine) {
+	// Point lights should be the only noticeable light source
+	_ambientLight = glm::vec3(0.05f);
+
+	Object cameraObject = addEmptyObject();
+	cameraObject.addComponent<TagComponent>("Camera");
+	cameraObject.addComponent<TagComponent>("MAINCAM");
+	_camera = cameraObject.addComponent<Camera>(
+		glm::vec3(0.f, 40.f, -100.f),
+		glm::vec3(glm::half_pi<float>(), -0.4f, 0.f),
+		glm::vec2(1280, 1040),
+		CameraPurpose::RenderTarget);
+	_freeCamera = cameraObject.addComponent<FreeCamera>(_camera);
+
+	auto materialResult = getMaterial("defaultmesh");
+	if (!materialResult) {
+		return tl::unexpected(new Error(ErrorMessage("Could not get default material")));
+	}
+	Material* material = materialResult.value();
+
+	auto meshResult = getMesh("plane");
+	if (!meshResult) {
+		return tl::unexpected(new Error(ErrorMessage("Could not get plane mesh")));
+	}
+	Object ground = addEmptyObject();
+	ground.addComponent<TransformComponent>(glm::mat4{1.f});
+	ground.addComponent<RenderObject>(meshResult.value(), material);
+
+	meshResult = getMesh("sphere");
+	if (!meshResult) {
+		return tl::unexpected(new Error(ErrorMessage("Could not get sphere mesh")));
+	}
+	Mesh* sphereMesh = meshResult.value();
+
+	const float fieldOffset = (FIELD_SIZE - 1) * FIELD_SPACING * 0.5f;
+	for (int x = 0; x < FIELD_SIZE; x++) {
+		for (int z = 0; z < FIELD_SIZE; z++) {
+			glm::vec3 position = { x * FIELD_SPACING - fieldOffset, 2.f, z * FIELD_SPACING - fieldOffset };
+			Object sphere = addEmptyObject();
+			sphere.addComponent<TransformComponent>(glm::translate(position) * glm::scale(glm::vec3(2.f)));
+			sphere.addComponent<RenderObject>(sphereMesh, material);
+		}
+	}
+
+	_lights.reserve(_lightCount);
+	for (uint32_t i = 0; i < _lightCount; i++) {
+		MovingLight light = {
+			.distance = RandomS.randFloat(2.f, fieldOffset + FIELD_SPACING),
+			.height = RandomS.randFloat(0.5f, 6.f),
+			.speed = RandomS.randFloat(-0.5f, 0.5f),
+			.phase = RandomS.randFloat(0.f, glm::two_pi<float>())
+		};
+		// Saturated colors make overlapping lights easy to tell apart
+		glm::vec3 color = { RandomS.randFloat(0.f, 1.f), RandomS.randFloat(0.f, 1.f), RandomS.randFloat(0.f, 1.f) };
+		color /= std::max({ color.r, color.g, color.b, 1e-3f });
+
+		Object lightObject = addEmptyObject();
+		light.transform = lightObject.addComponent<TransformComponent>(glm::mat4{1.f});
+		lightObject.addComponent<PointLight>(color, LIGHT_INTENSITY, LIGHT_RADIUS);
+		_lights.push_back(light);
+	}
+
+	return 0;
+}
+
+MaybeError LightsScene::update(float delta) {
+	MaybeError sceneResult = Scene::update(delta);
+	if (sceneResult.has_value()) return sceneResult;
+	_freeCamera->update(delta);
+
+	_time += delta;
+	for (MovingLight& light: _lights) {
+		const float angle = light.phase + light.speed * _time;
+		const glm::vec3 position = { std::cos(angle) * light.distance, light.height, std::sin(angle) * light.distance };
+		light.transform->setMatrix(glm::translate(position));
+	}
+	return std::nullopt;
+}
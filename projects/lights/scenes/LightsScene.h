@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+
+#include "src/error.h"
+#include "src/scene.h"
+#include "src/watchptr.h"
+#include "src/objects/components/freecamera.h"
+
+/*!
+ * \brief Stress scene for clustered lighting
+ *
+ * A field of spheres lit by a configurable number of small point lights circling
+ * around the origin. Run with --stats to see how frame time scales with the light count.
+ */
+class LightsScene: public Scene {
+public:
+    LightsScene(uint32_t lightCount): _lightCount(lightCount) {};
+    ~LightsScene() {};
+
+private:
+    struct MovingLight {
+        watch_ptr<TransformComponent> transform;
+        float distance;
+        float height;
+        float speed;
+        float phase;
+    };
+
+    uint32_t _lightCount;
+    float _time = 0.f;
+    watch_ptr<Camera> _camera;
+    watch_ptr<FreeCamera> _freeCamera;
+    std::vector<MovingLight> _lights;
+
+    tl::expected<int, Error*> loadMeshes(VulkanEngine* engine) override;
+
+    tl::expected<int, Error*> initScene(VulkanEngine* engine) override;
+
+    MaybeError update(float delta) override;
+};
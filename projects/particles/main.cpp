@@ -1,9 +1,29 @@
+#include <cstdlib>
 #include <iostream>
+#include <string_view>
 
 #include "src/vk_engine.h"
+#include "scenes/ParticlesScene.h"
 
 int main(int argc, char* argv[]) {
 	VulkanEngine engine;
+	EngineSettings settings = EngineSettings::fromArgs(argc, argv);
+	// The scene is pointless without particles, --particles <count> overrides this
+	if (settings.particleCapacity == 0)
+		settings.particleCapacity = 1 << 20;
+	engine.setSettings(settings);
+
+	// --emitters <count> splits the capacity between that many fountains
+	uint32_t emitterCount = 16;
+	for (int i = 1; i + 1 < argc; i++) {
+		if (std::string_view(argv[i]) == "--emitters")
+			emitterCount = std::strtoul(argv[i + 1], nullptr, 10);
+	}
+
+	ParticlesScene scene(emitterCount);
+	engine.setScene(&scene);
+
+	Physics::prepareJolt();
 
 	auto init = engine.init();
 
@@ -22,5 +42,7 @@ int main(int argc, char* argv[]) {
 	
 	engine.cleanup();	
 
+	PhysicsMan.destroy();
+
 	return 0;
 }
@@ -0,0 +1,123 @@
+#include "ParticlesScene.h"
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#include "src/error.h"
+#include "src/meshes/sphere.h"
+#include "src/objects/components/freecamera.h"
+#include "src/objects/components/tag.h"
+#include "src/random.h"
+#include "src/vk_engine.h"
+
+constexpr float RING_RADIUS = 30.f;
+constexpr float PARTICLE_LIFETIME = 4.f;
+
+tl::expected<int, Error*> ParticlesScene::loadMeshes(VulkanEngine* engine) {
+	Mesh planeMesh{};
+	planeMesh._vertices.resize(6);
+	planeMesh._vertices[0].position = {  100.f, 0.f,  100.f };
+	planeMesh._vertices[1].position = { -100.f, 0.f,  100.f };
+	planeMesh._vertices[2].position = { -100.f, 0.f, -100.f };
+	planeMesh._vertices[3].position = {  100.f, 0.f,  100.f };
+	planeMesh._vertices[4].position = { -100.f, 0.f, -100.f };
+	planeMesh._vertices[5].position = {  100.f, 0.f, -100.f };
+	for (Vertex& vertex: planeMesh._vertices) {
+		vertex.normal = { 0.f, 1.f, 0.f };
+		vertex.color = { 0.4f, 0.4f, 0.45f };
+	}
+
+	SphereCreator sphereFactory;
+	Mesh sphere = sphereFactory.create(2);
+	for (Vertex& vertex: sphere._vertices) vertex.color = { 0.7f, 0.7f, 0.7f };
+
+	auto uploadResult = engine->upload_mesh(planeMesh)
+	.and_then([&](int x) { return engine->upload_mesh(sphere); });
+
+	VK_UNEXPECTED_ERROR(uploadResult, "Failed to upload all used meshes")
+
+	_meshes["plane"] = planeMesh;
+	_meshes["sphere"] = sphere;
+
+	_onSceneDestruction.push_function([&]() {
+		for (auto& item: _meshes) item.second._vertexBuffer.destroy();
+	});
+
+	return 0;
+}
+
+tl::expected<int, Error*> ParticlesScene::initScene(VulkanEngine* engine) {
+	Object cameraObject = addEmptyObject();
+	cameraObject.addComponent<TagComponent>("Camera");
+	cameraObject.addComponent<TagComponent>("MAINCAM");
+	_camera = cameraObject.addComponent<Camera>(
+		glm::vec3(0.f, 30.f, -80.f),
+		glm::vec3(glm::half_pi<float>(), -0.35f, 0.f),
+		glm::vec2(1280, 1040),
+		CameraPurpose::RenderTarget);
+	_freeCamera = cameraObject.addComponent<FreeCamera>(_camera);
+
+	auto materialResult = getMaterial("defaultmesh");
+	if (!materialResult) {
+		return tl::unexpected(new Error(ErrorMessage("Could not get default material")));
+	}
+	Material* material = materialResult.value();
+
+	auto meshResult = getMesh("plane");
+	if (!meshResult) {
+		return tl::unexpected(new Error(ErrorMessage("Could not get plane mesh")));
+	}
+	Object ground = addEmptyObject();
+	ground.addComponent<TransformComponent>(glm::mat4{1.f});
+	ground.addComponent<RenderObject>(meshResult.value(), material);
+
+	meshResult = getMesh("sphere");
+	if (!meshResult) {
+		return tl::unexpected(new Error(ErrorMessage("Could not get sphere mesh")));
+	}
+	Mesh* sphereMesh = meshResult.value();
+
+	// Something for the spray to land on besides the ground
+	for (int i = 0; i < 8; i++) {
+		const float angle = i * glm::two_pi<float>() / 8;
+		glm::vec3 position = { std::cos(angle) * RING_RADIUS * 0.5f, 3.f, std::sin(angle) * RING_RADIUS * 0.5f };
+		Object sphere = addEmptyObject();
+		sphere.addComponent<TransformComponent>(glm::translate(position) * glm::scale(glm::vec3(3.f)));
+		sphere.addComponent<RenderObject>(sphereMesh, material);
+	}
+
+	const uint32_t emitterCount = std::clamp(_emitterCount, 1u, MAX_PARTICLE_EMITTERS);
+	const uint32_t capacity = engine->_particles.getCapacity();
+	// Spawning the whole budget once per lifetime keeps every emitter saturated
+	const uint32_t budget = std::max(capacity / emitterCount, 1u);
+	for (uint32_t i = 0; i < emitterCount; i++) {
+		const float angle = i * glm::two_pi<float>() / emitterCount;
+		const glm::vec3 position = { std::cos(angle) * RING_RADIUS, 0.5f, std::sin(angle) * RING_RADIUS };
+
+		Object emitterObject = addEmptyObject();
+		emitterObject.addComponent<TransformComponent>(glm::translate(position));
+		watch_ptr<ParticleEmitter> emitter = emitterObject.addComponent<ParticleEmitter>(budget / PARTICLE_LIFETIME, budget);
+		emitter->lifetime = PARTICLE_LIFETIME;
+		emitter->size = 0.15f;
+		emitter->spawnRadius = 0.5f;
+		// Aim inwards so the fountains rain onto the spheres
+		emitter->velocity = glm::vec3(-std::cos(angle) * 6.f, 14.f, -std::sin(angle) * 6.f);
+		emitter->velocitySpread = 3.f;
+		glm::vec3 color = { RandomS.randFloat(0.f, 1.f), RandomS.randFloat(0.f, 1.f), RandomS.randFloat(0.f, 1.f) };
+		color /= std::max({ color.r, color.g, color.b, 1e-3f });
+		// Additive blending saturates quickly with this many particles
+		emitter->color = glm::vec4(color, 0.25f);
+	}
+
+	return 0;
+}
+
+MaybeError ParticlesScene::update(float delta) {
+	MaybeError sceneResult = Scene::update(delta);
+	if (sceneResult.has_value()) return sceneResult;
+	_freeCamera->update(delta);
+	return std::nullopt;
+}
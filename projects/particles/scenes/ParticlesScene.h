@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+
+#include "src/error.h"
+#include "src/scene.h"
+#include "src/watchptr.h"
+#include "src/objects/components/freecamera.h"
+
+/*!
+ * \brief Benchmark scene for GPU particles
+ *
+ * A ring of fountains sprays particles over a ground plane and a few blocks they bounce off
+ * through the depth buffer. Particle capacity comes from --particles, every emitter gets an
+ * equal share of it as its budget.
+ */
+class ParticlesScene: public Scene {
+public:
+    ParticlesScene(uint32_t emitterCount): _emitterCount(emitterCount) {};
+    ~ParticlesScene() {};
+
+private:
+    uint32_t _emitterCount;
+    watch_ptr<Camera> _camera;
+    watch_ptr<FreeCamera> _freeCamera;
+
+    tl::expected<int, Error*> loadMeshes(VulkanEngine* engine) override;
+
+    tl::expected<int, Error*> initScene(VulkanEngine* engine) override;
+
+    MaybeError update(float delta) override;
+};
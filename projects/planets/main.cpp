@@ -5,6 +5,7 @@
 
 int main(int argc, char* argv[]) {
 	VulkanEngine engine;
+	engine.setSettings(EngineSettings::fromArgs(argc, argv));
 
 	PlanetScene scene;
 	engine.setScene(&scene);
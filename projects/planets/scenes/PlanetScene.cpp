@@ -254,7 +254,8 @@ tl::expected<int, Error*> PlanetScene::initScene(VulkanEngine* engine) {
 }
 
 MaybeError PlanetScene::update(float delta) {
-    Scene::update(delta);
+    MaybeError sceneResult = Scene::update(delta);
+    if (sceneResult.has_value()) return sceneResult;
 	// Orbit* orbit = _sphere.getComponent<Orbit>();
 	for (auto & entity: getHierarchyOrderedObjects()) {
 		Object item = getObject(entity);
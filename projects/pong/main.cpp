@@ -6,6 +6,7 @@
 
 int main(int argc, char* argv[]) {
 	VulkanEngine engine;
+	engine.setSettings(EngineSettings::fromArgs(argc, argv));
 
 	PongScene scene;
 	engine.setScene(&scene);
@@ -306,7 +306,7 @@ tl::expected<int, Error*> PongScene::initScene(VulkanEngine* engine) {
 	paddleController->createAndAdd();
 	_controller1.init(paddleController.get(), Events::kKeyLeft, Events::kKeyRight, Events::kKeyUp, Events::kKeyDown, "LEFT");
 	RenderObject br = RenderObject(_ball, ballMesh, material);
-	Physics::ContactCallback paddleCall = [br, this](const JPH::Body &inBody1, const JPH::Body &inBody2, const JPH::ContactManifold &inManifold, const JPH::ContactSettings &ioSettings) {
+	Physics::ContactCallback paddleCall = [br, this](const JPH::Body &inBody1, const JPH::Body &inBody2, const Physics::Contact &contact) {
 		const JPH::BodyID ballID = _ball.getComponent<RigidBodyComponent>()->getID();
 		if (ballID == inBody2.GetID())
 			_ball.addComponent<RenderObject>(br.mesh, br.material);
@@ -344,7 +344,7 @@ tl::expected<int, Error*> PongScene::initScene(VulkanEngine* engine) {
 	}
 	ballMesh = meshResult.value();
 	RenderObject otherRender = RenderObject(_ball, ballMesh, material);
-	paddleCall = [otherRender, this](const JPH::Body &inBody1, const JPH::Body &inBody2, const JPH::ContactManifold &inManifold, const JPH::ContactSettings &ioSettings) {
+	paddleCall = [otherRender, this](const JPH::Body &inBody1, const JPH::Body &inBody2, const Physics::Contact &contact) {
 		const JPH::BodyID ballID = _ball.getComponent<RigidBodyComponent>()->getID();
 		if (ballID == inBody2.GetID())
 			_ball.addComponent<RenderObject>(otherRender.mesh, otherRender.material);
@@ -375,7 +375,8 @@ tl::expected<int, Error*> PongScene::initScene(VulkanEngine* engine) {
 }
 
 MaybeError PongScene::update(float delta) {
-    Scene::update(delta);
+    MaybeError sceneResult = Scene::update(delta);
+    if (sceneResult.has_value()) return sceneResult;
 	_controller1.update(delta);
 	_controller2.update(delta);
 	_ballObject.update(delta);
@@ -0,0 +1,140 @@
+#include <Jolt/Jolt.h>
+#include <Jolt/Physics/Collision/Shape/BoxShape.h>
+#include <Jolt/Physics/Collision/Shape/SphereShape.h>
+
+#include <fmt/format.h>
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "src/material.h"
+#include "src/physics/physicsman.h"
+#include "src/profiling/profiler.h"
+#include "src/random.h"
+#include "src/vk_mesh.h"
+#include "src/objects/level.h"
+#include "src/objects/object.h"
+#include "src/objects/snapshot.h"
+#include "src/objects/components/hierarchy.h"
+#include "src/objects/components/render.h"
+#include "src/objects/components/rigidbody.h"
+#include "src/objects/components/shadowcaster.h"
+#include "src/objects/components/tag.h"
+#include "src/objects/components/transform.h"
+
+// Headless comparison of building a level in code against loading its snapshot.
+// Usage: snapshotbench [object count] [snapshot path]
+// Meshes are never uploaded, both paths only reference them.
+
+namespace {
+
+const char* ASSETS[] = { "tree", "mailbox", "monkey" };
+
+float millisecondsSince(Profiling::Clock::time_point start) {
+	return std::chrono::duration<float, std::milli>(Profiling::Clock::now() - start).count();
+}
+
+// Same steps as the scenes' initScene: a shape per object, then a body added right away
+MaybeError buildLevel(Level& level, Mesh* meshes, Material* materials, uint32_t count) {
+	Object ground = level.addObject();
+	ground.addComponent<HierarchyComponent>();
+	ground.addComponent<TagComponent>("GROUND");
+	watch_ptr<TransformComponent> groundTransform = ground.addComponent<TransformComponent>(glm::mat4{1.f});
+	JPH::ShapeRefC groundShape = JPH::BoxShapeSettings(JPH::Vec3(1000.f, .1f, 1000.f)).Create().Get();
+	watch_ptr<RigidBodyComponent> groundBody = ground.addComponent<RigidBodyComponent>(groundShape, groundTransform, RigidBodyType::Static);
+	if (auto result = groundBody->createAndAdd(); result) return result;
+
+	entt::entity previous = entt::null;
+	for (uint32_t i = 0; i < count; i++) {
+		const uint32_t asset = i % std::size(ASSETS);
+		const glm::vec3 position(randFloat(-150.f, 150.f), 7.5f, randFloat(-150.f, 150.f));
+
+		Object object = level.addObject();
+		watch_ptr<HierarchyComponent> hierarchy = object.addComponent<HierarchyComponent>();
+		watch_ptr<TransformComponent> transform = object.addComponent<TransformComponent>(glm::translate(glm::mat4{1.f}, position));
+		object.addComponent<RenderObject>(&meshes[asset], &materials[asset]);
+		object.addComponent<ShadowCaster>();
+
+		// Every fourth object rides on the one before it, like items stuck to the katamari
+		if (i % 4 == 3 && previous != entt::null) {
+			hierarchy->setLocalTransform(glm::translate(glm::mat4{1.f}, glm::vec3(0.f, 1.f, 0.f)));
+			hierarchy->setParent(object.another(previous));
+			continue;
+		}
+		if (i % 16 == 0) object.addComponent<TagComponent>(fmt::format("ITEM{}", i));
+
+		JPH::ShapeRefC shape = i % 2 == 0
+			? JPH::BoxShapeSettings(JPH::Vec3(1.f, 1.f, 1.f)).Create().Get()
+			: JPH::SphereShapeSettings(1.f).Create().Get();
+		watch_ptr<RigidBodyComponent> body = object.addComponent<RigidBodyComponent>(shape, transform, RigidBodyType::Dynamic);
+		if (auto result = body->createAndAdd(); result) return result;
+		previous = object.getID();
+	}
+	return std::nullopt;
+}
+
+} // End of anonymous namespace
+
+int main(int argc, char* argv[]) {
+	const uint32_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+	const std::string path = argc > 2 ? argv[2] : "snapshotbench.bin";
+
+	Physics::prepareJolt();
+
+	Mesh meshes[std::size(ASSETS)];
+	Material materials[std::size(ASSETS)];
+	Snapshot::AssetTable assets;
+	for (size_t i = 0; i < std::size(ASSETS); i++) {
+		assets.addMesh(ASSETS[i], &meshes[i]);
+		assets.addMaterial(ASSETS[i], &materials[i]);
+	}
+
+	float buildTime, saveTime, loadTime;
+	size_t builtObjects, loadedObjects;
+	{
+		Level level;
+		Profiling::Clock::time_point start = Profiling::Clock::now();
+		auto built = buildLevel(level, meshes, materials, count);
+		buildTime = millisecondsSince(start);
+		if (built) {
+			std::cerr << "Building the level failed:\n" << built.value()->what() << "\n";
+			delete built.value();
+			return 1;
+		}
+		builtObjects = level._registry.view<HierarchyComponent>().size();
+
+		start = Profiling::Clock::now();
+		auto saved = Snapshot::save(level, assets, path);
+		saveTime = millisecondsSince(start);
+		if (saved) {
+			std::cerr << "Saving the snapshot failed:\n" << saved.value()->what() << "\n";
+			delete saved.value();
+			return 1;
+		}
+	}
+	{
+		Level level;
+		Profiling::Clock::time_point start = Profiling::Clock::now();
+		auto loaded = Snapshot::load(level, assets, path);
+		loadTime = millisecondsSince(start);
+		if (!loaded) {
+			std::cerr << "Loading the snapshot failed:\n" << loaded.error()->what() << "\n";
+			delete loaded.error();
+			return 1;
+		}
+		loadedObjects = level._registry.view<HierarchyComponent>().size();
+	}
+
+	fmt::println("objects: {} built, {} loaded", builtObjects, loadedObjects);
+	fmt::println("procedural build: {:.2f} ms", buildTime);
+	fmt::println("snapshot save:    {:.2f} ms", saveTime);
+	fmt::println("snapshot load:    {:.2f} ms ({:.1f}x faster)", loadTime, buildTime / std::max(loadTime, 1e-3f));
+
+	PhysicsMan.destroy();
+
+	return builtObjects == loadedObjects ? 0 : 1;
+}
@@ -0,0 +1,109 @@
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "src/profiling/profiler.h"
+#include "src/timer.h"
+
+// Microbenchmark of TimerStorage with many active timers, against the linear scan it replaced.
+// Usage: timerbench [timer count] [frames]
+
+namespace {
+
+// The previous TimerStorage: every timer is visited each update, then fired ones are erased
+class LinearTimers {
+public:
+	void addTimer(float time, TimerCallback&& onTimer) { _timers.push_back({ time, std::move(onTimer) }); };
+	void update(float delta) {
+		std::vector<Error *> errors{};
+		for (auto item = _timers.rbegin(); item != _timers.rend(); item++) {
+			if (item->time < delta) {
+				item->time = 0;
+				std::optional<Error *> error = item->onTimer();
+				if (error) errors.push_back(error.value());
+			} else {
+				item->time -= delta;
+			}
+		}
+		_timers.erase(std::remove_if(_timers.begin(), _timers.end(), [](const Timer& o) { return o.time <= 0; }), _timers.end());
+	};
+private:
+	std::vector<Timer> _timers;
+};
+
+struct Result {
+	float addMilliseconds;
+	float updateMilliseconds;
+	float worstUpdateMilliseconds;
+	uint64_t fired;
+};
+
+float millisecondsSince(Profiling::Clock::time_point start) {
+	return std::chrono::duration<float, std::milli>(Profiling::Clock::now() - start).count();
+}
+
+// Timers run out over two minutes, so about half of them fire during the default minute of frames (3600 at 60 fps)
+template<typename Storage>
+Result run(Storage& storage, uint32_t count, uint32_t frames) {
+	constexpr float FRAME = 1.f / 60.f;
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> delays(0.1f, 120.f);
+	Result result {};
+
+	Profiling::Clock::time_point start = Profiling::Clock::now();
+	for (uint32_t i = 0; i < count; i++) {
+		storage.addTimer(delays(random), [&result]() -> MaybeError { result.fired++; return std::nullopt; });
+	}
+	result.addMilliseconds = millisecondsSince(start);
+
+	for (uint32_t frame = 0; frame < frames; frame++) {
+		start = Profiling::Clock::now();
+		storage.update(FRAME);
+		const float milliseconds = millisecondsSince(start);
+		result.updateMilliseconds += milliseconds;
+		result.worstUpdateMilliseconds = std::max(result.worstUpdateMilliseconds, milliseconds);
+	}
+	return result;
+}
+
+void print(const char* name, const Result& result, uint32_t frames) {
+	fmt::println("{}: add {:.2f} ms, update {:.4f} ms/frame (worst {:.4f} ms), {} fired",
+		name, result.addMilliseconds, result.updateMilliseconds / frames, result.worstUpdateMilliseconds, result.fired);
+}
+
+} // End of anonymous namespace
+
+int main(int argc, char* argv[]) {
+	const uint32_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+	const uint32_t frames = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 3600;
+
+	TimerStorage wheel;
+	wheel.reserve(count);
+	const Result wheelResult = run(wheel, count, frames);
+
+	// Cancelling through handles, on a fresh set of timers
+	TimerStorage cancelled;
+	cancelled.reserve(count);
+	std::vector<TimerHandle> handles;
+	handles.reserve(count);
+	for (uint32_t i = 0; i < count; i++)
+		handles.push_back(cancelled.addTimer(60.f, []() -> MaybeError { return std::nullopt; }));
+	Profiling::Clock::time_point start = Profiling::Clock::now();
+	for (TimerHandle handle: handles)
+		cancelled.cancelTimer(handle);
+	const float cancelMilliseconds = millisecondsSince(start);
+
+	LinearTimers linear;
+	const Result linearResult = run(linear, count, frames);
+
+	fmt::println("{} timers over {} frames", count, frames);
+	print("timing wheel", wheelResult, frames);
+	print("linear scan ", linearResult, frames);
+	fmt::println("cancel all: {:.2f} ms", cancelMilliseconds);
+
+	return 0;
+}
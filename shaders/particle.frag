@@ -0,0 +1,14 @@
+#version 450
+
+layout (location = 0) in vec4 inColor;
+layout (location = 1) in vec2 inCorner;
+
+layout (location = 0) out vec4 outFragColor;
+
+void main() {
+	// Soft disc, blending is additive so the color is premultiplied here
+	float falloff = 1.0 - dot(inCorner, inCorner);
+	if (falloff <= 0.0)
+		discard;
+	outFragColor = vec4(inColor.rgb * inColor.a * falloff, 1.0);
+}
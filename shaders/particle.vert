@@ -0,0 +1,39 @@
+#version 450
+
+layout (location = 0) out vec4 outColor;
+layout (location = 1) out vec2 outCorner;
+
+layout(set = 0, binding = 0) uniform CameraBuffer {
+	mat4 view;
+	mat4 proj;
+	mat4 viewproj;
+} cameraData;
+
+struct Particle {
+	vec4 positionLife; // w - remaining life in seconds
+	vec4 velocitySize; // w - billboard size
+	vec4 color;
+	uint emitter;
+	float lifetime;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer ParticleBuffer {
+	Particle particles[];
+} particleBuffer;
+
+const vec2 CORNERS[6] = vec2[](vec2(-1, -1), vec2(1, -1), vec2(1, 1), vec2(-1, -1), vec2(1, 1), vec2(-1, 1));
+
+void main() {
+	Particle particle = particleBuffer.particles[gl_InstanceIndex];
+	vec2 corner = CORNERS[gl_VertexIndex];
+
+	// Camera axes in world space are the rows of the view matrix
+	vec3 right = vec3(cameraData.view[0][0], cameraData.view[1][0], cameraData.view[2][0]);
+	vec3 up = vec3(cameraData.view[0][1], cameraData.view[1][1], cameraData.view[2][1]);
+	vec3 position = particle.positionLife.xyz + (right * corner.x + up * corner.y) * particle.velocitySize.w;
+
+	float fade = clamp(particle.positionLife.w / max(particle.lifetime, 1e-4), 0.0, 1.0);
+	outColor = vec4(particle.color.rgb, particle.color.a * fade);
+	outCorner = corner;
+	gl_Position = cameraData.viewproj * vec4(position, 1.0);
+}
@@ -0,0 +1,21 @@
+#version 460
+
+layout (location = 0) in vec3 vPosition;
+
+struct ObjectData {
+	mat4 model;
+};
+
+//all object matrices
+layout(std140, set = 0, binding = 0) readonly buffer ObjectBuffer{
+	ObjectData objects[];
+} objectBuffer;
+
+layout( push_constant ) uniform constants {
+	mat4 lightViewproj;
+} PushConstants;
+
+void main() {
+	mat4 modelMatrix = objectBuffer.objects[gl_BaseInstance].model;
+	gl_Position = PushConstants.lightViewproj * modelMatrix * vec4(vPosition, 1.f);
+}
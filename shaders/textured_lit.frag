@@ -4,6 +4,8 @@
 //shader input
 layout (location = 0) in vec3 inColor;
 layout (location = 1) in vec2 texCoord;
+layout (location = 2) in vec3 inPosition;
+layout (location = 3) in vec3 inNormal;
 //output write
 layout (location = 0) out vec4 outFragColor;
 
@@ -15,10 +17,108 @@ layout(set = 0, binding = 1) uniform  SceneData{
 	vec4 sunlightColor;
 } sceneData;
 
+layout(set = 0, binding = 2) uniform ShadowData {
+	mat4 cascadeViewproj[4];
+	vec4 texelSizes;
+	vec4 params; // x - cascade count (0 disables shadows), y - normal offset in texels
+} shadowData;
+
+layout(set = 0, binding = 3) uniform sampler2DArrayShadow shadowMap;
+
+float sunShadow(vec3 position, vec3 normal)
+{
+	int cascadeCount = int(shadowData.params.x);
+	for (int i = 0; i < cascadeCount; i++) {
+		vec3 offsetPosition = position + normal * shadowData.texelSizes[i] * shadowData.params.y;
+		vec4 lightPosition = shadowData.cascadeViewproj[i] * vec4(offsetPosition, 1.0f);
+		vec2 uv = lightPosition.xy * 0.5f + 0.5f;
+		// Take the finest cascade that has a border around the point
+		if (any(lessThan(uv, vec2(0.01f))) || any(greaterThan(uv, vec2(0.99f))) || lightPosition.z > 1.0f)
+			continue;
+
+		vec2 texel = 1.0f / vec2(textureSize(shadowMap, 0).xy);
+		float lit = 0.0f;
+		for (int x = -1; x <= 1; x++) {
+			for (int y = -1; y <= 1; y++) {
+				lit += texture(shadowMap, vec4(uv + vec2(x, y) * texel, i, lightPosition.z));
+			}
+		}
+		return lit / 9.0f;
+	}
+	return 1.0f;
+}
+
+vec3 sunLight(vec3 position, vec3 normal)
+{
+	float diffuse = max(dot(normal, -sceneData.sunlightDirection.xyz), 0.0f);
+	float shadow = diffuse > 0.0f ? sunShadow(position, normal) : 0.0f;
+	return sceneData.ambientColor.xyz + sceneData.sunlightColor.xyz * sceneData.sunlightDirection.w * diffuse * shadow;
+}
+
 layout(set = 2, binding = 0) uniform sampler2D tex1;
 
+const uvec3 GRID_SIZE = uvec3(16, 9, 24);
+const uint MAX_LIGHTS_PER_CLUSTER = 128;
+
+layout(set = 0, binding = 4) uniform ClusterParams {
+	mat4 view;
+	mat4 inverseProj;
+	vec4 tileSize; // xy - tile size in pixels, zw - framebuffer size
+	vec4 depthSlices; // x - slice scale, y - slice bias, z - near, w - far
+	uvec4 lightCount;
+} clusterData;
+
+struct PointLight {
+	vec4 positionRadius;
+	vec4 color; // w is for intensity
+};
+
+layout(std430, set = 0, binding = 5) readonly buffer LightBuffer {
+	PointLight lights[];
+} lightBuffer;
+
+layout(std430, set = 0, binding = 6) readonly buffer LightGrid {
+	uint counts[];
+} lightGrid;
+
+layout(std430, set = 0, binding = 7) readonly buffer LightIndices {
+	uint indices[];
+} lightIndices;
+
+vec3 pointLights(vec3 position, vec3 normal)
+{
+	float depth = -(clusterData.view * vec4(position, 1.0f)).z;
+	if (depth < clusterData.depthSlices.z || depth > clusterData.depthSlices.w)
+		return vec3(0.0f);
+
+	uint slice = min(uint(max(log(depth) * clusterData.depthSlices.x + clusterData.depthSlices.y, 0.0f)), GRID_SIZE.z - 1);
+	uvec2 tile = min(uvec2(gl_FragCoord.xy / clusterData.tileSize.xy), GRID_SIZE.xy - 1);
+	uint cluster = tile.x + GRID_SIZE.x * (tile.y + GRID_SIZE.y * slice);
+
+	vec3 result = vec3(0.0f);
+	uint count = lightGrid.counts[cluster];
+	for (uint i = 0; i < count; i++) {
+		PointLight light = lightBuffer.lights[lightIndices.indices[cluster * MAX_LIGHTS_PER_CLUSTER + i]];
+		vec3 toLight = light.positionRadius.xyz - position;
+		float distanceSquared = dot(toLight, toLight);
+		float radiusSquared = light.positionRadius.w * light.positionRadius.w;
+		if (distanceSquared >= radiusSquared)
+			continue;
+
+		// Inverse square falloff windowed to reach zero at the radius
+		float window = 1.0f - (distanceSquared * distanceSquared) / (radiusSquared * radiusSquared);
+		float attenuation = window * window / (distanceSquared + 1.0f);
+		float diffuse = max(dot(normal, toLight * inversesqrt(max(distanceSquared, 1e-6f))), 0.0f);
+		result += light.color.rgb * light.color.w * diffuse * attenuation;
+	}
+	return result;
+}
+
 void main() 
 {
 	vec3 color = texture(tex1,texCoord).xyz;
-	outFragColor = vec4(color,1.0f);
+	// Some procedural meshes come without normals
+	vec3 normal = dot(inNormal, inNormal) > 0.0f ? normalize(inNormal) : vec3(0.0f);
+	vec3 light = sunLight(inPosition, normal) + pointLights(inPosition, normal);
+	outFragColor = vec4(color * light,1.0f);
 }
\ No newline at end of file
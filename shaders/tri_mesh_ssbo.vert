@@ -7,6 +7,8 @@ layout (location = 3) in vec2 vTexCoord;
 
 layout (location = 0) out vec3 outColor;
 layout (location = 1) out vec2 texCoord;
+layout (location = 2) out vec3 worldPosition;
+layout (location = 3) out vec3 worldNormal;
 
 layout(set = 0, binding = 0) uniform CameraBuffer {   
     mat4 view;
@@ -38,5 +40,7 @@ void main() {
 
 	// outColor = (vNormal + vec3(1.0f, 1.0f, 1.0f)) / 2.0f;
 	texCoord = vTexCoord;
+	worldPosition = (modelMatrix * vec4(vPosition, 1.f)).xyz;
+	worldNormal = mat3(modelMatrix) * vNormal;
 	gl_Position = transformMatrix * vec4(vPosition, 1.f);
 }
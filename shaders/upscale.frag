@@ -0,0 +1,16 @@
+#version 450
+
+layout (location = 0) in vec2 inUV;
+
+layout (location = 0) out vec4 outFragColor;
+
+layout(set = 0, binding = 0) uniform sampler2D sceneColor;
+
+layout( push_constant ) uniform constants {
+	vec2 uvScale; // Rendered part of the scene target
+	vec2 uvMax; // Keeps bilinear taps inside of it
+} params;
+
+void main() {
+	outFragColor = vec4(texture(sceneColor, min(inUV * params.uvScale, params.uvMax)).rgb, 1.0);
+}
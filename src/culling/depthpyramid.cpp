@@ -0,0 +1,246 @@
+#include "depthpyramid.h"
+
+#include <algorithm>
+
+#include "src/devicesingleton.h"
+#include "src/vk_initializers.h"
+#include "src/vk_operations.h"
+#include "src/vmalloc.h"
+
+namespace Culling {
+
+struct ReduceConstants {
+	uint32_t inputSize[2];
+	uint32_t outputSize[2];
+};
+
+tl::expected<delFunc, VulkanError*> DepthPyramid::init(VkShaderModule reduceShader) {
+	VkDescriptorPoolSize sizes[] = {
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_LEVELS },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, MAX_LEVELS }
+	};
+	VkDescriptorPoolCreateInfo poolInfo = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.maxSets = MAX_LEVELS,
+		.poolSizeCount = std::size(sizes),
+		.pPoolSizes = sizes
+	};
+	auto poolResult = vkcommand::createDescriptorPool(&poolInfo);
+	VK_UNEXPECTED_ERROR(poolResult, "Failed to create descriptor pool for depth pyramid");
+	_descriptorPool = poolResult.value();
+
+	VkDescriptorSetLayoutBinding bindings[] = {
+		vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT, 0),
+		vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT, 1)
+	};
+	VkDescriptorSetLayoutCreateInfo setInfo = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.bindingCount = std::size(bindings),
+		.pBindings = bindings
+	};
+	auto layoutResult = vkcommand::createDescriptorSetLayout(&setInfo);
+	VK_UNEXPECTED_ERROR(layoutResult, "Failed to create descriptor set layout for depth pyramid");
+	_setLayout = layoutResult.value();
+
+	VkPushConstantRange pushConstants = {
+		.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+		.offset = 0,
+		.size = sizeof(ReduceConstants)
+	};
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.setLayoutCount = 1,
+		.pSetLayouts = &_setLayout,
+		.pushConstantRangeCount = 1,
+		.pPushConstantRanges = &pushConstants
+	};
+	auto pipeLayoutResult = vkcommand::createPipelineLayout(pipelineLayoutInfo);
+	VK_UNEXPECTED_ERROR(pipeLayoutResult, "Failed to create depth reduction pipeline layout");
+	_pipelineLayout = pipeLayoutResult.value();
+
+	VkComputePipelineCreateInfo pipelineInfo = {
+		.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.stage = {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			.pNext = nullptr,
+			.flags = 0,
+			.stage = VK_SHADER_STAGE_COMPUTE_BIT,
+			.module = reduceShader,
+			.pName = "main"
+		},
+		.layout = _pipelineLayout
+	};
+	auto pipelineResult = vkcommand::createComputePipeline(VK_NULL_HANDLE, pipelineInfo);
+	VK_UNEXPECTED_ERROR(pipelineResult, "Failed to create depth reduction pipeline");
+	_pipeline = pipelineResult.value();
+
+	// Exact texel reads of a given level; the culling shader picks levels with textureLod
+	VkSamplerCreateInfo samplerInfo = vkinit::createinfo::sampler(VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+	auto samplerResult = vkcommand::createSampler(samplerInfo);
+	VK_UNEXPECTED_ERROR(samplerResult, "Failed to create depth pyramid sampler");
+	_sampler = samplerResult.value();
+
+	return [=]() {
+		vkDestroySampler(DeviceRef(), _sampler, nullptr);
+		vkDestroyPipeline(DeviceRef(), _pipeline, nullptr);
+		vkDestroyPipelineLayout(DeviceRef(), _pipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(DeviceRef(), _setLayout, nullptr);
+		vkDestroyDescriptorPool(DeviceRef(), _descriptorPool, nullptr);
+	};
+}
+
+tl::expected<delFunc, VulkanError*> DepthPyramid::create(VkExtent2D depthExtent, VkImageView depthView) {
+	_depthExtent = depthExtent;
+	_extent = { std::max(depthExtent.width / 2, 1u), std::max(depthExtent.height / 2, 1u) };
+
+	_levelExtents.clear();
+	VkExtent2D levelExtent = _extent;
+	while (_levelExtents.size() < MAX_LEVELS) {
+		_levelExtents.push_back(levelExtent);
+		if (levelExtent.width == 1 && levelExtent.height == 1)
+			break;
+		levelExtent = { std::max(levelExtent.width / 2, 1u), std::max(levelExtent.height / 2, 1u) };
+	}
+	const uint32_t levelCount = _levelExtents.size();
+
+	VkImageCreateInfo imageInfo = vkinit::createinfo::image(VK_FORMAT_R32_SFLOAT,
+		VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT, VkExtent3D{ _extent.width, _extent.height, 1 });
+	imageInfo.mipLevels = levelCount;
+	auto imageResult = VMAlloc.createImage(VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT), VMA_MEMORY_USAGE_GPU_ONLY, imageInfo);
+	VK_UNEXPECTED_ERROR(imageResult, "Failed to create depth pyramid image");
+	_image = imageResult.value();
+
+	VkImageViewCreateInfo viewInfo = vkinit::createinfo::imageView(VK_FORMAT_R32_SFLOAT, _image._image, VK_IMAGE_ASPECT_COLOR_BIT);
+	viewInfo.subresourceRange.levelCount = levelCount;
+	auto viewResult = vkcommand::createImageView(viewInfo);
+	VK_UNEXPECTED_ERROR(viewResult, "Failed to create depth pyramid view");
+	_fullView = viewResult.value();
+
+	_levelViews.resize(levelCount);
+	_levelSets.resize(levelCount);
+	for (uint32_t level = 0; level < levelCount; level++) {
+		viewInfo.subresourceRange.baseMipLevel = level;
+		viewInfo.subresourceRange.levelCount = 1;
+		viewResult = vkcommand::createImageView(viewInfo);
+		VK_UNEXPECTED_ERROR(viewResult, "Failed to create depth pyramid view for level {}", level);
+		_levelViews[level] = viewResult.value();
+
+		auto setResult = vkcommand::allocateDescriptorSet(_descriptorPool, _setLayout);
+		VK_UNEXPECTED_ERROR(setResult, "Failed to allocate depth pyramid descriptor for level {}", level);
+		_levelSets[level] = setResult.value();
+
+		VkDescriptorImageInfo inputInfo = {
+			.sampler = _sampler,
+			.imageView = level == 0 ? depthView : _levelViews[level - 1],
+			.imageLayout = level == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL
+		};
+		VkDescriptorImageInfo outputInfo = {
+			.sampler = VK_NULL_HANDLE,
+			.imageView = _levelViews[level],
+			.imageLayout = VK_IMAGE_LAYOUT_GENERAL
+		};
+		VkWriteDescriptorSet writes[] = {
+			vkinit::write_descriptor_image(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, _levelSets[level], &inputInfo, 0),
+			vkinit::write_descriptor_image(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, _levelSets[level], &outputInfo, 1)
+		};
+		vkUpdateDescriptorSets(DeviceRef(), std::size(writes), writes, 0, nullptr);
+	}
+
+	_layoutReady = false;
+	_valid = false;
+
+	return [=]() {
+		vkResetDescriptorPool(DeviceRef(), _descriptorPool, 0);
+		for (VkImageView view: _levelViews)
+			vkDestroyImageView(DeviceRef(), view, nullptr);
+		vkDestroyImageView(DeviceRef(), _fullView, nullptr);
+		_image.destroy();
+	};
+}
+
+void DepthPyramid::prepare(VkCommandBuffer cmd) {
+	if (_layoutReady) return;
+
+	VkImageMemoryBarrier barrier = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.pNext = nullptr,
+		.srcAccessMask = 0,
+		.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+		.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+		.newLayout = VK_IMAGE_LAYOUT_GENERAL,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = _image._image,
+		.subresourceRange = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 0,
+			.levelCount = VK_REMAINING_MIP_LEVELS,
+			.baseArrayLayer = 0,
+			.layerCount = 1
+		}
+	};
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	_layoutReady = true;
+}
+
+void DepthPyramid::build(VkCommandBuffer cmd, VkExtent2D depthExtent) {
+	prepare(cmd);
+
+	VkImageMemoryBarrier barrier = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.pNext = nullptr,
+		// The previous contents were read by the culling pass
+		.srcAccessMask = VK_ACCESS_SHADER_READ_BIT,
+		.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+		.oldLayout = VK_IMAGE_LAYOUT_GENERAL,
+		.newLayout = VK_IMAGE_LAYOUT_GENERAL,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = _image._image,
+		.subresourceRange = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 0,
+			.levelCount = VK_REMAINING_MIP_LEVELS,
+			.baseArrayLayer = 0,
+			.layerCount = 1
+		}
+	};
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline);
+
+	VkExtent2D inputExtent = { std::min(depthExtent.width, _depthExtent.width), std::min(depthExtent.height, _depthExtent.height) };
+	for (uint32_t level = 0; level < _levelSets.size(); level++) {
+		const VkExtent2D outputExtent = _levelExtents[level];
+		ReduceConstants constants = {
+			{ inputExtent.width, inputExtent.height },
+			{ outputExtent.width, outputExtent.height }
+		};
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _pipelineLayout, 0, 1, &_levelSets[level], 0, nullptr);
+		vkCmdPushConstants(cmd, _pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ReduceConstants), &constants);
+		vkCmdDispatch(cmd, (outputExtent.width + 7) / 8, (outputExtent.height + 7) / 8, 1);
+
+		// Next level (and the culling pass after the last one) reads what was just written
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.subresourceRange.baseMipLevel = level;
+		barrier.subresourceRange.levelCount = 1;
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		inputExtent = outputExtent;
+	}
+
+	_valid = true;
+}
+
+} // End of namespace Culling
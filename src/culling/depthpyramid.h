@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+#include <expected.hpp>
+#include <glm/vec2.hpp>
+
+#include <vector>
+
+#include "src/allocstructs.h"
+#include "src/deletionqueue.h"
+#include "src/error.h"
+
+namespace Culling {
+
+/*!
+ * \brief Max-depth mip chain of the depth buffer, built in compute
+ *
+ * Level 0 is half the size of the depth buffer, every next level halves it again
+ * (rounding down) and keeps the farthest depth of the texels it covers.
+ */
+class DepthPyramid {
+public:
+	static constexpr uint32_t MAX_LEVELS = 16;
+
+	// Engine-lifetime objects: reduction pipeline, sampler and descriptor pool
+	tl::expected<delFunc, VulkanError*> init(VkShaderModule reduceShader);
+	// Swapchain-lifetime objects: the pyramid itself, sized after the depth buffer
+	tl::expected<delFunc, VulkanError*> create(VkExtent2D depthExtent, VkImageView depthView);
+
+	// Moves a freshly created pyramid into the layout the culling shader expects
+	void prepare(VkCommandBuffer cmd);
+	// Depth buffer has to be in VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL.
+	// Only its top-left depthExtent part is reduced, the pyramid always covers the whole view
+	void build(VkCommandBuffer cmd, VkExtent2D depthExtent);
+
+	// False until the first build after creation
+	bool isValid() const { return _valid; };
+	VkImageView getView() const { return _fullView; };
+	VkSampler getSampler() const { return _sampler; };
+	glm::vec2 getSize() const { return glm::vec2(_extent.width, _extent.height); };
+private:
+	VkPipeline _pipeline;
+	VkPipelineLayout _pipelineLayout;
+	VkDescriptorSetLayout _setLayout;
+	VkDescriptorPool _descriptorPool;
+	VkSampler _sampler;
+
+	AllocatedImage _image;
+	VkImageView _fullView;
+	std::vector<VkImageView> _levelViews;
+	std::vector<VkDescriptorSet> _levelSets;
+	std::vector<VkExtent2D> _levelExtents;
+	VkExtent2D _depthExtent;
+	VkExtent2D _extent;
+	bool _layoutReady = false;
+	bool _valid = false;
+};
+
+} // End of namespace Culling
@@ -0,0 +1,136 @@
+#include "occlusionculler.h"
+
+#include "src/devicesingleton.h"
+#include "src/gpustructs.h"
+#include "src/vk_initializers.h"
+#include "src/vk_operations.h"
+#include "src/vmalloc.h"
+#include "src/profiling/stats.h"
+
+namespace Culling {
+
+tl::expected<delFunc, VulkanError*> OcclusionCuller::init(VkShaderModule cullShader) {
+	VkDescriptorSetLayoutBinding bindings[] = {
+		vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 0),
+		vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1),
+		vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 2),
+		vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 3),
+		vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 4),
+		vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 5),
+		vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT, 6),
+		vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 7),
+		vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 8)
+	};
+	VkDescriptorSetLayoutCreateInfo setInfo = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.bindingCount = std::size(bindings),
+		.pBindings = bindings
+	};
+	auto layoutResult = vkcommand::createDescriptorSetLayout(&setInfo);
+	VK_UNEXPECTED_ERROR(layoutResult, "Failed to create descriptor set layout for culling");
+	_setLayout = layoutResult.value();
+
+	VkPushConstantRange pushConstants = {
+		.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+		.offset = 0,
+		.size = sizeof(uint32_t)
+	};
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.setLayoutCount = 1,
+		.pSetLayouts = &_setLayout,
+		.pushConstantRangeCount = 1,
+		.pPushConstantRanges = &pushConstants
+	};
+	auto pipeLayoutResult = vkcommand::createPipelineLayout(pipelineLayoutInfo);
+	VK_UNEXPECTED_ERROR(pipeLayoutResult, "Failed to create culling pipeline layout");
+	_pipelineLayout = pipeLayoutResult.value();
+
+	VkComputePipelineCreateInfo pipelineInfo = {
+		.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.stage = {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			.pNext = nullptr,
+			.flags = 0,
+			.stage = VK_SHADER_STAGE_COMPUTE_BIT,
+			.module = cullShader,
+			.pName = "main"
+		},
+		.layout = _pipelineLayout
+	};
+	auto pipelineResult = vkcommand::createComputePipeline(VK_NULL_HANDLE, pipelineInfo);
+	VK_UNEXPECTED_ERROR(pipelineResult, "Failed to create culling pipeline");
+	_pipeline = pipelineResult.value();
+
+	return [=]() {
+		vkDestroyPipeline(DeviceRef(), _pipeline, nullptr);
+		vkDestroyPipelineLayout(DeviceRef(), _pipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(DeviceRef(), _setLayout, nullptr);
+	};
+}
+
+void OcclusionCuller::dispatch(VkCommandBuffer cmd, Frame& frame, uint32_t objectCount, uint32_t latePass) {
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _pipelineLayout, 0, 1, &frame.cullDescriptor, 0, nullptr);
+	vkCmdPushConstants(cmd, _pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t), &latePass);
+	vkCmdDispatch(cmd, (objectCount + 63) / 64, 1, 1);
+
+	// Draw lists are consumed by indirect draws, and the late list also by the late phase
+	VkMemoryBarrier barrier = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.pNext = nullptr,
+		.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+	};
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void OcclusionCuller::cullEarly(VkCommandBuffer cmd, Frame& frame, uint32_t objectCount) {
+	vkCmdFillBuffer(cmd, frame.cullStatsBuffer._buffer, 0, sizeof(GPUCullStats), 0);
+	VkMemoryBarrier barrier = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.pNext = nullptr,
+		.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+	};
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	dispatch(cmd, frame, objectCount, 0);
+	frame.cullStatsReady = true;
+}
+
+void OcclusionCuller::cullLate(VkCommandBuffer cmd, Frame& frame, uint32_t objectCount) {
+	dispatch(cmd, frame, objectCount, 1);
+
+	// Results are read on the host once the frame fence is signaled
+	VkMemoryBarrier barrier = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.pNext = nullptr,
+		.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_HOST_READ_BIT
+	};
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+MaybeVulkanError OcclusionCuller::collectStats(Frame& frame) {
+	if (!frame.cullStatsReady) return {};
+
+	auto mapResult = VMAlloc.mapBuffer(frame.cullStatsBuffer);
+	VK_OPTIONAL_ERROR(mapResult, "Could not map culling statistics buffer");
+	const GPUCullStats stats = *static_cast<GPUCullStats*>(mapResult.value());
+	VMAlloc.unmapBuffer(frame.cullStatsBuffer);
+
+	StatsMan.set(Profiling::Counter::FrustumCulled, stats.frustumCulled);
+	StatsMan.set(Profiling::Counter::OcclusionRetested, stats.earlyOccluded);
+	StatsMan.set(Profiling::Counter::OcclusionCulled, stats.lateOccluded);
+	return {};
+}
+
+} // End of namespace Culling
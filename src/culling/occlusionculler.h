@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+#include <expected.hpp>
+
+#include "src/deletionqueue.h"
+#include "src/error.h"
+#include "src/frame.h"
+
+namespace Culling {
+
+/*!
+ * \brief Two-phase GPU frustum and occlusion culling
+ *
+ * The early phase tests every object against the depth pyramid of the previous frame and
+ * writes draws for the visible ones. Objects it rejects are re-tested by the late phase
+ * against the pyramid rebuilt from the early pass depth, so objects that got disoccluded
+ * this frame are still drawn (in the late pass).
+ *
+ * Surviving draws are appended to the range of their GPUDrawBatch, whose counts feed
+ * vkCmdDrawIndirectCount, so culled objects cost neither draws nor command buffer space.
+ */
+class OcclusionCuller {
+public:
+	tl::expected<delFunc, VulkanError*> init(VkShaderModule cullShader);
+
+	VkDescriptorSetLayout getSetLayout() const { return _setLayout; };
+
+	// Must be recorded outside of a render pass, before the early pass
+	void cullEarly(VkCommandBuffer cmd, Frame& frame, uint32_t objectCount);
+	// Must be recorded outside of a render pass, after the depth pyramid was built
+	void cullLate(VkCommandBuffer cmd, Frame& frame, uint32_t objectCount);
+
+	// Hands the statistics of the last finished submission of the frame over to the stats registry
+	MaybeVulkanError collectStats(Frame& frame);
+private:
+	void dispatch(VkCommandBuffer cmd, Frame& frame, uint32_t objectCount, uint32_t latePass);
+
+	VkDescriptorSetLayout _setLayout;
+	VkPipelineLayout _pipelineLayout;
+	VkPipeline _pipeline;
+};
+
+} // End of namespace Culling
@@ -21,6 +21,7 @@
 #ifndef OPENAWE_EVENT_H
 #define OPENAWE_EVENT_H
 
+#include <cstdint>
 #include <variant>
 
 #include <glm/glm.hpp>
@@ -60,6 +61,31 @@ struct Event {
 	EventData data;
 };
 
+/*!
+ * Kind of raw input an InputEvent comes from, picks the binding table its input is looked up in
+ */
+enum InputSource : uint8_t {
+	kSourceKey,
+	kSourceMouseButton,
+	kSourceMouse2DAxis,
+	kSourceMouse1DAxis,
+	kSourceGamepadButton,
+	kSourceGamepad2DAxis,
+	kSourceGamepad1DAxis
+};
+
+/*!
+ * A raw input waiting in the event queue, before it is mapped to an action
+ */
+struct InputEvent {
+	InputSource source;
+	// Key, button or axis enum value
+	uint32_t input;
+	// Key modifiers, zero for every other source
+	uint32_t modifiers;
+	EventData data;
+};
+
 }
 
 #endif //OPENAWE_EVENT_H
@@ -25,21 +25,20 @@
 namespace Events {
 
 void EventListener::bindCallbacks() {
-    for (auto callback = _listenerCallbacks.begin(); callback != _listenerCallbacks.end(); callback++)
-        EventMan.setActionCallback({ callback->first }, *(callback->second));
+    if (_isListening) return;
+    for (const ListenerCallback& callback: _listenerCallbacks)
+        _handles.push_back(EventMan.setActionCallback(callback.actions, callback.callback));
     _isListening = true;
 }
 
 void EventListener::addActionCallback(const std::initializer_list<uint32_t>& actions, EventCallback& callback) {
-	EventCallback* callAddress = &callback;
-	for (const auto &action: actions) {
-		_listenerCallbacks.insert(std::make_pair(action, callAddress));
-	}
+	_listenerCallbacks.push_back(ListenerCallback{ std::vector<uint32_t>(actions), callback });
 }
 
 void EventListener::unbindCallbacks() {
-    for (auto callback = _listenerCallbacks.begin(); callback != _listenerCallbacks.end(); callback++)
-        EventMan.removeActionCallback(callback->first, callback->second);
+    for (const CallbackHandle handle: _handles)
+        EventMan.removeActionCallback(handle);
+    _handles.clear();
     _isListening = false;
 }
 
@@ -36,8 +36,15 @@ public:
     void unbindCallbacks();
     bool isListening();
 private:
+    struct ListenerCallback {
+        std::vector<uint32_t> actions;
+        EventCallback callback;
+    };
+
     bool _isListening = false;
-    std::multimap<uint32_t, EventCallback*> _listenerCallbacks;
+    std::vector<ListenerCallback> _listenerCallbacks;
+    // Handles of the callbacks while they are bound
+    std::vector<CallbackHandle> _handles;
 };
 
 } // End of namespace Events
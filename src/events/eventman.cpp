@@ -23,183 +23,302 @@
 #include "src/events/key.h"
 #include "src/events/mouse.h"
 
+#include <algorithm>
 #include <cstdint>
 
 namespace Events {
 
-inline void EventManager::invokeCallbacks(const EventData data, const uint32_t action) {
-	const Event event{action, data};
-	auto callbacks = _actionCallbacks.equal_range(action);
-	while (callbacks.first != callbacks.second) {
-		EventCallback action = ((callbacks.first)->second);
-		action(event);
-		callbacks.first++;
-	};
+EventManager::EventManager() {
+	_keyBindings.fill(NO_ACTION);
+	_mouseBindings.fill(NO_ACTION);
+	_gamepadBindings.fill(NO_ACTION);
+	_mouse2DAxisBindings.fill(NO_ACTION);
+	_mouse1DAxisBindings.fill(NO_ACTION);
+	_gamepad2DAxisBindings.fill(NO_ACTION);
+	_gamepad1DAxisBindings.fill(NO_ACTION);
 }
 
-void EventManager::injectKeyboardInput(const Events::Key key, const Events::KeyState state, const uint32_t modifiers) {
-	fmt::println("Key inject code: {}", static_cast<int>(key));
-	KeyCombination combination = std::make_pair(key, modifiers);
-	const auto action = _keyBindings.map()->find(combination);
-	if (action == _keyBindings.map()->cend()) return;
+size_t EventManager::keyIndex(const Key key, const uint32_t modifiers) {
+	return static_cast<size_t>(key) * (kModifierAll + 1) + (modifiers & kModifierAll);
+}
 
-	invokeCallbacks(KeyEvent{state}, action->second);
+void EventManager::queueEvent(const InputEvent& event) {
+	// Mouse moves arrive many times per frame, consecutive ones of the same axis are merged into one
+	if (_queueSize > 0 && (event.source == kSourceMouse2DAxis || event.source == kSourceGamepad2DAxis)) {
+		InputEvent& last = _queue[(_queueStart + _queueSize - 1) % EVENT_QUEUE_SIZE];
+		if (last.source == event.source && last.input == event.input) {
+			auto& merged = std::get<AxisEvent<glm::vec2>>(last.data);
+			const auto& added = std::get<AxisEvent<glm::vec2>>(event.data);
+			merged.absolute = added.absolute;
+			merged.delta += added.delta;
+			return;
+		}
+	}
+	if (_queueSize == EVENT_QUEUE_SIZE) return;
+
+	_queue[(_queueStart + _queueSize) % EVENT_QUEUE_SIZE] = event;
+	_queueTimes[(_queueStart + _queueSize) % EVENT_QUEUE_SIZE] = std::chrono::steady_clock::now();
+	_queueSize++;
 }
 
-void EventManager::injectMouseButtonInput(const Events::MouseButton mouse, const Events::KeyState state) {
-	const auto action = _mouseBindings.map()->find(mouse);
-	if (action == _mouseBindings.map()->cend()) return;
+void EventManager::injectKeyboardInput(const Events::Key key, const Events::KeyState state, const uint32_t modifiers) {
+	queueEvent(InputEvent{kSourceKey, static_cast<uint32_t>(key), modifiers, KeyEvent{state}});
+}
 
-	invokeCallbacks(KeyEvent{state}, action->second);
+void EventManager::injectMouseButtonInput(const Events::MouseButton mouse, const Events::KeyState state) {
+	queueEvent(InputEvent{kSourceMouseButton, static_cast<uint32_t>(mouse), 0, KeyEvent{state}});
 }
 
 void EventManager::injectGamepadButtonInput(const Events::GamepadButton button, const Events::KeyState state) {
-	const auto action = _gamepadBindings.map()->find(button);
-	if (action == _gamepadBindings.map()->cend()) return;
-
-	invokeCallbacks(KeyEvent{state}, action->second);
+	queueEvent(InputEvent{kSourceGamepadButton, static_cast<uint32_t>(button), 0, KeyEvent{state}});
 }
 
 void EventManager::injectMouse2DAxisInput(const Events::Mouse2DAxis axis, const glm::vec2 position, const glm::vec2 delta) {
-	const auto action = _mouse2DAxisBindings.map()->find(axis);
-	if (action == _mouse2DAxisBindings.map()->cend()) return;
-
-	invokeCallbacks(AxisEvent<glm::vec2>{position, delta}, action->second);
+	queueEvent(InputEvent{kSourceMouse2DAxis, static_cast<uint32_t>(axis), 0, AxisEvent<glm::vec2>{position, delta}});
 }
 
 void EventManager::injectMouse1DAxisInput(const Events::Mouse1DAxis axis, const float position, const float delta) {
-	const auto action = _mouse1DAxisBindings.map()->find(axis);
-	if (action == _mouse1DAxisBindings.map()->cend()) return;
-
-	invokeCallbacks(AxisEvent<float>{position, delta}, action->second);
+	queueEvent(InputEvent{kSourceMouse1DAxis, static_cast<uint32_t>(axis), 0, AxisEvent<float>{position, delta}});
 }
 
 void EventManager::injectGamepad2DAxisInput(const Events::Gamepad2DAxis axis, const glm::vec2 position, const glm::vec2 delta) {
-	const auto action = _gamepad2DAxisBindings.map()->find(axis);
-	if (action == _gamepad2DAxisBindings.map()->cend()) return;
-
-	invokeCallbacks(AxisEvent<glm::vec2>{position, delta}, action->second);
+	queueEvent(InputEvent{kSourceGamepad2DAxis, static_cast<uint32_t>(axis), 0, AxisEvent<glm::vec2>{position, delta}});
 }
 
 void EventManager::injectGamepad1DAxisInput(const Events::Gamepad1DAxis axis, const double position, const double delta) {
-	const auto action = _gamepad1DAxisBindings.map()->find(axis);
-	if (action == _gamepad1DAxisBindings.map()->cend()) return;
+	queueEvent(InputEvent{kSourceGamepad1DAxis, static_cast<uint32_t>(axis), 0, AxisEvent<double>{position, delta}});
+}
+
+void EventManager::dispatchEvents() {
+	_dispatching = true;
+	// Only what was queued so far, callbacks injecting input cannot keep the loop going
+	const size_t count = _queueSize;
+	for (size_t i = 0; i < count; i++) {
+		invokeCallbacks(_queue[_queueStart]);
+		_queueStart = (_queueStart + 1) % EVENT_QUEUE_SIZE;
+		_queueSize--;
+	}
+	_dispatching = false;
 
-	invokeCallbacks(AxisEvent<double>{position, delta}, action->second);
+	for (uint32_t index: _removedCallbacks)
+		releaseCallback(index);
+	_removedCallbacks.clear();
 }
 
-EventCallback* EventManager::setActionCallback(const std::initializer_list<uint32_t>& actions, EventCallback callback) {
-	EventCallback* callAddress = &callback;
-	for (const auto &action: actions) {
-		// (*callAddress)(Event{action, KeyEvent{ Events::kPress }});
-		_actionCallbacks.insert(std::make_pair(action, callback));
+void EventManager::clearEvents() {
+	_queueStart = 0;
+	_queueSize = 0;
+}
+
+std::optional<uint32_t> EventManager::boundAction(const InputEvent& input) const {
+	switch (input.source) {
+		case kSourceKey:
+			if (input.input > kKeyLast) return std::nullopt;
+			return boundAction(_keyBindings, keyIndex(static_cast<Key>(input.input), input.modifiers));
+		case kSourceMouseButton: return boundAction(_mouseBindings, input.input);
+		case kSourceMouse2DAxis: return boundAction(_mouse2DAxisBindings, input.input);
+		case kSourceMouse1DAxis: return boundAction(_mouse1DAxisBindings, input.input);
+		case kSourceGamepadButton: return boundAction(_gamepadBindings, input.input);
+		case kSourceGamepad2DAxis: return boundAction(_gamepad2DAxisBindings, input.input);
+		case kSourceGamepad1DAxis: return boundAction(_gamepad1DAxisBindings, input.input);
 	}
+	return std::nullopt;
+}
 
-	return callAddress;
+glm::vec2 EventManager::queuedAxisDelta(const uint32_t action) const {
+	glm::vec2 delta(0.f);
+	for (size_t i = 0; i < _queueSize; i++) {
+		const InputEvent& event = queuedEvent(i);
+		const auto* axis = std::get_if<AxisEvent<glm::vec2>>(&event.data);
+		if (axis == nullptr) continue;
+		const std::optional<uint32_t> bound = boundAction(event);
+		if (bound && _actions[bound.value()].hash == action) delta += axis->delta;
+	}
+	return delta;
 }
 
-void EventManager::removeActionCallback(const uint32_t& action, const EventCallback* callbackAddress) {
-	auto range = _actionCallbacks.equal_range(action);
-	
-	for (auto rIter = range.first; rIter != range.second; rIter++) {
-		if (&rIter->second == callbackAddress) {
-			_actionCallbacks.erase(rIter);
-			return;
-		}
+std::optional<std::chrono::steady_clock::time_point> EventManager::oldestQueuedTime(const InputSource source, const std::chrono::steady_clock::time_point after) const {
+	for (size_t i = 0; i < _queueSize; i++) {
+		const size_t index = (_queueStart + i) % EVENT_QUEUE_SIZE;
+		if (_queue[index].source == source && _queueTimes[index] > after) return _queueTimes[index];
 	}
+	return std::nullopt;
+}
+
+void EventManager::invokeCallbacks(const InputEvent& input) {
+	const std::optional<uint32_t> action = boundAction(input);
+	if (!action) return;
 
-	// TODO: not working, need a rewrite (maybe)
+	const Event event{_actions[action.value()].hash, input.data};
+	// Callbacks set from within a callback only get the next event, removed ones are skipped
+	const size_t count = _actions[action.value()].callbacks.size();
+	for (size_t i = 0; i < count; i++) {
+		Callback& callback = _callbacks[_actions[action.value()].callbacks[i]];
+		if (callback.active) callback.callback(event);
+	}
+}
+
+uint32_t EventManager::actionIndex(const uint32_t hash) {
+	auto found = _actionIndices.find(hash);
+	if (found != _actionIndices.end()) return found->second;
+
+	const uint32_t index = _actions.size();
+	_actions.push_back(Action{hash, {}, {}});
+	_actionIndices.emplace(hash, index);
+	return index;
+}
+
+CallbackHandle EventManager::setActionCallback(const std::initializer_list<uint32_t>& actions, EventCallback callback) {
+	return setActionCallback(std::span<const uint32_t>(actions.begin(), actions.size()), std::move(callback));
+}
+
+CallbackHandle EventManager::setActionCallback(std::span<const uint32_t> actions, EventCallback callback) {
+	uint32_t index;
+	if (_freeCallbacks.empty()) {
+		index = _callbacks.size();
+		_callbacks.emplace_back();
+	} else {
+		index = _freeCallbacks.back();
+		_freeCallbacks.pop_back();
+	}
+
+	Callback& slot = _callbacks[index];
+	slot.callback = std::move(callback);
+	slot.active = true;
+	for (const uint32_t hash: actions) {
+		const uint32_t action = actionIndex(hash);
+		slot.actions.push_back(action);
+		_actions[action].callbacks.push_back(index);
+	}
+	return CallbackHandle{index, slot.generation};
+}
+
+void EventManager::removeActionCallback(const CallbackHandle handle) {
+	if (handle.index >= _callbacks.size()) return;
+	Callback& slot = _callbacks[handle.index];
+	if (!slot.active || slot.generation != handle.generation) return;
+
+	slot.active = false;
+	// The callback may be the one running right now, it has to stay alive until the dispatch is over
+	if (_dispatching)
+		_removedCallbacks.push_back(handle.index);
+	else
+		releaseCallback(handle.index);
+}
+
+void EventManager::releaseCallback(const uint32_t index) {
+	Callback& slot = _callbacks[index];
+	for (const uint32_t action: slot.actions) {
+		std::vector<uint32_t>& callbacks = _actions[action].callbacks;
+		callbacks.erase(std::find(callbacks.begin(), callbacks.end(), index));
+	}
+	slot.actions.clear();
+	slot.callback = nullptr;
+	slot.generation++;
+	_freeCallbacks.push_back(index);
+}
+
+uint32_t EventManager::bindAction(const std::string& action) {
+	const uint32_t hash = Common::crc32(action);
+	const uint32_t index = actionIndex(hash);
+	_actions[index].name = action;
+	return index;
+}
+
+template<size_t N>
+uint32_t EventManager::bind(BindingTable<N>& table, size_t input, const std::string& action) {
+	if (input >= N) return 0;
+	const uint32_t index = bindAction(action);
+	table[input] = index;
+	return _actions[index].hash;
+}
+
+template<size_t N>
+std::optional<uint32_t> EventManager::boundAction(const BindingTable<N>& table, size_t input) const {
+	if (input >= N || table[input] == NO_ACTION) return std::nullopt;
+	return table[input];
 }
 
 const uint32_t EventManager::addBinding(const std::string& action, const Key& key) {
-	return _keyBindings.insert(std::make_pair(key, kNoModifier), action);
+	return bind(_keyBindings, keyIndex(key, kNoModifier), action);
 }
 
 const uint32_t EventManager::addBinding(const std::string& action, const Key& key, const uint32_t& modifiers) {
-	return _keyBindings.insert(std::make_pair(key, modifiers), action);
+	return bind(_keyBindings, keyIndex(key, modifiers), action);
 }
 
 const uint32_t EventManager::addBinding(const std::string& action, const MouseButton& mouse) {
-	return _mouseBindings.insert(mouse, action);
+	return bind(_mouseBindings, mouse, action);
 }
 
 const uint32_t EventManager::addBinding(const std::string& action, const GamepadButton& button) {
-	return _gamepadBindings.insert(button, action);
+	return bind(_gamepadBindings, button, action);
 }
 
 const uint32_t EventManager::add2DAxisBinding(const std::string& action, const Mouse2DAxis& axis) {
-	return _mouse2DAxisBindings.insert(axis, action);
+	return bind(_mouse2DAxisBindings, axis, action);
 }
 
 const uint32_t EventManager::add1DAxisBinding(const std::string& action, const Mouse1DAxis& axis) {
-	return _mouse1DAxisBindings.insert(axis, action);
+	return bind(_mouse1DAxisBindings, axis, action);
 }
 
 const uint32_t EventManager::add2DAxisBinding(const std::string& action, const Gamepad2DAxis& axis) {
-	return _gamepad2DAxisBindings.insert(axis, action);
+	return bind(_gamepad2DAxisBindings, axis, action);
 }
 
 const uint32_t EventManager::add1DAxisBinding(const std::string& action, const Gamepad1DAxis& axis) {
-	return _gamepad1DAxisBindings.insert(axis, action);
+	return bind(_gamepad1DAxisBindings, axis, action);
 }
 
 void EventManager::removeBinding(const Key& key) {
-	_keyBindings.remove(std::make_pair(key, kNoModifier));
+	_keyBindings[keyIndex(key, kNoModifier)] = NO_ACTION;
 }
 
 void EventManager::removeBinding(const Key& key, const KeyModifier& modifier) {
-	_keyBindings.remove(std::make_pair(key, modifier));
+	_keyBindings[keyIndex(key, modifier)] = NO_ACTION;
 }
 
 void EventManager::removeBinding(const MouseButton& button) {
-	_mouseBindings.remove(button);
+	if (button <= kMouseLast) _mouseBindings[button] = NO_ACTION;
 }
 
 void EventManager::removeBinding(const GamepadButton& button) {
-	_gamepadBindings.remove(button);
+	_gamepadBindings[button] = NO_ACTION;
 }
 
 void EventManager::remove1DAxisBinding(const Gamepad1DAxis& axis) {
-	_gamepad1DAxisBindings.remove(axis);
+	_gamepad1DAxisBindings[axis] = NO_ACTION;
 }
 
 void EventManager::remove1DAxisBinding(const Mouse1DAxis& axis) {
-	_mouse1DAxisBindings.remove(axis);
+	_mouse1DAxisBindings[axis] = NO_ACTION;
 }
 
 void EventManager::remove2DAxisBinding(const Gamepad2DAxis& axes) {
-	_gamepad2DAxisBindings.remove(axes);
+	_gamepad2DAxisBindings[axes] = NO_ACTION;
 }
 
 void EventManager::remove2DAxisBinding(const Mouse2DAxis& axes) {
-	_mouse2DAxisBindings.remove(axes);
+	_mouse2DAxisBindings[axes] = NO_ACTION;
 }
 
-std::pair<EventManager::ActionMap<KeyCombination>::constIter, EventManager::ActionMap<KeyCombination>::constIter> EventManager::getKeyBindings() { return _keyBindings.actionBindings(); }
+std::optional<uint32_t> EventManager::getKeyBinding(const Key& key, const uint32_t& modifiers) const {
+	const auto action = boundAction(_keyBindings, keyIndex(key, modifiers));
+	if (!action) return std::nullopt;
+	return _actions[action.value()].hash;
+}
 
-std::pair<EventManager::ActionMap<MouseButton>::constIter, EventManager::ActionMap<MouseButton>::constIter> EventManager::getMouseKeyBindings() { return _mouseBindings.actionBindings(); }
+std::optional<uint32_t> EventManager::getMouseKeyBinding(const MouseButton& button) const {
+	const auto action = boundAction(_mouseBindings, button);
+	if (!action) return std::nullopt;
+	return _actions[action.value()].hash;
+}
 
 tl::expected<const std::string, Error*> EventManager::getActionName(const uint32_t &actionHash) const {
-	if (_keyBindings.nameMapping()->find(actionHash) != _keyBindings.nameMapping()->cend()) {
-		return _keyBindings.nameMapping()->at(actionHash);
-	}
-	if (_mouseBindings.nameMapping()->find(actionHash) != _mouseBindings.nameMapping()->cend()) {
-		return _mouseBindings.nameMapping()->at(actionHash);
-	}
-	if (_mouse1DAxisBindings.nameMapping()->find(actionHash) != _mouse1DAxisBindings.nameMapping()->cend()) {
-		return _mouse1DAxisBindings.nameMapping()->at(actionHash);
-	}
-	if (_mouse2DAxisBindings.nameMapping()->find(actionHash) != _mouse2DAxisBindings.nameMapping()->cend()) {
-		return _mouse2DAxisBindings.nameMapping()->at(actionHash);
-	}
-	if (_gamepadBindings.nameMapping()->find(actionHash) != _gamepadBindings.nameMapping()->cend()) {
-		return _gamepadBindings.nameMapping()->at(actionHash);
-	}
-	if (_gamepad1DAxisBindings.nameMapping()->find(actionHash) != _gamepad1DAxisBindings.nameMapping()->cend()) {
-		return _gamepad1DAxisBindings.nameMapping()->at(actionHash);
-	}
-	if (_gamepad2DAxisBindings.nameMapping()->find(actionHash) != _gamepad2DAxisBindings.nameMapping()->cend()) {
-		return _gamepad2DAxisBindings.nameMapping()->at(actionHash);
+	auto found = _actionIndices.find(actionHash);
+	if (found != _actionIndices.cend() && !_actions[found->second].name.empty()) {
+		return _actions[found->second].name;
 	}
 	return tl::unexpected(new Error(ErrorMessage("Cannot find assigned action with hash {}", actionHash)));
 }
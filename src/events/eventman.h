@@ -21,11 +21,16 @@
 #ifndef OPENAWE_EVENTMAN_H
 #define OPENAWE_EVENTMAN_H
 
+#include <array>
+#include <chrono>
 #include <cstdint>
-#include <map>
+#include <deque>
 #include <optional>
-#include <bitset>
 #include <functional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "src/singleton.h"
 #include "src/crc32.h"
@@ -41,55 +46,40 @@ namespace Events {
 typedef std::function<void(const Event &event)> EventCallback;
 typedef std::pair<Key, uint32_t> KeyCombination;
 
+/*!
+ * Refers to a registered callback, stays safe to use after the callback was removed
+ */
+struct CallbackHandle {
+	uint32_t index = UINT32_MAX;
+	uint32_t generation = 0;
+};
+
 /*!
  * \brief Class for exchanging input
  *
  * This class is a singleton for exchanging inputs to callbacks. A real input is for example a key on the keyboard or a
  * certain axis for example the mouse position, the scroll wheel or the game controller thumb stick. These raw input
- * events are mapped to one or more abstract actions. A callback is associated with multiple actions. If an input is
- * injected using the inject* methods, the assodciated actions are retrieved and the event is passed to the callbacks
- * associated actions.
+ * events are mapped to one or more abstract actions. A callback is associated with multiple actions. Inputs injected
+ * using the inject* methods are queued, and dispatchEvents later retrieves the associated actions of each one in
+ * order and passes the event to the callbacks of those actions.
  *
  * This design was chosen to decouple raw input events from the actions and allow to change the keybindings to be
- * changed at runtime.
+ * changed at runtime. Queueing keeps callbacks out of the GLFW callbacks, so they always run at the same point of
+ * the frame. Bindings are flat tables indexed by the input enums and callbacks are kept in a pool, so dispatching
+ * neither searches maps nor allocates.
  */
 class EventManager : public Singleton<EventManager> {
 public:
-	template<typename T>
-	class ActionMap {
-	public:
-		typedef std::map<uint32_t, std::string> nameMap;
-		typedef nameMap::const_iterator nameMapConstIter;
-		typedef std::map<T, uint32_t> actionMap;
-		typedef typename actionMap::const_iterator constIter;
-
-		bool hasAction(const uint32_t &actionHash) const { return _actionNames.find(actionHash) != _actionNames.end(); };
-		const std::string actionNameFromHash(const uint32_t &actionHash) const { return _actionNames.at(actionHash); };
-
-		uint32_t insert(const T &key, const std::string &action) { 
-			const uint32_t actionHash = Common::crc32(action);
-			if (hasAction(actionHash)) return 0;
-
-			_map.insert(std::make_pair(key, actionHash)); 
-			_actionNames.insert(std::make_pair(actionHash, action));
-
-			return actionHash;
-		};
-
-		void remove(const T &key) {
-			auto action = _map.find(key);
-			_map.erase(action);
-		};
-		
-		std::pair<nameMapConstIter, nameMapConstIter> actionNames() { return std::make_pair(_actionNames.cbegin(), _actionNames.cend()); }; 
-		std::pair<constIter, constIter> actionBindings() { return std::make_pair(_map.cbegin(), _map.cend()); }; 
-
-		const actionMap* map() const { return &_map; };
-		const nameMap* nameMapping() const { return &_actionNames; };
-	private:
-		actionMap _map;
-		nameMap _actionNames;
-	};
+	// Raw inputs queued between two dispatches, later ones are dropped
+	static constexpr size_t EVENT_QUEUE_SIZE = 1024;
+	static constexpr uint32_t NO_ACTION = UINT32_MAX;
+
+	template<size_t N>
+	using BindingTable = std::array<uint32_t, N>;
+	// Every key with every combination of modifiers
+	static constexpr size_t KEY_BINDINGS = (kKeyLast + 1) * (kModifierAll + 1);
+
+	EventManager();
 
 	/*!
 	 * Inject a keyboard event to the event system
@@ -140,20 +130,44 @@ public:
 	 */
 	void injectGamepad1DAxisInput(const Gamepad1DAxis axis, const double position, const double delta);
 
+	/*!
+	 * Inject an already assembled raw input, like the ones read back from an input log
+	 * \param event The input with its source, value and modifiers
+	 */
+	void queueEvent(const InputEvent& event);
+
+	/*!
+	 * Pass every queued input to the callbacks of its action, in the order the inputs were injected.
+	 * Inputs injected by the callbacks themselves wait for the next dispatch.
+	 */
+	void dispatchEvents();
+
+	// Drops queued inputs without dispatching them
+	void clearEvents();
+	/*!
+	 * Sum of the deltas of queued 2D axis inputs bound to an action, for looking ahead before they are dispatched
+	 * \param action The action the axis is bound to
+	 */
+	glm::vec2 queuedAxisDelta(const uint32_t action) const;
+	// When the oldest queued input of a source newer than after was injected, if there is one
+	std::optional<std::chrono::steady_clock::time_point> oldestQueuedTime(const InputSource source, const std::chrono::steady_clock::time_point after) const;
+	size_t queuedEventCount() const { return _queueSize; };
+	const InputEvent& queuedEvent(size_t index) const { return _queue[(_queueStart + index) % EVENT_QUEUE_SIZE]; };
+
 	/*!
 	 * Set a callback for a set of actions
 	 * \param actions The actions, the callback is associated with
 	 * \param callback The callback, to be associated with actions
+	 * \return Handle for removing the callback again
 	 */
-	EventCallback* setActionCallback(const std::initializer_list<uint32_t>& actions, EventCallback callback);
-	//EventCallback* setActionCallback(const std::initializer_list<uint32_t>& actions, EventCallback callback);
+	CallbackHandle setActionCallback(const std::initializer_list<uint32_t>& actions, EventCallback callback);
+	CallbackHandle setActionCallback(std::span<const uint32_t> actions, EventCallback callback);
 
 	/*!
-	 * Remove a callback for an action
-	 * \param action The action, the callback is associated with
-	 * \param callback The callback, to be associated with actions
+	 * Remove a callback from all of its actions. Safe to call from within a callback, including the removed one.
+	 * \param handle The handle returned when the callback was set
 	 */
-	void removeActionCallback(const uint32_t& action, const EventCallback* callbackAddress);
+	void removeActionCallback(const CallbackHandle handle);
 
 	/*!
 	 * Associate an action with a specific keyboard key
@@ -220,24 +234,72 @@ public:
 	void remove2DAxisBinding(const Gamepad2DAxis& axes);
 	void remove2DAxisBinding(const Mouse2DAxis& axes);
 
-	std::pair<ActionMap<KeyCombination>::constIter, ActionMap<KeyCombination>::constIter> getKeyBindings();
+	/*!
+	 * Action bound to a key combination, if any
+	 */
+	std::optional<uint32_t> getKeyBinding(const Key& key, const uint32_t& modifiers = kNoModifier) const;
 
-	std::pair<ActionMap<MouseButton>::constIter, ActionMap<MouseButton>::constIter> getMouseKeyBindings();
+	/*!
+	 * Action bound to a mouse button, if any
+	 */
+	std::optional<uint32_t> getMouseKeyBinding(const MouseButton& button) const;
 
 	tl::expected<const std::string, Error*> getActionName(const uint32_t &actionHash) const;
 
 private:
-	std::multimap<uint32_t, EventCallback> _actionCallbacks;
+	struct Action {
+		uint32_t hash;
+		// Empty until the action gets bound to an input
+		std::string name;
+		// Indices into _callbacks
+		std::vector<uint32_t> callbacks;
+	};
 
-	ActionMap<KeyCombination> _keyBindings;
-	ActionMap<MouseButton> _mouseBindings;
-	ActionMap<GamepadButton> _gamepadBindings;
-	ActionMap<Mouse2DAxis> _mouse2DAxisBindings;
-	ActionMap<Mouse1DAxis> _mouse1DAxisBindings;
-	ActionMap<Gamepad2DAxis> _gamepad2DAxisBindings;
-	ActionMap<Gamepad1DAxis> _gamepad1DAxisBindings;
+	struct Callback {
+		EventCallback callback;
+		// Indices into _actions
+		std::vector<uint32_t> actions;
+		uint32_t generation = 0;
+		bool active = false;
+	};
 
-	inline void invokeCallbacks(EventData data, uint32_t action);
+	// Finds the action or registers it, returns its index into _actions
+	uint32_t actionIndex(const uint32_t hash);
+	uint32_t bindAction(const std::string& action);
+	template<size_t N>
+	uint32_t bind(BindingTable<N>& table, size_t input, const std::string& action);
+	template<size_t N>
+	std::optional<uint32_t> boundAction(const BindingTable<N>& table, size_t input) const;
+	std::optional<uint32_t> boundAction(const InputEvent& event) const;
+	static size_t keyIndex(const Key key, const uint32_t modifiers);
+
+	void invokeCallbacks(const InputEvent& event);
+	void releaseCallback(const uint32_t index);
+
+	std::vector<Action> _actions;
+	// Only used while binding, dispatch goes through the binding tables
+	std::unordered_map<uint32_t, uint32_t> _actionIndices;
+
+	// A deque keeps callbacks in place while callbacks add new ones
+	std::deque<Callback> _callbacks;
+	std::vector<uint32_t> _freeCallbacks;
+	// Callbacks removed during a dispatch, released once it is done
+	std::vector<uint32_t> _removedCallbacks;
+	bool _dispatching = false;
+
+	std::array<InputEvent, EVENT_QUEUE_SIZE> _queue;
+	// When each queued input was injected, merged inputs keep the time of the first one
+	std::array<std::chrono::steady_clock::time_point, EVENT_QUEUE_SIZE> _queueTimes;
+	size_t _queueStart = 0;
+	size_t _queueSize = 0;
+
+	BindingTable<KEY_BINDINGS> _keyBindings;
+	BindingTable<kMouseLast + 1> _mouseBindings;
+	BindingTable<kGamepadButtonLast + 1> _gamepadBindings;
+	BindingTable<kMouse2DAxisLast + 1> _mouse2DAxisBindings;
+	BindingTable<kMouse1DAxisLast + 1> _mouse1DAxisBindings;
+	BindingTable<kGamepad2DAxisLast + 1> _gamepad2DAxisBindings;
+	BindingTable<kGamepad1DAxisLast + 1> _gamepad1DAxisBindings;
 };
 
 } // End of namespace Events
@@ -51,7 +51,8 @@ enum GamepadButton {
  */
 enum Gamepad1DAxis {
 	kGamepadAxisLeftTrigger,
-	kGamepadAxisRightTrigger
+	kGamepadAxisRightTrigger,
+	kGamepad1DAxisLast = kGamepadAxisRightTrigger
 };
 
 /*!
@@ -59,7 +60,8 @@ enum Gamepad1DAxis {
  */
 enum Gamepad2DAxis {
     kGamepadAxisLeft,
-    kGamepadAxisRight
+    kGamepadAxisRight,
+    kGamepad2DAxisLast = kGamepadAxisRight
 };
 
 } // End of namespace Events
@@ -0,0 +1,179 @@
+#include "inputlog.h"
+
+#include <cstring>
+#include <span>
+#include <type_traits>
+#include <variant>
+
+#include "src/events/eventman.h"
+
+namespace Events {
+
+namespace {
+
+// Chunk written to disk at once, a few seconds of busy input
+constexpr size_t FLUSH_SIZE = 64 * 1024;
+
+// Inputs are stored with the index of their EventData alternative, the reader relies on this order
+static_assert(std::is_same_v<std::variant_alternative_t<2, EventData>, AxisEvent<glm::vec2>>);
+static_assert(std::is_same_v<std::variant_alternative_t<3, EventData>, KeyEvent>);
+
+struct LogHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t seed;
+	uint32_t reserved;
+};
+
+template<typename T>
+void append(std::vector<std::byte>& buffer, const T& value) {
+	const size_t offset = buffer.size();
+	buffer.resize(offset + sizeof(T));
+	std::memcpy(buffer.data() + offset, &value, sizeof(T));
+}
+
+template<typename T>
+bool take(std::span<const std::byte>& data, T& value) {
+	if (data.size() < sizeof(T)) return false;
+	std::memcpy(&value, data.data(), sizeof(T));
+	data = data.subspan(sizeof(T));
+	return true;
+}
+
+template<typename T>
+bool takeAxis(std::span<const std::byte>& data, EventData& event) {
+	AxisEvent<T> axis;
+	if (!take(data, axis.absolute) || !take(data, axis.delta)) return false;
+	event = axis;
+	return true;
+}
+
+} // End of anonymous namespace
+
+MaybeError InputRecorder::open(const std::string& path, uint32_t seed) {
+	_file.open(path, std::ios::binary | std::ios::trunc);
+	if (!_file.is_open()) {
+		int errorCode = _file.bad() | _file.fail() << 1 | _file.eof() << 2;
+		return new FileError(errorCode, ErrorMessage("Unable to open input log \"{}\" for writing", path));
+	}
+	_path = path;
+	_frames = 0;
+	_buffer.clear();
+	_buffer.reserve(FLUSH_SIZE + EventManager::EVENT_QUEUE_SIZE * 32);
+	append(_buffer, LogHeader{ INPUT_LOG_MAGIC, INPUT_LOG_VERSION, seed, 0 });
+	return std::nullopt;
+}
+
+MaybeError InputRecorder::recordFrame(float delta) {
+	const size_t count = EventMan.queuedEventCount();
+	append(_buffer, delta);
+	append(_buffer, static_cast<uint16_t>(count));
+	for (size_t i = 0; i < count; i++) {
+		const InputEvent& event = EventMan.queuedEvent(i);
+		append(_buffer, static_cast<uint8_t>(event.source));
+		append(_buffer, static_cast<uint8_t>(event.data.index()));
+		append(_buffer, static_cast<uint16_t>(event.input));
+		append(_buffer, static_cast<uint8_t>(event.modifiers));
+		std::visit([this](const auto& data) {
+			if constexpr (std::is_same_v<std::decay_t<decltype(data)>, KeyEvent>) {
+				append(_buffer, static_cast<uint8_t>(data.state));
+			} else {
+				append(_buffer, data.absolute);
+				append(_buffer, data.delta);
+			}
+		}, event.data);
+	}
+	_frames++;
+
+	if (_buffer.size() >= FLUSH_SIZE) return flush();
+	return std::nullopt;
+}
+
+MaybeError InputRecorder::flush() {
+	_file.write(reinterpret_cast<const char*>(_buffer.data()), _buffer.size());
+	_buffer.clear();
+	if (!_file.good()) {
+		int errorCode = _file.bad() | _file.fail() << 1 | _file.eof() << 2;
+		return new FileError(errorCode, ErrorMessage("Unable to write input log \"{}\"", _path));
+	}
+	return std::nullopt;
+}
+
+MaybeError InputRecorder::close() {
+	if (!_file.is_open()) return std::nullopt;
+	MaybeError result = flush();
+	_file.close();
+	return result;
+}
+
+tl::expected<uint32_t, Error*> InputReplay::open(const std::string& path) {
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.is_open()) {
+		int errorCode = file.bad() | file.fail() << 1 | file.eof() << 2;
+		return tl::unexpected(new FileError(errorCode, ErrorMessage("Unable to open input log \"{}\"", path)));
+	}
+	std::vector<std::byte> bytes(file.tellg());
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+	if (!file.good()) {
+		int errorCode = file.bad() | file.fail() << 1 | file.eof() << 2;
+		return tl::unexpected(new FileError(errorCode, ErrorMessage("Unable to read input log \"{}\"", path)));
+	}
+
+	std::span<const std::byte> data(bytes);
+	LogHeader header;
+	if (!take(data, header) || header.magic != INPUT_LOG_MAGIC)
+		return tl::unexpected(new Error(ErrorMessage("\"{}\" is not an input log", path)));
+	if (header.version != INPUT_LOG_VERSION)
+		return tl::unexpected(new Error(ErrorMessage("Input log \"{}\" has version {}, expected {}", path, header.version, INPUT_LOG_VERSION)));
+
+	_deltas.clear();
+	_events.clear();
+	_frameStarts.assign(1, 0);
+	_frame = 0;
+	while (!data.empty()) {
+		float delta;
+		uint16_t count;
+		if (!take(data, delta) || !take(data, count))
+			return tl::unexpected(new Error(ErrorMessage("Input log \"{}\" ends inside frame {}", path, _deltas.size())));
+		for (uint16_t i = 0; i < count; i++) {
+			uint8_t source, kind, modifiers;
+			uint16_t input;
+			if (!take(data, source) || !take(data, kind) || !take(data, input) || !take(data, modifiers))
+				return tl::unexpected(new Error(ErrorMessage("Input log \"{}\" ends inside frame {}", path, _deltas.size())));
+
+			InputEvent event{ static_cast<InputSource>(source), input, modifiers, KeyEvent{} };
+			bool complete;
+			switch (kind) {
+				case 0: complete = takeAxis<float>(data, event.data); break;
+				case 1: complete = takeAxis<double>(data, event.data); break;
+				case 2: complete = takeAxis<glm::vec2>(data, event.data); break;
+				case 3: {
+					uint8_t state;
+					complete = take(data, state);
+					event.data = KeyEvent{ static_cast<KeyState>(state) };
+					break;
+				}
+				default:
+					return tl::unexpected(new Error(ErrorMessage("Input log \"{}\" has an input of unknown kind {} in frame {}", path, kind, _deltas.size())));
+			}
+			if (!complete || source > kSourceGamepad1DAxis)
+				return tl::unexpected(new Error(ErrorMessage("Input log \"{}\" has a broken input in frame {}", path, _deltas.size())));
+			_events.push_back(event);
+		}
+		_deltas.push_back(delta);
+		_frameStarts.push_back(_events.size());
+	}
+	return header.seed;
+}
+
+std::optional<float> InputReplay::nextFrame() {
+	if (_frame >= _deltas.size()) return std::nullopt;
+
+	EventMan.clearEvents();
+	for (uint32_t i = _frameStarts[_frame]; i < _frameStarts[_frame + 1]; i++)
+		EventMan.queueEvent(_events[i]);
+	return _deltas[_frame++];
+}
+
+} // End of namespace Events
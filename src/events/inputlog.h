@@ -0,0 +1,65 @@
+#pragma once
+
+#include <expected.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "src/error.h"
+#include "src/events/event.h"
+
+namespace Events {
+
+/*!
+ * \brief Binary log of the input and frame times of a run
+ *
+ * The log starts with the random seed of the run. Every frame follows as its delta, which is
+ * what the frame's updates got and what physics added to its fixed-step accumulator, and the
+ * raw inputs EventMan dispatched in it.
+ * Inputs take 5 bytes plus their values, so an hour of play stays within a few megabytes.
+ * Replaying a log feeds back the same deltas and inputs, so a scene runs identically across builds.
+ */
+
+// "CGIR"
+constexpr uint32_t INPUT_LOG_MAGIC = 0x52494743;
+// Bumped on any change of the layout, old logs are rejected
+constexpr uint32_t INPUT_LOG_VERSION = 1;
+
+class InputRecorder {
+public:
+	MaybeError open(const std::string& path, uint32_t seed);
+	bool isOpen() const { return _file.is_open(); };
+	// Logs the frame delta and every input queued in EventMan, call right before they are dispatched
+	MaybeError recordFrame(float delta);
+	MaybeError close();
+	uint64_t recordedFrames() const { return _frames; };
+private:
+	MaybeError flush();
+
+	std::ofstream _file;
+	std::string _path;
+	// Frames waiting to be written, flushed in large chunks
+	std::vector<std::byte> _buffer;
+	uint64_t _frames = 0;
+};
+
+class InputReplay {
+public:
+	// Reads and checks the whole log, returns the random seed the recording started with
+	tl::expected<uint32_t, Error*> open(const std::string& path);
+	// Replaces the queued live input with the next recorded frame's and returns its delta, nothing once the log is over
+	std::optional<float> nextFrame();
+	uint64_t frameCount() const { return _deltas.size(); };
+private:
+	std::vector<float> _deltas;
+	// Index of the first input of every frame in _events, plus the end of the last one
+	std::vector<uint32_t> _frameStarts;
+	std::vector<InputEvent> _events;
+	uint64_t _frame = 0;
+};
+
+} // End of namespace Events
@@ -159,7 +159,8 @@ enum Key {
 	kKeyRightControl,
 	kKeyRightAlt,
 	kKeyRightSuper,
-	kKeyMenu
+	kKeyMenu,
+	kKeyLast = kKeyMenu
 };
 
 
@@ -175,7 +176,8 @@ enum KeyModifier {
 	kModifierAlt = 0x4,
 	kModifierSuper = 0x8,
 	kModifierCapsLock = 0x10,
-	kModifierNumLock = 0x20
+	kModifierNumLock = 0x20,
+	kModifierAll = 0x3F
 };
 
 } // End of namespace Key
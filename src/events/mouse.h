@@ -44,12 +44,14 @@ enum MouseButton {
 };
 
 enum Mouse2DAxis {
-    kMousePosition
+    kMousePosition,
+    kMouse2DAxisLast = kMousePosition
 };
 
 enum Mouse1DAxis {
     kMouseScrollHorizontal,
-    kMouseScrollVertical
+    kMouseScrollVertical,
+    kMouse1DAxisLast = kMouseScrollVertical
 };
 
 } // End of namespace Events
@@ -30,6 +30,10 @@ std::optional<VulkanError*> Fence::reset() {
 	}
 }
 
+bool Fence::isSignaled() {
+	return vkGetFenceStatus(DeviceRef(), _fence) == VK_SUCCESS;
+}
+
 void Fence::destroy() {
     vkDestroyFence(DeviceRef(), _fence, nullptr);
 }
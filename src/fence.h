@@ -13,6 +13,9 @@ struct Fence {
 
     std::optional<VulkanError*> reset();
 
+    // Doesn't wait, errors count as not signaled
+    bool isSignaled();
+
     VkFence _fence;
 
     VkFence& operator()() { return _fence; };
@@ -7,18 +7,27 @@
 #include "vmalloc.h"
 #include "frame.h"
 
-tl::expected<FrameDeletion, VulkanError*> Frame::create(uint32_t queueFamilyIndex, VkDescriptorPool descriptorPool, VkDescriptorSetLayout globalLayout, VkDescriptorSetLayout objectLayout, AllocatedBuffer sceneBuffer) {
+tl::expected<FrameDeletion, VulkanError*> Frame::create(uint32_t queueFamilyIndex, VkDescriptorPool descriptorPool, VkDescriptorSetLayout globalLayout, VkDescriptorSetLayout objectLayout, VkDescriptorSetLayout cullLayout, VkDescriptorSetLayout lightCullLayout, AllocatedBuffer sceneBuffer, float timestampPeriod) {
     auto syncResult = createSync();
     VK_UNEXPECTED_ERROR(syncResult, "Failed to create sync primitives for frame");
     auto descResult = createDescriptors(descriptorPool, globalLayout, objectLayout, sceneBuffer);
     VK_UNEXPECTED_ERROR(descResult, "Failed to create descriptor sets for frame");
     auto commResult = createCommands(queueFamilyIndex);
     VK_UNEXPECTED_ERROR(commResult, "Failed to create command pool and buffers for frame");
+    auto queryResult = _gpuTimer.create(timestampPeriod);
+    VK_UNEXPECTED_ERROR(queryResult, "Failed to create GPU timer for frame");
+    auto cullResult = createCulling(descriptorPool, cullLayout);
+    VK_UNEXPECTED_ERROR(cullResult, "Failed to create culling buffers for frame");
+    auto lightResult = createLighting(descriptorPool, lightCullLayout);
+    VK_UNEXPECTED_ERROR(lightResult, "Failed to create lighting buffers for frame");
 
     return FrameDeletion{
         syncResult.value(),
         descResult.value(),
-        commResult.value()
+        commResult.value(),
+        queryResult.value(),
+        cullResult.value(),
+        lightResult.value()
     };
 }
 
@@ -46,12 +55,15 @@ tl::expected<delFunc, VulkanError*> Frame::createSync() {
 }
 
 tl::expected<delFunc, VulkanError*> Frame::createDescriptors(VkDescriptorPool descriptorPool, VkDescriptorSetLayout globalLayout, VkDescriptorSetLayout objectLayout, AllocatedBuffer sceneBuffer) {
-    auto createResult = VMAlloc.createBuffer(sizeof(GPUCameraData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+    auto createResult = VMAlloc.createBuffer(sizeof(GPUCameraData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, MemoryPool::FrameUploads);
     VK_UNEXPECTED_ERROR(createResult, "Failed to create a camera buffer")
     cameraBuffer = createResult.value();
 
-    const int MAX_OBJECTS = 10000;
-    createResult = VMAlloc.createBuffer(sizeof(GPUObjectData) * MAX_OBJECTS, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+    createResult = VMAlloc.createBuffer(sizeof(GPUShadowData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, MemoryPool::FrameUploads);
+    VK_UNEXPECTED_ERROR(createResult, "Failed to create a shadow buffer")
+    shadowBuffer = createResult.value();
+
+    createResult = VMAlloc.createBuffer(sizeof(GPUObjectData) * MAX_OBJECTS, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, MemoryPool::FrameUploads);
     VK_UNEXPECTED_ERROR(createResult, "Failed to create a buffer for scene parameters")
     objectBuffer = createResult.value();
 
@@ -91,6 +103,12 @@ tl::expected<delFunc, VulkanError*> Frame::createDescriptors(VkDescriptorPool de
         .range = sizeof(GPUSceneData)
     };
 
+    VkDescriptorBufferInfo shadowInfo {
+        .buffer = shadowBuffer._buffer,
+        .offset = 0,
+        .range = sizeof(GPUShadowData)
+    };
+
     VkDescriptorBufferInfo objectBufferInfo {
         .buffer = objectBuffer._buffer,
         .offset = 0,
@@ -101,13 +119,16 @@ tl::expected<delFunc, VulkanError*> Frame::createDescriptors(VkDescriptorPool de
     
     VkWriteDescriptorSet sceneWrite = vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, globalDescriptor, &sceneInfo, 1);
 
+    VkWriteDescriptorSet shadowWrite = vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, globalDescriptor, &shadowInfo, 2);
+
     VkWriteDescriptorSet objectWrite = vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, objectDescriptor, &objectBufferInfo, 0);
 
-    VkWriteDescriptorSet setWrites[] = { cameraWrite,sceneWrite,objectWrite };
-    vkUpdateDescriptorSets(DeviceRef(), 3, setWrites, 0, nullptr);
+    VkWriteDescriptorSet setWrites[] = { cameraWrite,sceneWrite,shadowWrite,objectWrite };
+    vkUpdateDescriptorSets(DeviceRef(), 4, setWrites, 0, nullptr);
 
     return [=](){
         cameraBuffer.destroy();
+        shadowBuffer.destroy();
         objectBuffer.destroy();
 		};
 }
@@ -131,3 +152,136 @@ tl::expected<delFunc, VulkanError*> Frame::createCommands(uint32_t queueFamilyIn
     };
 }
 
+tl::expected<delFunc, VulkanError*> Frame::createCulling(VkDescriptorPool descriptorPool, VkDescriptorSetLayout cullLayout) {
+    auto createResult = VMAlloc.createBuffer(sizeof(GPUCullData) * MAX_OBJECTS, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, MemoryPool::FrameUploads);
+    VK_UNEXPECTED_ERROR(createResult, "Failed to create a buffer for culling data")
+    cullBuffer = createResult.value();
+
+    createResult = VMAlloc.createBuffer(sizeof(GPUCullParams), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, MemoryPool::FrameUploads);
+    VK_UNEXPECTED_ERROR(createResult, "Failed to create a buffer for culling parameters")
+    cullParamsBuffer = createResult.value();
+
+    createResult = VMAlloc.createBuffer(sizeof(GPUCullStats), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU);
+    VK_UNEXPECTED_ERROR(createResult, "Failed to create a buffer for culling statistics")
+    cullStatsBuffer = createResult.value();
+
+    const VkBufferUsageFlags drawUsage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+    createResult = VMAlloc.createBuffer(sizeof(VkDrawIndirectCommand) * MAX_OBJECTS, drawUsage, VMA_MEMORY_USAGE_GPU_ONLY);
+    VK_UNEXPECTED_ERROR(createResult, "Failed to create a buffer for early draws")
+    earlyDrawBuffer = createResult.value();
+
+    createResult = VMAlloc.createBuffer(sizeof(VkDrawIndirectCommand) * MAX_OBJECTS, drawUsage, VMA_MEMORY_USAGE_GPU_ONLY);
+    VK_UNEXPECTED_ERROR(createResult, "Failed to create a buffer for late draws")
+    lateDrawBuffer = createResult.value();
+
+    // Host writes the offsets and clears the counts every frame, the culling shader counts
+    createResult = VMAlloc.createBuffer(sizeof(GPUDrawBatch) * MAX_OBJECTS, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, MemoryPool::FrameUploads);
+    VK_UNEXPECTED_ERROR(createResult, "Failed to create a buffer for draw batches")
+    drawBatchBuffer = createResult.value();
+
+    createResult = VMAlloc.createBuffer(sizeof(uint32_t) * MAX_OBJECTS, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+    VK_UNEXPECTED_ERROR(createResult, "Failed to create a buffer for late culling candidates")
+    lateCandidateBuffer = createResult.value();
+
+    auto allocResult = vkcommand::allocateDescriptorSet(descriptorPool, cullLayout);
+    VK_UNEXPECTED_ERROR(allocResult, "Could not allocate culling descriptor");
+    cullDescriptor = allocResult.value();
+
+    VkDescriptorBufferInfo objectInfo { .buffer = objectBuffer._buffer, .offset = 0, .range = sizeof(GPUObjectData) * MAX_OBJECTS };
+    VkDescriptorBufferInfo cullInfo { .buffer = cullBuffer._buffer, .offset = 0, .range = sizeof(GPUCullData) * MAX_OBJECTS };
+    VkDescriptorBufferInfo earlyInfo { .buffer = earlyDrawBuffer._buffer, .offset = 0, .range = sizeof(VkDrawIndirectCommand) * MAX_OBJECTS };
+    VkDescriptorBufferInfo lateInfo { .buffer = lateDrawBuffer._buffer, .offset = 0, .range = sizeof(VkDrawIndirectCommand) * MAX_OBJECTS };
+    VkDescriptorBufferInfo statsInfo { .buffer = cullStatsBuffer._buffer, .offset = 0, .range = sizeof(GPUCullStats) };
+    VkDescriptorBufferInfo paramsInfo { .buffer = cullParamsBuffer._buffer, .offset = 0, .range = sizeof(GPUCullParams) };
+    VkDescriptorBufferInfo batchInfo { .buffer = drawBatchBuffer._buffer, .offset = 0, .range = sizeof(GPUDrawBatch) * MAX_OBJECTS };
+    VkDescriptorBufferInfo candidateInfo { .buffer = lateCandidateBuffer._buffer, .offset = 0, .range = sizeof(uint32_t) * MAX_OBJECTS };
+
+    VkWriteDescriptorSet setWrites[] = {
+        vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, cullDescriptor, &objectInfo, 0),
+        vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, cullDescriptor, &cullInfo, 1),
+        vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, cullDescriptor, &earlyInfo, 2),
+        vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, cullDescriptor, &lateInfo, 3),
+        vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, cullDescriptor, &statsInfo, 4),
+        vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, cullDescriptor, &paramsInfo, 5),
+        vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, cullDescriptor, &batchInfo, 7),
+        vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, cullDescriptor, &candidateInfo, 8)
+    };
+    vkUpdateDescriptorSets(DeviceRef(), std::size(setWrites), setWrites, 0, nullptr);
+
+    return [=]() {
+        cullBuffer.destroy();
+        cullParamsBuffer.destroy();
+        cullStatsBuffer.destroy();
+        earlyDrawBuffer.destroy();
+        lateDrawBuffer.destroy();
+        drawBatchBuffer.destroy();
+        lateCandidateBuffer.destroy();
+    };
+}
+
+tl::expected<delFunc, VulkanError*> Frame::createLighting(VkDescriptorPool descriptorPool, VkDescriptorSetLayout lightCullLayout) {
+    auto createResult = VMAlloc.createBuffer(sizeof(GPUPointLight) * MAX_POINT_LIGHTS, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, MemoryPool::FrameUploads);
+    VK_UNEXPECTED_ERROR(createResult, "Failed to create a buffer for point lights")
+    lightBuffer = createResult.value();
+
+    createResult = VMAlloc.createBuffer(sizeof(GPUClusterParams), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, MemoryPool::FrameUploads);
+    VK_UNEXPECTED_ERROR(createResult, "Failed to create a buffer for cluster parameters")
+    clusterParamsBuffer = createResult.value();
+
+    createResult = VMAlloc.createBuffer(sizeof(uint32_t) * CLUSTER_COUNT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+    VK_UNEXPECTED_ERROR(createResult, "Failed to create a buffer for the light grid")
+    lightGridBuffer = createResult.value();
+
+    createResult = VMAlloc.createBuffer(sizeof(uint32_t) * CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+    VK_UNEXPECTED_ERROR(createResult, "Failed to create a buffer for light indices")
+    lightIndexBuffer = createResult.value();
+
+    auto allocResult = vkcommand::allocateDescriptorSet(descriptorPool, lightCullLayout);
+    VK_UNEXPECTED_ERROR(allocResult, "Could not allocate light culling descriptor");
+    lightCullDescriptor = allocResult.value();
+
+    VkDescriptorBufferInfo paramsInfo { .buffer = clusterParamsBuffer._buffer, .offset = 0, .range = sizeof(GPUClusterParams) };
+    VkDescriptorBufferInfo lightInfo { .buffer = lightBuffer._buffer, .offset = 0, .range = sizeof(GPUPointLight) * MAX_POINT_LIGHTS };
+    VkDescriptorBufferInfo gridInfo { .buffer = lightGridBuffer._buffer, .offset = 0, .range = sizeof(uint32_t) * CLUSTER_COUNT };
+    VkDescriptorBufferInfo indexInfo { .buffer = lightIndexBuffer._buffer, .offset = 0, .range = sizeof(uint32_t) * CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER };
+
+    // Same buffers are read by the lit shaders through the global set
+    VkWriteDescriptorSet setWrites[] = {
+        vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, lightCullDescriptor, &paramsInfo, 0),
+        vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, lightCullDescriptor, &lightInfo, 1),
+        vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, lightCullDescriptor, &gridInfo, 2),
+        vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, lightCullDescriptor, &indexInfo, 3),
+        vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, globalDescriptor, &paramsInfo, 4),
+        vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, globalDescriptor, &lightInfo, 5),
+        vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, globalDescriptor, &gridInfo, 6),
+        vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, globalDescriptor, &indexInfo, 7)
+    };
+    vkUpdateDescriptorSets(DeviceRef(), std::size(setWrites), setWrites, 0, nullptr);
+
+    return [=]() {
+        lightBuffer.destroy();
+        clusterParamsBuffer.destroy();
+        lightGridBuffer.destroy();
+        lightIndexBuffer.destroy();
+    };
+}
+
+void Frame::updatePyramidDescriptor(VkImageView pyramidView, VkSampler sampler) {
+    VkDescriptorImageInfo pyramidInfo {
+        .sampler = sampler,
+        .imageView = pyramidView,
+        .imageLayout = VK_IMAGE_LAYOUT_GENERAL
+    };
+    VkWriteDescriptorSet pyramidWrite = vkinit::write_descriptor_image(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, cullDescriptor, &pyramidInfo, 6);
+    vkUpdateDescriptorSets(DeviceRef(), 1, &pyramidWrite, 0, nullptr);
+}
+
+void Frame::updateShadowDescriptor(VkImageView shadowView, VkSampler sampler) {
+    VkDescriptorImageInfo shadowInfo {
+        .sampler = sampler,
+        .imageView = shadowView,
+        .imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+    };
+    VkWriteDescriptorSet shadowWrite = vkinit::write_descriptor_image(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, globalDescriptor, &shadowInfo, 3);
+    vkUpdateDescriptorSets(DeviceRef(), 1, &shadowWrite, 0, nullptr);
+}
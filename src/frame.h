@@ -7,11 +7,17 @@
 #include "allocstructs.h"
 #include "fence.h"
 #include "deletionqueue.h"
+#include "profiling/gputimer.h"
+
+constexpr int MAX_OBJECTS = 10000;
 
 struct FrameDeletion {
     delFunc destroySync;
     delFunc destroyDescriptors;
     delFunc destroyCommands;
+    delFunc destroyQueries;
+    delFunc destroyCulling;
+    delFunc destroyLighting;
 };
 
 struct Frame {
@@ -24,13 +30,45 @@ struct Frame {
 	VkCommandBuffer _mainCommandBuffer;
 
 	AllocatedBuffer cameraBuffer;
+	// Cascade matrices, see Shadows::CascadedShadows
+	AllocatedBuffer shadowBuffer;
 	VkDescriptorSet globalDescriptor;
 
 	AllocatedBuffer objectBuffer;
 	VkDescriptorSet objectDescriptor;
 
-    tl::expected<FrameDeletion, VulkanError*> create(uint32_t queueFamilyIndex, VkDescriptorPool descriptorPool, VkDescriptorSetLayout globalLayout, VkDescriptorSetLayout objectLayout, AllocatedBuffer sceneBuffer);
+	Profiling::GpuTimer _gpuTimer;
+
+	// Occlusion culling inputs and outputs, see Culling::OcclusionCuller
+	AllocatedBuffer cullBuffer;
+	AllocatedBuffer cullParamsBuffer;
+	AllocatedBuffer cullStatsBuffer;
+	AllocatedBuffer earlyDrawBuffer;
+	AllocatedBuffer lateDrawBuffer;
+	// Draw counts and offsets of every GPUDrawBatch
+	AllocatedBuffer drawBatchBuffer;
+	// Objects rejected by the early phase that the late phase tests again
+	AllocatedBuffer lateCandidateBuffer;
+	VkDescriptorSet cullDescriptor;
+	// Stats buffer holds results of a finished submission
+	bool cullStatsReady = false;
+
+	// Clustered lighting inputs and outputs, see Lighting::ClusteredLights
+	AllocatedBuffer lightBuffer;
+	AllocatedBuffer clusterParamsBuffer;
+	AllocatedBuffer lightGridBuffer;
+	AllocatedBuffer lightIndexBuffer;
+	VkDescriptorSet lightCullDescriptor;
+
+    tl::expected<FrameDeletion, VulkanError*> create(uint32_t queueFamilyIndex, VkDescriptorPool descriptorPool, VkDescriptorSetLayout globalLayout, VkDescriptorSetLayout objectLayout, VkDescriptorSetLayout cullLayout, VkDescriptorSetLayout lightCullLayout, AllocatedBuffer sceneBuffer, float timestampPeriod);
     tl::expected<delFunc, VulkanError*> createSync();
     tl::expected<delFunc, VulkanError*> createDescriptors(VkDescriptorPool descriptorPool, VkDescriptorSetLayout globalLayout, VkDescriptorSetLayout objectLayout, AllocatedBuffer sceneBuffer);
     tl::expected<delFunc, VulkanError*> createCommands(uint32_t queueFamilyIndex);
+    tl::expected<delFunc, VulkanError*> createCulling(VkDescriptorPool descriptorPool, VkDescriptorSetLayout cullLayout);
+    // Also fills the light bindings of the global descriptor, so it goes after createDescriptors
+    tl::expected<delFunc, VulkanError*> createLighting(VkDescriptorPool descriptorPool, VkDescriptorSetLayout lightCullLayout);
+
+    // Has to be called every time the depth pyramid gets recreated
+    void updatePyramidDescriptor(VkImageView pyramidView, VkSampler sampler);
+    void updateShadowDescriptor(VkImageView shadowView, VkSampler sampler);
 };
\ No newline at end of file
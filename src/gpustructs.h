@@ -19,10 +19,131 @@ struct GPUSceneData {
 	glm::vec4 sunlightColor;
 };
 
+// Must match the cascade array in the lit fragment shaders
+constexpr uint32_t SHADOW_CASCADES = 4;
+
+struct GPUShadowData {
+	glm::mat4 cascadeViewproj[SHADOW_CASCADES];
+	// World-space size of a shadow map texel for every cascade, used for normal offsets
+	glm::vec4 texelSizes;
+	glm::vec4 params; // x - cascade count (0 disables shadows), y - normal offset in texels, zw unused
+};
+
+// Light grid dimensions, must match light_cull.comp and the lit fragment shaders
+constexpr uint32_t CLUSTER_GRID_X = 16;
+constexpr uint32_t CLUSTER_GRID_Y = 9;
+constexpr uint32_t CLUSTER_GRID_Z = 24;
+constexpr uint32_t CLUSTER_COUNT = CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z;
+// Lights past this count are dropped from a cluster
+constexpr uint32_t MAX_LIGHTS_PER_CLUSTER = 128;
+constexpr uint32_t MAX_POINT_LIGHTS = 8192;
+
+struct GPUPointLight {
+	glm::vec4 positionRadius; // world space position in xyz, influence radius in w
+	glm::vec4 color; // w is for intensity
+};
+
+struct GPUClusterParams {
+	glm::mat4 view;
+	glm::mat4 inverseProj;
+	glm::vec4 tileSize; // xy - tile size in pixels, zw - framebuffer size
+	glm::vec4 depthSlices; // x - slice scale, y - slice bias, z - near, w - far
+	glm::uvec4 lightCount; // x - light count, yzw unused
+};
+
 struct GPUObjectData {
 	glm::mat4 modelMatrix;
 };
 
+// Per-object input of the culling shader, indexed the same way as GPUObjectData
+struct GPUCullData {
+	glm::vec4 sphere; // object space center in xyz, radius in w
+	// Range of the LOD picked for this frame
+	uint32_t vertexCount;
+	uint32_t firstVertex;
+	// Index into the draw batches, visible objects are appended to their batch's draws
+	uint32_t batch;
+	uint32_t padding;
+};
+
+// Objects sharing a mesh and material, drawn with one vkCmdDrawIndirectCount per pass
+struct GPUDrawBatch {
+	// Written by the culling shader, read as draw counts
+	uint32_t earlyCount;
+	uint32_t lateCount;
+	// Offset of the batch's draws in the early and late draw buffers
+	uint32_t firstDraw;
+	uint32_t padding;
+};
+
+struct GPUCullParams {
+	glm::mat4 viewproj;
+	// View-projection the depth pyramid was rendered with
+	glm::mat4 pyramidViewproj;
+	glm::vec2 pyramidSize;
+	uint32_t objectCount;
+	uint32_t pyramidValid;
+};
+
+struct GPUCullStats {
+	uint32_t frustumCulled;
+	// Rejected by the pyramid of the previous frame and sent to the second pass
+	uint32_t earlyOccluded;
+	// Still occluded after the second pass
+	uint32_t lateOccluded;
+	uint32_t lateDrawn;
+};
+
+// Must match the particle shaders
+constexpr uint32_t MAX_PARTICLE_EMITTERS = 64;
+
+struct GPUParticle {
+	glm::vec4 positionLife; // xyz - world position, w - remaining life in seconds
+	glm::vec4 velocitySize; // xyz - velocity, w - billboard size
+	glm::vec4 color;
+	uint32_t emitter;
+	float lifetime; // Full lifetime, used for fading out
+	uint32_t padding[2];
+};
+
+struct GPUParticleEmitter {
+	glm::vec4 position; // w - spawn sphere radius
+	glm::vec4 velocity; // w - random velocity added on top
+	glm::vec4 color;
+	float lifetime;
+	float size;
+	// Maximum number of particles of the emitter alive at once
+	uint32_t budget;
+	// Emission threads [spawnOffset, spawnOffset + spawnCount) belong to this emitter
+	uint32_t spawnOffset;
+	uint32_t spawnCount;
+	uint32_t padding[3];
+};
+
+struct GPUParticleParams {
+	// Camera the depth pyramid was rendered with, for depth buffer collisions
+	glm::mat4 depthViewproj;
+	glm::mat4 inverseDepthViewproj;
+	glm::vec4 gravity; // w - frame delta time
+	glm::vec4 collision; // x - 1 if the depth pyramid is valid, y - collision thickness, z - restitution
+	glm::vec2 depthSize;
+	uint32_t emitterCount;
+	uint32_t spawnCount;
+	uint32_t capacity;
+	uint32_t seed;
+	uint32_t padding[2];
+};
+
+// Lives on the GPU only, drives the indirect simulation dispatch and the billboard draw
+struct GPUParticleCounters {
+	VkDispatchIndirectCommand simulateDispatch;
+	uint32_t aliveCount;
+	VkDrawIndirectCommand draw;
+	uint32_t nextAliveCount;
+	uint32_t padding[3];
+	uint32_t emitterAlive[MAX_PARTICLE_EMITTERS];
+};
+
 struct MeshPushConstants {
 	glm::vec4 data;
 	glm::mat4 render_matrix;
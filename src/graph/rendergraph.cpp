@@ -0,0 +1,619 @@
+#include "rendergraph.h"
+
+#include <algorithm>
+
+#include "src/devicesingleton.h"
+#include "src/vk_initializers.h"
+#include "src/vk_operations.h"
+#include "src/vmalloc.h"
+
+namespace Graph {
+
+namespace {
+
+constexpr VkAccessFlags WRITE_ACCESS = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+struct UseState {
+	VkImageLayout layout;
+	VkPipelineStageFlags stages;
+	VkAccessFlags access;
+};
+
+bool isAttachment(Access access) {
+	return access == Access::ColorAttachment || access == Access::DepthAttachment;
+}
+
+bool isWrite(Access access) {
+	return isAttachment(access) || access == Access::StorageWrite;
+}
+
+bool hasStencil(VkFormat format) {
+	return format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+}
+
+bool isDepthFormat(VkFormat format) {
+	return format == VK_FORMAT_D16_UNORM || format == VK_FORMAT_X8_D24_UNORM_PACK32 || format == VK_FORMAT_D32_SFLOAT || hasStencil(format);
+}
+
+VkImageAspectFlags barrierAspect(VkFormat format) {
+	if (!isDepthFormat(format))
+		return VK_IMAGE_ASPECT_COLOR_BIT;
+	return hasStencil(format) ? VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT : VK_IMAGE_ASPECT_DEPTH_BIT;
+}
+
+VkImageUsageFlags usageOf(Access access) {
+	switch (access) {
+	case Access::ColorAttachment: return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	case Access::DepthAttachment: return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	case Access::Sampled: return VK_IMAGE_USAGE_SAMPLED_BIT;
+	case Access::StorageRead:
+	case Access::StorageWrite: return VK_IMAGE_USAGE_STORAGE_BIT;
+	}
+	return 0;
+}
+
+UseState useState(Access access, VkFormat format, VkPipelineStageFlags stages) {
+	switch (access) {
+	case Access::ColorAttachment:
+		return { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT };
+	case Access::DepthAttachment:
+		return { VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT };
+	case Access::Sampled:
+		return { isDepthFormat(format) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, stages, VK_ACCESS_SHADER_READ_BIT };
+	case Access::StorageRead:
+		return { VK_IMAGE_LAYOUT_GENERAL, stages, VK_ACCESS_SHADER_READ_BIT };
+	case Access::StorageWrite:
+		return { VK_IMAGE_LAYOUT_GENERAL, stages, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT };
+	}
+	return {};
+}
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+} // End of anonymous namespace
+
+PassBuilder& PassBuilder::color(ResourceId image, std::optional<VkClearColorValue> clear) {
+	std::optional<VkClearValue> clearValue;
+	if (clear)
+		clearValue = VkClearValue{ .color = clear.value() };
+	_graph._passes[_pass].uses.push_back({ .image = image, .access = Access::ColorAttachment, .stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, .clear = clearValue });
+	return *this;
+}
+
+PassBuilder& PassBuilder::depth(ResourceId image, std::optional<float> clear) {
+	std::optional<VkClearValue> clearValue;
+	if (clear)
+		clearValue = VkClearValue{ .depthStencil = { clear.value(), 0 } };
+	_graph._passes[_pass].uses.push_back({ .image = image, .access = Access::DepthAttachment,
+		.stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, .clear = clearValue });
+	return *this;
+}
+
+PassBuilder& PassBuilder::sampled(ResourceId image, VkPipelineStageFlags stages) {
+	_graph._passes[_pass].uses.push_back({ .image = image, .access = Access::Sampled, .stages = stages });
+	return *this;
+}
+
+PassBuilder& PassBuilder::storage(ResourceId image, VkPipelineStageFlags stages, bool write) {
+	_graph._passes[_pass].uses.push_back({ .image = image, .access = write ? Access::StorageWrite : Access::StorageRead, .stages = stages });
+	return *this;
+}
+
+PassBuilder& PassBuilder::sideEffects() {
+	_graph._passes[_pass].sideEffects = true;
+	return *this;
+}
+
+PassBuilder& PassBuilder::renderArea(std::function<VkExtent2D()> area) {
+	_graph._passes[_pass].renderArea = std::move(area);
+	return *this;
+}
+
+void RenderGraph::reset() {
+	_resources.clear();
+	_passes.clear();
+	_transientMemory = VK_NULL_HANDLE;
+	_aliasedBytes = 0;
+}
+
+ResourceId RenderGraph::createImage(const char* name, VkFormat format, VkExtent2D extent, bool transient) {
+	_resources.push_back({
+		.name = name,
+		.format = format,
+		.extent = extent,
+		.imported = false,
+		.transient = transient,
+		.output = false,
+		.finalLayout = VK_IMAGE_LAYOUT_UNDEFINED
+	});
+	return _resources.size() - 1;
+}
+
+ResourceId RenderGraph::importImage(const char* name, VkFormat format, VkExtent2D extent,
+	const std::vector<VkImage>& images, const std::vector<VkImageView>& views, VkImageLayout finalLayout) {
+	_resources.push_back({
+		.name = name,
+		.format = format,
+		.extent = extent,
+		.imported = true,
+		.transient = false,
+		.output = false,
+		.finalLayout = finalLayout,
+		.images = images,
+		.views = views
+	});
+	return _resources.size() - 1;
+}
+
+void RenderGraph::markOutput(ResourceId image) {
+	_resources[image].output = true;
+}
+
+PassBuilder RenderGraph::addPass(const char* name, Callback callback) {
+	_passes.push_back({ .name = name, .callback = std::move(callback) });
+	return PassBuilder(*this, _passes.size() - 1);
+}
+
+bool RenderGraph::hasAttachments(const Pass& pass) const {
+	return std::any_of(pass.uses.begin(), pass.uses.end(), [](const Use& use) { return isAttachment(use.access); });
+}
+
+void RenderGraph::cullPasses() {
+	// Walking backwards, an image is needed while some later live pass reads what was written before it
+	std::vector<bool> needed(_resources.size(), false);
+	for (size_t i = _passes.size(); i-- > 0;) {
+		Pass& pass = _passes[i];
+
+		bool alive = pass.sideEffects;
+		for (const Use& use : pass.uses) {
+			const Resource& resource = _resources[use.image];
+			const bool persistent = resource.imported || resource.output || !resource.transient;
+			if (isWrite(use.access) && (persistent || needed[use.image]))
+				alive = true;
+		}
+
+		pass.culled = !alive;
+		if (!alive)
+			continue;
+
+		// Cleared attachments don't care what came before, everything else reads the previous contents
+		for (const Use& use : pass.uses)
+			needed[use.image] = !(isAttachment(use.access) && use.clear.has_value());
+	}
+}
+
+void RenderGraph::inferAttachmentOps() {
+	for (uint32_t p = 0; p < _passes.size(); p++) {
+		if (_passes[p].culled)
+			continue;
+
+		for (Use& use : _passes[p].uses) {
+			if (!isAttachment(use.access))
+				continue;
+
+			const Resource& resource = _resources[use.image];
+			// Only graph-owned images that are not transient keep their contents from the previous frame
+			const bool definedBefore = resource.firstPass < static_cast<int32_t>(p) || (!resource.imported && !resource.transient);
+			const bool usedAfter = resource.lastPass > static_cast<int32_t>(p) || resource.imported || resource.output || !resource.transient;
+
+			if (use.clear)
+				use.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			else
+				use.loadOp = definedBefore ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			use.storeOp = usedAfter ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		}
+	}
+}
+
+MaybeVulkanError RenderGraph::createImages() {
+	std::vector<ResourceId> transients;
+	for (ResourceId id = 0; id < _resources.size(); id++) {
+		Resource& resource = _resources[id];
+		// Images no live pass touches are never created
+		if (resource.imported || resource.firstPass < 0)
+			continue;
+
+		VkImageCreateInfo imageInfo = vkinit::createinfo::image(resource.format, resource.usage, { resource.extent.width, resource.extent.height, 1 });
+		if (resource.transient) {
+			auto imageResult = vkcommand::createImage(imageInfo);
+			VK_OPTIONAL_ERROR(imageResult, "Failed to create transient image {}", resource.name);
+			resource.images = { imageResult.value() };
+			transients.push_back(id);
+		} else {
+			auto imageResult = VMAlloc.createImage(VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT), VMA_MEMORY_USAGE_GPU_ONLY, imageInfo);
+			VK_OPTIONAL_ERROR(imageResult, "Failed to create image {}", resource.name);
+			resource.allocation = imageResult.value();
+			resource.images = { resource.allocation._image };
+		}
+	}
+
+	if (!transients.empty()) {
+		auto placeResult = placeTransientImages(transients);
+		if (placeResult)
+			return placeResult;
+	}
+
+	for (Resource& resource : _resources) {
+		if (resource.imported || resource.images.empty())
+			continue;
+
+		const VkImageAspectFlags aspect = isDepthFormat(resource.format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+		VkImageViewCreateInfo viewInfo = vkinit::createinfo::imageView(resource.format, resource.images[0], aspect);
+		auto viewResult = vkcommand::createImageView(viewInfo);
+		VK_OPTIONAL_ERROR(viewResult, "Failed to create view for image {}", resource.name);
+		resource.views = { viewResult.value() };
+	}
+
+	return std::nullopt;
+}
+
+MaybeVulkanError RenderGraph::placeTransientImages(std::vector<ResourceId>& transients) {
+	std::vector<VkMemoryRequirements> requirements(_resources.size());
+	for (ResourceId id : transients)
+		vkGetImageMemoryRequirements(DeviceRef(), _resources[id].images[0], &requirements[id]);
+
+	// Biggest images first, smaller ones fill the gaps between them
+	std::sort(transients.begin(), transients.end(), [&](ResourceId a, ResourceId b) {
+		return requirements[a].size > requirements[b].size;
+	});
+
+	VkMemoryRequirements shared = { .size = 0, .alignment = 1, .memoryTypeBits = ~0u };
+	VkDeviceSize unaliasedSize = 0;
+	std::vector<ResourceId> placed;
+	for (ResourceId id : transients) {
+		Resource& resource = _resources[id];
+		const VkMemoryRequirements& own = requirements[id];
+
+		if ((shared.memoryTypeBits & own.memoryTypeBits) == 0) {
+			// No memory type fits it together with the others, give it memory of its own
+			vkDestroyImage(DeviceRef(), resource.images[0], nullptr);
+			resource.images.clear();
+			VkImageCreateInfo imageInfo = vkinit::createinfo::image(resource.format, resource.usage, { resource.extent.width, resource.extent.height, 1 });
+			auto imageResult = VMAlloc.createImage(VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT), VMA_MEMORY_USAGE_GPU_ONLY, imageInfo);
+			VK_OPTIONAL_ERROR(imageResult, "Failed to create image {}", resource.name);
+			resource.allocation = imageResult.value();
+			resource.images = { resource.allocation._image };
+			continue;
+		}
+
+		// First fit: move past every placed image that is alive at the same time and in the way
+		VkDeviceSize offset = 0;
+		bool moved = true;
+		while (moved) {
+			moved = false;
+			for (ResourceId otherId : placed) {
+				const Resource& other = _resources[otherId];
+				const bool livesTogether = other.firstPass <= resource.lastPass && resource.firstPass <= other.lastPass;
+				const bool overlaps = offset < other.memoryOffset + other.memorySize && other.memoryOffset < offset + own.size;
+				if (livesTogether && overlaps) {
+					offset = alignUp(other.memoryOffset + other.memorySize, own.alignment);
+					moved = true;
+				}
+			}
+		}
+
+		resource.placed = true;
+		resource.memoryOffset = offset;
+		resource.memorySize = own.size;
+		shared.size = std::max(shared.size, offset + own.size);
+		shared.alignment = std::max(shared.alignment, own.alignment);
+		shared.memoryTypeBits &= own.memoryTypeBits;
+		unaliasedSize += own.size;
+		placed.push_back(id);
+	}
+
+	if (placed.empty())
+		return std::nullopt;
+
+	auto memoryResult = VMAlloc.allocateMemory(shared, VMA_MEMORY_USAGE_GPU_ONLY);
+	VK_OPTIONAL_ERROR(memoryResult, "Failed to allocate memory for transient images");
+	_transientMemory = memoryResult.value();
+	_aliasedBytes = unaliasedSize - shared.size;
+
+	for (ResourceId id : placed) {
+		Resource& resource = _resources[id];
+		auto bindResult = VMAlloc.bindImageMemory(_transientMemory, resource.memoryOffset, resource.images[0]);
+		VK_OPTIONAL_OPT_ERROR(bindResult, "Failed to bind memory of transient image {}", resource.name);
+
+		for (ResourceId otherId : placed) {
+			const Resource& other = _resources[otherId];
+			if (otherId != id && resource.memoryOffset < other.memoryOffset + other.memorySize && other.memoryOffset < resource.memoryOffset + resource.memorySize)
+				resource.aliases.push_back(otherId);
+		}
+	}
+
+	return std::nullopt;
+}
+
+MaybeVulkanError RenderGraph::createRenderPass(Pass& pass) {
+	std::vector<VkAttachmentDescription> attachments;
+	std::vector<VkAttachmentReference> colorRefs;
+	std::optional<VkAttachmentReference> depthRef;
+	std::vector<const Resource*> attached;
+	VkExtent2D extent = { UINT32_MAX, UINT32_MAX };
+	size_t framebufferCount = 1;
+
+	for (const Use& use : pass.uses) {
+		if (!isAttachment(use.access))
+			continue;
+
+		const Resource& resource = _resources[use.image];
+		const VkImageLayout layout = useState(use.access, resource.format, use.stages).layout;
+		// Barriers recorded by execute() do all the transitions, the render pass keeps the layouts as they are
+		attachments.push_back({
+			.format = resource.format,
+			.samples = VK_SAMPLE_COUNT_1_BIT,
+			.loadOp = use.loadOp,
+			.storeOp = use.storeOp,
+			.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+			.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+			.initialLayout = layout,
+			.finalLayout = layout
+		});
+
+		const VkAttachmentReference ref = { .attachment = static_cast<uint32_t>(attachments.size() - 1), .layout = layout };
+		if (use.access == Access::ColorAttachment)
+			colorRefs.push_back(ref);
+		else
+			depthRef = ref;
+
+		pass.clearValues.push_back(use.clear.value_or(VkClearValue{}));
+		attached.push_back(&resource);
+		extent.width = std::min(extent.width, resource.extent.width);
+		extent.height = std::min(extent.height, resource.extent.height);
+		if (resource.imported)
+			framebufferCount = std::max(framebufferCount, resource.views.size());
+	}
+
+	VkSubpassDescription subpass = {
+		.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+		.colorAttachmentCount = static_cast<uint32_t>(colorRefs.size()),
+		.pColorAttachments = colorRefs.data(),
+		.pDepthStencilAttachment = depthRef ? &depthRef.value() : nullptr
+	};
+
+	VkRenderPassCreateInfo passInfo = {
+		.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+		.attachmentCount = static_cast<uint32_t>(attachments.size()),
+		.pAttachments = attachments.data(),
+		.subpassCount = 1,
+		.pSubpasses = &subpass
+	};
+
+	auto passResult = vkcommand::createRenderPass(passInfo);
+	VK_OPTIONAL_ERROR(passResult, "Failed to create render pass for {}", pass.name);
+	pass.renderPass = passResult.value();
+	pass.framebufferExtent = extent;
+
+	// Imported attachments get a framebuffer for each of their images
+	VkFramebufferCreateInfo framebufferInfo = vkinit::createinfo::framebuffer(pass.renderPass, extent);
+	std::vector<VkImageView> views(attached.size());
+	for (size_t i = 0; i < framebufferCount; i++) {
+		for (size_t a = 0; a < attached.size(); a++)
+			views[a] = attached[a]->views[std::min(i, attached[a]->views.size() - 1)];
+
+		framebufferInfo.attachmentCount = views.size();
+		framebufferInfo.pAttachments = views.data();
+		auto framebufferResult = vkcommand::createFramebuffer(framebufferInfo);
+		VK_OPTIONAL_ERROR(framebufferResult, "Failed to create framebuffer {} for {}", i, pass.name);
+		pass.framebuffers.push_back(framebufferResult.value());
+	}
+
+	return std::nullopt;
+}
+
+tl::expected<delFunc, VulkanError*> RenderGraph::compile() {
+	cullPasses();
+
+	for (uint32_t p = 0; p < _passes.size(); p++) {
+		if (_passes[p].culled)
+			continue;
+
+		for (const Use& use : _passes[p].uses) {
+			Resource& resource = _resources[use.image];
+			if (resource.firstPass < 0)
+				resource.firstPass = p;
+			resource.lastPass = p;
+			resource.usage |= usageOf(use.access);
+		}
+	}
+
+	inferAttachmentOps();
+
+	auto imagesResult = createImages();
+	if (imagesResult) {
+		destroy();
+		return tl::unexpected(new VulkanError(imagesResult.value()->getCode(), imagesResult.value(), ErrorMessage("Failed to create render graph images")));
+	}
+
+	for (Pass& pass : _passes) {
+		if (pass.culled || !hasAttachments(pass))
+			continue;
+
+		auto passResult = createRenderPass(pass);
+		if (passResult) {
+			destroy();
+			return tl::unexpected(new VulkanError(passResult.value()->getCode(), passResult.value(), ErrorMessage("Failed to create render graph passes")));
+		}
+	}
+
+	return [=]() {
+		destroy();
+	};
+}
+
+void RenderGraph::destroy() {
+	for (Pass& pass : _passes) {
+		for (VkFramebuffer framebuffer : pass.framebuffers)
+			vkDestroyFramebuffer(DeviceRef(), framebuffer, nullptr);
+		pass.framebuffers.clear();
+		pass.clearValues.clear();
+		vkDestroyRenderPass(DeviceRef(), pass.renderPass, nullptr);
+		pass.renderPass = VK_NULL_HANDLE;
+	}
+
+	for (Resource& resource : _resources) {
+		if (resource.imported)
+			continue;
+
+		for (VkImageView view : resource.views)
+			vkDestroyImageView(DeviceRef(), view, nullptr);
+		resource.views.clear();
+
+		if (resource.allocation._allocation != VK_NULL_HANDLE)
+			resource.allocation.destroy();
+		else if (!resource.images.empty())
+			vkDestroyImage(DeviceRef(), resource.images[0], nullptr);
+		resource.allocation = {};
+		resource.images.clear();
+	}
+
+	if (_transientMemory != VK_NULL_HANDLE)
+		VMAlloc.freeMemory(_transientMemory);
+	_transientMemory = VK_NULL_HANDLE;
+}
+
+void RenderGraph::recordBarriers(VkCommandBuffer cmd, const Pass& pass, uint32_t importIndex, uint32_t passIndex) {
+	std::vector<VkImageMemoryBarrier> barriers;
+	VkPipelineStageFlags srcStages = 0;
+	VkPipelineStageFlags dstStages = 0;
+
+	for (const Use& use : pass.uses) {
+		Resource& resource = _resources[use.image];
+		const UseState state = useState(use.access, resource.format, use.stages);
+		const bool write = isWrite(use.access);
+		const bool discard = isAttachment(use.access) && use.loadOp != VK_ATTACHMENT_LOAD_OP_LOAD;
+
+		// Layout transitions and writes wait for every earlier use, reads only for the last write
+		VkPipelineStageFlags waitStages = 0;
+		VkAccessFlags waitAccess = resource.writeAccess;
+		if (resource.layout != state.layout || write)
+			waitStages = resource.writeStages | resource.readStages;
+		else if ((resource.readStages & state.stages) != state.stages)
+			waitStages = resource.writeStages;
+
+		// Memory shared with other transient images is taken over from whoever used it last
+		if (static_cast<int32_t>(passIndex) == resource.firstPass) {
+			for (ResourceId aliasId : resource.aliases) {
+				const Resource& alias = _resources[aliasId];
+				waitStages |= alias.writeStages | alias.readStages;
+				waitAccess |= alias.writeAccess;
+			}
+		}
+
+		if (waitStages != 0 || resource.layout != state.layout) {
+			barriers.push_back({
+				.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+				.pNext = nullptr,
+				.srcAccessMask = waitAccess,
+				.dstAccessMask = state.access,
+				.oldLayout = discard ? VK_IMAGE_LAYOUT_UNDEFINED : resource.layout,
+				.newLayout = state.layout,
+				.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+				.image = resource.images[std::min<size_t>(importIndex, resource.images.size() - 1)],
+				.subresourceRange = {
+					.aspectMask = barrierAspect(resource.format),
+					.baseMipLevel = 0,
+					.levelCount = VK_REMAINING_MIP_LEVELS,
+					.baseArrayLayer = 0,
+					.layerCount = VK_REMAINING_ARRAY_LAYERS
+				}
+			});
+			// Nothing to wait for still has to chain with the semaphore the submit waits on at this stage
+			srcStages |= waitStages != 0 ? waitStages : state.stages;
+			dstStages |= state.stages;
+		}
+
+		if (write || resource.layout != state.layout) {
+			// A layout transition counts as a write finished by the time this use starts
+			resource.writeStages = state.stages;
+			resource.writeAccess = write ? state.access & WRITE_ACCESS : 0;
+			resource.readStages = write ? 0 : state.stages;
+		} else {
+			resource.readStages |= state.stages;
+		}
+		resource.layout = state.layout;
+	}
+
+	if (!barriers.empty())
+		vkCmdPipelineBarrier(cmd, srcStages, dstStages, 0, 0, nullptr, 0, nullptr, barriers.size(), barriers.data());
+}
+
+void RenderGraph::execute(VkCommandBuffer cmd, uint32_t importIndex, Profiling::GpuTimer& timer) {
+	for (Resource& resource : _resources) {
+		if (resource.imported) {
+			// Uses outside of the frame are ordered by the submit's semaphore wait
+			resource.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			resource.writeStages = 0;
+			resource.writeAccess = 0;
+			resource.readStages = 0;
+		} else if (resource.transient) {
+			// Contents are gone, but the previous frame's uses still have to finish first
+			resource.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		}
+	}
+
+	for (uint32_t i = 0; i < _passes.size(); i++) {
+		const Pass& pass = _passes[i];
+		if (pass.culled)
+			continue;
+
+		PROFILE_GPU_SCOPE(timer, cmd, pass.name);
+		recordBarriers(cmd, pass, importIndex, i);
+
+		if (pass.renderPass == VK_NULL_HANDLE) {
+			pass.callback(cmd);
+			continue;
+		}
+
+		const VkFramebuffer framebuffer = pass.framebuffers[std::min<size_t>(importIndex, pass.framebuffers.size() - 1)];
+		const VkExtent2D area = pass.renderArea ? pass.renderArea() : pass.framebufferExtent;
+		VkRenderPassBeginInfo rpInfo = vkinit::renderpass_begin_info(pass.renderPass, area, framebuffer);
+		rpInfo.clearValueCount = pass.clearValues.size();
+		rpInfo.pClearValues = pass.clearValues.data();
+
+		vkCmdBeginRenderPass(cmd, &rpInfo, VK_SUBPASS_CONTENTS_INLINE);
+		pass.callback(cmd);
+		vkCmdEndRenderPass(cmd);
+	}
+
+	// Imported images are handed back in the layout their owner expects
+	std::vector<VkImageMemoryBarrier> barriers;
+	VkPipelineStageFlags srcStages = 0;
+	for (Resource& resource : _resources) {
+		if (!resource.imported || resource.firstPass < 0 || resource.layout == resource.finalLayout)
+			continue;
+
+		barriers.push_back({
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+			.pNext = nullptr,
+			.srcAccessMask = resource.writeAccess,
+			.dstAccessMask = 0,
+			.oldLayout = resource.layout,
+			.newLayout = resource.finalLayout,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = resource.images[std::min<size_t>(importIndex, resource.images.size() - 1)],
+			.subresourceRange = {
+				.aspectMask = barrierAspect(resource.format),
+				.baseMipLevel = 0,
+				.levelCount = VK_REMAINING_MIP_LEVELS,
+				.baseArrayLayer = 0,
+				.layerCount = VK_REMAINING_ARRAY_LAYERS
+			}
+		});
+		srcStages |= resource.writeStages | resource.readStages;
+		resource.layout = resource.finalLayout;
+	}
+
+	if (!barriers.empty())
+		vkCmdPipelineBarrier(cmd, srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			0, 0, nullptr, 0, nullptr, barriers.size(), barriers.data());
+}
+
+} // End of namespace Graph
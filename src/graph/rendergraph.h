@@ -0,0 +1,170 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+#include <expected.hpp>
+#include <vk_mem_alloc.h>
+
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include "src/allocstructs.h"
+#include "src/deletionqueue.h"
+#include "src/error.h"
+#include "src/profiling/gputimer.h"
+
+namespace Graph {
+
+using ResourceId = uint32_t;
+using PassId = uint32_t;
+
+// How a pass touches an image, decides layouts, stages and access masks of the barriers
+enum class Access: uint8_t {
+	ColorAttachment,
+	DepthAttachment,
+	// Read through a sampler, depth formats stay in VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+	Sampled,
+	StorageRead,
+	StorageWrite
+};
+
+class RenderGraph;
+
+// Collects the images a pass uses, returned by RenderGraph::addPass
+class PassBuilder {
+public:
+	PassBuilder(RenderGraph& graph, PassId pass): _graph(graph), _pass(pass) {};
+
+	// Attachments are bound in declaration order. Without a clear value the previous contents are loaded
+	PassBuilder& color(ResourceId image, std::optional<VkClearColorValue> clear = std::nullopt);
+	PassBuilder& depth(ResourceId image, std::optional<float> clear = std::nullopt);
+	PassBuilder& sampled(ResourceId image, VkPipelineStageFlags stages);
+	PassBuilder& storage(ResourceId image, VkPipelineStageFlags stages, bool write);
+	// The pass writes something the graph does not track, so it is never culled
+	PassBuilder& sideEffects();
+	// Passes with attachments cover the whole framebuffer unless this is set
+	PassBuilder& renderArea(std::function<VkExtent2D()> area);
+
+	PassId id() const { return _pass; };
+private:
+	RenderGraph& _graph;
+	PassId _pass;
+};
+
+/*!
+ * \brief Frame described as passes declaring the images they read and write
+ *
+ * Passes run in declaration order. Compiling culls passes whose results are never used,
+ * creates the images the graph owns (transient ones with disjoint lifetimes share memory)
+ * and builds a render pass for every pass with attachments, with load and store ops inferred
+ * from the surrounding uses. Layout transitions and barriers are derived while executing,
+ * including the ones against the previous frame.
+ *
+ * Buffers and images owned by other modules are not tracked; passes touching them keep their
+ * own barriers and are declared with sideEffects().
+ */
+class RenderGraph {
+public:
+	using Callback = std::function<void(VkCommandBuffer cmd)>;
+
+	// Drops everything declared, the graph has to be declared and compiled again
+	void reset();
+
+	// Graph-owned image. Transient images don't keep their contents between frames and may alias
+	ResourceId createImage(const char* name, VkFormat format, VkExtent2D extent, bool transient = true);
+	// Image owned by someone else, execute() picks one of the given ones (e.g. a swapchain image).
+	// Its contents are discarded at the start of every frame and it is left in finalLayout at the end,
+	// the submit has to wait for it no later than the stage of its first use
+	ResourceId importImage(const char* name, VkFormat format, VkExtent2D extent,
+		const std::vector<VkImage>& images, const std::vector<VkImageView>& views, VkImageLayout finalLayout);
+	// The contents are used after the frame, passes producing them are kept
+	void markOutput(ResourceId image);
+
+	PassBuilder addPass(const char* name, Callback callback);
+
+	tl::expected<delFunc, VulkanError*> compile();
+	// Every pass gets its own GPU zone named after it
+	void execute(VkCommandBuffer cmd, uint32_t importIndex, Profiling::GpuTimer& timer);
+
+	// Valid until the next compile
+	VkImageView getView(ResourceId image) const { return _resources[image].views.empty() ? VK_NULL_HANDLE : _resources[image].views[0]; };
+	VkRenderPass getRenderPass(PassId pass) const { return _passes[pass].renderPass; };
+	bool isCulled(PassId pass) const { return _passes[pass].culled; };
+	// Memory the transient images would take without aliasing, minus what they take with it
+	VkDeviceSize getAliasedBytes() const { return _aliasedBytes; };
+private:
+	friend class PassBuilder;
+
+	struct Use {
+		ResourceId image;
+		Access access;
+		VkPipelineStageFlags stages;
+		std::optional<VkClearValue> clear;
+		// Filled in by compile for attachments. Anything but a load discards the previous contents
+		VkAttachmentLoadOp loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+		VkAttachmentStoreOp storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	};
+
+	struct Resource {
+		const char* name;
+		VkFormat format;
+		VkExtent2D extent;
+		bool imported;
+		bool transient;
+		bool output;
+		VkImageLayout finalLayout;
+		std::vector<VkImage> images;
+		std::vector<VkImageView> views;
+
+		// Filled in by compile
+		VkImageUsageFlags usage = 0;
+		AllocatedImage allocation{};
+		// Placed into the shared transient memory instead of having an allocation of its own
+		bool placed = false;
+		VkDeviceSize memoryOffset = 0;
+		VkDeviceSize memorySize = 0;
+		int32_t firstPass = -1;
+		int32_t lastPass = -1;
+		// Transient images placed over the same memory
+		std::vector<ResourceId> aliases;
+
+		// Tracked while executing and carried over to the next frame
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags writeStages = 0;
+		VkAccessFlags writeAccess = 0;
+		// Readers since the last write, a write has to wait for them
+		VkPipelineStageFlags readStages = 0;
+	};
+
+	struct Pass {
+		const char* name;
+		Callback callback;
+		std::vector<Use> uses;
+		bool sideEffects = false;
+		std::function<VkExtent2D()> renderArea;
+
+		// Filled in by compile
+		bool culled = false;
+		VkRenderPass renderPass = VK_NULL_HANDLE;
+		// One per imported image when an attachment is imported
+		std::vector<VkFramebuffer> framebuffers;
+		VkExtent2D framebufferExtent;
+		std::vector<VkClearValue> clearValues;
+	};
+
+	bool hasAttachments(const Pass& pass) const;
+	void cullPasses();
+	void inferAttachmentOps();
+	MaybeVulkanError createImages();
+	MaybeVulkanError placeTransientImages(std::vector<ResourceId>& transients);
+	MaybeVulkanError createRenderPass(Pass& pass);
+	void recordBarriers(VkCommandBuffer cmd, const Pass& pass, uint32_t importIndex, uint32_t passIndex);
+	void destroy();
+
+	std::vector<Resource> _resources;
+	std::vector<Pass> _passes;
+	VmaAllocation _transientMemory = VK_NULL_HANDLE;
+	VkDeviceSize _aliasedBytes = 0;
+};
+
+} // End of namespace Graph
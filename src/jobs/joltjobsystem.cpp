@@ -0,0 +1,53 @@
+#include "joltjobsystem.h"
+
+#include <chrono>
+#include <thread>
+
+#include "threadpool.h"
+
+namespace Jobs {
+
+JoltJobSystem::JoltJobSystem(uint32_t maxJobs, uint32_t maxBarriers) {
+	JobSystemWithBarrier::Init(maxBarriers);
+	_jobs.Init(maxJobs, maxJobs);
+}
+
+int JoltJobSystem::GetMaxConcurrency() const {
+	return static_cast<int>(WorkerPool.threadCount());
+}
+
+JPH::JobSystem::JobHandle JoltJobSystem::CreateJob(const char* inName, JPH::ColorArg inColor, const JobFunction& inJobFunction, JPH::uint32 inNumDependencies) {
+	JPH::uint32 index;
+	// Every job slot is taken only if the pool is too small for the physics settings
+	while ((index = _jobs.ConstructObject(inName, inColor, this, inJobFunction, inNumDependencies)) == decltype(_jobs)::cInvalidObjectIndex) {
+		JPH_ASSERT(false, "No jobs available!");
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+	Job* job = &_jobs.Get(index);
+
+	// Keeps the job alive even if it runs and finishes before we return
+	JobHandle handle(job);
+	if (inNumDependencies == 0)
+		QueueJob(job);
+	return handle;
+}
+
+void JoltJobSystem::QueueJob(Job* inJob) {
+	// The queued task holds a reference until the job ran
+	inJob->AddRef();
+	WorkerPool.submit([inJob]() {
+		inJob->Execute();
+		inJob->Release();
+	}, nullptr, Priority::High);
+}
+
+void JoltJobSystem::QueueJobs(Job** inJobs, JPH::uint inNumJobs) {
+	for (JPH::uint i = 0; i < inNumJobs; i++)
+		QueueJob(inJobs[i]);
+}
+
+void JoltJobSystem::FreeJob(Job* inJob) {
+	_jobs.DestructObject(inJob);
+}
+
+} // End of namespace Jobs
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <Jolt/Jolt.h>
+#include <Jolt/Core/FixedSizeFreeList.h>
+#include <Jolt/Core/JobSystemWithBarrier.h>
+
+namespace Jobs {
+
+/*!
+ * \brief Runs Jolt's jobs on the engine's worker pool
+ *
+ * Jobs go in at high priority since the physics step blocks the frame.
+ * Barriers come from JobSystemWithBarrier, a thread waiting on one runs its ready jobs itself.
+ */
+class JoltJobSystem final: public JPH::JobSystemWithBarrier {
+public:
+	JoltJobSystem(uint32_t maxJobs, uint32_t maxBarriers);
+
+	int GetMaxConcurrency() const override;
+	JobHandle CreateJob(const char* inName, JPH::ColorArg inColor, const JobFunction& inJobFunction, JPH::uint32 inNumDependencies = 0) override;
+protected:
+	void QueueJob(Job* inJob) override;
+	void QueueJobs(Job** inJobs, JPH::uint inNumJobs) override;
+	void FreeJob(Job* inJob) override;
+private:
+	JPH::FixedSizeFreeList<Job> _jobs;
+};
+
+} // End of namespace Jobs
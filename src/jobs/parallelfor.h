@@ -0,0 +1,30 @@
+#pragma once
+
+#include <entt/entt.hpp>
+
+#include <tuple>
+#include <vector>
+
+#include "threadpool.h"
+
+namespace Jobs {
+
+/*!
+ * \brief Calls body(entity, components...) for every entity of an EnTT view, spread over the worker pool
+ *
+ * Entities are gathered on the calling thread first, so the view may be of any shape.
+ * Empty (tag) components are not passed to the body. The body must only touch its own
+ * entity's components and must not add or remove components of the viewed types.
+ */
+template<typename View, typename Body>
+void parallelFor(View view, Body&& body, uint32_t chunkSize = 64, Priority priority = Priority::Normal) {
+	const std::vector<entt::entity> entities(view.begin(), view.end());
+	WorkerPool.parallelFor(entities.size(), chunkSize, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; i++) {
+			const entt::entity entity = entities[i];
+			std::apply([&](auto&... components) { body(entity, components...); }, view.get(entity));
+		}
+	}, priority);
+}
+
+} // End of namespace Jobs
@@ -0,0 +1,153 @@
+#include "threadpool.h"
+
+#include <fmt/format.h>
+
+#include "src/profiling/profiler.h"
+
+namespace Jobs {
+
+namespace {
+
+constexpr uint32_t NOT_A_WORKER = UINT32_MAX;
+thread_local uint32_t workerIndex = NOT_A_WORKER;
+
+} // End of anonymous namespace
+
+ThreadPool::ThreadPool() {
+	const uint32_t workers = std::max(1u, std::thread::hardware_concurrency()) - 1;
+	for (uint32_t i = 0; i <= workers; i++)
+		_queues.push_back(std::make_unique<Queue>());
+	for (uint32_t i = 0; i < workers; i++)
+		_workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard lock(_sleepMutex);
+		_stop = true;
+	}
+	_wake.notify_all();
+	for (std::thread& worker: _workers)
+		worker.join();
+}
+
+void ThreadPool::submit(Task&& task, TaskCounter* counter, Priority priority) {
+	if (counter != nullptr)
+		counter->_pending.fetch_add(1, std::memory_order_relaxed);
+	push({ std::move(task), counter, priority });
+}
+
+void ThreadPool::submitAfter(TaskCounter& dependency, Task&& task, TaskCounter* counter, Priority priority) {
+	if (counter != nullptr)
+		counter->_pending.fetch_add(1, std::memory_order_relaxed);
+
+	Job job { std::move(task), counter, priority };
+	{
+		// The last task of the dependency takes the same lock before releasing continuations
+		std::lock_guard lock(dependency._mutex);
+		if (!dependency.done()) {
+			dependency._continuations.push_back(std::move(job));
+			return;
+		}
+	}
+	push(std::move(job));
+}
+
+void ThreadPool::push(Job&& job) {
+	// Without workers the task runs right away
+	if (_workers.empty()) {
+		execute(job);
+		return;
+	}
+
+	Queue& queue = *_queues[localQueue()];
+	{
+		std::lock_guard lock(queue.mutex);
+		queue.jobs[static_cast<size_t>(job.priority)].push_back(std::move(job));
+	}
+	_queued.fetch_add(1, std::memory_order_release);
+	// Taking the lock orders this with a worker checking _queued right before it sleeps
+	{
+		std::lock_guard lock(_sleepMutex);
+	}
+	_wake.notify_one();
+}
+
+bool ThreadPool::runOne() {
+	const uint32_t queue = localQueue();
+	for (size_t i = 0; i < PRIORITY_COUNT; i++) {
+		const Priority priority = static_cast<Priority>(i);
+		std::optional<Job> job = pop(queue, priority);
+		if (!job) job = steal(queue, priority);
+		if (job) {
+			execute(*job);
+			return true;
+		}
+	}
+	return false;
+}
+
+void ThreadPool::wait(TaskCounter& counter) {
+	while (!counter.done()) {
+		if (!runOne())
+			std::this_thread::yield();
+	}
+}
+
+void ThreadPool::workerLoop(uint32_t index) {
+	workerIndex = index;
+	ProfileMan.setThreadName(fmt::format("Worker {}", index));
+
+	while (true) {
+		if (runOne()) continue;
+
+		std::unique_lock lock(_sleepMutex);
+		_wake.wait(lock, [this]() { return _stop || _queued.load(std::memory_order_acquire) > 0; });
+		if (_stop) return;
+	}
+}
+
+uint32_t ThreadPool::localQueue() const {
+	return workerIndex == NOT_A_WORKER ? _queues.size() - 1 : workerIndex;
+}
+
+std::optional<Job> ThreadPool::pop(uint32_t queue, Priority priority) {
+	Queue& own = *_queues[queue];
+	std::lock_guard lock(own.mutex);
+	std::deque<Job>& jobs = own.jobs[static_cast<size_t>(priority)];
+	if (jobs.empty()) return std::nullopt;
+	Job job = std::move(jobs.back());
+	jobs.pop_back();
+	_queued.fetch_sub(1, std::memory_order_relaxed);
+	return job;
+}
+
+std::optional<Job> ThreadPool::steal(uint32_t thief, Priority priority) {
+	for (uint32_t i = 1; i < _queues.size(); i++) {
+		Queue& victim = *_queues[(thief + i) % _queues.size()];
+		std::lock_guard lock(victim.mutex);
+		std::deque<Job>& jobs = victim.jobs[static_cast<size_t>(priority)];
+		if (jobs.empty()) continue;
+		Job job = std::move(jobs.front());
+		jobs.pop_front();
+		_queued.fetch_sub(1, std::memory_order_relaxed);
+		return job;
+	}
+	return std::nullopt;
+}
+
+void ThreadPool::execute(Job& job) {
+	job.task();
+	if (job.counter == nullptr) return;
+
+	std::vector<Job> ready;
+	{
+		std::lock_guard lock(job.counter->_mutex);
+		if (job.counter->_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			ready.swap(job.counter->_continuations);
+	}
+	for (Job& continuation: ready)
+		push(std::move(continuation));
+}
+
+} // End of namespace Jobs
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "src/singleton.h"
+
+namespace Jobs {
+
+using Task = std::function<void()>;
+
+// Queued tasks of a higher priority are always taken first, by every thread
+enum class Priority: uint8_t {
+	// On the critical path of the frame, e.g. the physics step
+	High,
+	Normal,
+	// Background work that may take several frames
+	Low,
+
+	Count
+};
+
+constexpr size_t PRIORITY_COUNT = static_cast<size_t>(Priority::Count);
+
+class TaskCounter;
+
+struct Job {
+	Task task;
+	TaskCounter* counter;
+	Priority priority;
+};
+
+/*!
+ * \brief Tracks tasks submitted with it that have not finished yet
+ *
+ * Tasks submitted with ThreadPool::submitAfter() are held back until the counter drops to zero.
+ * A counter must outlive its tasks: destroy it only after ThreadPool::wait() returned.
+ */
+class TaskCounter {
+public:
+	TaskCounter() = default;
+	// Waits for a task finishing right now to let go of the counter
+	~TaskCounter() { std::lock_guard lock(_mutex); };
+
+	TaskCounter(const TaskCounter&) = delete;
+	TaskCounter& operator=(const TaskCounter&) = delete;
+
+	bool done() const { return _pending.load(std::memory_order_acquire) == 0; };
+private:
+	friend class ThreadPool;
+
+	std::atomic<uint32_t> _pending{0};
+	std::mutex _mutex;
+	std::vector<Job> _continuations;
+};
+
+/*!
+ * \brief Work-stealing pool of worker threads shared by the whole engine
+ *
+ * Every worker owns a queue and takes its newest task first, idle workers steal the oldest
+ * tasks of the others. Threads outside the pool share one more queue. Waiting on a counter
+ * runs queued tasks instead of blocking, so tasks may wait on tasks they submitted.
+ * Jolt runs its jobs here as well, see JoltJobSystem.
+ */
+class ThreadPool: public Singleton<ThreadPool> {
+public:
+	// One worker per hardware thread, minus the main thread
+	ThreadPool();
+	~ThreadPool();
+
+	void submit(Task&& task, TaskCounter* counter = nullptr, Priority priority = Priority::Normal);
+	// Queues the task once every task of the dependency finished
+	void submitAfter(TaskCounter& dependency, Task&& task, TaskCounter* counter = nullptr, Priority priority = Priority::Normal);
+	// Runs one queued task on the calling thread, false if there was nothing to run
+	bool runOne();
+	void wait(TaskCounter& counter);
+
+	// Runs body(begin, end) over [0, count) in chunks, the calling thread takes the first one
+	template<typename Body>
+	void parallelFor(uint32_t count, uint32_t chunkSize, Body&& body, Priority priority = Priority::Normal) {
+		if (count == 0) return;
+		chunkSize = std::max(chunkSize, 1u);
+		TaskCounter counter;
+		for (uint32_t begin = chunkSize; begin < count; begin += chunkSize) {
+			const uint32_t end = std::min(count, begin + chunkSize);
+			submit([&body, begin, end]() { body(begin, end); }, &counter, priority);
+		}
+		body(0, std::min(count, chunkSize));
+		wait(counter);
+	}
+
+	// Workers and the thread helping them
+	uint32_t threadCount() const { return _workers.size() + 1; };
+	// Of the calling thread, below threadCount(). Threads outside the pool all get the last one
+	uint32_t threadIndex() const { return localQueue(); };
+private:
+	struct Queue {
+		std::mutex mutex;
+		std::array<std::deque<Job>, PRIORITY_COUNT> jobs;
+	};
+
+	void workerLoop(uint32_t index);
+	uint32_t localQueue() const;
+	void push(Job&& job);
+	std::optional<Job> pop(uint32_t queue, Priority priority);
+	std::optional<Job> steal(uint32_t thief, Priority priority);
+	void execute(Job& job);
+
+	// One per worker, the last one is shared by outside threads
+	std::vector<std::unique_ptr<Queue>> _queues;
+	std::vector<std::thread> _workers;
+	std::atomic<uint32_t> _queued{0};
+	std::mutex _sleepMutex;
+	std::condition_variable _wake;
+	bool _stop = false;
+};
+
+} // End of namespace Jobs
+
+#define WorkerPool Jobs::ThreadPool::instance()
@@ -0,0 +1,96 @@
+#include "clusteredlights.h"
+
+#include <cmath>
+
+#include "src/devicesingleton.h"
+#include "src/vk_initializers.h"
+#include "src/vk_operations.h"
+
+namespace Lighting {
+
+tl::expected<delFunc, VulkanError*> ClusteredLights::init(VkShaderModule cullShader) {
+	VkDescriptorSetLayoutBinding bindings[] = {
+		vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 0),
+		vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1),
+		vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 2),
+		vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 3)
+	};
+	VkDescriptorSetLayoutCreateInfo setInfo = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.bindingCount = std::size(bindings),
+		.pBindings = bindings
+	};
+	auto layoutResult = vkcommand::createDescriptorSetLayout(&setInfo);
+	VK_UNEXPECTED_ERROR(layoutResult, "Failed to create descriptor set layout for light culling");
+	_setLayout = layoutResult.value();
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.setLayoutCount = 1,
+		.pSetLayouts = &_setLayout,
+		.pushConstantRangeCount = 0,
+		.pPushConstantRanges = nullptr
+	};
+	auto pipeLayoutResult = vkcommand::createPipelineLayout(pipelineLayoutInfo);
+	VK_UNEXPECTED_ERROR(pipeLayoutResult, "Failed to create light culling pipeline layout");
+	_pipelineLayout = pipeLayoutResult.value();
+
+	VkComputePipelineCreateInfo pipelineInfo = {
+		.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.stage = {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			.pNext = nullptr,
+			.flags = 0,
+			.stage = VK_SHADER_STAGE_COMPUTE_BIT,
+			.module = cullShader,
+			.pName = "main"
+		},
+		.layout = _pipelineLayout
+	};
+	auto pipelineResult = vkcommand::createComputePipeline(VK_NULL_HANDLE, pipelineInfo);
+	VK_UNEXPECTED_ERROR(pipelineResult, "Failed to create light culling pipeline");
+	_pipeline = pipelineResult.value();
+
+	return [=]() {
+		vkDestroyPipeline(DeviceRef(), _pipeline, nullptr);
+		vkDestroyPipelineLayout(DeviceRef(), _pipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(DeviceRef(), _setLayout, nullptr);
+	};
+}
+
+GPUClusterParams ClusteredLights::makeParams(const GPUCameraData& camera, VkExtent2D framebufferSize, uint32_t lightCount) {
+	const glm::vec2 size = { framebufferSize.width, framebufferSize.height };
+	// Slice of view depth z is log(z) * scale + bias
+	const float scale = CLUSTER_GRID_Z / std::log(CLUSTER_FAR / CLUSTER_NEAR);
+	const float bias = -std::log(CLUSTER_NEAR) * scale;
+	return GPUClusterParams{
+		.view = camera.view,
+		.inverseProj = glm::inverse(camera.proj),
+		.tileSize = glm::vec4(glm::ceil(size / glm::vec2(CLUSTER_GRID_X, CLUSTER_GRID_Y)), size),
+		.depthSlices = glm::vec4(scale, bias, CLUSTER_NEAR, CLUSTER_FAR),
+		.lightCount = glm::uvec4(lightCount, 0, 0, 0)
+	};
+}
+
+void ClusteredLights::build(VkCommandBuffer cmd, Frame& frame) {
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _pipelineLayout, 0, 1, &frame.lightCullDescriptor, 0, nullptr);
+	// One thread per cluster
+	vkCmdDispatch(cmd, (CLUSTER_COUNT + 63) / 64, 1, 1);
+
+	VkMemoryBarrier barrier = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.pNext = nullptr,
+		.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_SHADER_READ_BIT
+	};
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+} // End of namespace Lighting
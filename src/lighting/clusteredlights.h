@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+#include <expected.hpp>
+#include <glm/glm.hpp>
+
+#include "src/deletionqueue.h"
+#include "src/error.h"
+#include "src/frame.h"
+#include "src/gpustructs.h"
+
+namespace Lighting {
+
+/*!
+ * \brief Clustered forward lighting
+ *
+ * The view frustum is split into a CLUSTER_GRID_X x CLUSTER_GRID_Y grid of screen tiles and
+ * CLUSTER_GRID_Z exponential depth slices. A compute pass tests every point light against
+ * every cluster and writes per-cluster light lists, which lit fragment shaders walk instead
+ * of the whole light buffer.
+ */
+class ClusteredLights {
+public:
+	// Fragments outside of this depth range get no point lights
+	static constexpr float CLUSTER_NEAR = 0.1f;
+	static constexpr float CLUSTER_FAR = 1000.f;
+
+	tl::expected<delFunc, VulkanError*> init(VkShaderModule cullShader);
+
+	VkDescriptorSetLayout getSetLayout() const { return _setLayout; };
+
+	static GPUClusterParams makeParams(const GPUCameraData& camera, VkExtent2D framebufferSize, uint32_t lightCount);
+
+	// Must be recorded outside of a render pass, before anything is shaded
+	void build(VkCommandBuffer cmd, Frame& frame);
+private:
+	VkDescriptorSetLayout _setLayout;
+	VkPipelineLayout _pipelineLayout;
+	VkPipeline _pipeline;
+};
+
+} // End of namespace Lighting
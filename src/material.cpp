@@ -61,7 +61,7 @@ tl::expected<VkPipeline, VulkanError*> PipelineBuilder::build_pipeline(VkDevice
 
 		.logicOpEnable = VK_FALSE,
 		.logicOp = VK_LOGIC_OP_COPY,
-		.attachmentCount = 1,
+		.attachmentCount = _colorAttachmentCount,
 		.pAttachments = &_colorBlendAttachment,
 	};
 
@@ -26,6 +26,8 @@ public:
 	VkPipelineMultisampleStateCreateInfo _multisampling;
 	VkPipelineLayout _pipelineLayout;
 	VkPipelineDepthStencilStateCreateInfo _depthStencil;
+	// Set to 0 for depth-only passes
+	uint32_t _colorAttachmentCount = 1;
 
     PipelineBuilder& addFragmentShader(VkShaderModule& shader);
     PipelineBuilder& addVertexShader(VkShaderModule& shader);
@@ -0,0 +1,238 @@
+#include "simplifier.h"
+
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <tuple>
+#include <utility>
+
+// Open borders get a perpendicular plane with this weight so silhouettes don't shrink
+constexpr double BOUNDARY_WEIGHT = 10.0;
+// Collapses that turn a face further than ~80 degrees are rejected
+constexpr float FLIP_THRESHOLD = 0.2f;
+
+MeshSimplifier::Quadric MeshSimplifier::Quadric::fromPlane(glm::vec3 normal, float distance, double weight) {
+    Quadric q;
+    const double a = normal.x, b = normal.y, c = normal.z, d = distance;
+    q.a2 = weight * a * a; q.ab = weight * a * b; q.ac = weight * a * c; q.ad = weight * a * d;
+    q.b2 = weight * b * b; q.bc = weight * b * c; q.bd = weight * b * d;
+    q.c2 = weight * c * c; q.cd = weight * c * d;
+    q.d2 = weight * d * d;
+    return q;
+}
+
+MeshSimplifier::Quadric& MeshSimplifier::Quadric::operator+=(const Quadric& other) {
+    a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+    b2 += other.b2; bc += other.bc; bd += other.bd;
+    c2 += other.c2; cd += other.cd;
+    d2 += other.d2;
+    return *this;
+}
+
+double MeshSimplifier::Quadric::evaluate(glm::vec3 point) const {
+    const double x = point.x, y = point.y, z = point.z;
+    return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+        + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+        + c2 * z * z + 2 * cd * z
+        + d2;
+}
+
+MeshSimplifier::MeshSimplifier(const std::vector<Vertex>& vertices): _corners(vertices) {
+    // Weld corners with identical positions
+    std::map<std::tuple<float, float, float>, uint32_t> welded;
+    std::vector<uint32_t> cornerVertex(_corners.size());
+    for (size_t i = 0; i < _corners.size(); i++) {
+        const glm::vec3& position = _corners[i].position;
+        auto [it, inserted] = welded.try_emplace({position.x, position.y, position.z}, _positions.size());
+        if (inserted)
+            _positions.push_back(position);
+        cornerVertex[i] = it->second;
+    }
+
+    _quadrics.resize(_positions.size());
+    _versions.resize(_positions.size(), 0);
+    _vertexTriangles.resize(_positions.size());
+
+    const size_t triangleCount = _corners.size() / 3;
+    _triangles.resize(triangleCount);
+    _triangleAlive.resize(triangleCount, false);
+
+    std::map<std::pair<uint32_t, uint32_t>, std::vector<uint32_t>> edges;
+    for (uint32_t t = 0; t < triangleCount; t++) {
+        std::array<uint32_t, 3> triangle = { cornerVertex[3 * t], cornerVertex[3 * t + 1], cornerVertex[3 * t + 2] };
+        _triangles[t] = triangle;
+        if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2])
+            continue;
+
+        glm::vec3 normal = glm::cross(_positions[triangle[1]] - _positions[triangle[0]], _positions[triangle[2]] - _positions[triangle[0]]);
+        float length = glm::length(normal);
+        if (length == 0.f)
+            continue;
+        normal /= length;
+
+        _triangleAlive[t] = true;
+        _liveTriangles++;
+
+        Quadric plane = Quadric::fromPlane(normal, -glm::dot(normal, _positions[triangle[0]]), 1.0);
+        for (int k = 0; k < 3; k++) {
+            _quadrics[triangle[k]] += plane;
+            _vertexTriangles[triangle[k]].push_back(t);
+
+            uint32_t a = triangle[k], b = triangle[(k + 1) % 3];
+            edges[{std::min(a, b), std::max(a, b)}].push_back(t);
+        }
+    }
+
+    for (auto& [edge, triangles]: edges) {
+        if (triangles.size() == 1) {
+            const auto& triangle = _triangles[triangles[0]];
+            glm::vec3 faceNormal = glm::normalize(glm::cross(_positions[triangle[1]] - _positions[triangle[0]], _positions[triangle[2]] - _positions[triangle[0]]));
+            glm::vec3 edgeDirection = _positions[edge.second] - _positions[edge.first];
+            glm::vec3 borderNormal = glm::cross(edgeDirection, faceNormal);
+            float length = glm::length(borderNormal);
+            if (length > 0.f) {
+                borderNormal /= length;
+                Quadric border = Quadric::fromPlane(borderNormal, -glm::dot(borderNormal, _positions[edge.first]), BOUNDARY_WEIGHT);
+                _quadrics[edge.first] += border;
+                _quadrics[edge.second] += border;
+            }
+        }
+    }
+
+    for (auto& [edge, triangles]: edges) {
+        pushCollapse(edge.first, edge.second);
+    }
+}
+
+void MeshSimplifier::pushCollapse(uint32_t first, uint32_t second) {
+    Quadric quadric = _quadrics[first];
+    quadric += _quadrics[second];
+
+    // Subset placement: either endpoint or the middle of the edge
+    const glm::vec3 candidates[3] = { _positions[first], _positions[second], (_positions[first] + _positions[second]) * 0.5f };
+    int best = 0;
+    double bestCost = quadric.evaluate(candidates[0]);
+    for (int i = 1; i < 3; i++) {
+        double cost = quadric.evaluate(candidates[i]);
+        if (cost < bestCost) {
+            bestCost = cost;
+            best = i;
+        }
+    }
+
+    uint32_t keep = best == 1 ? second : first;
+    uint32_t remove = best == 1 ? first : second;
+    _queue.push({
+        .cost = std::max(bestCost, 0.0),
+        .keep = keep,
+        .remove = remove,
+        .keepVersion = _versions[keep],
+        .removeVersion = _versions[remove],
+        .target = candidates[best]
+    });
+}
+
+bool MeshSimplifier::flipsTriangles(uint32_t vertex, uint32_t other, glm::vec3 target) const {
+    for (uint32_t t: _vertexTriangles[vertex]) {
+        if (!_triangleAlive[t])
+            continue;
+        const auto& triangle = _triangles[t];
+        // Triangles on the collapsed edge disappear anyway
+        if (triangle[0] == other || triangle[1] == other || triangle[2] == other)
+            continue;
+
+        glm::vec3 before[3], after[3];
+        for (int k = 0; k < 3; k++) {
+            before[k] = _positions[triangle[k]];
+            after[k] = triangle[k] == vertex ? target : before[k];
+        }
+        glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+        glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+        float lengths = glm::length(normalBefore) * glm::length(normalAfter);
+        if (lengths == 0.f || glm::dot(normalBefore, normalAfter) < FLIP_THRESHOLD * lengths)
+            return true;
+    }
+    return false;
+}
+
+void MeshSimplifier::collapse(const Collapse& edge) {
+    const uint32_t keep = edge.keep, remove = edge.remove;
+
+    _positions[keep] = edge.target;
+    _quadrics[keep] += _quadrics[remove];
+    _versions[keep]++;
+    _versions[remove]++;
+    _maxCost = std::max(_maxCost, edge.cost);
+
+    for (uint32_t t: _vertexTriangles[remove]) {
+        if (!_triangleAlive[t])
+            continue;
+        auto& triangle = _triangles[t];
+        bool degenerate = false;
+        for (int k = 0; k < 3; k++) {
+            if (triangle[k] == keep)
+                degenerate = true;
+            if (triangle[k] == remove)
+                triangle[k] = keep;
+        }
+        if (degenerate) {
+            _triangleAlive[t] = false;
+            _liveTriangles--;
+        } else {
+            _vertexTriangles[keep].push_back(t);
+        }
+    }
+    _vertexTriangles[remove].clear();
+
+    auto& keepTriangles = _vertexTriangles[keep];
+    keepTriangles.erase(std::remove_if(keepTriangles.begin(), keepTriangles.end(), [&](uint32_t t) { return !_triangleAlive[t]; }), keepTriangles.end());
+
+    // Edges around the kept vertex have new costs now
+    std::vector<uint32_t> neighbours;
+    for (uint32_t t: keepTriangles) {
+        for (uint32_t vertex: _triangles[t]) {
+            if (vertex != keep)
+                neighbours.push_back(vertex);
+        }
+    }
+    std::sort(neighbours.begin(), neighbours.end());
+    neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+    for (uint32_t neighbour: neighbours) {
+        pushCollapse(keep, neighbour);
+    }
+}
+
+std::vector<Vertex> MeshSimplifier::simplify(size_t targetTriangles) {
+    while (_liveTriangles > targetTriangles && !_queue.empty()) {
+        Collapse edge = _queue.top();
+        _queue.pop();
+
+        // Either end was changed after this entry was queued
+        if (edge.keepVersion != _versions[edge.keep] || edge.removeVersion != _versions[edge.remove])
+            continue;
+
+        if (flipsTriangles(edge.keep, edge.remove, edge.target) || flipsTriangles(edge.remove, edge.keep, edge.target))
+            continue;
+
+        collapse(edge);
+    }
+
+    std::vector<Vertex> result;
+    result.reserve(_liveTriangles * 3);
+    for (size_t t = 0; t < _triangles.size(); t++) {
+        if (!_triangleAlive[t])
+            continue;
+        for (int k = 0; k < 3; k++) {
+            Vertex vertex = _corners[3 * t + k];
+            vertex.position = _positions[_triangles[t][k]];
+            result.push_back(vertex);
+        }
+    }
+    return result;
+}
+
+float MeshSimplifier::error() const {
+    return static_cast<float>(std::sqrt(_maxCost));
+}
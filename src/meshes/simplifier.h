@@ -0,0 +1,65 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <vector>
+
+#include "src/vk_mesh.h"
+
+/*!
+ * \brief Quadric error metric simplifier for triangle lists
+ *
+ * Corners that share a position are welded together, then edges are collapsed
+ * cheapest-first (Garland & Heckbert). Corners keep their own normal, color and UV,
+ * only positions move. Simplification is progressive: every simplify() call
+ * continues from where the previous one stopped.
+ */
+class MeshSimplifier {
+public:
+    MeshSimplifier(const std::vector<Vertex>& vertices);
+
+    // Collapses edges until at most targetTriangles are left or nothing can be collapsed anymore
+    std::vector<Vertex> simplify(size_t targetTriangles);
+
+    size_t triangleCount() const { return _liveTriangles; };
+    // Object-space distance estimate of the worst collapse done so far
+    float error() const;
+
+private:
+    struct Quadric {
+        // Upper triangle of the symmetric 4x4 matrix
+        double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+
+        static Quadric fromPlane(glm::vec3 normal, float distance, double weight);
+        Quadric& operator+=(const Quadric& other);
+        double evaluate(glm::vec3 point) const;
+    };
+
+    struct Collapse {
+        double cost;
+        uint32_t keep, remove;
+        uint32_t keepVersion, removeVersion;
+        glm::vec3 target;
+
+        bool operator>(const Collapse& other) const { return cost > other.cost; };
+    };
+
+    void pushCollapse(uint32_t first, uint32_t second);
+    bool flipsTriangles(uint32_t vertex, uint32_t other, glm::vec3 target) const;
+    void collapse(const Collapse& edge);
+
+    std::vector<Vertex> _corners;
+    std::vector<glm::vec3> _positions;
+    std::vector<Quadric> _quadrics;
+    std::vector<uint32_t> _versions;
+    std::vector<std::vector<uint32_t>> _vertexTriangles;
+    std::vector<std::array<uint32_t, 3>> _triangles;
+    std::vector<bool> _triangleAlive;
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> _queue;
+    size_t _liveTriangles = 0;
+    double _maxCost = 0.0;
+};
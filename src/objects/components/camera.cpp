@@ -33,10 +33,15 @@ void Camera::updateProjection() {
     }
 }
 
+glm::vec3 Camera::directionFromPYR(glm::vec3 orientationPYR) {
+    return glm::vec3(
+        glm::cos(orientationPYR.y) * glm::cos(orientationPYR.x),
+        glm::sin(orientationPYR.y),
+        glm::sin(orientationPYR.x) * glm::cos(orientationPYR.y));
+}
+
 void Camera::updateRotation() {
-    _rotation.x = glm::cos(_orientationPYR.y) * glm::cos(_orientationPYR.x);
-    _rotation.y = glm::sin(_orientationPYR.y);
-    _rotation.z = glm::sin(_orientationPYR.x) * glm::cos(_orientationPYR.y);
+    _rotation = directionFromPYR(_orientationPYR);
 }
 
 void Camera::updateCameraData() {
@@ -44,6 +49,17 @@ void Camera::updateCameraData() {
     _data.viewproj = _data.proj * _data.view;
 }
 
+GPUCameraData Camera::latched() const {
+    const std::optional<CameraPose> pose = _lateLatch ? _lateLatch() : std::nullopt;
+    if (!pose) return _data;
+
+    // Only the view changes, the projection stays the one of the update
+    GPUCameraData data = _data;
+    data.view = glm::lookAt(pose->position, pose->position + directionFromPYR(pose->orientationPYR), glm::vec3(0, 1, 0));
+    data.viewproj = data.proj * data.view;
+    return data;
+}
+
 void Camera::setPosition(glm::vec3 position) {
     _position = position;
     updateCameraData();
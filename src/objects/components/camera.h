@@ -1,5 +1,8 @@
 #pragma once
 
+#include <functional>
+#include <optional>
+
 #include "base.h"
 #include "src/gpustructs.h"
 
@@ -13,6 +16,14 @@ enum class CameraPurpose {
     LightTarget = 2,
 };
 
+struct CameraPose {
+    glm::vec3 position;
+    glm::vec3 orientationPYR;
+};
+
+// Where the camera would be with the look input that arrived after the frame's update, nothing if none did
+using CameraLateLatch = std::function<std::optional<CameraPose>()>;
+
 class Camera: public ComponentBase {
 public:
     Camera(const Object &self, glm::vec3 position, glm::vec3 orientationPYR, glm::vec2 viewportSize, CameraPurpose purpose);
@@ -25,6 +36,10 @@ public:
 
     void setPosition(glm::vec3 position);
     void setOrientation(glm::vec3 orientationPYR);
+    // Set by the camera's controller, asked right before the frame is recorded
+    void setLateLatch(CameraLateLatch latch) { _lateLatch = std::move(latch); };
+    // Camera data with the late latched pose, the data from the last update without one
+    GPUCameraData latched() const;
 
     glm::vec3 getPosition() { return _position; };
     glm::vec3 getOrientation() { return _orientationPYR; };
@@ -34,9 +49,11 @@ protected:
     inline void updateProjection();
     inline void updateRotation();
     inline void updateCameraData();
+    static glm::vec3 directionFromPYR(glm::vec3 orientationPYR);
     glm::vec2 _viewportSize;
     glm::vec3 _position, _rotation, _orientationPYR;
     CameraProjection _projectionType;
     CameraPurpose _purpose;
     GPUCameraData _data;
+    CameraLateLatch _lateLatch;
 };
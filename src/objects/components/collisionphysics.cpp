@@ -10,6 +10,7 @@
 
 #include "collisionphysics.h"
 #include "src/physics/physicsman.h"
+#include "src/physics/shapecache.h"
 
 CollisionPhysicsComponent::CollisionPhysicsComponent(Object &self, JPH::ShapeRefC shape, watch_ptr<TransformComponent> transform):  
 	ComponentBase(self), _created(false), _inSimulation(false), _callbacks({self}) {
@@ -88,21 +89,21 @@ MaybeError CollisionPhysicsComponent::update(float delta) {
 }
 
 CollisionPhysicsComponent CollisionPhysicsComponent::Box(Object &self, Vec3 halfExtents, watch_ptr<TransformComponent> transform) { 
-	JPH::ShapeRefC boxShape = JPH::BoxShapeSettings(halfExtents).Create().Get();
+	JPH::ShapeRefC boxShape = ShapeCacheMan.box(halfExtents);
 	return CollisionPhysicsComponent(self, boxShape, transform); 
 }
 
 CollisionPhysicsComponent CollisionPhysicsComponent::Cylinder(Object &self, float halfHeight, float radius, watch_ptr<TransformComponent> transform) { 
-	JPH::ShapeRefC boxShape = JPH::CylinderShapeSettings(halfHeight, radius).Create().Get();
+	JPH::ShapeRefC boxShape = ShapeCacheMan.cylinder(halfHeight, radius);
 	return CollisionPhysicsComponent(self, boxShape, transform); 
 }
 
 CollisionPhysicsComponent CollisionPhysicsComponent::Capsule(Object &self, float halfHeight, float radius, watch_ptr<TransformComponent> transform) { 
-	JPH::ShapeRefC boxShape = JPH::CapsuleShapeSettings(halfHeight, radius).Create().Get();
+	JPH::ShapeRefC boxShape = ShapeCacheMan.capsule(halfHeight, radius);
 	return CollisionPhysicsComponent(self, boxShape, transform); 
 }
 
 CollisionPhysicsComponent CollisionPhysicsComponent::Sphere(Object &self, float radius, watch_ptr<TransformComponent> transform) { 
-	JPH::ShapeRefC boxShape = JPH::SphereShapeSettings(radius).Create().Get();
+	JPH::ShapeRefC boxShape = ShapeCacheMan.sphere(radius);
 	return CollisionPhysicsComponent(self, boxShape, transform);
 }
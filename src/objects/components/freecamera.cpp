@@ -94,6 +94,8 @@ void FreeCamera::initListener() {
     EventMan.addBinding(_rotateRightStr, Events::kKeyRight);
 
     EventMan.add2DAxisBinding(_rotateMouseStr, Events::kMousePosition);
+
+    _cam->setLateLatch([this]() { return latch(); });
 }
 
 void FreeCamera::handleMovement(const Events::Event &event) {
@@ -165,16 +167,29 @@ void FreeCamera::handleRotation(const Events::Event &event) {
 	}
 }
 
-MaybeError FreeCamera::update(float delta) {
+glm::vec3 FreeCamera::rotate(glm::vec3 PYR, glm::vec2 input, float delta) const {
     constexpr double cameraPitchLimit = glm::pi<float>() / 2 - 1e-5;
-    // fmt::println("Pos input: {} {} {}", _positionInput.x, _positionInput.y, _positionInput.z);
-    // fmt::println("Rot input: {} {}", _rotationInput.x, _rotationInput.y);
-	_PYR.x += glm::radians(_rotationInput.x * delta * rotateFactor);
-	_PYR.y -= glm::radians(_rotationInput.y * delta * rotateFactor);
+	PYR.x += glm::radians(input.x * delta * rotateFactor);
+	PYR.y -= glm::radians(input.y * delta * rotateFactor);
 	// roll is not used so far
-	// _PYR.z += glm::radians(_rotationInput.z * delta * rotateFactor);
+	// PYR.z += glm::radians(input.z * delta * rotateFactor);
 	// limit pitch to -90..90 degree range
-	_PYR.y = glm::clamp(double(_PYR.y), -cameraPitchLimit, cameraPitchLimit);
+	PYR.y = glm::clamp(double(PYR.y), -cameraPitchLimit, cameraPitchLimit);
+    return PYR;
+}
+
+std::optional<CameraPose> FreeCamera::latch() const {
+    const glm::vec2 look = EventMan.queuedAxisDelta(_rotateMouseHash);
+    if (look == glm::vec2(0.f)) return std::nullopt;
+    // The next update turns by the same amount, only with its own delta
+    return CameraPose{ _position, rotate(_PYR, look, _lastDelta) };
+}
+
+MaybeError FreeCamera::update(float delta) {
+    // fmt::println("Pos input: {} {} {}", _positionInput.x, _positionInput.y, _positionInput.z);
+    // fmt::println("Rot input: {} {}", _rotationInput.x, _rotationInput.y);
+    _lastDelta = delta;
+    _PYR = rotate(_PYR, _rotationInput, delta);
     // fmt::println("Camera: {} {}", _PYR.x, _PYR.y);
     _cam->setOrientation(_PYR);
     const glm::vec3 direction = _cam->getRotation();
@@ -17,11 +17,15 @@ public:
 private:
  	void handleMovement(const Events::Event &event);
 	void handleRotation(const Events::Event &event);
+	glm::vec3 rotate(glm::vec3 PYR, glm::vec2 input, float delta) const;
+	// Pose with the mouse look still waiting in the event queue
+	std::optional<CameraPose> latch() const;
 
     watch_ptr<Camera> _cam;
     glm::vec3 _PYR, _position;
     glm::vec2 _rotationInput;
     glm::vec3 _positionInput;
+    float _lastDelta = 0.f;
 
     // Event references
     std::string _moveUpStr, _moveDownStr, _moveLeftStr, _moveRightStr, _moveBackStr, _moveForwardsStr, _rotateMouseStr, _rotateLeftStr, _rotateRightStr, _rotateUpStr, _rotateDownStr;
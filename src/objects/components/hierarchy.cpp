@@ -4,7 +4,15 @@
 
 MaybeError HierarchyComponent::setParent(Object parentTarget) {
     // TODO: check for cycles in hierarchy and error+abort when found
-    _parentId = parentTarget.getID();
+    if (_parentId != parentTarget.getID()) {
+        Object oldParent = _self.another(_parentId);
+        if (_parentId != entt::null && oldParent.hasComponent<HierarchyComponent>()) {
+            watch_ptr<HierarchyComponent> oldHierarchy = oldParent.getComponent<HierarchyComponent>();
+            std::erase(oldHierarchy->children, _self.getID());
+        }
+        _parentId = parentTarget.getID();
+        _self.getLevel()->_hierarchy.invalidate();
+    }
     watch_ptr<HierarchyComponent> parentHierarchy = parentTarget.getComponentDefault<HierarchyComponent>();
     return parentHierarchy->addChild(_self);
 }
@@ -18,10 +26,33 @@ MaybeError HierarchyComponent::addChild(Object childTarget) {
     // TODO: make object printable with fmt
     if (hasChild(childTarget)) return std::nullopt;
     children.push_back(childTarget.getID());
+    _self.getLevel()->_hierarchy.invalidate();
     watch_ptr<HierarchyComponent> childH = childTarget.getComponentDefault<HierarchyComponent>();
     return childH->setParent(_self);
 }
 
+MaybeError HierarchyComponent::removeChild(Object childTarget) {
+    if (!hasChild(childTarget)) return std::nullopt;
+    std::erase(children, childTarget.getID());
+    if (childTarget.hasComponent<HierarchyComponent>()) {
+        watch_ptr<HierarchyComponent> childH = childTarget.getComponent<HierarchyComponent>();
+        childH->_parentId = entt::null;
+        childH->clearLocalTransform();
+    }
+    _self.getLevel()->_hierarchy.invalidate();
+    return std::nullopt;
+}
+
+void HierarchyComponent::setLocalTransform(const glm::mat4 &local) {
+    _inheritanceFlags.set(static_cast<size_t>(InheritanceFlag::LOCAL_TRANSFORM));
+    _localTransform = local;
+    _self.getLevel()->_hierarchy.markDirty(_self.getID());
+}
+
+void HierarchyComponent::clearLocalTransform() {
+    _inheritanceFlags.reset(static_cast<size_t>(InheritanceFlag::LOCAL_TRANSFORM));
+}
+
 entityList HierarchyComponent::allChildren() {
     entityList result = children;
     entityList queue = children;
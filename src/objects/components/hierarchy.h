@@ -1,5 +1,7 @@
 #pragma once
 
+#include <glm/glm.hpp>
+
 #include <bitset>
 #include <vector>
 
@@ -7,8 +9,6 @@
 #include "src/error.h"
 #include "src/objects/object.h"
 
-using entityList = std::vector<entt::entity>;
-
 enum class InheritanceFlag {
     LOCAL_TRANSFORM = 0,
 };
@@ -32,7 +32,16 @@ public:
     entityList allChildren();
     entityList leafChildren();
 
+    // Makes the transform follow the parent's one: world = parent's world * local
+    void setLocalTransform(const glm::mat4 &local);
+    // Stops following the parent, the transform stays where it was last put
+    void clearLocalTransform();
+    bool inheritsTransform() const { return _inheritanceFlags.test(static_cast<size_t>(InheritanceFlag::LOCAL_TRANSFORM)); };
+    const glm::mat4& getLocalTransform() const { return _localTransform; };
+
     entt::entity _parentId = entt::null;
-    // std::bitset<32> _inheritanceFlags;
     entityList children;    
+private:
+    std::bitset<32> _inheritanceFlags;
+    glm::mat4 _localTransform { 1.f };
 };
@@ -17,7 +17,7 @@ OrbitalCamera::OrbitalCamera(const Object &self, watch_ptr<Camera> camera, watch
         origin->getTranslation()
     };
 
-    _position = calcOrbitPosition();
+    _position = calcOrbitPosition(_PYR);
 
     initListener();
 }
@@ -74,6 +74,8 @@ void OrbitalCamera::initListener() {
     EventMan.addBinding(_rotateRightStr, Events::kKeyRight);
 
     EventMan.add2DAxisBinding(_rotateMouseStr, Events::kMousePosition);
+
+    _cam->setLateLatch([this]() { return latch(); });
 }
 
 void OrbitalCamera::handleRotation(const Events::Event &event) {
@@ -110,13 +112,32 @@ void OrbitalCamera::handleRotation(const Events::Event &event) {
 	}
 }
 
-glm::vec3 OrbitalCamera::calcOrbitPosition(float radius) {
+glm::vec3 OrbitalCamera::rotate(glm::vec3 PYR, glm::vec2 input, float delta) const {
+	// Get target look direction as pitch and yaw values
+	// roll (_rotationAttitude.z) is not used so far
+	PYR.x += glm::radians(input.x * delta * rotateFactor);
+	PYR.y -= glm::radians(input.y * delta * rotateFactor);
+	// limit pitch to -60..60 degree range 
+	constexpr float cameraPitchLimit = M_PI_2 / 3 * 2;
+	PYR.y = glm::clamp(PYR.y, -cameraPitchLimit, cameraPitchLimit);
+	return PYR;
+}
+
+std::optional<CameraPose> OrbitalCamera::latch() const {
+	const glm::vec2 look = EventMan.queuedAxisDelta(_rotateMouseHash);
+	if (look == glm::vec2(0.f)) return std::nullopt;
+	// The orbit keeps its origin, only the angle around it moves ahead
+	const glm::vec3 PYR = rotate(_PYR, look, _lastDelta);
+	return CameraPose{ calcOrbitPosition(PYR, _orbitRadiusBase), PYR };
+}
+
+glm::vec3 OrbitalCamera::calcOrbitPosition(const glm::vec3& PYR, float radius) const {
 	// Convert camera direction from pitch and yaw 
 	// to a 3D vector
 	glm::vec3 _rotationDirection = glm::normalize(glm::vec3(
-		cos(_PYR.y) * cos(_PYR.x),
-		sin(_PYR.y),
-		sin(_PYR.x) * cos(_PYR.y)));
+		cos(PYR.y) * cos(PYR.x),
+		sin(PYR.y),
+		sin(PYR.x) * cos(PYR.y)));
 
 	// const glm::vec3 right = glm::cross(_up, _rotationDirection);
 
@@ -150,15 +171,10 @@ MaybeError OrbitalCamera::update(float delta) {
     _origin.target = _orbitOrigin->getTranslation();
 	_origin.current = glm::mix(_origin.current, _origin.target, lerpCoefSnappy);
 
-	// Get target look direction as pitch and yaw values
-	// roll (_rotationAttitude.z) is not used so far
-	_PYR.x += glm::radians(_rotationInput.x * delta * rotateFactor);
-	_PYR.y -= glm::radians(_rotationInput.y * delta * rotateFactor);
-	// limit pitch to -60..60 degree range 
-	constexpr float cameraPitchLimit = M_PI_2 / 3 * 2;
-	_PYR.y = glm::clamp(_PYR.y, -cameraPitchLimit, cameraPitchLimit);
+	_lastDelta = delta;
+	_PYR = rotate(_PYR, _rotationInput, delta);
 
-	_position = calcOrbitPosition(_orbitRadiusBase);
+	_position = calcOrbitPosition(_PYR, _orbitRadiusBase);
     _cam->setPosition(_position);
     _cam->setOrientation(_PYR);
 
@@ -18,7 +18,10 @@ public:
     MaybeError update(float delta) override;
 private:
 	void handleRotation(const Events::Event &event);
-	glm::vec3 calcOrbitPosition(float radius = 10.f);
+	glm::vec3 rotate(glm::vec3 PYR, glm::vec2 input, float delta) const;
+	// Pose with the mouse look still waiting in the event queue
+	std::optional<CameraPose> latch() const;
+	glm::vec3 calcOrbitPosition(const glm::vec3& PYR, float radius = 10.f) const;
 
     struct Lerpable {
         glm::vec3 current, target;
@@ -28,6 +31,7 @@ private:
     watch_ptr<TransformComponent> _orbitOrigin;
     glm::vec3 _PYR, _position;
     glm::vec2 _rotationInput;
+    float _lastDelta = 0.f;
     Lerpable _origin;
     const float _orbitRadiusBase = 10.f;
 
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#include "base.h"
+
+// Spawns GPU particles at the object's transform, see Particles::ParticleSystem
+class ParticleEmitter: public ComponentBase {
+public:
+	ParticleEmitter(const Object &self, float _rate, uint32_t _budget):
+		ComponentBase(self), rate(_rate), budget(_budget) {};
+
+	// Particles per second
+	float rate;
+	// Emission stops while this many particles of the emitter are alive
+	uint32_t budget;
+	float lifetime = 2.f;
+	float size = 0.1f;
+	// Particles spawn inside a sphere of this radius
+	float spawnRadius = 0.f;
+	glm::vec3 velocity{0.f, 5.f, 0.f};
+	float velocitySpread = 1.f;
+	glm::vec4 color{1.f, 0.6f, 0.2f, 1.f};
+
+	// Whole particles to spawn this frame, the fractional rest carries over
+	uint32_t takeSpawnCount(float delta) {
+		_spawnCarry += rate * delta;
+		const float whole = std::floor(_spawnCarry);
+		_spawnCarry -= whole;
+		return std::min(static_cast<uint32_t>(whole), budget);
+	};
+private:
+	float _spawnCarry = 0.f;
+};
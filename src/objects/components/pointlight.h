@@ -0,0 +1,16 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "base.h"
+
+// Point light placed at the object's transform, shaded through the clustered light grid
+class PointLight: public ComponentBase {
+public:
+	PointLight(const Object &self, glm::vec3 _color, float _intensity, float _radius):
+		ComponentBase(self), color(_color), intensity(_intensity), radius(_radius) {};
+	glm::vec3 color;
+	float intensity;
+	// Light has no effect past this distance
+	float radius;
+};
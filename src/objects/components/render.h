@@ -8,4 +8,6 @@ public:
         ComponentBase(self), mesh(_mesh), material(_material) {};
 	Mesh* mesh;
 	Material* material;
+	// LOD picked last frame, kept for hysteresis
+	uint32_t lod = 0;
 };
@@ -4,11 +4,12 @@
 #include <Jolt/Physics/Collision/Shape/SphereShape.h>
 
 #include "src/physics/physicsman.h"
+#include "src/physics/shapecache.h"
 
 #include "rigidbody.h"
 
 RigidBodyComponent::RigidBodyComponent(Object &self, JPH::ShapeRefC shape, watch_ptr<TransformComponent> transform, RigidBodyType type, std::optional<float> mass):
-	ComponentBase(self), _created(false), _inSimulation(false), _callbacks({self}) {
+	ComponentBase(self), _created(false), _callbacks({self}) {
 	_transform = transform;
 	const glm::vec3 position = transform->getTranslation();
 	const glm::quat rotation = transform->getOrientation();
@@ -40,6 +41,16 @@ RigidBodyComponent::RigidBodyComponent(Object &self, JPH::ShapeRefC shape, watch
 	_initSettings.mUserData = reinterpret_cast<JPH::uint64>(&_callbacks);
 }
 
+RigidBodyComponent::RigidBodyComponent(Object &self, const JPH::BodyCreationSettings &settings, watch_ptr<TransformComponent> transform):
+	ComponentBase(self), _created(false), _initSettings(settings), _callbacks({self}) {
+	_transform = transform;
+	const glm::vec3 position = transform->getTranslation();
+	const glm::quat rotation = transform->getOrientation();
+	_initSettings.mPosition = JPH::Vec3(position.x, position.y, position.z);
+	_initSettings.mRotation = JPH::Quat(rotation.x, rotation.y, rotation.z, rotation.w);
+	_initSettings.mUserData = reinterpret_cast<JPH::uint64>(&_callbacks);
+}
+
 MaybeError RigidBodyComponent::create() {
 	std::optional<Physics::NewBodyData> maybeBody = PhysicsMan.createBody(_initSettings);
 	if (!maybeBody.has_value()) {
@@ -51,6 +62,7 @@ MaybeError RigidBodyComponent::create() {
 	// _body->SetUserData(reinterpret_cast<JPH::uint64>(this));
 	_id = bodydata.id;
 	_created = true;
+	bindTransform();
 	return std::nullopt;
 }
 
@@ -65,28 +77,104 @@ MaybeError RigidBodyComponent::createAndAdd() {
 	// _body->SetUserData(reinterpret_cast<JPH::uint64>(this));
 	_id = bodydata.id;
 	_created = true;
-	_inSimulation = true;
+	bindTransform();
+	return std::nullopt;
+}
+
+MaybeError RigidBodyComponent::createAndAddBatch(std::span<RigidBodyComponent*> bodies) {
+	std::vector<JPH::BodyID> ids;
+	ids.reserve(bodies.size());
+	for (size_t i = 0; i < bodies.size(); i++) {
+		auto result = bodies[i]->create();
+		if (result.has_value()) {
+			// Nothing was added yet, so the batch goes away as a whole
+			for (size_t created = 0; created < i; created++)
+				bodies[created]->destroy();
+			return result;
+		}
+		ids.push_back(bodies[i]->_id);
+	}
+	PhysicsMan.addBodies(ids);
 	return std::nullopt;
 }
 
+RigidBodyComponent::RigidBodyComponent(RigidBodyComponent&& other) noexcept:
+	ComponentBase(other._self), _body(other._body), _transform(other._transform), _id(other._id),
+	_created(other._created), _initSettings(other._initSettings), _callbacks(std::move(other._callbacks)) {
+	other._id = JPH::BodyID();
+	other._body = watch_ptr<JPH::Body>();
+	other._created = false;
+	pointUserData();
+}
+
+RigidBodyComponent& RigidBodyComponent::operator=(RigidBodyComponent&& other) noexcept {
+	if (this == &other) return *this;
+	destroy();
+	_self = other._self;
+	_body = other._body;
+	_transform = other._transform;
+	_id = other._id;
+	_created = other._created;
+	_initSettings = other._initSettings;
+	_callbacks = std::move(other._callbacks);
+	other._id = JPH::BodyID();
+	other._body = watch_ptr<JPH::Body>();
+	other._created = false;
+	pointUserData();
+	return *this;
+}
+
 RigidBodyComponent::~RigidBodyComponent() {
-	if (_inSimulation)
+	destroy();
+}
+
+void RigidBodyComponent::pointUserData() {
+	_initSettings.mUserData = reinterpret_cast<JPH::uint64>(&_callbacks);
+	if (_created) _body->SetUserData(_initSettings.mUserData);
+}
+
+void RigidBodyComponent::destroy() {
+	if (_id.IsInvalid()) return;
+	PhysicsMan.unbindTransform(_id);
+	if (isSimulated())
 		PhysicsMan.removeBody(_id);
 	PhysicsMan.destroyBody(_id);
+	_id = JPH::BodyID();
+	_body = watch_ptr<JPH::Body>();
+	_created = false;
+}
+
+void RigidBodyComponent::bindTransform() {
+	PhysicsMan.bindTransform(_id, _transform->getStorage(), _transform->getSlot());
+}
+
+JPH::BodyCreationSettings RigidBodyComponent::getCreationSettings() const {
+	// Setters only change the live body once it exists, the shape is still the shared one
+	if (_created) return _body->GetBodyCreationSettings();
+	return _initSettings;
+}
+
+bool RigidBodyComponent::isSimulated() const {
+	return _created && PhysicsMan.isAdded(_id);
 }
 
 void RigidBodyComponent::add() {
 	PhysicsMan.addBody(_id);
-	_inSimulation = true;
 }
 
 void RigidBodyComponent::remove() {
 	PhysicsMan.removeBody(_id);
-	_inSimulation = false;
 }
 
 void RigidBodyComponent::scheduleRemove() {
-	_toRemove = true;
+	PhysicsMan.scheduleRemove(_id);
+}
+
+void RigidBodyComponent::reset() {
+	const glm::vec3 position = _transform->getTranslation();
+	const glm::quat rotation = _transform->getOrientation();
+	PhysicsMan.resetBody(_id, JPH::Vec3(position.x, position.y, position.z), JPH::Quat(rotation.x, rotation.y, rotation.z, rotation.w));
+	PhysicsMan.cancelRemove(_id);
 }
 
 glm::vec3 RigidBodyComponent::GetPosition() const {
@@ -105,19 +193,6 @@ void RigidBodyComponent::setVelocity(Vec3 velocity) {
 	_body->SetLinearVelocity(velocity);
 }
 
-MaybeError RigidBodyComponent::update(float delta) {
-	// Update transform
-	if (_toRemove) {
-		remove();
-		_toRemove = false;
-	}
-	if (_inSimulation) {
-		_transform->setMatrix(_body->GetWorldTransform());
-	}
-
-    return std::nullopt;
-}
-
 void RigidBodyComponent::applyCentralImpulseAngular(Vec3 impulse) {
 	_body->AddImpulse(impulse);
 	_body->AddTorque(impulse);
@@ -147,23 +222,31 @@ void RigidBodyComponent::setRestitution(float restitution) {
 	}
 }
 
+void RigidBodyComponent::setLayer(JPH::ObjectLayer layer) {
+	if (_created) {
+		PhysicsMan.setObjectLayer(_id, layer);
+	} else {
+		_initSettings.mObjectLayer = layer;
+	}
+}
+
 RigidBodyComponent RigidBodyComponent::Box(Object &self, Vec3 halfExtents, watch_ptr<TransformComponent> transform) { 
-	JPH::ShapeRefC boxShape = JPH::BoxShapeSettings(halfExtents).Create().Get();
+	JPH::ShapeRefC boxShape = ShapeCacheMan.box(halfExtents);
 	return RigidBodyComponent(self, boxShape, transform); 
 }
 
 RigidBodyComponent RigidBodyComponent::Cylinder(Object &self, float halfHeight, float radius, watch_ptr<TransformComponent> transform) { 
-	JPH::ShapeRefC boxShape = JPH::CylinderShapeSettings(halfHeight, radius).Create().Get();
+	JPH::ShapeRefC boxShape = ShapeCacheMan.cylinder(halfHeight, radius);
 	return RigidBodyComponent(self, boxShape, transform); 
 }
 
 RigidBodyComponent RigidBodyComponent::Capsule(Object &self, float halfHeight, float radius, watch_ptr<TransformComponent> transform) { 
-	JPH::ShapeRefC boxShape = JPH::CapsuleShapeSettings(halfHeight, radius).Create().Get();
+	JPH::ShapeRefC boxShape = ShapeCacheMan.capsule(halfHeight, radius);
 	return RigidBodyComponent(self, boxShape, transform); 
 }
 
 RigidBodyComponent RigidBodyComponent::Sphere(Object &self, float radius, watch_ptr<TransformComponent> transform) { 
-	JPH::ShapeRefC boxShape = JPH::SphereShapeSettings(radius).Create().Get();
+	JPH::ShapeRefC boxShape = ShapeCacheMan.sphere(radius);
 	return RigidBodyComponent(self, boxShape, transform);
 }
 
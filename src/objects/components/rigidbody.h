@@ -7,6 +7,8 @@
 #include <entt/entt.hpp>
 
 #include <optional>
+#include <span>
+#include <vector>
 
 #include "base.h"
 #include "render.h"
@@ -25,9 +27,18 @@ enum class RigidBodyType {
 
 class Object;
 
-struct RigidBodyComponent: public Update, public ComponentBase {
+// Transforms follow the bodies through PhysicsManager::syncTransforms(), not a per-body update.
+// The component owns its Jolt body, so it is move-only: EnTT relocates components when
+// others are destroyed, and a move hands the body over and re-points its user data
+struct RigidBodyComponent: public ComponentBase {
 public:
     RigidBodyComponent(Object &self, JPH::ShapeRefC shape, watch_ptr<TransformComponent> transform, RigidBodyType type = RigidBodyType::Dynamic, std::optional<float> mass = std::nullopt);
+    // Restores a body from saved settings, placed where the transform is
+    RigidBodyComponent(Object &self, const JPH::BodyCreationSettings &settings, watch_ptr<TransformComponent> transform);
+    RigidBodyComponent(const RigidBodyComponent&) = delete;
+    RigidBodyComponent& operator=(const RigidBodyComponent&) = delete;
+    RigidBodyComponent(RigidBodyComponent&& other) noexcept;
+    RigidBodyComponent& operator=(RigidBodyComponent&& other) noexcept;
     ~RigidBodyComponent();
 
     static RigidBodyComponent Box(Object &self, Vec3 halfExtents, watch_ptr<TransformComponent> transform);
@@ -40,13 +51,17 @@ public:
 
 	MaybeError create();
 	MaybeError createAndAdd();
+	// Creates every body, then inserts them into the physics system as one batch.
+	// If one fails, the bodies created before it are destroyed again
+	static MaybeError createAndAddBatch(std::span<RigidBodyComponent*> bodies);
 	void add();
 	void remove();
+	// Safe from contact callbacks, see PhysicsManager::scheduleRemove
 	void scheduleRemove();
+	// Puts the body where the transform is and stops it, drops a scheduled removal
+	void reset();
 
-	bool isSimulated() const { return _inSimulation; };
-
-	MaybeError update(float delta) override;
+	bool isSimulated() const;
 
 	void applyCentralImpulse(Vec3 impulse);
 	void applyTorque(Vec3 impulse);
@@ -59,8 +74,12 @@ public:
 	// Body creation settings
 	void setFriction(float friction);
 	void setRestitution(float restitution);
+	// A layer of PhysicsManager::layers(), instead of the one picked by the body type
+	void setLayer(JPH::ObjectLayer layer);
 
 	JPH::BodyID getID() { return _id; };
+	// Settings the body would be created with now, setters called after creation included
+	JPH::BodyCreationSettings getCreationSettings() const;
 
 	void setContactAddedCallback(Physics::ContactCallback callback) { _callbacks.onContactAdded = callback; };
 	watch_ptr<JPH::Body> _body;
@@ -69,8 +88,13 @@ private:
 	// Physics
 	watch_ptr<TransformComponent> _transform;
 	JPH::BodyID _id;
-	bool _created, _inSimulation;
+	bool _created;
 	JPH::BodyCreationSettings _initSettings;
 	Physics::PhysicalCallbacks _callbacks;
-	bool _toRemove = false;
+	// Binds the transform for syncTransforms() once the body exists
+	void bindTransform();
+	// Takes the body out of the physics system and destroys it, create() may be called again
+	void destroy();
+	// Callbacks live inside the component, bodies find them through their user data
+	void pointUserData();
 };
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+
+#include "base.h"
+
+// Tracks whether an object stopped moving, still objects go into the cached static shadow layer
+class ShadowCaster: public ComponentBase {
+public:
+	static constexpr uint32_t STILL_FRAMES = 30;
+
+	ShadowCaster(const Object &self, bool castsShadow = true): ComponentBase(self), _castsShadow(castsShadow) {};
+
+	// Returns true if the object joined or left the static set this frame
+	bool update(const glm::mat4& model) {
+		const bool wasStatic = _static;
+		if (model == _lastModel) {
+			_stillFrames = std::min(_stillFrames + 1, STILL_FRAMES);
+		} else {
+			_previousModel = _lastModel;
+			_lastModel = model;
+			_stillFrames = 0;
+		}
+		_static = _stillFrames >= STILL_FRAMES;
+		return wasStatic != _static;
+	};
+
+	bool isStatic() const { return _static; };
+	// Set to false for things like sky domes that would shadow the whole scene
+	bool castsShadow() const { return _castsShadow; };
+	// Matrix the object had before its last move, that's where its cached shadow is
+	const glm::mat4& previousModel() const { return _previousModel; };
+	// Matrix the object was last seen with, where a static object's shadow is cached
+	const glm::mat4& lastModel() const { return _lastModel; };
+	// Forgets the object's history, e.g. when it stops being rendered
+	void reset() {
+		_lastModel = glm::mat4(0.f);
+		_previousModel = glm::mat4(0.f);
+		_stillFrames = 0;
+		_static = false;
+	};
+private:
+	glm::mat4 _lastModel{0.f};
+	glm::mat4 _previousModel{0.f};
+	uint32_t _stillFrames = 0;
+	bool _static = false;
+	bool _castsShadow;
+};
@@ -1,180 +1,95 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/quaternion.hpp>
-#include <glm/gtx/matrix_decompose.hpp>
 #include <glm/gtx/euler_angles.hpp>
 #include <glm/gtc/type_ptr.hpp>
-#include <glm/gtx/transform.hpp>
 
 #include "transform.h"
 #include "src/gpustructs.h"
 
-const glm::vec3 TransformComponent::getTranslation() { 
-    if (_dirtyData) {
-        decompose();
-        _dirtyData = false;
+TransformComponent& TransformComponent::operator=(TransformComponent&& other) noexcept {
+    if (this != &other) {
+        if (_slot != INVALID_SLOT) _storage->release(_slot);
+        _self = other._self;
+        _storage = other._storage;
+        _slot = std::exchange(other._slot, INVALID_SLOT);
     }
-    return _translation; 
+    return *this;
+}
+
+TransformComponent::~TransformComponent() {
+    if (_slot != INVALID_SLOT) _storage->release(_slot);
+}
+
+const glm::vec3 TransformComponent::getTranslation() { 
+    return _storage->getTranslation(_slot);
 };
 
 const glm::vec3 TransformComponent::getScale() { 
-    if (_dirtyData) {
-        decompose();
-        _dirtyData = false;
-    }
-    return _scale; 
+    return _storage->getScale(_slot);
 };
 
 const glm::vec3 TransformComponent::getSkew() { 
-    if (_dirtyData) {
-        decompose();
-        _dirtyData = false;
-    }
-    return _skew; 
+    return _storage->getSkew(_slot);
 };
 
 const glm::quat TransformComponent::getOrientation() { 
-    if (_dirtyData) {
-        decompose();
-        _dirtyData = false;
-    }
-    return _orientation; 
+    return _storage->getOrientation(_slot);
 };
 
 const glm::vec3 TransformComponent::getEulerOrientation() {
-    if (_dirtyData) {
-        decompose();
-        _dirtyData = false;
-    }
-    return _euler;
+    return glm::eulerAngles(getOrientation());
 };
 
 const glm::vec4 TransformComponent::getPerspective() { 
-    if (_dirtyData) {
-        decompose();
-        _dirtyData = false;
-    }
-    return _perspective; 
+    return _storage->getPerspective(_slot);
 };
 
 const JPH::RMat44 TransformComponent::getJoltTransform() {
-    recalcIfDirty();
-    return JPH::Mat44::sLoadFloat4x4(reinterpret_cast<JPH::Float4*>(glm::value_ptr(_fullMatrix)));
+    return JPH::Mat44::sLoadFloat4x4(reinterpret_cast<const JPH::Float4*>(glm::value_ptr(_storage->getMatrix(_slot))));
 }
 
 const glm::mat4 TransformComponent::getMatrix() {
-    recalcIfDirty();
-    return _fullMatrix;
+    return _storage->getMatrix(_slot);
 }
 
 const GPUObjectData TransformComponent::getGPUMatrix() {
-    recalcIfDirty();
-    return {_fullMatrix};
+    return {_storage->getMatrix(_slot)};
 }
 
 void TransformComponent::setTranslation(const glm::vec3 &translation) {
-    if (_dirtyData) decompose();
-    _dirtyMatrix = true;
-    _dirtyData = false;
-    _translation = translation;
+    _storage->setTranslation(_slot, translation);
 };
 
 void TransformComponent::setScale(const glm::vec3 &scale) {
-    if (_dirtyData) decompose();
-    _dirtyMatrix = true;
-    _dirtyData = false;
-    _scale = scale;
+    _storage->setScale(_slot, scale);
 };
 
 void TransformComponent::setSkew(const glm::vec3 &skew) {
-    if (_dirtyData) decompose();
-    _dirtyMatrix = true;
-    _dirtyData = false;
-    _skew = skew;
+    _storage->setSkew(_slot, skew);
 };
 
 void TransformComponent::setOrientation(const glm::quat &orientation) {
-    if (_dirtyData) decompose();
-    _dirtyMatrix = true;
-    _dirtyData = false;
-    _orientation = orientation;
-    _euler = glm::eulerAngles(_orientation);
+    _storage->setOrientation(_slot, orientation);
 };
 
 void TransformComponent::setEulerOrientation(const glm::vec3 &euler) {
-    if (_dirtyData) decompose();
-    _dirtyMatrix = true;
-    _dirtyData = false;
-    _euler = euler;
-    _orientation = glm::toQuat(glm::orientate3(_euler));
+    _storage->setOrientation(_slot, glm::toQuat(glm::orientate3(euler)));
 };
 
 void TransformComponent::setPerspective(const glm::vec4 &perspective) {
-    if (_dirtyData) decompose();
-    _dirtyMatrix = true;
-    _dirtyData = false;
-    _perspective = perspective;
+    _storage->setPerspective(_slot, perspective);
 };
 
 void TransformComponent::setMatrix(const glm::mat4 &matrix) {
-    _dirtyData = true;
-    _dirtyMatrix = false;
-    _fullMatrix = matrix;
+    _storage->setMatrix(_slot, matrix);
 }
 
 void TransformComponent::setMatrix(JPH::Mat44Arg &matrix) {
-    _dirtyData = true;
-    _dirtyMatrix = false;
-    float * temp = new float[16];
-    matrix.StoreFloat4x4(reinterpret_cast<JPH::Float4*>(temp));
-    _fullMatrix = glm::make_mat4x4(temp);
+    JPH::Float4 temp[4];
+    matrix.StoreFloat4x4(temp);
+    _storage->setMatrix(_slot, glm::make_mat4x4(reinterpret_cast<const float*>(temp)));
 }
 
 void TransformComponent::setIdentity() {
-    _dirtyData = true;
-    _dirtyMatrix = false;
-    _fullMatrix = glm::identity<glm::mat4>();
-}
-
-void TransformComponent::decompose() {
-	glm::decompose(_fullMatrix, _scale, _orientation, _translation, _skew, _perspective);
-    glm::extractEulerAngleXYZ(_fullMatrix, _euler.x, _euler.y, _euler.z);
+    _storage->setMatrix(_slot, glm::identity<glm::mat4>());
 }
-
-void TransformComponent::recalcMatrix() {
-    _fullMatrix = glm::mat4(1.0f);
-
-    _fullMatrix[0][3] = _perspective.x;
-    _fullMatrix[1][3] = _perspective.y;
-    _fullMatrix[2][3] = _perspective.z;
-    _fullMatrix[3][3] = _perspective.w;
-
-    _fullMatrix *= glm::translate(_translation);
-    _fullMatrix *= glm::mat4_cast(_orientation);
-
-    if (_skew.x) {
-        glm::mat4 tmp { 1.f };
-        tmp[2][1] = _skew.x;
-        _fullMatrix *= tmp;
-    }
-
-    if (_skew.y) {
-        glm::mat4 tmp { 1.f };
-        tmp[2][0] = _skew.y;
-        _fullMatrix *= tmp;
-    }
-
-    if (_skew.z) {
-        glm::mat4 tmp { 1.f };
-        tmp[1][0] = _skew.z;
-        _fullMatrix *= tmp;
-    }
-
-    _fullMatrix *= glm::scale(_scale);
-}
-
-void TransformComponent::recalcIfDirty() {
-    if (_dirtyMatrix) {
-        recalcMatrix();
-        _dirtyMatrix = false;
-    }
-}
\ No newline at end of file
@@ -8,13 +8,16 @@
 
 #include "base.h"
 #include "src/gpustructs.h"
+#include "src/objects/transformstorage.h"
 
+// View of an object's slot in its level's TransformStorage
 struct TransformComponent: public ComponentBase {
-    // template<typename... Args>
-    // TransformComponent(Args&&... args): _fullMatrix(std::forward(args)...) {};
-    TransformComponent(const Object &self, glm::mat4 matrix): ComponentBase(self), _fullMatrix(matrix) { decompose(); };
-    TransformComponent(const Object &self): ComponentBase(self), _fullMatrix(1.0f) { decompose(); };
-    TransformComponent(TransformComponent& other): ComponentBase(other._self), _fullMatrix(other._fullMatrix) { decompose(); };
+    TransformComponent(const Object &self, glm::mat4 matrix): ComponentBase(self), _storage(&self.getLevel()->_transforms), _slot(_storage->allocate(matrix)) {};
+    TransformComponent(const Object &self): TransformComponent(self, glm::mat4(1.0f)) {};
+    TransformComponent(TransformComponent& other): ComponentBase(other._self), _storage(other._storage), _slot(_storage->allocate(other.getMatrix())) {};
+    TransformComponent(TransformComponent&& other) noexcept: ComponentBase(other._self), _storage(other._storage), _slot(std::exchange(other._slot, INVALID_SLOT)) {};
+    TransformComponent& operator=(TransformComponent&& other) noexcept;
+    ~TransformComponent();
 
     const glm::vec3 getTranslation();
     const glm::vec3 getScale();
@@ -35,6 +38,11 @@ struct TransformComponent: public ComponentBase {
     void setMatrix(const glm::mat4 &matrix);
     void setMatrix(JPH::Mat44Arg &matrix);
     void setIdentity();
+    // Whether the transform was written since the last call, see HierarchyOrder
+    bool takeChanged() { return _storage->takeChanged(_slot); };
+    // Where the transform lives, for passes that write many transforms directly
+    TransformStorage* getStorage() const { return _storage; };
+    TransformStorage::Slot getSlot() const { return _slot; };
 
     operator glm::mat4() { return getMatrix(); };
     operator JPH::RMat44() { return getJoltTransform(); };
@@ -42,15 +50,8 @@ struct TransformComponent: public ComponentBase {
     TransformComponent& operator=(glm::mat4 &matrix) { setMatrix(matrix); return *this; };
     TransformComponent& operator=(JPH::Mat44Arg &matrix) { setMatrix(matrix); return *this; };
 private:
-    glm::mat4 _fullMatrix;
+    static constexpr TransformStorage::Slot INVALID_SLOT = UINT32_MAX;
 
-    glm::vec3 _translation, _scale, _skew, _euler;
-    glm::vec4 _perspective;
-    glm::quat _orientation;
-
-    bool _dirtyMatrix, _dirtyData;
-
-    void recalcMatrix();
-    inline void recalcIfDirty();
-    void decompose();
+    TransformStorage* _storage;
+    TransformStorage::Slot _slot;
 };
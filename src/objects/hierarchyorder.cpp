@@ -0,0 +1,183 @@
+#include "hierarchyorder.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include "src/objects/components/hierarchy.h"
+#include "src/objects/components/transform.h"
+#include "src/jobs/threadpool.h"
+#include "src/profiling/profiler.h"
+
+struct HierarchyOrder::Pools {
+	entt::storage_for_t<TransformComponent>& transforms;
+	entt::storage_for_t<HierarchyComponent>& hierarchies;
+};
+
+const entityList& HierarchyOrder::getOrder(entt::registry& registry) {
+	if (!_valid) rebuild(registry);
+	return _order;
+}
+
+uint32_t HierarchyOrder::indexOf(entt::entity entity) const {
+	const size_t entityIndex = entt::to_entity(entity);
+	if (entityIndex >= _indices.size()) return NO_INDEX;
+	const uint32_t index = _indices[entityIndex];
+	// Index slots get reused by newer versions of the entity
+	return (index != NO_INDEX && _order[index] == entity) ? index : NO_INDEX;
+}
+
+void HierarchyOrder::rebuild(entt::registry& registry) {
+	PROFILE_SCOPE("Rebuild hierarchy order");
+	auto hierarchies = registry.view<HierarchyComponent>();
+
+	_order.clear();
+	_parents.clear();
+	_subtreeEnd.clear();
+	_withChildren.clear();
+
+	size_t maxEntity = 0;
+	std::vector<std::pair<entt::entity, uint32_t>> stack;
+	for (auto &&[entity, hierarchy]: hierarchies.each()) {
+		maxEntity = std::max<size_t>(maxEntity, entt::to_entity(entity));
+		const entt::entity parent = hierarchy.getParent();
+		if (parent == entt::null || !registry.valid(parent) || !hierarchies.contains(parent))
+			stack.emplace_back(entity, NO_INDEX);
+	}
+	_indices.assign(maxEntity + 1, NO_INDEX);
+	// Keep roots in registry order
+	std::reverse(stack.begin(), stack.end());
+
+	// Depth-first preorder, every subtree ends up contiguous
+	while (!stack.empty()) {
+		const auto [entity, parent] = stack.back();
+		stack.pop_back();
+		// Entities listed twice, or reached through a cycle, keep their first position
+		if (_indices[entt::to_entity(entity)] != NO_INDEX) continue;
+
+		const uint32_t index = _order.size();
+		_indices[entt::to_entity(entity)] = index;
+		_order.push_back(entity);
+		_parents.push_back(parent);
+
+		const entityList& children = hierarchies.get<HierarchyComponent>(entity).children;
+		for (auto it = children.rbegin(); it != children.rend(); it++) {
+			if (registry.valid(*it) && hierarchies.contains(*it))
+				stack.emplace_back(*it, index);
+		}
+	}
+
+	_subtreeEnd.resize(_order.size());
+	for (uint32_t index = 0; index < _order.size(); index++)
+		_subtreeEnd[index] = index + 1;
+	// Descendants come right after their ancestor, so walking backwards grows every subtree to its full size
+	for (uint32_t index = _order.size(); index-- > 0;) {
+		if (_parents[index] != NO_INDEX)
+			_subtreeEnd[_parents[index]] = std::max(_subtreeEnd[_parents[index]], _subtreeEnd[index]);
+	}
+	for (uint32_t index = 0; index < _order.size(); index++) {
+		if (_subtreeEnd[index] > index + 1)
+			_withChildren.push_back(index);
+	}
+
+	_valid = true;
+}
+
+size_t HierarchyOrder::propagate(entt::registry& registry) {
+	if (!_valid) rebuild(registry);
+	const Pools pools { registry.storage<TransformComponent>(), registry.storage<HierarchyComponent>() };
+
+	std::vector<Range> ranges;
+	// Parents moved, their children follow
+	for (uint32_t index: _withChildren) {
+		const entt::entity entity = _order[index];
+		if (pools.transforms.contains(entity) && pools.transforms.get(entity).takeChanged())
+			ranges.emplace_back(index + 1, _subtreeEnd[index]);
+	}
+	// Local transforms changed, the entity itself follows too
+	for (entt::entity entity: _dirty) {
+		const uint32_t index = indexOf(entity);
+		if (index != NO_INDEX)
+			ranges.emplace_back(index, _subtreeEnd[index]);
+	}
+	_dirty.clear();
+	if (ranges.empty()) return 0;
+
+	// Ranges are subtrees or runs of siblings, so they either nest or do not overlap at all
+	std::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) {
+		return a.first != b.first ? a.first < b.first : a.second > b.second;
+	});
+	size_t kept = 0;
+	size_t total = 0;
+	for (const Range& range: ranges) {
+		if (kept > 0 && range.first < ranges[kept - 1].second) continue;
+		ranges[kept++] = range;
+		total += range.second - range.first;
+	}
+	ranges.resize(kept);
+
+	const uint32_t threads = WorkerPool.threadCount();
+	if (threads == 1 || total < 2 * MIN_PARALLEL_RANGE) {
+		size_t written = 0;
+		for (const Range& range: ranges)
+			written += propagateRange(pools, range);
+		return written;
+	}
+
+	// A few times more ranges than threads evens out uneven subtrees
+	const uint32_t grain = std::max<uint32_t>(MIN_PARALLEL_RANGE, total / (threads * 4));
+	std::atomic<size_t> written = splitRanges(pools, ranges, grain);
+
+	WorkerPool.parallelFor(ranges.size(), 1, [&](uint32_t begin, uint32_t end) {
+		size_t count = 0;
+		for (uint32_t i = begin; i < end; i++)
+			count += propagateRange(pools, ranges[i]);
+		written.fetch_add(count, std::memory_order_relaxed);
+	});
+	return written.load();
+}
+
+size_t HierarchyOrder::splitRanges(const Pools& pools, std::vector<Range>& ranges, uint32_t grain) {
+	size_t written = 0;
+	std::vector<Range> result;
+	std::vector<Range> pending = std::move(ranges);
+	while (!pending.empty()) {
+		const Range range = pending.back();
+		pending.pop_back();
+		if (range.second - range.first <= grain) {
+			result.push_back(range);
+		} else if (_subtreeEnd[range.first] < range.second) {
+			for (uint32_t index = range.first; index < range.second; index = _subtreeEnd[index])
+				pending.emplace_back(index, _subtreeEnd[index]);
+		} else {
+			written += propagateNode(pools, range.first);
+			if (range.first + 1 < range.second)
+				pending.emplace_back(range.first + 1, range.second);
+		}
+	}
+	ranges = std::move(result);
+	return written;
+}
+
+size_t HierarchyOrder::propagateRange(const Pools& pools, Range range) {
+	size_t written = 0;
+	// Parents come first, so their world transforms are already up to date
+	for (uint32_t index = range.first; index < range.second; index++)
+		written += propagateNode(pools, index);
+	return written;
+}
+
+bool HierarchyOrder::propagateNode(const Pools& pools, uint32_t index) {
+	const uint32_t parent = _parents[index];
+	if (parent == NO_INDEX) return false;
+
+	const entt::entity entity = _order[index];
+	const HierarchyComponent& hierarchy = pools.hierarchies.get(entity);
+	if (!hierarchy.inheritsTransform()) return false;
+	if (!pools.transforms.contains(entity) || !pools.transforms.contains(_order[parent])) return false;
+
+	TransformComponent& transform = pools.transforms.get(entity);
+	transform.setMatrix(pools.transforms.get(_order[parent]).getMatrix() * hierarchy.getLocalTransform());
+	// Children are covered by the range already
+	transform.takeChanged();
+	return true;
+}
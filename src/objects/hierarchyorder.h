@@ -0,0 +1,63 @@
+#pragma once
+
+#include <entt/entt.hpp>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using entityList = std::vector<entt::entity>;
+
+/*!
+ * \brief Level's hierarchy flattened into a parents-first array
+ *
+ * Entities are stored in depth-first preorder, so every subtree is a contiguous range
+ * that ends at _subtreeEnd of its root. The array is only rebuilt after parenting changes.
+ * propagate() recomputes world transforms of children that inherit their parent's transform,
+ * visiting only the subtrees under transforms that changed since the last call.
+ */
+class HierarchyOrder {
+public:
+	// Parenting changed, the order is rebuilt on the next access
+	void invalidate() { _valid = false; };
+	// Local transform of the entity changed, its world transform has to be recomputed
+	void markDirty(entt::entity entity) { _dirty.push_back(entity); };
+
+	const entityList& getOrder(entt::registry& registry);
+
+	// Expects every transform to be composed, see TransformStorage::composeDirty()
+	// Returns the number of world transforms written
+	size_t propagate(entt::registry& registry);
+private:
+	// Below twice this many dirty entries everything stays on the calling thread
+	static constexpr uint32_t MIN_PARALLEL_RANGE = 256;
+	// Roots have no parent, entities without a hierarchy have no position
+	static constexpr uint32_t NO_INDEX = UINT32_MAX;
+
+	using Range = std::pair<uint32_t, uint32_t>;
+	// Component storages, fetched once so worker threads never touch the registry
+	struct Pools;
+
+	void rebuild(entt::registry& registry);
+	uint32_t indexOf(entt::entity entity) const;
+	/*!
+	 * \brief Splits ranges into sibling subtrees until none is bigger than the grain
+	 *
+	 * A range holding a single subtree has its root propagated right away, the remaining
+	 * ranges do not depend on each other. Returns the number of roots propagated
+	 */
+	size_t splitRanges(const Pools& pools, std::vector<Range>& ranges, uint32_t grain);
+	size_t propagateRange(const Pools& pools, Range range);
+	bool propagateNode(const Pools& pools, uint32_t index);
+
+	entityList _order;
+	std::vector<uint32_t> _parents;
+	// One past the last index of the subtree rooted at each entry
+	std::vector<uint32_t> _subtreeEnd;
+	// Entries with children, checked every propagation for changed transforms
+	std::vector<uint32_t> _withChildren;
+	// Position in _order by entity index
+	std::vector<uint32_t> _indices;
+	entityList _dirty;
+	bool _valid = false;
+};
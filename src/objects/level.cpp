@@ -1,7 +1,10 @@
 #include "object.h"
 #include "level.h"
+#include "components/hierarchy.h"
 
 Level::Level() {
+    _registry.on_construct<HierarchyComponent>().connect<&HierarchyOrder::invalidate>(_hierarchy);
+    _registry.on_destroy<HierarchyComponent>().connect<&HierarchyOrder::invalidate>(_hierarchy);
 }
 
 Object Level::addObject() {
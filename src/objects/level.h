@@ -3,6 +3,8 @@
 #include <entt/entt.hpp>
 
 #include "src/gpustructs.h"
+#include "src/objects/hierarchyorder.h"
+#include "src/objects/transformstorage.h"
 #include "src/update/update.h"
 
 class Object;
@@ -20,5 +22,8 @@ public:
 
     Object addObject();
 
+    // Declared before the registry so that components are destroyed while these still exist
+    TransformStorage _transforms;
+    HierarchyOrder _hierarchy;
     entt::registry _registry;
 };
@@ -43,7 +43,7 @@ public:
     Object another(entt::entity id) { return Object(_level, id); };
 
     entt::entity getID() const { return _id; };
-    Level* getLevel() { return _level; };
+    Level* getLevel() const { return _level; };
 private:
     entt::entity _id;
     Level* _level;
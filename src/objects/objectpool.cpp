@@ -0,0 +1,67 @@
+#include "objectpool.h"
+
+#include <algorithm>
+
+#include "src/scene.h"
+
+MaybeError ObjectPool::prewarm(size_t count) {
+	count = std::min(count, _limit - _size);
+	if (count == 0) return std::nullopt;
+
+	// Pooled objects are spawned hidden and with their bodies outside of the simulation
+	SpawnTemplate hidden = _spawn;
+	hidden.mesh = nullptr;
+	hidden.material = nullptr;
+	hidden.simulated = false;
+	const std::vector<glm::mat4> transforms(count, glm::mat4(1.f));
+	auto spawned = _scene->spawnBatch(hidden, transforms);
+	if (!spawned.has_value())
+		return new Error(spawned.error(), ErrorMessage("Could not prewarm an object pool with {} objects", count));
+
+	_size += count;
+	// Render components come back on acquire, their pool never has to grow then
+	auto& renders = _scene->getStorage<RenderObject>();
+	renders.reserve(renders.size() + _size);
+	_free.reserve(_size);
+	_free.insert(_free.end(), spawned->begin(), spawned->end());
+	return std::nullopt;
+}
+
+tl::expected<entt::entity, Error*> ObjectPool::acquire(const glm::mat4& transform) {
+	if (exhausted())
+		return tl::unexpected(new Error(ErrorMessage("Object pool has all of its {} objects in use", _size)));
+	if (_free.empty()) {
+		auto grown = prewarm(GROWTH_STEP);
+		if (grown.has_value())
+			return tl::unexpected(new Error(grown.value(), ErrorMessage("Object pool ran empty and could not grow")));
+	}
+	const entt::entity entity = _free.back();
+	_free.pop_back();
+
+	Object object = _scene->getObject(entity);
+	object.getComponent<TransformComponent>()->setMatrix(transform);
+	if (_spawn.mesh != nullptr && _spawn.material != nullptr)
+		object.addComponent<RenderObject>(_spawn.mesh, _spawn.material);
+	if (watch_ptr<RigidBodyComponent> body = object.getComponent<RigidBodyComponent>(); body) {
+		body->reset();
+		body->add();
+	}
+	return entity;
+}
+
+void ObjectPool::release(entt::entity entity) {
+	Object object = _scene->getObject(entity);
+	watch_ptr<HierarchyComponent> hierarchy = object.getComponent<HierarchyComponent>();
+	if (hierarchy && !hierarchy->hasRootParent()) {
+		Object parent = object.another(hierarchy->getParent());
+		if (watch_ptr<HierarchyComponent> parentHierarchy = parent.getComponent<HierarchyComponent>(); parentHierarchy)
+			parentHierarchy->removeChild(object);
+	}
+	if (watch_ptr<RigidBodyComponent> body = object.getComponent<RigidBodyComponent>(); body) {
+		if (body->isSimulated()) body->remove();
+		body->reset();
+	}
+	if (object.hasComponent<RenderObject>())
+		object.removeComponent<RenderObject>();
+	_free.push_back(entity);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <entt/entt.hpp>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "src/error.h"
+#include "src/objects/spawntemplate.h"
+
+class Scene;
+
+/*!
+ * \brief Recycles objects of one template together with their rigid bodies
+ *
+ * A released object keeps its entity, components and Jolt body. The body only leaves the
+ * physics system and the render component is dropped so nothing draws it. acquire() puts
+ * both back, so once the pool is warm, spawning and releasing allocate nothing and create
+ * no bodies. An empty pool grows by at most GROWTH_STEP objects per acquire(), so a pool
+ * that runs dry every frame spreads the new bodies over several frames, and never grows
+ * past its limit.
+ */
+class ObjectPool {
+public:
+	static constexpr size_t GROWTH_STEP = 16;
+
+	// A limit of 0 lets the pool grow without bound
+	ObjectPool(Scene* scene, const SpawnTemplate& spawn, size_t limit = 0): _scene(scene), _spawn(spawn), _limit(limit == 0 ? SIZE_MAX : limit) {};
+
+	// Creates count more objects, all of them waiting in the pool, clamped to the limit
+	MaybeError prewarm(size_t count);
+	// Fails once every object up to the limit is in use, check exhausted() first
+	tl::expected<entt::entity, Error*> acquire(const glm::mat4& transform);
+	// Also detaches the object from its parent, its own children are left alone
+	void release(entt::entity entity);
+
+	size_t size() const { return _size; };
+	size_t available() const { return _free.size(); };
+	bool exhausted() const { return _free.empty() && _size >= _limit; };
+	const SpawnTemplate& getTemplate() const { return _spawn; };
+private:
+	Scene* _scene;
+	SpawnTemplate _spawn;
+	std::vector<entt::entity> _free;
+	size_t _size = 0;
+	size_t _limit;
+};
@@ -0,0 +1,382 @@
+#include <Jolt/Jolt.h>
+#include <Jolt/Core/StreamIn.h>
+#include <Jolt/Core/StreamOut.h>
+#include <Jolt/Physics/Body/BodyCreationSettings.h>
+
+#include <cstring>
+#include <fstream>
+#include <span>
+
+#include "snapshot.h"
+#include "object.h"
+#include "components/hierarchy.h"
+#include "components/render.h"
+#include "components/rigidbody.h"
+#include "components/shadowcaster.h"
+#include "components/tag.h"
+#include "components/transform.h"
+
+namespace Snapshot {
+
+namespace {
+
+class MemoryStreamOut final: public JPH::StreamOut {
+public:
+	void WriteBytes(const void* data, size_t bytes) override {
+		const std::byte* begin = static_cast<const std::byte*>(data);
+		_data.insert(_data.end(), begin, begin + bytes);
+	};
+	bool IsFailed() const override { return false; };
+
+	std::vector<std::byte> _data;
+};
+
+class MemoryStreamIn final: public JPH::StreamIn {
+public:
+	MemoryStreamIn(std::span<const std::byte> data): _data(data) {};
+
+	void ReadBytes(void* data, size_t bytes) override {
+		if (_position + bytes > _data.size()) {
+			std::memset(data, 0, bytes);
+			_failed = true;
+			return;
+		}
+		std::memcpy(data, _data.data() + _position, bytes);
+		_position += bytes;
+	};
+	bool IsEOF() const override { return _position >= _data.size(); };
+	bool IsFailed() const override { return _failed; };
+private:
+	std::span<const std::byte> _data;
+	size_t _position = 0;
+	bool _failed = false;
+};
+
+// Numbers saved entities in the order they are first seen
+class EntityIndices {
+public:
+	uint32_t operator()(entt::entity entity) {
+		auto [it, inserted] = _indices.try_emplace(entity, _indices.size());
+		return it->second;
+	};
+	uint32_t count() const { return _indices.size(); };
+private:
+	std::unordered_map<entt::entity, uint32_t> _indices;
+};
+
+class SnapshotWriter {
+public:
+	SnapshotWriter() { _data.resize(sizeof(Header)); };
+
+	template<typename Record>
+	void addSection(Header& header, SectionKind kind, std::span<const Record> records) {
+		const uint64_t offset = (_data.size() + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+		const uint64_t size = records.size_bytes();
+		_data.resize(offset + size);
+		if (size > 0) std::memcpy(_data.data() + offset, records.data(), size);
+		header.sections[static_cast<size_t>(kind)] = { static_cast<uint32_t>(records.size()), sizeof(Record), offset, size };
+	};
+
+	MaybeError write(const Header& header, const std::string& path) {
+		std::memcpy(_data.data(), &header, sizeof(Header));
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			int errorCode = file.bad() | file.fail() << 1 | file.eof() << 2;
+			return new FileError(errorCode, ErrorMessage("Unable to open snapshot file \"{}\" for writing", path));
+		}
+		file.write(reinterpret_cast<const char*>(_data.data()), _data.size());
+		if (!file.good()) {
+			int errorCode = file.bad() | file.fail() << 1 | file.eof() << 2;
+			return new FileError(errorCode, ErrorMessage("Unable to write snapshot file \"{}\"", path));
+		}
+		return std::nullopt;
+	};
+private:
+	std::vector<std::byte> _data;
+};
+
+template<typename Record>
+tl::expected<std::span<const Record>, Error*> getSection(std::span<const std::byte> data, const Header& header, SectionKind kind) {
+	const Section& section = header.sections[static_cast<size_t>(kind)];
+	if (section.count == 0) return std::span<const Record>();
+	if (section.recordSize != sizeof(Record) || section.size != uint64_t(section.count) * sizeof(Record))
+		return tl::unexpected(new Error(ErrorMessage("Snapshot section {} has records of {} bytes, expected {}", static_cast<uint32_t>(kind), section.recordSize, sizeof(Record))));
+	if (section.offset % SECTION_ALIGNMENT != 0 || section.offset > data.size() || section.size > data.size() - section.offset)
+		return tl::unexpected(new Error(ErrorMessage("Snapshot section {} lies outside of the file", static_cast<uint32_t>(kind))));
+	return std::span<const Record>(reinterpret_cast<const Record*>(data.data() + section.offset), section.count);
+}
+
+struct Records {
+	std::span<const TransformRecord> transforms;
+	std::span<const RenderRecord> renders;
+	std::span<const HierarchyRecord> hierarchy;
+	std::span<const TagRecord> tags;
+	std::span<const char> tagNames;
+	std::span<const RigidBodyRecord> bodies;
+	std::span<const ShadowCasterRecord> shadowCasters;
+};
+
+// Checks every reference between records before anything is created, so only Jolt can fail later
+MaybeError validate(const Records& records, const AssetTable& assets, uint32_t entityCount, const std::string& path) {
+	auto corrupted = [&](uint32_t index) {
+		return new Error(ErrorMessage("Snapshot \"{}\" references entity {} out of {}", path, index, entityCount));
+	};
+
+	std::vector<bool> hasTransform(entityCount), hasHierarchy(entityCount);
+	for (const TransformRecord& record: records.transforms) {
+		if (record.entity >= entityCount) return corrupted(record.entity);
+		hasTransform[record.entity] = true;
+	}
+	for (const RenderRecord& record: records.renders) {
+		if (record.entity >= entityCount) return corrupted(record.entity);
+		if (assets.findMesh(record.mesh) == nullptr || assets.findMaterial(record.material) == nullptr)
+			return new Error(ErrorMessage("Snapshot \"{}\" uses mesh {:#x} or material {:#x} that is not loaded", path, record.mesh, record.material));
+	}
+	for (const HierarchyRecord& record: records.hierarchy) {
+		if (record.entity >= entityCount) return corrupted(record.entity);
+		hasHierarchy[record.entity] = true;
+	}
+	for (const HierarchyRecord& record: records.hierarchy) {
+		if (record.parent == NO_PARENT) continue;
+		if (record.parent >= entityCount) return corrupted(record.parent);
+		if (!hasHierarchy[record.parent])
+			return new Error(ErrorMessage("Snapshot \"{}\" has a parent {} without a hierarchy", path, record.parent));
+	}
+	for (const TagRecord& record: records.tags) {
+		if (record.entity >= entityCount) return corrupted(record.entity);
+		if (record.nameOffset > records.tagNames.size() || record.nameLength > records.tagNames.size() - record.nameOffset)
+			return new Error(ErrorMessage("Snapshot \"{}\" has a tag name outside of its section", path));
+	}
+	for (const ShadowCasterRecord& record: records.shadowCasters) {
+		if (record.entity >= entityCount) return corrupted(record.entity);
+	}
+	for (const RigidBodyRecord& record: records.bodies) {
+		if (record.entity >= entityCount) return corrupted(record.entity);
+		if (!hasTransform[record.entity])
+			return new Error(ErrorMessage("Snapshot \"{}\" has rigid body {} without a transform", path, record.entity));
+	}
+	return std::nullopt;
+}
+
+} // End of anonymous namespace
+
+void AssetTable::addMesh(std::string_view name, Mesh* mesh) {
+	const AssetId id = assetId(name);
+	_meshes[id] = mesh;
+	_meshIds[mesh] = id;
+}
+
+void AssetTable::addMaterial(std::string_view name, Material* material) {
+	const AssetId id = assetId(name);
+	_materials[id] = material;
+	_materialIds[material] = id;
+}
+
+Mesh* AssetTable::findMesh(AssetId id) const {
+	auto it = _meshes.find(id);
+	return it == _meshes.end() ? nullptr : it->second;
+}
+
+Material* AssetTable::findMaterial(AssetId id) const {
+	auto it = _materials.find(id);
+	return it == _materials.end() ? nullptr : it->second;
+}
+
+AssetId AssetTable::meshId(const Mesh* mesh) const {
+	auto it = _meshIds.find(mesh);
+	return it == _meshIds.end() ? 0 : it->second;
+}
+
+AssetId AssetTable::materialId(const Material* material) const {
+	auto it = _materialIds.find(material);
+	return it == _materialIds.end() ? 0 : it->second;
+}
+
+MaybeError save(Level& level, const AssetTable& assets, const std::string& path) {
+	entt::registry& registry = level._registry;
+	EntityIndices index;
+
+	std::vector<TransformRecord> transforms;
+	for (auto &&[entity, transform]: registry.view<TransformComponent>().each())
+		transforms.push_back({ index(entity), transform.getMatrix() });
+
+	std::vector<RenderRecord> renders;
+	for (auto &&[entity, render]: registry.view<RenderObject>().each()) {
+		const AssetId mesh = assets.meshId(render.mesh);
+		const AssetId material = assets.materialId(render.material);
+		if (mesh == 0 || material == 0)
+			return new Error(ErrorMessage("Render object {} uses a mesh or material missing from the asset table", static_cast<uint32_t>(entity)));
+		renders.push_back({ index(entity), mesh, material });
+	}
+
+	std::vector<HierarchyRecord> hierarchy;
+	for (auto &&[entity, node]: registry.view<HierarchyComponent>().each()) {
+		const entt::entity parent = node.getParent();
+		hierarchy.push_back({
+			index(entity),
+			registry.valid(parent) ? index(parent) : NO_PARENT,
+			node.inheritsTransform(),
+			node.getLocalTransform()
+		});
+	}
+
+	std::vector<TagRecord> tags;
+	std::vector<char> tagNames;
+	for (auto &&[entity, tag]: registry.view<TagComponent>().each()) {
+		const std::string name = tag.getName();
+		tags.push_back({ index(entity), static_cast<uint32_t>(tagNames.size()), static_cast<uint32_t>(name.size()) });
+		tagNames.insert(tagNames.end(), name.begin(), name.end());
+	}
+
+	// Bodies sharing a shape share it in the file as well
+	std::vector<RigidBodyRecord> bodies;
+	MemoryStreamOut physics;
+	JPH::BodyCreationSettings::ShapeToIDMap shapeIds;
+	JPH::BodyCreationSettings::MaterialToIDMap materialIds;
+	JPH::BodyCreationSettings::GroupFilterToIDMap groupFilterIds;
+	for (auto &&[entity, body]: registry.view<RigidBodyComponent>().each()) {
+		bodies.push_back({ index(entity), body.isSimulated() });
+		body.getCreationSettings().SaveWithChildren(physics, &shapeIds, &materialIds, &groupFilterIds);
+	}
+
+	std::vector<ShadowCasterRecord> shadowCasters;
+	for (auto &&[entity, caster]: registry.view<ShadowCaster>().each())
+		shadowCasters.push_back({ index(entity), caster.castsShadow() });
+
+	Header header {};
+	SnapshotWriter writer;
+	writer.addSection<TransformRecord>(header, SectionKind::Transforms, transforms);
+	writer.addSection<RenderRecord>(header, SectionKind::Renders, renders);
+	writer.addSection<HierarchyRecord>(header, SectionKind::Hierarchy, hierarchy);
+	writer.addSection<TagRecord>(header, SectionKind::Tags, tags);
+	writer.addSection<char>(header, SectionKind::TagNames, tagNames);
+	writer.addSection<RigidBodyRecord>(header, SectionKind::RigidBodies, bodies);
+	writer.addSection<std::byte>(header, SectionKind::PhysicsSettings, physics._data);
+	writer.addSection<ShadowCasterRecord>(header, SectionKind::ShadowCasters, shadowCasters);
+	header.magic = MAGIC;
+	header.version = VERSION;
+	header.entityCount = index.count();
+	header.sectionCount = SECTION_COUNT;
+	return writer.write(header, path);
+}
+
+tl::expected<std::vector<entt::entity>, Error*> load(Level& level, const AssetTable& assets, const std::string& path) {
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.is_open()) {
+		int errorCode = file.bad() | file.fail() << 1 | file.eof() << 2;
+		return tl::unexpected(new FileError(errorCode, ErrorMessage("Unable to open snapshot file \"{}\"", path)));
+	}
+	// One read for the whole file, sections are used in place from here
+	std::vector<std::byte> data(file.tellg());
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(data.data()), data.size());
+	if (!file.good()) {
+		int errorCode = file.bad() | file.fail() << 1 | file.eof() << 2;
+		return tl::unexpected(new FileError(errorCode, ErrorMessage("Unable to read snapshot file \"{}\"", path)));
+	}
+
+	if (data.size() < sizeof(Header))
+		return tl::unexpected(new Error(ErrorMessage("\"{}\" is too small to be a snapshot", path)));
+	Header header;
+	std::memcpy(&header, data.data(), sizeof(Header));
+	if (header.magic != MAGIC)
+		return tl::unexpected(new Error(ErrorMessage("\"{}\" is not a snapshot", path)));
+	if (header.version != VERSION || header.sectionCount != SECTION_COUNT)
+		return tl::unexpected(new Error(ErrorMessage("Snapshot \"{}\" has version {}, expected {}", path, header.version, VERSION)));
+
+	auto transforms = getSection<TransformRecord>(data, header, SectionKind::Transforms);
+	auto renders = getSection<RenderRecord>(data, header, SectionKind::Renders);
+	auto hierarchy = getSection<HierarchyRecord>(data, header, SectionKind::Hierarchy);
+	auto tags = getSection<TagRecord>(data, header, SectionKind::Tags);
+	auto tagNames = getSection<char>(data, header, SectionKind::TagNames);
+	auto bodies = getSection<RigidBodyRecord>(data, header, SectionKind::RigidBodies);
+	auto physics = getSection<std::byte>(data, header, SectionKind::PhysicsSettings);
+	auto shadowCasters = getSection<ShadowCasterRecord>(data, header, SectionKind::ShadowCasters);
+	if (!transforms) return tl::unexpected(transforms.error());
+	if (!renders) return tl::unexpected(renders.error());
+	if (!hierarchy) return tl::unexpected(hierarchy.error());
+	if (!tags) return tl::unexpected(tags.error());
+	if (!tagNames) return tl::unexpected(tagNames.error());
+	if (!bodies) return tl::unexpected(bodies.error());
+	if (!physics) return tl::unexpected(physics.error());
+	if (!shadowCasters) return tl::unexpected(shadowCasters.error());
+
+	const Records records { *transforms, *renders, *hierarchy, *tags, *tagNames, *bodies, *shadowCasters };
+	if (MaybeError invalid = validate(records, assets, header.entityCount, path); invalid.has_value())
+		return tl::unexpected(invalid.value());
+
+	entt::registry& registry = level._registry;
+	std::vector<entt::entity> entities(header.entityCount);
+	registry.create(entities.begin(), entities.end());
+
+	// Only restoring or creating a body can fail from here. That leaves the level as it was:
+	// destroying the entities also destroys the rigid bodies created for them so far
+	auto fail = [&](Error* error) {
+		registry.destroy(entities.begin(), entities.end());
+		return tl::unexpected(error);
+	};
+
+	level._transforms.reserve(transforms->size());
+	registry.storage<TransformComponent>().reserve(registry.storage<TransformComponent>().size() + transforms->size());
+	for (const TransformRecord& record: *transforms) {
+		const entt::entity entity = entities[record.entity];
+		registry.emplace<TransformComponent>(entity, Object(&level, entity), record.matrix);
+	}
+
+	registry.storage<RenderObject>().reserve(registry.storage<RenderObject>().size() + renders->size());
+	for (const RenderRecord& record: *renders) {
+		const entt::entity entity = entities[record.entity];
+		registry.emplace<RenderObject>(entity, Object(&level, entity), assets.findMesh(record.mesh), assets.findMaterial(record.material));
+	}
+
+	// Every node exists before parents and children are linked
+	registry.storage<HierarchyComponent>().reserve(registry.storage<HierarchyComponent>().size() + hierarchy->size());
+	for (const HierarchyRecord& record: *hierarchy) {
+		const entt::entity entity = entities[record.entity];
+		registry.emplace<HierarchyComponent>(entity, Object(&level, entity));
+	}
+	for (const HierarchyRecord& record: *hierarchy) {
+		HierarchyComponent& node = registry.get<HierarchyComponent>(entities[record.entity]);
+		if (record.parent != NO_PARENT) {
+			node._parentId = entities[record.parent];
+			registry.get<HierarchyComponent>(entities[record.parent]).children.push_back(entities[record.entity]);
+		}
+		if (record.inheritsTransform)
+			node.setLocalTransform(record.localTransform);
+	}
+
+	registry.storage<TagComponent>().reserve(registry.storage<TagComponent>().size() + tags->size());
+	for (const TagRecord& record: *tags) {
+		const entt::entity entity = entities[record.entity];
+		registry.emplace<TagComponent>(entity, Object(&level, entity), std::string(tagNames->data() + record.nameOffset, record.nameLength));
+	}
+
+	registry.storage<ShadowCaster>().reserve(registry.storage<ShadowCaster>().size() + shadowCasters->size());
+	for (const ShadowCasterRecord& record: *shadowCasters) {
+		const entt::entity entity = entities[record.entity];
+		registry.emplace<ShadowCaster>(entity, Object(&level, entity), record.castsShadow != 0);
+	}
+
+	// Settings are stored in body order, shared shapes are only restored once
+	MemoryStreamIn physicsStream(*physics);
+	JPH::BodyCreationSettings::IDToShapeMap shapes;
+	JPH::BodyCreationSettings::IDToMaterialMap materials;
+	JPH::BodyCreationSettings::IDToGroupFilterMap groupFilters;
+	registry.storage<RigidBodyComponent>().reserve(registry.storage<RigidBodyComponent>().size() + bodies->size());
+	for (const RigidBodyRecord& record: *bodies) {
+		JPH::BodyCreationSettings::BCSResult settings = JPH::BodyCreationSettings::sRestoreWithChildren(physicsStream, shapes, materials, groupFilters);
+		if (settings.HasError())
+			return fail(new Error(ErrorMessage("Could not restore rigid body {} of snapshot \"{}\": {}", record.entity, path, settings.GetError().c_str())));
+
+		const entt::entity entity = entities[record.entity];
+		Object object(&level, entity);
+		RigidBodyComponent& body = registry.emplace<RigidBodyComponent>(entity, object, settings.Get(), watch_ptr<TransformComponent>(&registry.get<TransformComponent>(entity)));
+		MaybeError created = record.simulated ? body.createAndAdd() : body.create();
+		if (created)
+			return fail(new Error(created.value(), ErrorMessage("Could not create rigid body {} of snapshot \"{}\"", record.entity, path)));
+	}
+
+	return entities;
+}
+
+} // End of namespace Snapshot
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <entt/entt.hpp>
+#include <expected.hpp>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "src/crc32.h"
+#include "src/error.h"
+#include "src/objects/level.h"
+
+struct Mesh;
+struct Material;
+
+/*!
+ * \brief Versioned binary snapshots of a level
+ *
+ * A snapshot holds the transforms, render references, rigid bodies, hierarchy, tags and
+ * shadow casters of a level. Every section is a little-endian array of fixed-size records
+ * at a 16-byte aligned offset, so the file can be mapped or read in one go and used in place.
+ * Entities are stored as indices into the snapshot, meshes and materials as crc32 of their
+ * scene names. Anything else (cameras, controllers, game callbacks) is left to the scene.
+ */
+namespace Snapshot {
+
+using AssetId = uint32_t;
+
+inline AssetId assetId(std::string_view name) { return Common::crc32(name); };
+
+// "CGSN"
+constexpr uint32_t MAGIC = 0x4E534743;
+// Bumped on any change of the records below, old files are rejected
+constexpr uint32_t VERSION = 1;
+constexpr uint32_t NO_PARENT = UINT32_MAX;
+constexpr uint64_t SECTION_ALIGNMENT = 16;
+
+enum class SectionKind: uint32_t {
+	Transforms,
+	Renders,
+	Hierarchy,
+	Tags,
+	// Characters of every tag name, referenced by TagRecord
+	TagNames,
+	RigidBodies,
+	// Jolt body creation settings with their shapes, one per RigidBodyRecord in order
+	PhysicsSettings,
+	ShadowCasters,
+
+	Count
+};
+
+constexpr size_t SECTION_COUNT = static_cast<size_t>(SectionKind::Count);
+
+struct Section {
+	uint32_t count;
+	uint32_t recordSize;
+	uint64_t offset;
+	uint64_t size;
+};
+
+struct Header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t entityCount;
+	uint32_t sectionCount;
+	Section sections[SECTION_COUNT];
+};
+
+struct TransformRecord {
+	uint32_t entity;
+	glm::mat4 matrix;
+};
+
+struct RenderRecord {
+	uint32_t entity;
+	AssetId mesh;
+	AssetId material;
+};
+
+struct HierarchyRecord {
+	uint32_t entity;
+	uint32_t parent;
+	uint32_t inheritsTransform;
+	glm::mat4 localTransform;
+};
+
+struct TagRecord {
+	uint32_t entity;
+	uint32_t nameOffset;
+	uint32_t nameLength;
+};
+
+struct RigidBodyRecord {
+	uint32_t entity;
+	// Whether the body was in the physics system
+	uint32_t simulated;
+};
+
+struct ShadowCasterRecord {
+	uint32_t entity;
+	uint32_t castsShadow;
+};
+
+static_assert(std::is_trivially_copyable_v<TransformRecord> && std::is_trivially_copyable_v<HierarchyRecord>);
+
+// Maps render assets to their IDs and back, usually built from a scene's meshes and materials
+class AssetTable {
+public:
+	void addMesh(std::string_view name, Mesh* mesh);
+	void addMaterial(std::string_view name, Material* material);
+
+	Mesh* findMesh(AssetId id) const;
+	Material* findMaterial(AssetId id) const;
+	// Meshes and materials that were never added get ID 0
+	AssetId meshId(const Mesh* mesh) const;
+	AssetId materialId(const Material* material) const;
+private:
+	std::unordered_map<AssetId, Mesh*> _meshes;
+	std::unordered_map<AssetId, Material*> _materials;
+	std::unordered_map<const Mesh*, AssetId> _meshIds;
+	std::unordered_map<const Material*, AssetId> _materialIds;
+};
+
+MaybeError save(Level& level, const AssetTable& assets, const std::string& path);
+
+/*!
+ * \brief Adds every entity of the snapshot to the level, returns them in snapshot order
+ *
+ * Component pools are reserved up front and filled straight from the record arrays.
+ * Rigid bodies that were simulated when saved are added to the physics system.
+ * Records are checked against each other before anything is created. If Jolt fails to restore
+ * or create a body, every entity created so far is destroyed again and the level is left unchanged.
+ */
+tl::expected<std::vector<entt::entity>, Error*> load(Level& level, const AssetTable& assets, const std::string& path);
+
+} // End of namespace Snapshot
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <Jolt/Jolt.h>
+#include <Jolt/Physics/Collision/Shape/Shape.h>
+
+#include <optional>
+
+#include "src/objects/components/rigidbody.h"
+
+struct Mesh;
+struct Material;
+
+// What every object of a Scene::spawnBatch() call gets, resolved once for the whole batch
+struct SpawnTemplate {
+	// Both set for a rendered object
+	Mesh* mesh = nullptr;
+	Material* material = nullptr;
+	// Set for a rigid body, one shape is shared by all spawns (see Physics::ShapeCache)
+	JPH::ShapeRefC shape;
+	RigidBodyType bodyType = RigidBodyType::Dynamic;
+	std::optional<float> mass;
+	// Instead of the layer picked by the body type, e.g. a debris layer of PhysicsManager::layers()
+	std::optional<JPH::ObjectLayer> layer;
+	// Bodies are only created when false, e.g. for objects waiting in an ObjectPool
+	bool simulated = true;
+};
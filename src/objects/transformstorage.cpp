@@ -0,0 +1,338 @@
+#include "transformstorage.h"
+
+#include <glm/gtx/matrix_decompose.hpp>
+#include <glm/gtx/quaternion.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64)
+#	include <immintrin.h>
+#endif
+
+namespace {
+
+// Parts closer than this to "no skew, no perspective" are treated as plain TRS
+constexpr float EXTRAS_EPSILON = 1e-5f;
+
+#if defined(__AVX__)
+struct Simd {
+	using Reg = __m256;
+	static Reg load(const float* p) { return _mm256_loadu_ps(p); };
+	static void store(float* p, Reg v) { _mm256_store_ps(p, v); };
+	static Reg set(float v) { return _mm256_set1_ps(v); };
+	static Reg add(Reg a, Reg b) { return _mm256_add_ps(a, b); };
+	static Reg sub(Reg a, Reg b) { return _mm256_sub_ps(a, b); };
+	static Reg mul(Reg a, Reg b) { return _mm256_mul_ps(a, b); };
+};
+#elif defined(__SSE2__) || defined(_M_X64)
+struct Simd {
+	using Reg = __m128;
+	static Reg load(const float* p) { return _mm_loadu_ps(p); };
+	static void store(float* p, Reg v) { _mm_store_ps(p, v); };
+	static Reg set(float v) { return _mm_set1_ps(v); };
+	static Reg add(Reg a, Reg b) { return _mm_add_ps(a, b); };
+	static Reg sub(Reg a, Reg b) { return _mm_sub_ps(a, b); };
+	static Reg mul(Reg a, Reg b) { return _mm_mul_ps(a, b); };
+};
+#else
+// Plain loops, left to the compiler to vectorize
+struct Simd {
+	struct Reg { float v[TransformStorage::LANES]; };
+	static Reg load(const float* p) { Reg r; std::memcpy(r.v, p, sizeof(r.v)); return r; };
+	static void store(float* p, Reg v) { std::memcpy(p, v.v, sizeof(v.v)); };
+	static Reg set(float v) { Reg r; std::fill(std::begin(r.v), std::end(r.v), v); return r; };
+	static Reg add(Reg a, Reg b) { for (uint32_t i = 0; i < TransformStorage::LANES; i++) a.v[i] += b.v[i]; return a; };
+	static Reg sub(Reg a, Reg b) { for (uint32_t i = 0; i < TransformStorage::LANES; i++) a.v[i] -= b.v[i]; return a; };
+	static Reg mul(Reg a, Reg b) { for (uint32_t i = 0; i < TransformStorage::LANES; i++) a.v[i] *= b.v[i]; return a; };
+};
+#endif
+
+} // End of anonymous namespace
+
+TransformStorage::Slot TransformStorage::allocate(const glm::mat4& matrix) {
+	Slot slot;
+	if (!_freeSlots.empty()) {
+		slot = _freeSlots.back();
+		_freeSlots.pop_back();
+	} else {
+		slot = _slotCount++;
+		if (slot >= _state.size())
+			grow(std::max<size_t>(LANES, _state.size() * 2));
+	}
+
+	_state[slot] = ALIVE;
+	setMatrix(slot, matrix);
+	return slot;
+}
+
+void TransformStorage::reserve(size_t count) {
+	const size_t needed = _slotCount + count;
+	if (needed > _state.size())
+		grow((needed + LANES - 1) / LANES * LANES);
+}
+
+void TransformStorage::grow(size_t capacity) {
+	// Padding lanes hold an identity transform, so whole blocks are always valid to compose
+	_positionX.resize(capacity, 0.f);
+	_positionY.resize(capacity, 0.f);
+	_positionZ.resize(capacity, 0.f);
+	_rotationX.resize(capacity, 0.f);
+	_rotationY.resize(capacity, 0.f);
+	_rotationZ.resize(capacity, 0.f);
+	_rotationW.resize(capacity, 1.f);
+	_scaleX.resize(capacity, 1.f);
+	_scaleY.resize(capacity, 1.f);
+	_scaleZ.resize(capacity, 1.f);
+	_matrices.resize(capacity, glm::mat4(1.f));
+	_state.resize(capacity, 0);
+}
+
+void TransformStorage::release(Slot slot) {
+	if (_state[slot] & MATRIX_DIRTY)
+		_dirtyCount--;
+	if (_state[slot] & HAS_EXTRAS) {
+		std::lock_guard lock(_extrasMutex);
+		_extras.erase(slot);
+	}
+	_state[slot] = 0;
+	_freeSlots.push_back(slot);
+}
+
+glm::vec3 TransformStorage::getTranslation(Slot slot) {
+	if (_state[slot] & PARTS_DIRTY) decompose(slot);
+	return glm::vec3(_positionX[slot], _positionY[slot], _positionZ[slot]);
+}
+
+glm::quat TransformStorage::getOrientation(Slot slot) {
+	if (_state[slot] & PARTS_DIRTY) decompose(slot);
+	return glm::quat(_rotationW[slot], _rotationX[slot], _rotationY[slot], _rotationZ[slot]);
+}
+
+glm::vec3 TransformStorage::getScale(Slot slot) {
+	if (_state[slot] & PARTS_DIRTY) decompose(slot);
+	return glm::vec3(_scaleX[slot], _scaleY[slot], _scaleZ[slot]);
+}
+
+glm::vec3 TransformStorage::getSkew(Slot slot) {
+	if (_state[slot] & PARTS_DIRTY) decompose(slot);
+	return getExtras(slot).skew;
+}
+
+glm::vec4 TransformStorage::getPerspective(Slot slot) {
+	if (_state[slot] & PARTS_DIRTY) decompose(slot);
+	return getExtras(slot).perspective;
+}
+
+const glm::mat4& TransformStorage::getMatrix(Slot slot) {
+	if (_state[slot] & MATRIX_DIRTY) {
+		composeScalar(slot);
+		_state[slot] &= ~MATRIX_DIRTY;
+		_dirtyCount--;
+	}
+	return _matrices[slot];
+}
+
+void TransformStorage::setTranslation(Slot slot, const glm::vec3& translation) {
+	touchParts(slot);
+	_positionX[slot] = translation.x;
+	_positionY[slot] = translation.y;
+	_positionZ[slot] = translation.z;
+}
+
+void TransformStorage::setOrientation(Slot slot, const glm::quat& orientation) {
+	touchParts(slot);
+	_rotationX[slot] = orientation.x;
+	_rotationY[slot] = orientation.y;
+	_rotationZ[slot] = orientation.z;
+	_rotationW[slot] = orientation.w;
+}
+
+void TransformStorage::setScale(Slot slot, const glm::vec3& scale) {
+	touchParts(slot);
+	_scaleX[slot] = scale.x;
+	_scaleY[slot] = scale.y;
+	_scaleZ[slot] = scale.z;
+}
+
+void TransformStorage::setSkew(Slot slot, const glm::vec3& skew) {
+	touchParts(slot);
+	updateExtras(slot, skew, getPerspective(slot));
+}
+
+void TransformStorage::setPerspective(Slot slot, const glm::vec4& perspective) {
+	touchParts(slot);
+	updateExtras(slot, getSkew(slot), perspective);
+}
+
+void TransformStorage::setMatrix(Slot slot, const glm::mat4& matrix) {
+	_matrices[slot] = matrix;
+	if (_state[slot] & MATRIX_DIRTY)
+		_dirtyCount--;
+	_state[slot] = (_state[slot] & ~MATRIX_DIRTY) | PARTS_DIRTY | CHANGED;
+}
+
+bool TransformStorage::takeChanged(Slot slot) {
+	const bool changed = _state[slot] & CHANGED;
+	_state[slot] &= ~CHANGED;
+	return changed;
+}
+
+void TransformStorage::touchParts(Slot slot) {
+	if (_state[slot] & PARTS_DIRTY)
+		decompose(slot);
+	_state[slot] |= CHANGED;
+	if (!(_state[slot] & MATRIX_DIRTY)) {
+		_state[slot] |= MATRIX_DIRTY;
+		_dirtyCount++;
+	}
+}
+
+void TransformStorage::decompose(Slot slot) {
+	// Degenerate matrices leave the outputs untouched
+	glm::vec3 scale(1.f), translation(0.f), skew(0.f);
+	glm::vec4 perspective(0.f, 0.f, 0.f, 1.f);
+	glm::quat orientation(1.f, 0.f, 0.f, 0.f);
+	glm::decompose(_matrices[slot], scale, orientation, translation, skew, perspective);
+
+	_positionX[slot] = translation.x;
+	_positionY[slot] = translation.y;
+	_positionZ[slot] = translation.z;
+	_rotationX[slot] = orientation.x;
+	_rotationY[slot] = orientation.y;
+	_rotationZ[slot] = orientation.z;
+	_rotationW[slot] = orientation.w;
+	_scaleX[slot] = scale.x;
+	_scaleY[slot] = scale.y;
+	_scaleZ[slot] = scale.z;
+	updateExtras(slot, skew, perspective);
+	_state[slot] &= ~PARTS_DIRTY;
+}
+
+void TransformStorage::updateExtras(Slot slot, const glm::vec3& skew, const glm::vec4& perspective) {
+	const bool plain = glm::all(glm::lessThan(glm::abs(skew), glm::vec3(EXTRAS_EPSILON)))
+		&& glm::all(glm::lessThan(glm::abs(perspective - glm::vec4(0.f, 0.f, 0.f, 1.f)), glm::vec4(EXTRAS_EPSILON)));
+	// Most transforms never had extras, those skip the lock
+	if (plain && !(_state[slot] & HAS_EXTRAS)) return;
+
+	std::lock_guard lock(_extrasMutex);
+	if (plain) {
+		_extras.erase(slot);
+		_state[slot] &= ~HAS_EXTRAS;
+	} else {
+		_extras[slot] = { skew, perspective };
+		_state[slot] |= HAS_EXTRAS;
+	}
+}
+
+TransformStorage::Extras TransformStorage::getExtras(Slot slot) {
+	if (!(_state[slot] & HAS_EXTRAS))
+		return { glm::vec3(0.f), glm::vec4(0.f, 0.f, 0.f, 1.f) };
+	std::lock_guard lock(_extrasMutex);
+	return _extras[slot];
+}
+
+void TransformStorage::composeScalar(Slot slot) {
+	glm::mat4& matrix = _matrices[slot];
+	matrix = glm::mat4(1.0f);
+
+	if (_state[slot] & HAS_EXTRAS) {
+		const Extras extras = getExtras(slot);
+		matrix[0][3] = extras.perspective.x;
+		matrix[1][3] = extras.perspective.y;
+		matrix[2][3] = extras.perspective.z;
+		matrix[3][3] = extras.perspective.w;
+	}
+
+	matrix *= glm::translate(glm::vec3(_positionX[slot], _positionY[slot], _positionZ[slot]));
+	matrix *= glm::mat4_cast(glm::quat(_rotationW[slot], _rotationX[slot], _rotationY[slot], _rotationZ[slot]));
+
+	if (_state[slot] & HAS_EXTRAS) {
+		const glm::vec3 skew = getExtras(slot).skew;
+		if (skew.x) {
+			glm::mat4 tmp { 1.f };
+			tmp[2][1] = skew.x;
+			matrix *= tmp;
+		}
+
+		if (skew.y) {
+			glm::mat4 tmp { 1.f };
+			tmp[2][0] = skew.y;
+			matrix *= tmp;
+		}
+
+		if (skew.z) {
+			glm::mat4 tmp { 1.f };
+			tmp[1][0] = skew.z;
+			matrix *= tmp;
+		}
+	}
+
+	matrix *= glm::scale(glm::vec3(_scaleX[slot], _scaleY[slot], _scaleZ[slot]));
+}
+
+void TransformStorage::composeDirty() {
+	if (_dirtyCount == 0)
+		return;
+
+	using Reg = Simd::Reg;
+	const Reg one = Simd::set(1.f);
+	const Reg two = Simd::set(2.f);
+	// Rotation-scale part of the matrices, column by column, then the translation
+	alignas(32) float columns[12][LANES];
+
+	for (size_t base = 0; base < _slotCount; base += LANES) {
+		bool anyDirty = false;
+		for (uint32_t lane = 0; lane < LANES; lane++)
+			anyDirty |= (_state[base + lane] & MATRIX_DIRTY) != 0;
+		if (!anyDirty)
+			continue;
+
+		const Reg x = Simd::load(&_rotationX[base]);
+		const Reg y = Simd::load(&_rotationY[base]);
+		const Reg z = Simd::load(&_rotationZ[base]);
+		const Reg w = Simd::load(&_rotationW[base]);
+		const Reg sx = Simd::load(&_scaleX[base]);
+		const Reg sy = Simd::load(&_scaleY[base]);
+		const Reg sz = Simd::load(&_scaleZ[base]);
+
+		const Reg xx = Simd::mul(x, x), yy = Simd::mul(y, y), zz = Simd::mul(z, z);
+		const Reg xy = Simd::mul(x, y), xz = Simd::mul(x, z), yz = Simd::mul(y, z);
+		const Reg wx = Simd::mul(w, x), wy = Simd::mul(w, y), wz = Simd::mul(w, z);
+
+		// Same as glm::mat4_cast(q) * glm::scale(s)
+		Simd::store(columns[0], Simd::mul(Simd::sub(one, Simd::mul(two, Simd::add(yy, zz))), sx));
+		Simd::store(columns[1], Simd::mul(Simd::mul(two, Simd::add(xy, wz)), sx));
+		Simd::store(columns[2], Simd::mul(Simd::mul(two, Simd::sub(xz, wy)), sx));
+		Simd::store(columns[3], Simd::mul(Simd::mul(two, Simd::sub(xy, wz)), sy));
+		Simd::store(columns[4], Simd::mul(Simd::sub(one, Simd::mul(two, Simd::add(xx, zz))), sy));
+		Simd::store(columns[5], Simd::mul(Simd::mul(two, Simd::add(yz, wx)), sy));
+		Simd::store(columns[6], Simd::mul(Simd::mul(two, Simd::add(xz, wy)), sz));
+		Simd::store(columns[7], Simd::mul(Simd::mul(two, Simd::sub(yz, wx)), sz));
+		Simd::store(columns[8], Simd::mul(Simd::sub(one, Simd::mul(two, Simd::add(xx, yy))), sz));
+		Simd::store(columns[9], Simd::load(&_positionX[base]));
+		Simd::store(columns[10], Simd::load(&_positionY[base]));
+		Simd::store(columns[11], Simd::load(&_positionZ[base]));
+
+		for (uint32_t lane = 0; lane < LANES; lane++) {
+			const Slot slot = base + lane;
+			if (!(_state[slot] & MATRIX_DIRTY))
+				continue;
+
+			if (_state[slot] & HAS_EXTRAS) {
+				composeScalar(slot);
+			} else {
+				glm::mat4& matrix = _matrices[slot];
+				matrix[0] = glm::vec4(columns[0][lane], columns[1][lane], columns[2][lane], 0.f);
+				matrix[1] = glm::vec4(columns[3][lane], columns[4][lane], columns[5][lane], 0.f);
+				matrix[2] = glm::vec4(columns[6][lane], columns[7][lane], columns[8][lane], 0.f);
+				matrix[3] = glm::vec4(columns[9][lane], columns[10][lane], columns[11][lane], 1.f);
+			}
+			_state[slot] &= ~MATRIX_DIRTY;
+		}
+	}
+
+	_dirtyCount = 0;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/*!
+ * \brief Transforms of every object in a level, stored as structure of arrays
+ *
+ * Position, rotation and scale live in separate per-component arrays so that composeDirty()
+ * can build the matrices of LANES objects at once with SIMD. A matrix set directly is kept
+ * as is and only decomposed when its parts are asked for. The rare transforms with skew or
+ * perspective are composed separately with scalar code.
+ *
+ * Different slots may be read and written from different threads at the same time,
+ * allocate(), release() and composeDirty() need the storage to themselves.
+ */
+class TransformStorage {
+public:
+	using Slot = uint32_t;
+
+#if defined(__AVX__)
+	static constexpr uint32_t LANES = 8;
+#else
+	static constexpr uint32_t LANES = 4;
+#endif
+
+	Slot allocate(const glm::mat4& matrix);
+	void release(Slot slot);
+	// Makes room for count more slots at once, e.g. before loading a snapshot
+	void reserve(size_t count);
+
+	glm::vec3 getTranslation(Slot slot);
+	glm::quat getOrientation(Slot slot);
+	glm::vec3 getScale(Slot slot);
+	glm::vec3 getSkew(Slot slot);
+	glm::vec4 getPerspective(Slot slot);
+	// Composes this one matrix if composeDirty() has not reached it yet
+	const glm::mat4& getMatrix(Slot slot);
+
+	void setTranslation(Slot slot, const glm::vec3& translation);
+	void setOrientation(Slot slot, const glm::quat& orientation);
+	void setScale(Slot slot, const glm::vec3& scale);
+	void setSkew(Slot slot, const glm::vec3& skew);
+	void setPerspective(Slot slot, const glm::vec4& perspective);
+	void setMatrix(Slot slot, const glm::mat4& matrix);
+
+	// Rebuilds every matrix whose parts changed since it was last composed
+	void composeDirty();
+	// Whether the transform was written since the last call
+	bool takeChanged(Slot slot);
+
+	size_t size() const { return _slotCount - _freeSlots.size(); };
+	size_t dirtyCount() const { return _dirtyCount; };
+private:
+	enum StateBits: uint8_t {
+		// Parts changed, the matrix is stale
+		MATRIX_DIRTY = 1 << 0,
+		// Matrix was set directly, the parts are stale
+		PARTS_DIRTY = 1 << 1,
+		// Skew or perspective are set, see _extras
+		HAS_EXTRAS = 1 << 2,
+		ALIVE = 1 << 3,
+		// Written since the last takeChanged(), used for hierarchy propagation
+		CHANGED = 1 << 4
+	};
+
+	struct Extras {
+		glm::vec3 skew;
+		glm::vec4 perspective;
+	};
+
+	void grow(size_t capacity);
+	void decompose(Slot slot);
+	// Parts are about to change, the matrix has to be recomposed afterwards
+	void touchParts(Slot slot);
+	void composeScalar(Slot slot);
+	void updateExtras(Slot slot, const glm::vec3& skew, const glm::vec4& perspective);
+	Extras getExtras(Slot slot);
+
+	// Sized to a multiple of LANES, so whole blocks can always be loaded
+	std::vector<float> _positionX, _positionY, _positionZ;
+	std::vector<float> _rotationX, _rotationY, _rotationZ, _rotationW;
+	std::vector<float> _scaleX, _scaleY, _scaleZ;
+	std::vector<glm::mat4> _matrices;
+	std::vector<uint8_t> _state;
+
+	std::mutex _extrasMutex;
+	std::unordered_map<Slot, Extras> _extras;
+	std::vector<Slot> _freeSlots;
+	uint32_t _slotCount = 0;
+	std::atomic<size_t> _dirtyCount = 0;
+};
@@ -0,0 +1,321 @@
+#include "particlesystem.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include "src/devicesingleton.h"
+#include "src/material.h"
+#include "src/vk_initializers.h"
+#include "src/vk_operations.h"
+#include "src/vmalloc.h"
+#include "src/profiling/stats.h"
+
+namespace Particles {
+
+tl::expected<VkPipeline, VulkanError*> ParticleSystem::createComputePipeline(VkShaderModule shader) {
+	VkComputePipelineCreateInfo pipelineInfo = {
+		.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.stage = {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			.pNext = nullptr,
+			.flags = 0,
+			.stage = VK_SHADER_STAGE_COMPUTE_BIT,
+			.module = shader,
+			.pName = "main"
+		},
+		.layout = _computePipelineLayout
+	};
+	return vkcommand::createComputePipeline(VK_NULL_HANDLE, pipelineInfo);
+}
+
+tl::expected<delFunc, VulkanError*> ParticleSystem::init(uint32_t capacity, const Shaders& shaders, VkRenderPass renderPass, VkDescriptorSetLayout globalLayout) {
+	_capacity = capacity;
+
+	VkDescriptorPoolSize sizes[] = {
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 * FRAMES },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 8 * FRAMES + 2 },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2 * FRAMES }
+	};
+	VkDescriptorPoolCreateInfo poolInfo = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.maxSets = 2 * FRAMES + 2,
+		.poolSizeCount = std::size(sizes),
+		.pPoolSizes = sizes
+	};
+	auto poolResult = vkcommand::createDescriptorPool(&poolInfo);
+	VK_UNEXPECTED_ERROR(poolResult, "Failed to create descriptor pool for particles");
+	_descriptorPool = poolResult.value();
+
+	VkDescriptorSetLayoutBinding computeBindings[] = {
+		vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 0),
+		vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1),
+		vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 2),
+		vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 3),
+		vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 4),
+		vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT, 5)
+	};
+	VkDescriptorSetLayoutCreateInfo setInfo = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.bindingCount = std::size(computeBindings),
+		.pBindings = computeBindings
+	};
+	auto layoutResult = vkcommand::createDescriptorSetLayout(&setInfo);
+	VK_UNEXPECTED_ERROR(layoutResult, "Failed to create descriptor set layout for particle simulation");
+	_computeLayout = layoutResult.value();
+
+	VkDescriptorSetLayoutBinding renderBinding = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 0);
+	setInfo.bindingCount = 1;
+	setInfo.pBindings = &renderBinding;
+	layoutResult = vkcommand::createDescriptorSetLayout(&setInfo);
+	VK_UNEXPECTED_ERROR(layoutResult, "Failed to create descriptor set layout for particle rendering");
+	_renderLayout = layoutResult.value();
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.setLayoutCount = 1,
+		.pSetLayouts = &_computeLayout,
+		.pushConstantRangeCount = 0,
+		.pPushConstantRanges = nullptr
+	};
+	auto pipeLayoutResult = vkcommand::createPipelineLayout(pipelineLayoutInfo);
+	VK_UNEXPECTED_ERROR(pipeLayoutResult, "Failed to create particle simulation pipeline layout");
+	_computePipelineLayout = pipeLayoutResult.value();
+
+	auto pipelineResult = createComputePipeline(shaders.simulate);
+	VK_UNEXPECTED_ERROR(pipelineResult, "Failed to create particle simulation pipeline");
+	_simulatePipeline = pipelineResult.value();
+	pipelineResult = createComputePipeline(shaders.emit);
+	VK_UNEXPECTED_ERROR(pipelineResult, "Failed to create particle emission pipeline");
+	_emitPipeline = pipelineResult.value();
+	pipelineResult = createComputePipeline(shaders.finalize);
+	VK_UNEXPECTED_ERROR(pipelineResult, "Failed to create particle count pipeline");
+	_finalizePipeline = pipelineResult.value();
+
+	// Additive billboards, tested against the scene depth but not writing it
+	PipelineBuilder pipelineBuilder;
+	pipelineBuilder._viewport = { 0.f, 0.f, 1.f, 1.f, 0.f, 1.f };
+	pipelineBuilder._scissor = { .offset = { 0, 0 }, .extent = { 1, 1 } };
+	pipelineBuilder._depthStencil.depthWriteEnable = VK_FALSE;
+	pipelineBuilder._colorBlendAttachment.blendEnable = VK_TRUE;
+	pipelineBuilder._colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+	pipelineBuilder._colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+	pipelineBuilder._colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+	pipelineBuilder._colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	pipelineBuilder._colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	pipelineBuilder._colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+	VkShaderModule vertexShader = shaders.vertex, fragmentShader = shaders.fragment;
+	pipelineBuilder
+		.addVertexShader(vertexShader)
+		.addFragmentShader(fragmentShader);
+
+	std::vector<VkDescriptorSetLayout> setLayouts = { globalLayout, _renderLayout };
+	std::vector<VkPushConstantRange> pushConstants;
+	auto renderLayoutResult = pipelineBuilder.setLayout(setLayouts, pushConstants);
+	VK_UNEXPECTED_ERROR(renderLayoutResult, "Failed to create particle render pipeline layout");
+	_renderPipelineLayout = renderLayoutResult.value();
+
+	auto renderPipelineResult = pipelineBuilder.build_pipeline(DeviceRef(), renderPass);
+	VK_UNEXPECTED_ERROR(renderPipelineResult, "Failed to build particle render pipeline");
+	_renderPipeline = renderPipelineResult.value();
+
+	for (uint32_t i = 0; i < 2; i++) {
+		auto createResult = VMAlloc.createBuffer(sizeof(GPUParticle) * std::max(capacity, 1u), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+		VK_UNEXPECTED_ERROR(createResult, "Failed to create particle buffer {}", i);
+		_particleBuffers[i] = createResult.value();
+	}
+
+	auto createResult = VMAlloc.createBuffer(sizeof(GPUParticleCounters),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+	VK_UNEXPECTED_ERROR(createResult, "Failed to create particle counter buffer");
+	_counterBuffer = createResult.value();
+
+	for (uint32_t frame = 0; frame < FRAMES; frame++) {
+		createResult = VMAlloc.createBuffer(sizeof(GPUParticleParams), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, MemoryPool::FrameUploads);
+		VK_UNEXPECTED_ERROR(createResult, "Failed to create particle parameter buffer");
+		_paramBuffers[frame] = createResult.value();
+
+		createResult = VMAlloc.createBuffer(sizeof(GPUParticleEmitter) * MAX_PARTICLE_EMITTERS, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, MemoryPool::FrameUploads);
+		VK_UNEXPECTED_ERROR(createResult, "Failed to create particle emitter buffer");
+		_emitterBuffers[frame] = createResult.value();
+	}
+
+	VkDescriptorBufferInfo particleInfos[2];
+	for (uint32_t i = 0; i < 2; i++) {
+		particleInfos[i] = { .buffer = _particleBuffers[i]._buffer, .offset = 0, .range = VK_WHOLE_SIZE };
+
+		auto allocResult = vkcommand::allocateDescriptorSet(_descriptorPool, _renderLayout);
+		VK_UNEXPECTED_ERROR(allocResult, "Could not allocate particle render descriptor");
+		_renderSets[i] = allocResult.value();
+		VkWriteDescriptorSet write = vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, _renderSets[i], &particleInfos[i], 0);
+		vkUpdateDescriptorSets(DeviceRef(), 1, &write, 0, nullptr);
+	}
+
+	VkDescriptorBufferInfo counterInfo { .buffer = _counterBuffer._buffer, .offset = 0, .range = sizeof(GPUParticleCounters) };
+	for (uint32_t frame = 0; frame < FRAMES; frame++) {
+		VkDescriptorBufferInfo paramsInfo { .buffer = _paramBuffers[frame]._buffer, .offset = 0, .range = sizeof(GPUParticleParams) };
+		VkDescriptorBufferInfo emitterInfo { .buffer = _emitterBuffers[frame]._buffer, .offset = 0, .range = sizeof(GPUParticleEmitter) * MAX_PARTICLE_EMITTERS };
+		for (uint32_t source = 0; source < 2; source++) {
+			auto allocResult = vkcommand::allocateDescriptorSet(_descriptorPool, _computeLayout);
+			VK_UNEXPECTED_ERROR(allocResult, "Could not allocate particle simulation descriptor");
+			_computeSets[frame][source] = allocResult.value();
+
+			VkWriteDescriptorSet setWrites[] = {
+				vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, _computeSets[frame][source], &paramsInfo, 0),
+				vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, _computeSets[frame][source], &emitterInfo, 1),
+				vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, _computeSets[frame][source], &particleInfos[source], 2),
+				vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, _computeSets[frame][source], &particleInfos[1 - source], 3),
+				vkinit::write_descriptor_buffer(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, _computeSets[frame][source], &counterInfo, 4)
+			};
+			vkUpdateDescriptorSets(DeviceRef(), std::size(setWrites), setWrites, 0, nullptr);
+		}
+	}
+
+	return [=]() {
+		for (uint32_t frame = 0; frame < FRAMES; frame++) {
+			_paramBuffers[frame].destroy();
+			_emitterBuffers[frame].destroy();
+		}
+		_counterBuffer.destroy();
+		_particleBuffers[0].destroy();
+		_particleBuffers[1].destroy();
+		vkDestroyPipeline(DeviceRef(), _renderPipeline, nullptr);
+		vkDestroyPipeline(DeviceRef(), _finalizePipeline, nullptr);
+		vkDestroyPipeline(DeviceRef(), _emitPipeline, nullptr);
+		vkDestroyPipeline(DeviceRef(), _simulatePipeline, nullptr);
+		vkDestroyPipelineLayout(DeviceRef(), _renderPipelineLayout, nullptr);
+		vkDestroyPipelineLayout(DeviceRef(), _computePipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(DeviceRef(), _renderLayout, nullptr);
+		vkDestroyDescriptorSetLayout(DeviceRef(), _computeLayout, nullptr);
+		vkDestroyDescriptorPool(DeviceRef(), _descriptorPool, nullptr);
+	};
+}
+
+void ParticleSystem::updateDepthDescriptor(VkImageView pyramidView, VkSampler sampler) {
+	if (!isEnabled()) return;
+
+	VkDescriptorImageInfo pyramidInfo {
+		.sampler = sampler,
+		.imageView = pyramidView,
+		.imageLayout = VK_IMAGE_LAYOUT_GENERAL
+	};
+	for (auto& frameSets: _computeSets) {
+		for (VkDescriptorSet set: frameSets) {
+			VkWriteDescriptorSet pyramidWrite = vkinit::write_descriptor_image(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, set, &pyramidInfo, 5);
+			vkUpdateDescriptorSets(DeviceRef(), 1, &pyramidWrite, 0, nullptr);
+		}
+	}
+}
+
+MaybeVulkanError ParticleSystem::upload(uint32_t frameIndex, std::vector<GPUParticleEmitter>& emitters, GPUParticleParams params) {
+	if (!isEnabled()) return {};
+
+	if (emitters.size() > MAX_PARTICLE_EMITTERS)
+		emitters.resize(MAX_PARTICLE_EMITTERS);
+
+	// Every emitted particle gets its own thread, emitters take consecutive ranges of them
+	uint32_t spawnCount = 0;
+	for (GPUParticleEmitter& emitter: emitters) {
+		emitter.spawnCount = std::min(emitter.spawnCount, _capacity - spawnCount);
+		emitter.spawnOffset = spawnCount;
+		spawnCount += emitter.spawnCount;
+	}
+	_spawnCount[frameIndex] = spawnCount;
+	StatsMan.add(Profiling::Counter::ParticlesSpawned, spawnCount);
+
+	params.emitterCount = emitters.size();
+	params.spawnCount = spawnCount;
+	params.capacity = _capacity;
+
+	auto mapResult = VMAlloc.mapBuffer(_emitterBuffers[frameIndex]);
+	VK_OPTIONAL_ERROR(mapResult, "Could not map particle emitter buffer");
+	memcpy(mapResult.value(), emitters.data(), sizeof(GPUParticleEmitter) * emitters.size());
+	VMAlloc.unmapBuffer(_emitterBuffers[frameIndex]);
+
+	mapResult = VMAlloc.mapBuffer(_paramBuffers[frameIndex]);
+	VK_OPTIONAL_ERROR(mapResult, "Could not map particle parameter buffer");
+	memcpy(mapResult.value(), &params, sizeof(GPUParticleParams));
+	VMAlloc.unmapBuffer(_paramBuffers[frameIndex]);
+
+	StatsMan.add(Profiling::Counter::BytesUploaded, sizeof(GPUParticleEmitter) * emitters.size() + sizeof(GPUParticleParams));
+	return {};
+}
+
+void ParticleSystem::simulate(VkCommandBuffer cmd, uint32_t frameIndex) {
+	if (!isEnabled()) return;
+
+	// Last frame's draw and simulation are done with the buffers before they get rewritten
+	VkMemoryBarrier barrier = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.pNext = nullptr,
+		.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT
+	};
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	if (!_countersReady) {
+		vkCmdFillBuffer(cmd, _counterBuffer._buffer, 0, sizeof(GPUParticleCounters), 0);
+		_countersReady = true;
+	} else {
+		// Survivor counts are rebuilt by the simulation
+		vkCmdFillBuffer(cmd, _counterBuffer._buffer, offsetof(GPUParticleCounters, nextAliveCount),
+			sizeof(GPUParticleCounters) - offsetof(GPUParticleCounters, nextAliveCount), 0);
+	}
+
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _computePipelineLayout, 0, 1, &_computeSets[frameIndex][_current], 0, nullptr);
+
+	// Counts between the passes never leave the GPU
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _simulatePipeline);
+	vkCmdDispatchIndirect(cmd, _counterBuffer._buffer, offsetof(GPUParticleCounters, simulateDispatch));
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	if (_spawnCount[frameIndex] > 0) {
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _emitPipeline);
+		vkCmdDispatch(cmd, (_spawnCount[frameIndex] + 63) / 64, 1, 1);
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _finalizePipeline);
+	vkCmdDispatch(cmd, 1, 1, 1);
+
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+		0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	_current = 1 - _current;
+}
+
+void ParticleSystem::draw(VkCommandBuffer cmd, VkExtent2D extent, VkDescriptorSet globalDescriptor, uint32_t sceneOffset) {
+	if (!isEnabled()) return;
+
+	VkViewport viewport = { 0.f, 0.f, (float)extent.width, (float)extent.height, 0.f, 1.f };
+	VkRect2D scissor = { .offset = { 0, 0 }, .extent = extent };
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, _renderPipeline);
+	vkCmdSetViewport(cmd, 0, 1, &viewport);
+	vkCmdSetScissor(cmd, 0, 1, &scissor);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, _renderPipelineLayout, 0, 1, &globalDescriptor, 1, &sceneOffset);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, _renderPipelineLayout, 1, 1, &_renderSets[_current], 0, nullptr);
+	vkCmdDrawIndirect(cmd, _counterBuffer._buffer, offsetof(GPUParticleCounters, draw), 1, sizeof(VkDrawIndirectCommand));
+	StatsMan.add(Profiling::Counter::DrawCalls);
+	StatsMan.add(Profiling::Counter::PipelineBinds);
+}
+
+} // End of namespace Particles
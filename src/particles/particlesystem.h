@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+#include <expected.hpp>
+
+#include <array>
+#include <vector>
+
+#include "src/allocstructs.h"
+#include "src/deletionqueue.h"
+#include "src/error.h"
+#include "src/gpustructs.h"
+
+namespace Particles {
+
+struct Shaders {
+	VkShaderModule simulate;
+	VkShaderModule emit;
+	VkShaderModule finalize;
+	VkShaderModule vertex;
+	VkShaderModule fragment;
+};
+
+/*!
+ * \brief Particles simulated and drawn entirely on the GPU
+ *
+ * Particles live in two buffers that swap roles every frame. The simulation pass
+ * integrates the particles of one buffer and appends the survivors to the other,
+ * which compacts away dead ones. The emission pass appends new particles after them
+ * while respecting per-emitter budgets, and a one-thread pass turns the final count into
+ * the indirect arguments for the next simulation dispatch and for the billboard draw.
+ * The CPU never reads any of it back.
+ */
+class ParticleSystem {
+public:
+	// Capacity is the total number of particles alive at once, 0 disables the system
+	tl::expected<delFunc, VulkanError*> init(uint32_t capacity, const Shaders& shaders, VkRenderPass renderPass, VkDescriptorSetLayout globalLayout);
+	// Has to be called every time the depth pyramid gets recreated
+	void updateDepthDescriptor(VkImageView pyramidView, VkSampler sampler);
+
+	// Writes emitters and parameters for the frame, spawn offsets are filled in here
+	MaybeVulkanError upload(uint32_t frameIndex, std::vector<GPUParticleEmitter>& emitters, GPUParticleParams params);
+
+	// Must be recorded outside of a render pass, after the depth pyramid got its layout
+	void simulate(VkCommandBuffer cmd, uint32_t frameIndex);
+	// Must be recorded inside the render pass given to init
+	void draw(VkCommandBuffer cmd, VkExtent2D extent, VkDescriptorSet globalDescriptor, uint32_t sceneOffset);
+
+	bool isEnabled() const { return _capacity > 0; };
+	uint32_t getCapacity() const { return _capacity; };
+private:
+	// Same as FRAME_OVERLAP of the engine
+	static constexpr uint32_t FRAMES = 2;
+
+	tl::expected<VkPipeline, VulkanError*> createComputePipeline(VkShaderModule shader);
+
+	uint32_t _capacity = 0;
+	// Buffer holding the particles simulated last, it is the one drawn
+	uint32_t _current = 0;
+	uint32_t _spawnCount[FRAMES] = {};
+	bool _countersReady = false;
+
+	VkDescriptorPool _descriptorPool;
+	VkDescriptorSetLayout _computeLayout;
+	VkDescriptorSetLayout _renderLayout;
+	VkPipelineLayout _computePipelineLayout;
+	VkPipelineLayout _renderPipelineLayout;
+	VkPipeline _simulatePipeline;
+	VkPipeline _emitPipeline;
+	VkPipeline _finalizePipeline;
+	VkPipeline _renderPipeline;
+
+	std::array<AllocatedBuffer, 2> _particleBuffers;
+	AllocatedBuffer _counterBuffer;
+	std::array<AllocatedBuffer, FRAMES> _paramBuffers;
+	std::array<AllocatedBuffer, FRAMES> _emitterBuffers;
+	// Indexed by frame, then by the buffer that is read from
+	std::array<std::array<VkDescriptorSet, 2>, FRAMES> _computeSets;
+	std::array<VkDescriptorSet, 2> _renderSets;
+};
+
+} // End of namespace Particles
@@ -0,0 +1,51 @@
+#include "contactqueue.h"
+
+#include <algorithm>
+#include <tuple>
+
+#include "src/jobs/threadpool.h"
+
+namespace Physics {
+
+namespace {
+
+// Contents break ties between events of the same bodies, e.g. contacts of several sub shapes
+auto orderKey(const ContactEvent& event) {
+    const Contact& contact = event.contact;
+    return std::make_tuple(event.body1.GetIndexAndSequenceNumber(), event.body2.GetIndexAndSequenceNumber(), static_cast<uint8_t>(event.type),
+        contact.point.GetX(), contact.point.GetY(), contact.point.GetZ(),
+        contact.normal.GetX(), contact.normal.GetY(), contact.normal.GetZ(), contact.penetration);
+}
+
+} // End of anonymous namespace
+
+ContactQueue::ContactQueue() {
+    const uint32_t threads = WorkerPool.threadCount();
+    _buffers.reserve(threads);
+    for (uint32_t i = 0; i < threads; i++)
+        _buffers.push_back(std::make_unique<Buffer>());
+}
+
+void ContactQueue::push(const ContactEvent& event) {
+    _buffers[WorkerPool.threadIndex()]->events.push_back(event);
+}
+
+void ContactQueue::gather() {
+    _draining.clear();
+    for (std::unique_ptr<Buffer>& buffer: _buffers) {
+        _draining.insert(_draining.end(), buffer->events.begin(), buffer->events.end());
+        buffer->events.clear();
+    }
+    std::sort(_draining.begin(), _draining.end(), [](const ContactEvent& first, const ContactEvent& second) {
+        return orderKey(first) < orderKey(second);
+    });
+}
+
+size_t ContactQueue::size() const {
+    size_t count = 0;
+    for (const std::unique_ptr<Buffer>& buffer: _buffers)
+        count += buffer->events.size();
+    return count;
+}
+
+} // End of namespace Physics
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <Jolt/Jolt.h>
+#include <Jolt/Physics/Body/BodyID.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Physics {
+
+// What a contact callback learns about the contact, seen from the body the callback belongs to
+struct Contact {
+	// World space, halfway between the surfaces
+	JPH::RVec3 point;
+	// World space, pointing from this body towards the other one
+	JPH::Vec3 normal;
+	float penetration;
+};
+
+enum class ContactEventType: uint8_t {
+	Added,
+	Persisted,
+	Activated,
+	Deactivated,
+};
+
+// Compact copy of something Jolt reported during the step
+struct ContactEvent {
+	Contact contact;
+	JPH::BodyID body1;
+	// Invalid for activation events
+	JPH::BodyID body2;
+	ContactEventType type;
+};
+
+/*!
+ * \brief Collects contact and activation events from Jolt's threads until the step is over
+ *
+ * Every thread of the worker pool pushes into a buffer of its own, so pushing takes no lock.
+ * Threads outside the pool share one buffer, during the step that is only the main thread.
+ * Buffers keep their memory between steps, so a step with as many contacts as before does
+ * not allocate.
+ *
+ * Which buffer an event lands in depends on which worker found the contact, so drain()
+ * sorts the events by their bodies and contents first. Gameplay callbacks then run in the
+ * same order on every run, which replays rely on.
+ */
+class ContactQueue {
+public:
+	ContactQueue();
+
+	// Any pool thread, only while nothing drains the queue
+	void push(const ContactEvent& event);
+	// Visits every event in a deterministic order, then empties the queue. Main thread only,
+	// with no step running. Events queued while visiting (removing a body deactivates it)
+	// are left for the next drain
+	template<typename Visitor>
+	void drain(Visitor&& visit) {
+		gather();
+		for (const ContactEvent& event: _draining)
+			visit(event);
+		_draining.clear();
+	}
+
+	size_t size() const;
+private:
+	// Aligned so threads pushing next to each other do not share cache lines
+	struct alignas(64) Buffer {
+		std::vector<ContactEvent> events;
+	};
+
+	// Moves every buffered event into _draining and sorts them
+	void gather();
+
+	std::vector<std::unique_ptr<Buffer>> _buffers;
+	std::vector<ContactEvent> _draining;
+};
+
+} // End of namespace Physics
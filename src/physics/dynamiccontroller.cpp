@@ -3,6 +3,7 @@
 #include <Jolt/Physics/Collision/Shape/CylinderShape.h>
 
 #include "dynamiccontroller.h"
+#include "src/physics/shapecache.h"
 
 DynamicCharacterController::DynamicCharacterController(Object &self, JPH::ShapeRefC shape, watch_ptr<TransformComponent> transform, std::optional<float> mass):
 	ComponentBase(self),
@@ -143,21 +144,21 @@ bool DynamicCharacterController::IsOnGround() const {
 }
 
 DynamicCharacterController DynamicCharacterController::Box(Object &self, Vec3 halfExtents, watch_ptr<TransformComponent> transform) { 
-	JPH::ShapeRefC boxShape = JPH::BoxShapeSettings(halfExtents).Create().Get();
+	JPH::ShapeRefC boxShape = ShapeCacheMan.box(halfExtents);
 	return DynamicCharacterController(self, boxShape, transform); 
 }
 
 DynamicCharacterController DynamicCharacterController::Cylinder(Object &self, float halfHeight, float radius, watch_ptr<TransformComponent> transform) { 
-	JPH::ShapeRefC boxShape = JPH::CylinderShapeSettings(halfHeight, radius).Create().Get();
+	JPH::ShapeRefC boxShape = ShapeCacheMan.cylinder(halfHeight, radius);
 	return DynamicCharacterController(self, boxShape, transform); 
 }
 
 DynamicCharacterController DynamicCharacterController::Capsule(Object &self, float halfHeight, float radius, watch_ptr<TransformComponent> transform) { 
-	JPH::ShapeRefC boxShape = JPH::CapsuleShapeSettings(halfHeight, radius).Create().Get();
+	JPH::ShapeRefC boxShape = ShapeCacheMan.capsule(halfHeight, radius);
 	return DynamicCharacterController(self, boxShape, transform); 
 }
 
 DynamicCharacterController DynamicCharacterController::Sphere(Object &self, float radius, watch_ptr<TransformComponent> transform) { 
-	JPH::ShapeRefC boxShape = JPH::SphereShapeSettings(radius).Create().Get();
+	JPH::ShapeRefC boxShape = ShapeCacheMan.sphere(radius);
 	return DynamicCharacterController(self, boxShape, transform);
 }
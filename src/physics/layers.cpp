@@ -0,0 +1,67 @@
+#include "layers.h"
+
+namespace Physics {
+
+LayerTable::LayerTable() {
+    addLayer("NON_MOVING", BroadPhaseLayers::NON_MOVING);
+    addLayer("MOVING", BroadPhaseLayers::MOVING);
+    setCollides(Layers::NON_MOVING, Layers::MOVING);
+    setCollides(Layers::MOVING, Layers::MOVING);
+}
+
+std::optional<JPH::ObjectLayer> LayerTable::addLayer(std::string_view name, JPH::BroadPhaseLayer broadPhase) {
+    if (_count == Layers::MAX_LAYERS) return std::nullopt;
+    const JPH::ObjectLayer layer = static_cast<JPH::ObjectLayer>(_count++);
+    _names[layer] = name;
+    _broadPhase[layer] = broadPhase;
+    return layer;
+}
+
+std::optional<JPH::ObjectLayer> LayerTable::findLayer(std::string_view name) const {
+    for (uint32_t layer = 0; layer < _count; layer++) {
+        if (_names[layer] == name) return static_cast<JPH::ObjectLayer>(layer);
+    }
+    return std::nullopt;
+}
+
+void LayerTable::setCollides(JPH::ObjectLayer first, JPH::ObjectLayer second, bool collides) {
+    JPH_ASSERT(first < _count && second < _count);
+    if (collides) {
+        _masks[first] |= 1u << second;
+        _masks[second] |= 1u << first;
+    } else {
+        _masks[first] &= ~(1u << second);
+        _masks[second] &= ~(1u << first);
+    }
+    updateBroadPhaseMask(first);
+    updateBroadPhaseMask(second);
+}
+
+void LayerTable::setBroadPhaseLayer(JPH::ObjectLayer layer, JPH::BroadPhaseLayer broadPhase) {
+    JPH_ASSERT(layer < _count && static_cast<JPH::BroadPhaseLayer::Type>(broadPhase) < BroadPhaseLayers::NUM_LAYERS);
+    _broadPhase[layer] = broadPhase;
+    // Layers colliding with this one may now need a different tree
+    for (uint32_t other = 0; other < _count; other++)
+        updateBroadPhaseMask(static_cast<JPH::ObjectLayer>(other));
+}
+
+void LayerTable::updateBroadPhaseMask(JPH::ObjectLayer layer) {
+    uint32_t mask = 0;
+    for (uint32_t other = 0; other < _count; other++) {
+        if (collides(layer, static_cast<JPH::ObjectLayer>(other)))
+            mask |= 1u << static_cast<JPH::BroadPhaseLayer::Type>(_broadPhase[other]);
+    }
+    _broadPhaseMasks[layer] = mask;
+}
+
+const char* LayerTable::broadPhaseLayerName(JPH::BroadPhaseLayer broadPhase) {
+    switch (static_cast<JPH::BroadPhaseLayer::Type>(broadPhase)) {
+    case static_cast<JPH::BroadPhaseLayer::Type>(BroadPhaseLayers::NON_MOVING): return "NON_MOVING";
+    case static_cast<JPH::BroadPhaseLayer::Type>(BroadPhaseLayers::MOVING): return "MOVING";
+    case static_cast<JPH::BroadPhaseLayer::Type>(BroadPhaseLayers::DEBRIS): return "DEBRIS";
+    case static_cast<JPH::BroadPhaseLayer::Type>(BroadPhaseLayers::SENSOR): return "SENSOR";
+    default: JPH_ASSERT(false); return "INVALID";
+    }
+}
+
+} // End of namespace Physics
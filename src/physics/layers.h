@@ -0,0 +1,74 @@
+#pragma once
+
+#include <Jolt/Jolt.h>
+#include <Jolt/Physics/Collision/ObjectLayer.h>
+#include <Jolt/Physics/Collision/BroadPhase/BroadPhaseLayer.h>
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace Physics {
+
+// Layers every table starts with, scenes add their own with LayerTable::addLayer
+namespace Layers
+{
+	static constexpr JPH::ObjectLayer NON_MOVING = 0;
+	static constexpr JPH::ObjectLayer MOVING = 1;
+	static constexpr uint32_t MAX_LAYERS = 32;
+};
+
+// Every tree the broadphase is built with. Pair tests only happen between layers of trees
+// that collide, so layers that rarely meet anything are best kept in a tree of their own
+namespace BroadPhaseLayers
+{
+	static constexpr JPH::BroadPhaseLayer NON_MOVING(0);
+	static constexpr JPH::BroadPhaseLayer MOVING(1);
+	// Many small bodies that only hit static geometry
+	static constexpr JPH::BroadPhaseLayer DEBRIS(2);
+	// Triggers and pickups
+	static constexpr JPH::BroadPhaseLayer SENSOR(3);
+	static constexpr JPH::uint NUM_LAYERS(4);
+};
+
+/*!
+ * \brief Which object layers collide, and which broadphase tree each of them lives in
+ *
+ * Collisions are a symmetric bitmask matrix, one 32 bit row per layer, so every filter
+ * Jolt calls is a table lookup. Layers that collide with a broadphase tree are cached the
+ * same way. Change the table only between physics steps, and map a layer to its tree
+ * before any body uses it.
+ */
+class LayerTable {
+public:
+	// NON_MOVING collides with MOVING only, MOVING with both
+	LayerTable();
+
+	// Adds a layer that collides with nothing yet, nullopt once all MAX_LAYERS are taken
+	std::optional<JPH::ObjectLayer> addLayer(std::string_view name, JPH::BroadPhaseLayer broadPhase);
+	std::optional<JPH::ObjectLayer> findLayer(std::string_view name) const;
+	uint32_t layerCount() const { return _count; };
+	const std::string& layerName(JPH::ObjectLayer layer) const { return _names[layer]; };
+
+	void setCollides(JPH::ObjectLayer first, JPH::ObjectLayer second, bool collides = true);
+	bool collides(JPH::ObjectLayer first, JPH::ObjectLayer second) const { return (_masks[first] >> second) & 1; };
+	// Whether any layer of the tree collides with the layer
+	bool collides(JPH::ObjectLayer layer, JPH::BroadPhaseLayer broadPhase) const { return (_broadPhaseMasks[layer] >> static_cast<JPH::BroadPhaseLayer::Type>(broadPhase)) & 1; };
+
+	JPH::BroadPhaseLayer broadPhaseLayer(JPH::ObjectLayer layer) const { return _broadPhase[layer]; };
+	void setBroadPhaseLayer(JPH::ObjectLayer layer, JPH::BroadPhaseLayer broadPhase);
+	static const char* broadPhaseLayerName(JPH::BroadPhaseLayer broadPhase);
+private:
+	// Recomputes which trees collide with the layer
+	void updateBroadPhaseMask(JPH::ObjectLayer layer);
+
+	uint32_t _count = 0;
+	std::array<uint32_t, Layers::MAX_LAYERS> _masks {};
+	std::array<uint32_t, Layers::MAX_LAYERS> _broadPhaseMasks {};
+	std::array<JPH::BroadPhaseLayer, Layers::MAX_LAYERS> _broadPhase {};
+	std::array<std::string, Layers::MAX_LAYERS> _names;
+};
+
+} // End of namespace Physics
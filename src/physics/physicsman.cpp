@@ -1,27 +1,18 @@
 #include <fmt/std.h>
+#include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/matrix_decompose.hpp>
 
+#include <Jolt/Physics/Body/BodyLockMulti.h>
+
+#include <algorithm>
+
 #include "physicsman.h"
 #include "src/literals.h"
 
 namespace Physics {
 
 bool ObjectLayerPairFilterImpl::ShouldCollide(JPH::ObjectLayer inObject1, JPH::ObjectLayer inObject2) const {
-    switch (inObject1) {
-    case Layers::NON_MOVING:
-        return inObject2 == Layers::MOVING; // Non moving only collides with moving
-    case Layers::MOVING:
-        return true; // Moving collides with everything
-    default:
-        JPH_ASSERT(false);
-        return false;
-    }
-}
-
-BPLayerInterfaceImpl::BPLayerInterfaceImpl() {
-    // Create a mapping table from object to broad phase layer
-    mObjectToBroadPhase[Layers::NON_MOVING] = BroadPhaseLayers::NON_MOVING;
-    mObjectToBroadPhase[Layers::MOVING] = BroadPhaseLayers::MOVING;
+    return _layers.collides(inObject1, inObject2);
 }
 
 uint BPLayerInterfaceImpl::GetNumBroadPhaseLayers() const {
@@ -29,30 +20,18 @@ uint BPLayerInterfaceImpl::GetNumBroadPhaseLayers() const {
 }
 
 JPH::BroadPhaseLayer BPLayerInterfaceImpl::GetBroadPhaseLayer(JPH::ObjectLayer inLayer) const {
-    JPH_ASSERT(inLayer < Layers::NUM_LAYERS);
-    return mObjectToBroadPhase[inLayer];
+    JPH_ASSERT(inLayer < _layers.layerCount());
+    return _layers.broadPhaseLayer(inLayer);
 }
 
 #if defined(JPH_EXTERNAL_PROFILE) || defined(JPH_PROFILE_ENABLED)
 const char * BPLayerInterfaceImpl::GetBroadPhaseLayerName(JPH::BroadPhaseLayer inLayer) const {
-    switch ((JPH::BroadPhaseLayer::Type)inLayer) {
-	    case (JPH::BroadPhaseLayer::Type)BroadPhaseLayers::NON_MOVING:	return "NON_MOVING";
-	    case (JPH::BroadPhaseLayer::Type)BroadPhaseLayers::MOVING:		return "MOVING";
-    default:													JPH_ASSERT(false); return "INVALID";
-    }
+    return LayerTable::broadPhaseLayerName(inLayer);
 }
 #endif // JPH_EXTERNAL_PROFILE || JPH_PROFILE_ENABLED
 
 bool ObjectVsBroadPhaseLayerFilterImpl::ShouldCollide(JPH::ObjectLayer inLayer1, JPH::BroadPhaseLayer inLayer2) const {
-    switch (inLayer1) {
-    case Layers::NON_MOVING:
-        return inLayer2 == BroadPhaseLayers::MOVING;
-    case Layers::MOVING:
-        return true;
-    default:
-        JPH_ASSERT(false);
-        return false;
-    }
+    return _layers.collides(inLayer1, inLayer2);
 }
 
 // See: JPH::ContactListener
@@ -79,35 +58,51 @@ JPH::ValidateResult	MyContactListener::OnContactValidate(const JPH::Body &inBody
     return result;
 }
 
+namespace {
+
+const std::optional<ContactCallback>& contactCallback(const PhysicalCallbacks &callbacks, ContactEventType type) {
+    return type == ContactEventType::Added ? callbacks.onContactAdded : callbacks.onContactPersisted;
+}
+
+bool wantsContact(const JPH::Body &body, ContactEventType type) {
+    if (body.GetUserData() == 0) return false;
+    return contactCallback(*reinterpret_cast<PhysicalCallbacks*>(body.GetUserData()), type).has_value();
+}
+
+void callContact(const JPH::Body &self, const JPH::Body &other, ContactEventType type, const Contact &contact) {
+    if (self.GetUserData() == 0) return;
+    const std::optional<ContactCallback> &callback = contactCallback(*reinterpret_cast<PhysicalCallbacks*>(self.GetUserData()), type);
+    if (callback.has_value()) callback.value()(self, other, contact);
+}
+
+void callActivation(const JPH::Body &body, ContactEventType type) {
+    if (body.GetUserData() == 0) return;
+    PhysicalCallbacks* callbacks = reinterpret_cast<PhysicalCallbacks*>(body.GetUserData());
+    const std::optional<ActivationCallback> &callback = type == ContactEventType::Activated ? callbacks->onActivate : callbacks->onDeactivate;
+    if (callback.has_value()) callback.value()(body.GetID(), body.GetUserData());
+}
+
+} // End of anonymous namespace
+
+void MyContactListener::queue(ContactEventType type, const JPH::Body &inBody1, const JPH::Body &inBody2, const JPH::ContactManifold &inManifold) {
+    // Most contacts have no callback at all, those are not worth a record
+    if (!wantsContact(inBody1, type) && !wantsContact(inBody2, type)) return;
+    const JPH::RVec3 point = inManifold.mBaseOffset + 0.5f * (inManifold.mRelativeContactPointsOn1[0] + inManifold.mRelativeContactPointsOn2[0]);
+    _queue.push(ContactEvent{
+        .contact = Contact{ point, inManifold.mWorldSpaceNormal, inManifold.mPenetrationDepth },
+        .body1 = inBody1.GetID(),
+        .body2 = inBody2.GetID(),
+        .type = type,
+    });
+}
+
 void MyContactListener::OnContactAdded(const JPH::Body &inBody1, const JPH::Body &inBody2, const JPH::ContactManifold &inManifold, JPH::ContactSettings &ioSettings) {
     // fmt::println("A contact was added");
-    if (inBody1.GetUserData() != 0) {
-        PhysicalCallbacks* callbacks = reinterpret_cast<PhysicalCallbacks*>(inBody1.GetUserData());
-        if (callbacks->onContactAdded.has_value()) {
-            callbacks->onContactAdded.value()(inBody1, inBody2, inManifold, ioSettings);
-        }
-    }
-    if (inBody2.GetUserData() != 0) {
-        PhysicalCallbacks* callbacks = reinterpret_cast<PhysicalCallbacks*>(inBody2.GetUserData());
-        if (callbacks->onContactAdded.has_value()) {
-            callbacks->onContactAdded.value()(inBody2, inBody1, inManifold, ioSettings);
-        }
-    }
+    queue(ContactEventType::Added, inBody1, inBody2, inManifold);
 }
 
 void MyContactListener::OnContactPersisted(const JPH::Body &inBody1, const JPH::Body &inBody2, const JPH::ContactManifold &inManifold, JPH::ContactSettings &ioSettings) {
-    if (inBody1.GetUserData() != 0) {
-        PhysicalCallbacks* callbacks = reinterpret_cast<PhysicalCallbacks*>(inBody1.GetUserData());
-        if (callbacks->onContactPersisted.has_value()) {
-            callbacks->onContactPersisted.value()(inBody1, inBody2, inManifold, ioSettings);
-        }
-    }
-    if (inBody2.GetUserData() != 0) {
-        PhysicalCallbacks* callbacks = reinterpret_cast<PhysicalCallbacks*>(inBody2.GetUserData());
-        if (callbacks->onContactPersisted.has_value()) {
-            callbacks->onContactPersisted.value()(inBody2, inBody1, inManifold, ioSettings);
-        }
-    }
+    queue(ContactEventType::Persisted, inBody1, inBody2, inManifold);
     // fmt::println("One: {}, {}, {}", inBody1.GetCenterOfMassPosition().GetX(), inBody1.GetCenterOfMassPosition().GetZ(), inBody1.GetCenterOfMassPosition().GetZ());
     // fmt::println("Two: {}, {}, {}", inBody2.GetCenterOfMassPosition().GetX(), inBody2.GetCenterOfMassPosition().GetZ(), inBody2.GetCenterOfMassPosition().GetZ());
     // fmt::println("A contact was persisted");
@@ -119,22 +114,14 @@ void MyContactListener::OnContactRemoved(const JPH::SubShapeIDPair &inSubShapePa
 
 void MyBodyActivationListener::OnBodyActivated(const JPH::BodyID &inBodyID, JPH::uint64 inBodyUserData) {
     // fmt::println("A body got activated");
-    if (inBodyUserData != 0) {
-        PhysicalCallbacks* callbacks = reinterpret_cast<PhysicalCallbacks*>(inBodyUserData);
-        if (callbacks->onActivate.has_value()) {
-            callbacks->onActivate.value()(inBodyID, inBodyUserData);
-        }
-    }
+    if (inBodyUserData == 0 || !reinterpret_cast<PhysicalCallbacks*>(inBodyUserData)->onActivate.has_value()) return;
+    _queue.push(ContactEvent{ .body1 = inBodyID, .type = ContactEventType::Activated });
 }
 
 void MyBodyActivationListener::OnBodyDeactivated(const JPH::BodyID &inBodyID, JPH::uint64 inBodyUserData) {
     // fmt::println("A body went to sleep");
-    if (inBodyUserData != 0) {
-        PhysicalCallbacks* callbacks = reinterpret_cast<PhysicalCallbacks*>(inBodyUserData);
-        if (callbacks->onDeactivate.has_value()) {
-            callbacks->onDeactivate.value()(inBodyID, inBodyUserData);
-        }
-    }
+    if (inBodyUserData == 0 || !reinterpret_cast<PhysicalCallbacks*>(inBodyUserData)->onDeactivate.has_value()) return;
+    _queue.push(ContactEvent{ .body1 = inBodyID, .type = ContactEventType::Deactivated });
 }
 
 void prepareJolt() {
@@ -145,7 +132,7 @@ void prepareJolt() {
 
 PhysicsManager::PhysicsManager():
     _tempAllocator(32_MB),
-    _threadPool(JPH::cMaxPhysicsJobs, JPH::cMaxPhysicsBarriers, std::thread::hardware_concurrency() - 1) {
+    _jobSystem(JPH::cMaxPhysicsJobs, JPH::cMaxPhysicsBarriers) {
     _physicsSystem.Init(
         MAX_BODIES, 
         BODY_MUTEXES, 
@@ -164,11 +151,45 @@ PhysicsManager::PhysicsManager():
 }
 
 void PhysicsManager::update(float delta) {
+    if (_fixedStep > 0.f) {
+        _accumulator += delta;
+        int steps = 0;
+        for (; _accumulator >= _fixedStep && steps < MAX_FIXED_STEPS; steps++) {
+            _physicsSystem.Update(_fixedStep, 1, &_tempAllocator, &_jobSystem);
+            _accumulator -= _fixedStep;
+        }
+        if (steps == MAX_FIXED_STEPS)
+            _accumulator = std::min(_accumulator, _fixedStep);
+        return;
+    }
+
     int collisionSteps = 1;
     if (delta > (1.f / 60.f)) {
         collisionSteps = static_cast<int>(std::ceil(60.f * delta));
     }
-    _physicsSystem.Update(delta, collisionSteps, &_tempAllocator, &_threadPool);
+    _physicsSystem.Update(delta, collisionSteps, &_tempAllocator, &_jobSystem);
+}
+
+void PhysicsManager::dispatchContacts() {
+    // No step is running, and callbacks may lock bodies themselves
+    const JPH::BodyLockInterfaceNoLock &bodies = _physicsSystem.GetBodyLockInterfaceNoLock();
+    _contacts.drain([&bodies](const ContactEvent &event) {
+        // Bodies are looked up again before every call, an earlier callback may have destroyed them
+        const JPH::Body* body1 = bodies.TryGetBody(event.body1);
+        if (event.type == ContactEventType::Activated || event.type == ContactEventType::Deactivated) {
+            if (body1 != nullptr) callActivation(*body1, event.type);
+            return;
+        }
+        const JPH::Body* body2 = bodies.TryGetBody(event.body2);
+        if (body1 == nullptr || body2 == nullptr) return;
+        callContact(*body1, *body2, event.type, event.contact);
+
+        body1 = bodies.TryGetBody(event.body1);
+        body2 = bodies.TryGetBody(event.body2);
+        if (body1 == nullptr || body2 == nullptr) return;
+        const Contact flipped { event.contact.point, -event.contact.normal, event.contact.penetration };
+        callContact(*body2, *body1, event.type, flipped);
+    });
 }
 
 //const CastResult PhysicsManager::raycastStatic(glm::vec3& from, glm::vec3& to) {
@@ -215,14 +236,78 @@ void PhysicsManager::addBody(const JPH::BodyID &id) {
     _bodyInterface->AddBody(id, JPH::EActivation::Activate);
 }
 
+void PhysicsManager::addBodies(std::span<JPH::BodyID> ids) {
+    if (ids.empty()) return;
+    // Builds one subtree for the whole batch instead of inserting bodies one by one
+    JPH::BodyInterface::AddState state = _bodyInterface->AddBodiesPrepare(ids.data(), ids.size());
+    _bodyInterface->AddBodiesFinalize(ids.data(), ids.size(), state, JPH::EActivation::Activate);
+}
+
 void PhysicsManager::removeBody(const JPH::BodyID &id) {
     _bodyInterface->RemoveBody(id);
 }
 
+void PhysicsManager::setObjectLayer(const JPH::BodyID &id, JPH::ObjectLayer layer) {
+    _bodyInterface->SetObjectLayer(id, layer);
+}
+
+bool PhysicsManager::isAdded(const JPH::BodyID &id) const {
+    return _bodyInterface->IsAdded(id);
+}
+
+void PhysicsManager::scheduleRemove(const JPH::BodyID &id) {
+    std::lock_guard lock(_removalMutex);
+    _scheduledRemovals.push_back(id);
+}
+
+void PhysicsManager::cancelRemove(const JPH::BodyID &id) {
+    std::lock_guard lock(_removalMutex);
+    std::erase(_scheduledRemovals, id);
+}
+
+void PhysicsManager::removeScheduled() {
+    std::lock_guard lock(_removalMutex);
+    for (const JPH::BodyID &id: _scheduledRemovals) {
+        // The same body may be scheduled by several contacts, or be destroyed already
+        if (_bodyInterface->IsAdded(id)) _bodyInterface->RemoveBody(id);
+    }
+    _scheduledRemovals.clear();
+}
+
 void PhysicsManager::destroyBody(const JPH::BodyID &id) {
     _bodyInterface->DestroyBody(id);
 }
 
+void PhysicsManager::bindTransform(const JPH::BodyID &id, TransformStorage* storage, TransformStorage::Slot slot) {
+    const uint32_t index = id.GetIndex();
+    if (index >= _transformTargets.size()) _transformTargets.resize(index + 1);
+    _transformTargets[index] = { storage, slot };
+}
+
+void PhysicsManager::unbindTransform(const JPH::BodyID &id) {
+    const uint32_t index = id.GetIndex();
+    if (index < _transformTargets.size()) _transformTargets[index] = {};
+}
+
+uint32_t PhysicsManager::syncTransforms() {
+    _physicsSystem.GetActiveBodies(JPH::EBodyType::RigidBody, _activeBodies);
+    if (_activeBodies.empty()) return 0;
+    uint32_t synced = 0;
+    JPH::BodyLockMultiRead lock(_physicsSystem.GetBodyLockInterface(), _activeBodies.data(), static_cast<int>(_activeBodies.size()));
+    for (int i = 0; i < static_cast<int>(_activeBodies.size()); i++) {
+        const JPH::Body* body = lock.GetBody(i);
+        const uint32_t index = _activeBodies[i].GetIndex();
+        if (body == nullptr || index >= _transformTargets.size()) continue;
+        const TransformTarget &target = _transformTargets[index];
+        if (target.storage == nullptr) continue;
+        JPH::Float4 matrix[4];
+        body->GetWorldTransform().StoreFloat4x4(matrix);
+        target.storage->setMatrix(target.slot, glm::make_mat4x4(reinterpret_cast<const float*>(matrix)));
+        synced++;
+    }
+    return synced;
+}
+
 void PhysicsManager::setLinearVelocity(const JPH::BodyID &id, JPH::Vec3Arg velocity) {
     _bodyInterface->SetLinearVelocity(id, velocity);
 }
@@ -239,10 +324,41 @@ void PhysicsManager::setPosition(const JPH::BodyID &id, const JPH::Vec3Arg &posi
     _bodyInterface->SetPosition(id, position, JPH::EActivation::Activate);
 }
 
+void PhysicsManager::resetBody(const JPH::BodyID &id, JPH::Vec3Arg position, JPH::QuatArg rotation) {
+    _bodyInterface->SetPositionAndRotation(id, position, rotation, JPH::EActivation::DontActivate);
+    _bodyInterface->SetLinearAndAngularVelocity(id, JPH::Vec3::sZero(), JPH::Vec3::sZero());
+}
+
 void PhysicsManager::optimizeBroadphase() {
     _physicsSystem.OptimizeBroadPhase();
 }
 
+BodyStats PhysicsManager::getBodyStats() {
+    const JPH::BodyManager::BodyStats jolt = _physicsSystem.GetBodyStats();
+
+    // Jolt counts every created body, those outside the broadphase can not be asleep
+    uint32_t unaddedMoving = 0;
+    uint32_t unaddedStatic = 0;
+    _physicsSystem.GetBodies(_statBodies);
+    const JPH::BodyLockInterfaceNoLock& bodies = _physicsSystem.GetBodyLockInterfaceNoLock();
+    for (const JPH::BodyID& id: _statBodies) {
+        const JPH::Body* body = bodies.TryGetBody(id);
+        if (body == nullptr || body->IsInBroadPhase()) continue;
+        if (body->IsStatic()) unaddedStatic++;
+        else unaddedMoving++;
+    }
+
+    const uint32_t active = jolt.mNumActiveBodiesDynamic + jolt.mNumActiveBodiesKinematic;
+    const uint32_t moving = jolt.mNumBodiesDynamic + jolt.mNumBodiesKinematic - unaddedMoving;
+    return BodyStats{
+        .active = active,
+        .sleeping = moving - active,
+        .staticBodies = jolt.mNumBodiesStatic - unaddedStatic,
+        .unadded = unaddedMoving + unaddedStatic,
+        .total = jolt.mNumBodies
+    };
+}
+
 void PhysicsManager::destroy() {
     JPH::UnregisterTypes();
     delete JPH::Factory::sInstance;
@@ -8,7 +8,6 @@
 #include <Jolt/RegisterTypes.h>
 #include <Jolt/Core/Factory.h>
 #include <Jolt/Core/TempAllocator.h>
-#include <Jolt/Core/JobSystemThreadPool.h>
 #include <Jolt/Physics/PhysicsSettings.h>
 #include <Jolt/Physics/PhysicsSystem.h>
 #include <Jolt/Physics/Character/Character.h>
@@ -18,9 +17,16 @@
 #include <Jolt/Physics/Body/BodyActivationListener.h>
 
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <span>
+#include <vector>
 
+#include "src/jobs/joltjobsystem.h"
+#include "src/physics/contactqueue.h"
+#include "src/physics/layers.h"
 #include "src/objects/object.h"
+#include "src/objects/transformstorage.h"
 #include "src/singleton.h"
 #include "src/watchptr.h"
 
@@ -32,20 +38,6 @@ struct CharacterAdditionalData {
 
 namespace Physics {
 
-namespace Layers
-{
-	static constexpr JPH::ObjectLayer NON_MOVING = 0;
-	static constexpr JPH::ObjectLayer MOVING = 1;
-	static constexpr JPH::ObjectLayer NUM_LAYERS = 2;
-};
-
-namespace BroadPhaseLayers
-{
-	static constexpr JPH::BroadPhaseLayer NON_MOVING(0);
-	static constexpr JPH::BroadPhaseLayer MOVING(1);
-	static constexpr JPH::uint NUM_LAYERS(2);
-};
-
 struct CastResult {
 	const bool hasHit;
 	const float hitFraction;
@@ -56,12 +48,16 @@ struct CastResult {
 /// Class that determines if two object layers can collide
 class ObjectLayerPairFilterImpl : public JPH::ObjectLayerPairFilter {
 public:
+	explicit ObjectLayerPairFilterImpl(const LayerTable& layers): _layers(layers) {};
+
 	virtual bool ShouldCollide(JPH::ObjectLayer inObject1, JPH::ObjectLayer inObject2) const override;
+private:
+	const LayerTable& _layers;
 };
 
 class BPLayerInterfaceImpl final : public JPH::BroadPhaseLayerInterface {
 public:
-	BPLayerInterfaceImpl();
+	explicit BPLayerInterfaceImpl(const LayerTable& layers): _layers(layers) {};
 
 	virtual uint GetNumBroadPhaseLayers() const override;
 
@@ -72,17 +68,23 @@ public:
 #endif // JPH_EXTERNAL_PROFILE || JPH_PROFILE_ENABLED
 
 private:
-	JPH::BroadPhaseLayer mObjectToBroadPhase[Layers::NUM_LAYERS];
+	const LayerTable& _layers;
 };
 
 class ObjectVsBroadPhaseLayerFilterImpl : public JPH::ObjectVsBroadPhaseLayerFilter {
 public:
+	explicit ObjectVsBroadPhaseLayerFilterImpl(const LayerTable& layers): _layers(layers) {};
+
 	virtual bool ShouldCollide(JPH::ObjectLayer inLayer1, JPH::BroadPhaseLayer inLayer2) const override;
+private:
+	const LayerTable& _layers;
 };
 
-// An example contact listener
+// Validation runs inside the step, added and persisted contacts are queued for dispatchContacts()
 class MyContactListener : public JPH::ContactListener {
 public:
+	explicit MyContactListener(ContactQueue& queue): _queue(queue) {};
+
 	// See: JPH::ContactListener
 	virtual JPH::ValidateResult	OnContactValidate(const JPH::Body &inBody1, const JPH::Body &inBody2, JPH::RVec3Arg inBaseOffset, const JPH::CollideShapeResult &inCollisionResult) override;
 
@@ -91,21 +93,31 @@ public:
 	virtual void OnContactPersisted(const JPH::Body &inBody1, const JPH::Body &inBody2, const JPH::ContactManifold &inManifold, JPH::ContactSettings &ioSettings) override;
 
 	virtual void OnContactRemoved(const JPH::SubShapeIDPair &inSubShapePair) override;
+private:
+	void queue(ContactEventType type, const JPH::Body &inBody1, const JPH::Body &inBody2, const JPH::ContactManifold &inManifold);
+
+	ContactQueue& _queue;
 };
 
-// An example activation listener
+// Queues activation changes for dispatchContacts()
 class MyBodyActivationListener : public JPH::BodyActivationListener
 {
 public:
+	explicit MyBodyActivationListener(ContactQueue& queue): _queue(queue) {};
+
 	virtual void OnBodyActivated(const JPH::BodyID &inBodyID, JPH::uint64 inBodyUserData) override;
 
 	virtual void OnBodyDeactivated(const JPH::BodyID &inBodyID, JPH::uint64 inBodyUserData) override;
+private:
+	ContactQueue& _queue;
 };
 
 using ValidateCallback = std::function<JPH::ValidateResult (const JPH::Body &, const JPH::Body &, JPH::RVec3Arg, const JPH::CollideShapeResult &)>;
-using ContactCallback = std::function<void (const JPH::Body &, const JPH::Body &, const JPH::ContactManifold &, const JPH::ContactSettings &)>;
+// Called on the main thread after the step, with the body the callback belongs to first
+using ContactCallback = std::function<void (const JPH::Body &, const JPH::Body &, const Contact &)>;
 using ActivationCallback = std::function<void (const JPH::BodyID &, JPH::uint64)>;
 
+// Validation is called from inside the step on Jolt's threads, so it must only look at the bodies
 struct PhysicalCallbacks {
 	Object caller;
 	std::optional<ValidateCallback> onContactValidate;
@@ -125,21 +137,47 @@ struct NewBodyData {
 	JPH::BodyID id;
 };
 
+struct BodyStats {
+	// Dynamic and kinematic bodies in the simulation, awake or not
+	uint32_t active;
+	uint32_t sleeping;
+	uint32_t staticBodies;
+	// Created but not in the simulation, like pooled bodies waiting for a spawn
+	uint32_t unadded;
+	uint32_t total;
+};
+
 void prepareJolt();
 
 class PhysicsManager : public Singleton<PhysicsManager> {
 public:
 	PhysicsManager();
 
+	// Steps by delta, or in fixed steps once setFixedStep() was called
 	void update(float delta);
+	// Frame deltas only feed an accumulator and the system always advances by step, so the
+	// same deltas give the same simulation. 0 goes back to one variable step per frame
+	void setFixedStep(float step) { _fixedStep = step; _accumulator = 0.f; };
+	// Calls the contact and activation callbacks queued by the last step, main thread only
+	void dispatchContacts();
 
 	std::optional<NewBodyData> createBody(const JPH::BodyCreationSettings &settings);
 	std::optional<NewBodyData> createAndAddBody(const JPH::BodyCreationSettings &settings);
 	JPH::Character& createCharacter(const JPH::CharacterSettings &settings, const CharacterAdditionalData &extra);
 
 	void addBody(const JPH::BodyID &id);
+	// Inserts many created bodies into the broadphase at once, may reorder the IDs
+	void addBodies(std::span<JPH::BodyID> ids);
 	JPH::Body getBody(const JPH::BodyID &id);
 	void removeBody(const JPH::BodyID &id);
+	// The layer must already map to a broadphase tree, see LayerTable
+	void setObjectLayer(const JPH::BodyID &id, JPH::ObjectLayer layer);
+	bool isAdded(const JPH::BodyID &id) const;
+	// Safe from contact callbacks, the body leaves the simulation on the next removeScheduled()
+	void scheduleRemove(const JPH::BodyID &id);
+	// Drops a removal that did not happen yet
+	void cancelRemove(const JPH::BodyID &id);
+	void removeScheduled();
 
 	void destroyBody(const JPH::BodyID &id);
 
@@ -149,30 +187,68 @@ public:
 
 	JPH::RVec3 getCoMPosition(const JPH::BodyID &id);
 	void setPosition(const JPH::BodyID &id, const JPH::Vec3Arg &position);
+	// Teleports a body and stops it, without waking it up
+	void resetBody(const JPH::BodyID &id, JPH::Vec3Arg position, JPH::QuatArg rotation);
 	// const CastResult raycastStatic(glm::vec3& from, glm::vec3& to);
 	// const CastResult raycastController(btRigidBody* controllerBody, btPairCachingGhostObject* ghost, float yOffset);
 	// const CastResult raycastController(RigidBodyComponent* object, float yOffset);
 	// const CastResult shapeCastStatic(btConvexShape* castShape, glm::mat4& from, glm::mat4& to);
 
+	// Where syncTransforms() writes the world transform of the body
+	void bindTransform(const JPH::BodyID &id, TransformStorage* storage, TransformStorage::Slot slot);
+	void unbindTransform(const JPH::BodyID &id);
+	// Copies world transforms of the active rigid bodies into their bound slots, returns how many.
+	// Sleeping and removed bodies are not visited at all
+	uint32_t syncTransforms();
+
 	void optimizeBroadphase();
 
+	// Walks every body, meant for sampling once per frame
+	BodyStats getBodyStats();
+
+	// Only change between steps
+	LayerTable& layers() { return _layers; };
+
 	void destroy();
 private:
 	//
     JPH::TempAllocatorImpl _tempAllocator;
-	JPH::JobSystemThreadPool _threadPool;
+	// Jolt shares the engine worker pool instead of starting threads of its own
+	Jobs::JoltJobSystem _jobSystem;
 	JPH::PhysicsSystem _physicsSystem;
 	watch_ptr<const JPH::NarrowPhaseQuery> _nphasequery;
 	watch_ptr<JPH::BodyInterface> _bodyInterface;
 
-	// Interfaces
-	BPLayerInterfaceImpl _broadPhaseLayers;
-	ObjectVsBroadPhaseLayerFilterImpl _objectVsBroadphaseLayerFilter;
-	ObjectLayerPairFilterImpl _objectVsObjectLayerFilter;
+	struct TransformTarget {
+		TransformStorage* storage = nullptr;
+		TransformStorage::Slot slot = 0;
+	};
+	// Indexed by BodyID::GetIndex(), storage is null for unbound bodies
+	std::vector<TransformTarget> _transformTargets;
+	// Reused by syncTransforms(), so it does not allocate once warmed up
+	JPH::BodyIDVector _activeBodies;
+	// Reused by getBodyStats()
+	JPH::BodyIDVector _statBodies;
+
+	// Caps the steps of one frame, time beyond that is dropped instead of piling up
+	static constexpr int MAX_FIXED_STEPS = 8;
+	float _fixedStep = 0.f;
+	// Frame time not simulated yet
+	float _accumulator = 0.f;
+
+	std::mutex _removalMutex;
+	std::vector<JPH::BodyID> _scheduledRemovals;
+
+	// Interfaces, all looking up the layer table
+	LayerTable _layers;
+	BPLayerInterfaceImpl _broadPhaseLayers {_layers};
+	ObjectVsBroadPhaseLayerFilterImpl _objectVsBroadphaseLayerFilter {_layers};
+	ObjectLayerPairFilterImpl _objectVsObjectLayerFilter {_layers};
 
 	// Listeners
-	MyBodyActivationListener _activationListener;
-	MyContactListener _contactListener;
+	ContactQueue _contacts;
+	MyBodyActivationListener _activationListener {_contacts};
+	MyContactListener _contactListener {_contacts};
 
 };
 
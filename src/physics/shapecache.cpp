@@ -0,0 +1,75 @@
+#include <Jolt/Jolt.h>
+#include <Jolt/Physics/Collision/Shape/BoxShape.h>
+#include <Jolt/Physics/Collision/Shape/CapsuleShape.h>
+#include <Jolt/Physics/Collision/Shape/CylinderShape.h>
+#include <Jolt/Physics/Collision/Shape/SphereShape.h>
+
+#include <functional>
+
+#include "shapecache.h"
+
+namespace Physics {
+
+bool ShapeCache::Key::operator==(const Key& other) const {
+	return primitive == other.primitive && size[0] == other.size[0] && size[1] == other.size[1] && size[2] == other.size[2];
+}
+
+size_t ShapeCache::KeyHash::operator()(const Key& key) const {
+	size_t hash = std::hash<uint32_t>()(static_cast<uint32_t>(key.primitive));
+	for (float value: key.size)
+		hash = hash * 31 + std::hash<float>()(value);
+	return hash;
+}
+
+template<typename Settings>
+JPH::ShapeRefC ShapeCache::get(const Key& key, const Settings& settings) {
+	std::lock_guard lock(_mutex);
+	auto it = _shapes.find(key);
+	if (it != _shapes.end()) return it->second;
+
+	JPH::ShapeRefC shape = settings.Create().Get();
+	// Failed shapes are not cached, the caller gets a null reference
+	if (shape != nullptr) _shapes.emplace(key, shape);
+	return shape;
+}
+
+JPH::ShapeRefC ShapeCache::box(Vec3 halfExtents) {
+	const glm::vec3 extents = halfExtents.glm();
+	return get({ Primitive::Box, { extents.x, extents.y, extents.z } }, JPH::BoxShapeSettings(halfExtents.jolt()));
+}
+
+JPH::ShapeRefC ShapeCache::sphere(float radius) {
+	return get({ Primitive::Sphere, { radius, 0.f, 0.f } }, JPH::SphereShapeSettings(radius));
+}
+
+JPH::ShapeRefC ShapeCache::capsule(float halfHeight, float radius) {
+	return get({ Primitive::Capsule, { halfHeight, radius, 0.f } }, JPH::CapsuleShapeSettings(halfHeight, radius));
+}
+
+JPH::ShapeRefC ShapeCache::cylinder(float halfHeight, float radius) {
+	return get({ Primitive::Cylinder, { halfHeight, radius, 0.f } }, JPH::CylinderShapeSettings(halfHeight, radius));
+}
+
+JPH::ShapeRefC ShapeCache::cooked(uint64_t key) {
+	std::lock_guard lock(_mutex);
+	auto it = _cooked.find(key);
+	return it != _cooked.end() ? it->second : nullptr;
+}
+
+JPH::ShapeRefC ShapeCache::addCooked(uint64_t key, JPH::ShapeRefC shape) {
+	std::lock_guard lock(_mutex);
+	return _cooked.try_emplace(key, shape).first->second;
+}
+
+size_t ShapeCache::size() {
+	std::lock_guard lock(_mutex);
+	return _shapes.size() + _cooked.size();
+}
+
+void ShapeCache::clear() {
+	std::lock_guard lock(_mutex);
+	_shapes.clear();
+	_cooked.clear();
+}
+
+} // End of namespace Physics
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <Jolt/Jolt.h>
+#include <Jolt/Physics/Collision/Shape/Shape.h>
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+#include "src/singleton.h"
+#include "src/vector.h"
+
+namespace Physics {
+
+/*!
+ * \brief Hands out one shared shape per primitive and size
+ *
+ * Bodies of the same size share their shape instead of each building one,
+ * which also lets snapshots store the shape once.
+ */
+class ShapeCache: public Singleton<ShapeCache> {
+public:
+	JPH::ShapeRefC box(Vec3 halfExtents);
+	JPH::ShapeRefC sphere(float radius);
+	JPH::ShapeRefC capsule(float halfHeight, float radius);
+	JPH::ShapeRefC cylinder(float halfHeight, float radius);
+
+	// Shapes built from content, e.g. by ShapeCooker, keyed by a hash of that content.
+	// Null if there is none yet
+	JPH::ShapeRefC cooked(uint64_t key);
+	// Returns the shape kept under the key, which is an earlier one if another thread was faster
+	JPH::ShapeRefC addCooked(uint64_t key, JPH::ShapeRefC shape);
+
+	size_t size();
+	// Drops the cache's references, shapes still used by bodies stay alive
+	void clear();
+private:
+	enum class Primitive: uint32_t {
+		Box,
+		Sphere,
+		Capsule,
+		Cylinder,
+	};
+
+	struct Key {
+		Primitive primitive;
+		float size[3];
+
+		bool operator==(const Key& other) const;
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key& key) const;
+	};
+
+	template<typename Settings>
+	JPH::ShapeRefC get(const Key& key, const Settings& settings);
+
+	std::mutex _mutex;
+	std::unordered_map<Key, JPH::ShapeRefC, KeyHash> _shapes;
+	std::unordered_map<uint64_t, JPH::ShapeRefC> _cooked;
+};
+
+} // End of namespace Physics
+
+#define ShapeCacheMan Physics::ShapeCache::instance()
@@ -0,0 +1,183 @@
+#include <Jolt/Jolt.h>
+#include <Jolt/Core/StreamWrapper.h>
+#include <Jolt/Physics/Collision/Shape/ConvexHullShape.h>
+#include <Jolt/Physics/Collision/Shape/MeshShape.h>
+#include <Jolt/Physics/Collision/Shape/StaticCompoundShape.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <fstream>
+#include <vector>
+
+#include "shapecooker.h"
+#include "shapecache.h"
+#include "src/crc32.h"
+#include "src/vk_mesh.h"
+
+namespace Physics {
+
+namespace {
+
+JPH::Vec3 centroid(std::span<const JPH::Float3> positions, uint32_t triangle) {
+	const uint32_t first = triangle * 3;
+	return (JPH::Vec3(positions[first]) + JPH::Vec3(positions[first + 1]) + JPH::Vec3(positions[first + 2])) / 3.f;
+}
+
+// Halves the triangles along the longest extent of their centroids, each half gets half the hull budget
+void splitPieces(std::span<const JPH::Float3> positions, std::span<uint32_t> triangles, uint32_t maxTriangles, uint32_t budget, std::vector<std::span<uint32_t>>& pieces) {
+	if (triangles.size() <= maxTriangles || budget < 2) {
+		pieces.push_back(triangles);
+		return;
+	}
+	JPH::Vec3 low = JPH::Vec3::sReplicate(FLT_MAX);
+	JPH::Vec3 high = -low;
+	for (uint32_t triangle: triangles) {
+		const JPH::Vec3 center = centroid(positions, triangle);
+		low = JPH::Vec3::sMin(low, center);
+		high = JPH::Vec3::sMax(high, center);
+	}
+	const int axis = (high - low).GetHighestComponentIndex();
+	const size_t middle = triangles.size() / 2;
+	std::nth_element(triangles.begin(), triangles.begin() + middle, triangles.end(), [&](uint32_t first, uint32_t second) {
+		return centroid(positions, first)[axis] < centroid(positions, second)[axis];
+	});
+	splitPieces(positions, triangles.first(middle), maxTriangles, budget / 2, pieces);
+	splitPieces(positions, triangles.subspan(middle), maxTriangles, budget - budget / 2, pieces);
+}
+
+tl::expected<JPH::ShapeRefC, Error*> createShape(const JPH::ShapeSettings& settings, const char* kind) {
+	JPH::ShapeSettings::ShapeResult result = settings.Create();
+	if (result.HasError())
+		return tl::unexpected(new Error(ErrorMessage("Could not cook {} shape: {}", kind, result.GetError().c_str())));
+	return JPH::ShapeRefC(result.Get());
+}
+
+} // End of anonymous namespace
+
+tl::expected<JPH::ShapeRefC, Error*> ShapeCooker::cook(const Mesh& mesh, const CookOptions& options) {
+	std::vector<JPH::Float3> positions;
+	positions.reserve(mesh._vertices.size());
+	for (const Vertex& vertex: mesh._vertices)
+		positions.emplace_back(vertex.position.x, vertex.position.y, vertex.position.z);
+	// Meshes are plain triangle lists
+	positions.resize(positions.size() / 3 * 3);
+	if (positions.empty())
+		return tl::unexpected(new Error("Could not cook a shape from a mesh without triangles"));
+
+	const uint64_t key = makeKey(positions, options);
+	if (JPH::ShapeRefC shape = ShapeCacheMan.cooked(key); shape != nullptr) return shape;
+	if (JPH::ShapeRefC shape = load(key); shape != nullptr) return ShapeCacheMan.addCooked(key, shape);
+
+	auto built = build(positions, options);
+	if (!built.has_value()) return built;
+	save(key, *built.value());
+	return ShapeCacheMan.addCooked(key, built.value());
+}
+
+uint64_t ShapeCooker::makeKey(std::span<const JPH::Float3> positions, const CookOptions& options) {
+	const uint32_t settings[] = { static_cast<uint32_t>(options.kind), options.maxTrianglesPerHull, options.maxHulls, static_cast<uint32_t>(positions.size()) };
+	const uint32_t contentHash = Common::crc32(reinterpret_cast<const unsigned char*>(positions.data()), positions.size_bytes());
+	const uint32_t settingsHash = Common::crc32(reinterpret_cast<const unsigned char*>(settings), sizeof(settings));
+	return static_cast<uint64_t>(contentHash) << 32 | settingsHash;
+}
+
+tl::expected<JPH::ShapeRefC, Error*> ShapeCooker::build(std::span<const JPH::Float3> positions, const CookOptions& options) {
+	switch (options.kind) {
+	case CookedShapeKind::ConvexHull: {
+		JPH::Array<JPH::Vec3> points;
+		points.reserve(positions.size());
+		for (const JPH::Float3& position: positions)
+			points.push_back(JPH::Vec3(position));
+		return createShape(JPH::ConvexHullShapeSettings(points), "convex hull");
+	}
+	case CookedShapeKind::Triangles: {
+		JPH::TriangleList triangles;
+		triangles.reserve(positions.size() / 3);
+		for (size_t i = 0; i < positions.size(); i += 3)
+			triangles.push_back(JPH::Triangle(positions[i], positions[i + 1], positions[i + 2]));
+		return createShape(JPH::MeshShapeSettings(triangles), "mesh");
+	}
+	case CookedShapeKind::Decomposed: {
+		std::vector<uint32_t> triangles(positions.size() / 3);
+		for (uint32_t i = 0; i < triangles.size(); i++)
+			triangles[i] = i;
+		std::vector<std::span<uint32_t>> pieces;
+		splitPieces(positions, triangles, std::max(options.maxTrianglesPerHull, 1u), std::max(options.maxHulls, 1u), pieces);
+
+		JPH::StaticCompoundShapeSettings compound;
+		JPH::Array<JPH::Vec3> points;
+		for (std::span<uint32_t> piece: pieces) {
+			points.clear();
+			for (uint32_t triangle: piece) {
+				for (uint32_t corner = 0; corner < 3; corner++)
+					points.push_back(JPH::Vec3(positions[triangle * 3 + corner]));
+			}
+			// Flat pieces have no volume to wrap, the pieces around them still do
+			auto hull = createShape(JPH::ConvexHullShapeSettings(points), "convex hull");
+			if (hull.has_value()) compound.AddShape(JPH::Vec3::sZero(), JPH::Quat::sIdentity(), hull.value());
+		}
+		if (compound.mSubShapes.empty())
+			return tl::unexpected(new Error("Could not cook a decomposed shape: no piece of the mesh has volume"));
+		if (compound.mSubShapes.size() == 1)
+			return JPH::ShapeRefC(compound.mSubShapes.front().mShapePtr);
+		return createShape(compound, "decomposed");
+	}
+	}
+	return tl::unexpected(new Error("Unknown cooked shape kind"));
+}
+
+std::filesystem::path ShapeCooker::cachePath(uint64_t key) const {
+	return _cacheDirectory / fmt::format("{:016x}.shape", key);
+}
+
+JPH::ShapeRefC ShapeCooker::load(uint64_t key) const {
+	if (_cacheDirectory.empty()) return nullptr;
+	std::ifstream file(cachePath(key), std::ios::binary);
+	if (!file.is_open()) return nullptr;
+
+	CacheHeader header {};
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file || header.magic != CACHE_MAGIC || header.version != CACHE_VERSION || header.key != key
+		|| header.joltVersion != JPH_VERSION_ID || header.realSize != sizeof(JPH::Real))
+		return nullptr;
+
+	JPH::StreamInWrapper stream(file);
+	JPH::Shape::IDToShapeMap shapes;
+	JPH::Shape::IDToMaterialMap materials;
+	JPH::Shape::ShapeResult result = JPH::Shape::sRestoreWithChildren(stream, shapes, materials);
+	if (result.HasError() || stream.IsFailed()) return nullptr;
+	return result.Get();
+}
+
+void ShapeCooker::save(uint64_t key, const JPH::Shape& shape) const {
+	// A failed save only means the next launch cooks again
+	if (_cacheDirectory.empty()) return;
+	std::error_code error;
+	std::filesystem::create_directories(_cacheDirectory, error);
+	if (error) return;
+
+	// Written aside and renamed, so an interrupted save never leaves a truncated file behind
+	const std::filesystem::path path = cachePath(key);
+	std::filesystem::path temporary = path;
+	temporary += ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) return;
+		const CacheHeader header { CACHE_MAGIC, CACHE_VERSION, JPH_VERSION_ID, sizeof(JPH::Real), key };
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		JPH::StreamOutWrapper stream(file);
+		JPH::Shape::ShapeToIDMap shapes;
+		JPH::Shape::MaterialToIDMap materials;
+		shape.SaveWithChildren(stream, shapes, materials);
+		if (stream.IsFailed()) {
+			file.close();
+			std::filesystem::remove(temporary, error);
+			return;
+		}
+	}
+	std::filesystem::rename(temporary, path, error);
+}
+
+} // End of namespace Physics
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <Jolt/Jolt.h>
+#include <Jolt/Physics/Collision/Shape/Shape.h>
+
+#include <expected.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+#include "src/error.h"
+#include "src/singleton.h"
+
+struct Mesh;
+
+namespace Physics {
+
+enum class CookedShapeKind: uint32_t {
+	// One hull around the whole mesh, for small dynamic props
+	ConvexHull,
+	// The triangles themselves, exact but only for static and kinematic bodies
+	Triangles,
+	// A compound of hulls around spatial pieces of the mesh, for concave dynamic bodies
+	Decomposed,
+};
+
+struct CookOptions {
+	CookedShapeKind kind = CookedShapeKind::Triangles;
+	// Decomposed only: pieces are halved until they have at most this many triangles,
+	// or there would be more than maxHulls of them
+	uint32_t maxTrianglesPerHull = 256;
+	uint32_t maxHulls = 32;
+};
+
+/*!
+ * \brief Builds collision shapes from render meshes
+ *
+ * Shapes are keyed by a hash of the vertex positions and the options, so the same mesh
+ * is only cooked once per launch (see ShapeCache). With a cache directory set, cooked
+ * shapes are saved there with Jolt's binary state and later launches only read them back.
+ * Cache files are checked against the key and the Jolt version, stale ones are cooked again.
+ */
+class ShapeCooker: public Singleton<ShapeCooker> {
+public:
+	// Empty keeps cooked shapes in memory only
+	void setCacheDirectory(const std::filesystem::path& directory) { _cacheDirectory = directory; };
+
+	tl::expected<JPH::ShapeRefC, Error*> cook(const Mesh& mesh, const CookOptions& options = {});
+private:
+	struct CacheHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t joltVersion;
+		uint32_t realSize;
+		uint64_t key;
+	};
+	// "CGSH"
+	static constexpr uint32_t CACHE_MAGIC = 0x48534743;
+	// Bumped whenever cooking changes, old files are cooked again
+	static constexpr uint32_t CACHE_VERSION = 1;
+
+	static uint64_t makeKey(std::span<const JPH::Float3> positions, const CookOptions& options);
+	static tl::expected<JPH::ShapeRefC, Error*> build(std::span<const JPH::Float3> positions, const CookOptions& options);
+	std::filesystem::path cachePath(uint64_t key) const;
+	JPH::ShapeRefC load(uint64_t key) const;
+	void save(uint64_t key, const JPH::Shape& shape) const;
+
+	std::filesystem::path _cacheDirectory;
+};
+
+} // End of namespace Physics
+
+#define ShapeCookerMan Physics::ShapeCooker::instance()
@@ -49,6 +49,7 @@ void GamepadManager::callbackJoystickConnectionChanged(int jid, int event) {
 
 void GamepadManager::setActiveGamepad(int id) {
     _activeGamepadId = id;
+    buttonsHeld.reset();
 
     // set default last axis/trigger values
     stickLastValues[GLFW_GAMEPAD_AXIS_LEFT] = glm::vec2(0, 0);
@@ -74,32 +75,28 @@ void GamepadManager::pollGamepadEvents() {
     GLFWgamepadstate state;
     glfwGetGamepadState(_activeGamepadId.value(), &state);
 
-    for (int i = 0; i < GLFW_GAMEPAD_BUTTON_LAST; i++) {
+    for (int i = 0; i <= GLFW_GAMEPAD_BUTTON_LAST; i++) {
         if (state.buttons[i] == GLFW_PRESS) {
-            if (buttonsHeld.count(i) == 0) {
-                buttonsHeld.insert(i);
+            if (!buttonsHeld.test(i)) {
+                buttonsHeld.set(i);
 
-                if (buttonCallback) {
-                    InputGamepadButtonCallback callback = buttonCallback.value();
-                    callback(i, GLFW_PRESS);
-                }
+                if (buttonCallback)
+                    buttonCallback.value()(i, GLFW_PRESS);
             }
         } else if (state.buttons[i] == GLFW_RELEASE) {
-            if (buttonsHeld.count(i)) {
-                buttonsHeld.erase(i);
+            if (buttonsHeld.test(i)) {
+                buttonsHeld.reset(i);
 
-                if (buttonCallback) {
-                    InputGamepadButtonCallback callback = buttonCallback.value();
-                    callback(i, GLFW_RELEASE);
-                }
+                if (buttonCallback)
+                    buttonCallback.value()(i, GLFW_RELEASE);
             }
         }
     }
     if (stickCallback) {
-        InputGamepadStickCallback callback = stickCallback.value();
+        const InputGamepadStickCallback& callback = stickCallback.value();
 
         glm::vec2 axisNew = glm::vec2(state.axes[GLFW_GAMEPAD_AXIS_LEFT_X], state.axes[GLFW_GAMEPAD_AXIS_LEFT_Y]);
-        glm::vec2 axisLast = stickLastValues.find(GLFW_GAMEPAD_AXIS_LEFT)->second;
+        glm::vec2 axisLast = stickLastValues[GLFW_GAMEPAD_AXIS_LEFT];
         if (axisNew.x != 0.0f && axisNew.y != 0.0f) {
             glm::vec2 delta = axisNew - axisLast;
             callback(GLFW_GAMEPAD_AXIS_LEFT, axisNew, delta);
@@ -109,7 +106,7 @@ void GamepadManager::pollGamepadEvents() {
             stickLastValues[GLFW_GAMEPAD_AXIS_LEFT] = axisNew;
         
         axisNew = glm::vec2(state.axes[GLFW_GAMEPAD_AXIS_RIGHT_X], state.axes[GLFW_GAMEPAD_AXIS_RIGHT_Y]);
-        axisLast = stickLastValues.find(GLFW_GAMEPAD_AXIS_RIGHT)->second;
+        axisLast = stickLastValues[GLFW_GAMEPAD_AXIS_RIGHT];
         if (axisNew.x != 0.0f && axisNew.y != 0.0f) {
             glm::vec2 delta = axisNew - axisLast;
             callback(GLFW_GAMEPAD_AXIS_RIGHT, axisNew, delta);
@@ -119,10 +116,10 @@ void GamepadManager::pollGamepadEvents() {
             stickLastValues[GLFW_GAMEPAD_AXIS_RIGHT] = axisNew;
     }
     if (triggerCallback) {
-        InputGamepadTriggerCallback callback = triggerCallback.value();
+        const InputGamepadTriggerCallback& callback = triggerCallback.value();
 
         double triggerNew = state.axes[GLFW_GAMEPAD_AXIS_LEFT_TRIGGER];
-        double triggerLast = triggerLastValues.find(GLFW_GAMEPAD_AXIS_LEFT_TRIGGER)->second;
+        double triggerLast = triggerLastValues[GLFW_GAMEPAD_AXIS_LEFT_TRIGGER];
         if (triggerNew != 0.0f) {
             double delta = triggerNew - triggerLast;
             callback(GLFW_GAMEPAD_AXIS_LEFT_TRIGGER, triggerNew, delta);
@@ -132,7 +129,7 @@ void GamepadManager::pollGamepadEvents() {
             triggerLastValues[GLFW_GAMEPAD_AXIS_LEFT_TRIGGER] = triggerNew;
 
         triggerNew = state.axes[GLFW_GAMEPAD_AXIS_RIGHT_TRIGGER];
-        triggerLast = triggerLastValues.find(GLFW_GAMEPAD_AXIS_RIGHT_TRIGGER)->second;
+        triggerLast = triggerLastValues[GLFW_GAMEPAD_AXIS_RIGHT_TRIGGER];
         if (triggerNew != 0.0f) {
             double delta = triggerNew - triggerLast;
             callback(GLFW_GAMEPAD_AXIS_RIGHT_TRIGGER, triggerNew, delta);
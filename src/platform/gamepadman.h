@@ -21,8 +21,8 @@
 #ifndef OPENAWE_INPUTMAN_H
 #define OPENAWE_INPUTMAN_H
 
-#include <set>
-#include <map>
+#include <array>
+#include <bitset>
 #include <string>
 #include <optional>
 #include <functional>
@@ -63,9 +63,9 @@ private:
 	static void callbackJoystickConnectionChanged(int jid, int event);
 
 	std::optional<int> _activeGamepadId;
-	std::set<int> buttonsHeld;
-	std::map<int, double> triggerLastValues;
-	std::map<int, glm::vec2> stickLastValues;
+	std::bitset<GLFW_GAMEPAD_BUTTON_LAST + 1> buttonsHeld;
+	std::array<double, GLFW_GAMEPAD_AXIS_LAST + 1> triggerLastValues {};
+	std::array<glm::vec2, GLFW_GAMEPAD_AXIS_LAST + 1> stickLastValues {};
 	std::optional<InputGamepadButtonCallback> buttonCallback;
 	std::optional<InputGamepadTriggerCallback> triggerCallback;
 	std::optional<InputGamepadStickCallback> stickCallback;
@@ -0,0 +1,82 @@
+#include "gputimer.h"
+
+#include "src/devicesingleton.h"
+#include "src/vk_operations.h"
+
+namespace Profiling {
+
+tl::expected<delFunc, VulkanError*> GpuTimer::create(float timestampPeriod) {
+	_timestampPeriod = timestampPeriod;
+	if (_timestampPeriod == 0.f)
+		return [](){};
+
+	VkQueryPoolCreateInfo poolInfo = {
+		.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.queryType = VK_QUERY_TYPE_TIMESTAMP,
+		.queryCount = MAX_QUERIES,
+		.pipelineStatistics = 0
+	};
+	auto poolResult = vkcommand::createQueryPool(poolInfo);
+	VK_UNEXPECTED_ERROR(poolResult, "Failed to create timestamp query pool");
+	_queryPool = poolResult.value();
+	_zones.reserve(MAX_QUERIES / 2);
+	_results.resize(MAX_QUERIES);
+
+	return [=]() {
+		vkDestroyQueryPool(DeviceRef(), _queryPool, nullptr);
+	};
+}
+
+void GpuTimer::reset(VkCommandBuffer cmd) {
+	if (_queryPool == VK_NULL_HANDLE) return;
+	vkCmdResetQueryPool(cmd, _queryPool, 0, MAX_QUERIES);
+	_zones.clear();
+	_queryCount = 0;
+}
+
+uint32_t GpuTimer::begin(VkCommandBuffer cmd, const char* name, VkPipelineStageFlagBits stage) {
+	if (_queryPool == VK_NULL_HANDLE || _queryCount + 2 > MAX_QUERIES) return UINT32_MAX;
+	const uint32_t query = _queryCount;
+	_queryCount += 2;
+	vkCmdWriteTimestamp(cmd, stage, _queryPool, query);
+	_zones.push_back(GpuZone{name, query, query + 1});
+	return _zones.size() - 1;
+}
+
+void GpuTimer::end(VkCommandBuffer cmd, uint32_t zone, VkPipelineStageFlagBits stage) {
+	if (zone == UINT32_MAX) return;
+	vkCmdWriteTimestamp(cmd, stage, _queryPool, _zones[zone].endQuery);
+}
+
+void GpuTimer::markSubmit() {
+	_submitTime = ProfileMan.now();
+}
+
+MaybeVulkanError GpuTimer::collect() {
+	if (_queryPool == VK_NULL_HANDLE || _zones.empty()) return {};
+
+	auto readResult = vkcommand::getQueryPoolResults(_queryPool, 0, _queryCount,
+		_results.size() * sizeof(uint64_t), _results.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+	VK_OPTIONAL_ERROR(readResult, "Failed to read timestamp queries");
+	// The frame fence has already been waited on, so this only happens on weird drivers; skip the frame
+	if (!readResult.value()) return {};
+
+	// GPU and CPU clocks are not calibrated against each other, so the first timestamp of the
+	// submission is pinned to the moment of submit. Good enough to see what overlaps what.
+	const uint64_t gpuOrigin = _results[_zones.front().beginQuery];
+	auto toProfilerTime = [&](uint64_t timestamp) {
+		return _submitTime + static_cast<uint64_t>((timestamp - gpuOrigin) * _timestampPeriod);
+	};
+	for (const GpuZone& zone: _zones) {
+		ProfileMan.recordGpuZone(zone.name, toProfilerTime(_results[zone.beginQuery]), toProfilerTime(_results[zone.endQuery]));
+	}
+	const GpuZone& first = _zones.front();
+	_lastFrameTime = (_results[first.endQuery] - _results[first.beginQuery]) * _timestampPeriod / 1e6f;
+
+	_zones.clear();
+	return {};
+}
+
+} // End of namespace Profiling
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+#include <expected.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "src/error.h"
+#include "src/deletionqueue.h"
+#include "profiler.h"
+
+namespace Profiling {
+
+/*!
+ * \brief Timestamp query pool owned by a single frame in flight
+ *
+ * Zones are recorded into the frame's command buffer and read back the next time
+ * the same frame comes around, right after its fence has been waited on.
+ */
+class GpuTimer {
+public:
+	static constexpr uint32_t MAX_QUERIES = 256;
+
+	// A zero timestampPeriod means the queue does not support timestamps and the timer stays disabled
+	tl::expected<delFunc, VulkanError*> create(float timestampPeriod);
+
+	// Must be recorded outside of any render pass, before any zone of this frame
+	void reset(VkCommandBuffer cmd);
+	// Returns the zone index to be passed to end(), or UINT32_MAX if out of queries
+	uint32_t begin(VkCommandBuffer cmd, const char* name, VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+	void end(VkCommandBuffer cmd, uint32_t zone, VkPipelineStageFlagBits stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+
+	// CPU time of the queue submit, used to place GPU zones on the profiler timeline
+	void markSubmit();
+	// Reads back the zones of the last submission of this frame and hands them over to the profiler
+	MaybeVulkanError collect();
+	// Duration of the first zone of the last collected submission, in milliseconds
+	float lastFrameTime() const { return _lastFrameTime; };
+private:
+	struct GpuZone {
+		const char* name;
+		uint32_t beginQuery;
+		uint32_t endQuery;
+	};
+
+	VkQueryPool _queryPool = VK_NULL_HANDLE;
+	float _timestampPeriod = 0.f;
+	std::vector<GpuZone> _zones;
+	std::vector<uint64_t> _results;
+	uint32_t _queryCount = 0;
+	uint64_t _submitTime = 0;
+	float _lastFrameTime = 0.f;
+};
+
+class GpuScope {
+public:
+	GpuScope(GpuTimer& timer, VkCommandBuffer cmd, const char* name): _timer(timer), _cmd(cmd), _zone(timer.begin(cmd, name)) {};
+	~GpuScope() { _timer.end(_cmd, _zone); };
+
+	GpuScope(const GpuScope&) = delete;
+	GpuScope& operator=(const GpuScope&) = delete;
+private:
+	GpuTimer& _timer;
+	VkCommandBuffer _cmd;
+	uint32_t _zone;
+};
+
+} // End of namespace Profiling
+
+#ifdef ENGINE_PROFILING
+#	define PROFILE_GPU_SCOPE(TIMER, CMD, NAME) Profiling::GpuScope PROFILE_CONCAT(_profileGpuScope, __LINE__)(TIMER, CMD, NAME)
+#else
+#	define PROFILE_GPU_SCOPE(TIMER, CMD, NAME)
+#endif
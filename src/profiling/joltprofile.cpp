@@ -0,0 +1,25 @@
+// Routes Jolt's JPH_PROFILE zones into the engine profiler.
+// Only compiled in when Jolt is built with JPH_EXTERNAL_PROFILE (see third_party/CMakeLists.txt)
+#include <Jolt/Jolt.h>
+#include <Jolt/Core/Profiler.h>
+
+#include <new>
+
+#include "profiler.h"
+
+#ifdef JPH_EXTERNAL_PROFILE
+
+JPH_NAMESPACE_BEGIN
+
+ExternalProfileMeasurement::ExternalProfileMeasurement(const char* inName, uint32 inColor) {
+	static_assert(sizeof(Profiling::Scope) <= sizeof(mUserData), "Profiling scope doesn't fit into Jolt's measurement");
+	new (mUserData) Profiling::Scope(inName);
+}
+
+ExternalProfileMeasurement::~ExternalProfileMeasurement() {
+	reinterpret_cast<Profiling::Scope*>(mUserData)->~Scope();
+}
+
+JPH_NAMESPACE_END
+
+#endif
@@ -0,0 +1,132 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <fstream>
+
+namespace Profiling {
+
+namespace {
+	thread_local ThreadZoneBuffer* tlsBuffer = nullptr;
+
+	void writeEscaped(std::ofstream& file, const std::string_view text) {
+		for (const char c: text) {
+			if (c == '"' || c == '\\') file << '\\';
+			file << c;
+		}
+	}
+}
+
+void ThreadZoneBuffer::copyTo(std::vector<Zone>& out, uint64_t since) const {
+	const uint64_t head = _head.load(std::memory_order_acquire);
+	const uint64_t first = head > CAPACITY ? head - CAPACITY : 0;
+	for (uint64_t i = first; i < head; i++) {
+		const Zone& zone = _zones[i & (CAPACITY - 1)];
+		if (zone.start >= since)
+			out.push_back(zone);
+	}
+}
+
+Profiler::Profiler(): _epoch(Clock::now()) {
+	_gpuBuffer = std::make_unique<ThreadZoneBuffer>(UINT32_MAX);
+	_gpuBuffer->_threadName = "GPU";
+}
+
+uint64_t Profiler::now() const {
+	return toProfilerTime(Clock::now());
+}
+
+uint64_t Profiler::toProfilerTime(Clock::time_point point) const {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(point - _epoch).count();
+}
+
+ThreadZoneBuffer& Profiler::localBuffer() {
+	if (tlsBuffer == nullptr)
+		return registerBuffer();
+	return *tlsBuffer;
+}
+
+ThreadZoneBuffer& Profiler::registerBuffer() {
+	std::lock_guard lock(_registryMutex);
+	_buffers.push_back(std::make_unique<ThreadZoneBuffer>(_nextThreadId++));
+	tlsBuffer = _buffers.back().get();
+	return *tlsBuffer;
+}
+
+void Profiler::recordZone(const char* name, uint64_t start, uint64_t end) {
+	localBuffer().push(Zone{name, start, end - start, ZoneKind::Cpu});
+}
+
+void Profiler::recordGpuZone(const char* name, uint64_t start, uint64_t end) {
+	_gpuBuffer->push(Zone{name, start, end > start ? end - start : 0, ZoneKind::Gpu});
+}
+
+void Profiler::markFrame() {
+	localBuffer().push(Zone{"Frame", now(), 0, ZoneKind::FrameMarker});
+}
+
+void Profiler::setThreadName(const std::string& name) {
+	std::lock_guard lock(_registryMutex);
+	if (tlsBuffer == nullptr) {
+		_buffers.push_back(std::make_unique<ThreadZoneBuffer>(_nextThreadId++));
+		tlsBuffer = _buffers.back().get();
+	}
+	tlsBuffer->_threadName = name;
+}
+
+std::vector<ThreadZones> Profiler::collect(uint64_t since) {
+	std::vector<ThreadZones> result;
+	std::lock_guard lock(_registryMutex);
+	result.reserve(_buffers.size() + 1);
+	for (auto& buffer: _buffers) {
+		ThreadZones& thread = result.emplace_back(buffer->getThreadId(), buffer->_threadName);
+		buffer->copyTo(thread.zones, since);
+	}
+	ThreadZones& gpu = result.emplace_back(_gpuBuffer->getThreadId(), _gpuBuffer->_threadName);
+	_gpuBuffer->copyTo(gpu.zones, since);
+	return result;
+}
+
+MaybeError Profiler::exportChromeTrace(const std::string& path) {
+	std::ofstream file(path, std::ios::trunc);
+	if (!file.is_open()) {
+		int errorCode = file.bad() | file.fail() << 1 | file.eof() << 2;
+		return new FileError(errorCode, ErrorMessage("Unable to open trace file at \"{}\"", path));
+	}
+
+	// Chrome's trace viewer expects microseconds; GPU zones go into a separate "process"
+	// so they don't get nested under the CPU zones that happen to overlap them
+	bool first = true;
+	file << "{\"traceEvents\":[\n";
+	for (const ThreadZones& thread: collect()) {
+		const bool isGpu = thread.threadId == UINT32_MAX;
+		const int pid = isGpu ? 1 : 0;
+		const uint32_t tid = isGpu ? 0 : thread.threadId;
+		if (!thread.threadName.empty()) {
+			if (!first) file << ",\n";
+			first = false;
+			file << fmt::format("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":{},\"tid\":{},\"args\":{{\"name\":\"", pid, tid);
+			writeEscaped(file, thread.threadName);
+			file << "\"}}";
+		}
+		for (const Zone& zone: thread.zones) {
+			if (!first) file << ",\n";
+			first = false;
+			file << "{\"name\":\"";
+			writeEscaped(file, zone.name);
+			if (zone.kind == ZoneKind::FrameMarker) {
+				file << fmt::format("\",\"ph\":\"i\",\"s\":\"g\",\"ts\":{:.3f},\"pid\":{},\"tid\":{}}}",
+					zone.start / 1000.0, pid, tid);
+			} else {
+				file << fmt::format("\",\"ph\":\"X\",\"ts\":{:.3f},\"dur\":{:.3f},\"pid\":{},\"tid\":{}}}",
+					zone.start / 1000.0, zone.duration / 1000.0, pid, tid);
+			}
+		}
+	}
+	file << "\n]}\n";
+
+	if (file.fail())
+		return new FileError(1, ErrorMessage("Failed writing trace file at \"{}\"", path));
+	return {};
+}
+
+} // End of namespace Profiling
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "src/error.h"
+#include "src/singleton.h"
+
+namespace Profiling {
+
+using Clock = std::chrono::steady_clock;
+
+enum class ZoneKind: uint8_t {
+	Cpu,
+	Gpu,
+	FrameMarker,
+};
+
+struct Zone {
+	// Zone names are never copied, so they must outlive the profiler (string literals)
+	const char* name;
+	// Nanoseconds since profiler creation
+	uint64_t start;
+	uint64_t duration;
+	ZoneKind kind;
+};
+
+struct ThreadZones {
+	uint32_t threadId;
+	std::string threadName;
+	std::vector<Zone> zones;
+};
+
+/*!
+ * \brief Fixed-size ring of zones owned by a single thread
+ *
+ * Only the owning thread ever writes into the ring, so pushing a zone is a plain store
+ * followed by a release of the head counter. Readers copy whatever is inside the ring
+ * at the moment; the oldest zones may get overwritten while being read, which is fine for profiling data.
+ */
+class ThreadZoneBuffer {
+public:
+	static constexpr uint64_t CAPACITY = 1 << 16;
+
+	ThreadZoneBuffer(uint32_t threadId): _threadId(threadId), _zones(CAPACITY) {};
+
+	void push(const Zone& zone) {
+		const uint64_t head = _head.load(std::memory_order_relaxed);
+		_zones[head & (CAPACITY - 1)] = zone;
+		_head.store(head + 1, std::memory_order_release);
+	}
+
+	void copyTo(std::vector<Zone>& out, uint64_t since) const;
+
+	uint32_t getThreadId() const { return _threadId; };
+	std::string _threadName;
+private:
+	const uint32_t _threadId;
+	std::atomic<uint64_t> _head{0};
+	std::vector<Zone> _zones;
+};
+
+class Profiler: public Singleton<Profiler> {
+public:
+	Profiler();
+
+	// Nanoseconds since profiler creation
+	uint64_t now() const;
+	uint64_t toProfilerTime(Clock::time_point point) const;
+
+	void recordZone(const char* name, uint64_t start, uint64_t end);
+	void recordGpuZone(const char* name, uint64_t start, uint64_t end);
+	void markFrame();
+
+	void setThreadName(const std::string& name);
+
+	// Copies every zone still held by the rolling buffers, optionally only the ones started after 'since'
+	std::vector<ThreadZones> collect(uint64_t since = 0);
+
+	MaybeError exportChromeTrace(const std::string& path);
+private:
+	ThreadZoneBuffer& localBuffer();
+	ThreadZoneBuffer& registerBuffer();
+
+	Clock::time_point _epoch;
+	std::mutex _registryMutex;
+	std::vector<std::unique_ptr<ThreadZoneBuffer>> _buffers;
+	// GPU zones are pushed by the render thread only, but are kept on their own timeline
+	std::unique_ptr<ThreadZoneBuffer> _gpuBuffer;
+	uint32_t _nextThreadId = 0;
+};
+
+class Scope {
+public:
+	Scope(const char* name): _name(name), _start(Profiler::instance().now()) {};
+	~Scope() { Profiler::instance().recordZone(_name, _start, Profiler::instance().now()); };
+
+	Scope(const Scope&) = delete;
+	Scope& operator=(const Scope&) = delete;
+private:
+	const char* _name;
+	uint64_t _start;
+};
+
+} // End of namespace Profiling
+
+#define ProfileMan Profiling::Profiler::instance()
+
+#define PROFILE_CONCAT_IMPL(A, B) A##B
+#define PROFILE_CONCAT(A, B) PROFILE_CONCAT_IMPL(A, B)
+
+#ifdef ENGINE_PROFILING
+#	define PROFILE_SCOPE(NAME) Profiling::Scope PROFILE_CONCAT(_profileScope, __LINE__)(NAME)
+#	define PROFILE_FRAME() ProfileMan.markFrame()
+#else
+#	define PROFILE_SCOPE(NAME)
+#	define PROFILE_FRAME()
+#endif
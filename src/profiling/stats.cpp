@@ -0,0 +1,133 @@
+#include "stats.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Profiling {
+
+const char* counterName(Counter counter) {
+	switch (counter) {
+		case Counter::DrawCalls: return "draw_calls";
+		case Counter::PipelineBinds: return "pipeline_binds";
+		case Counter::DescriptorBinds: return "descriptor_binds";
+		case Counter::VertexBufferBinds: return "vertex_buffer_binds";
+		case Counter::Triangles: return "triangles";
+		case Counter::BytesUploaded: return "bytes_uploaded";
+		case Counter::Lod0Instances: return "lod0_instances";
+		case Counter::Lod1Instances: return "lod1_instances";
+		case Counter::Lod2Instances: return "lod2_instances";
+		case Counter::Lod3Instances: return "lod3_instances";
+		case Counter::ShadowDrawCalls: return "shadow_draw_calls";
+		case Counter::ShadowStaticRedraws: return "shadow_static_redraws";
+		case Counter::PointLights: return "point_lights";
+		case Counter::ParticlesSpawned: return "particles_spawned";
+		case Counter::BytesDefragmented: return "bytes_defragmented";
+		case Counter::TransformsPropagated: return "transforms_propagated";
+		case Counter::ActiveBodies: return "active_bodies";
+		case Counter::SleepingBodies: return "sleeping_bodies";
+		case Counter::StaticBodies: return "static_bodies";
+		case Counter::UnaddedBodies: return "unadded_bodies";
+		case Counter::TotalBodies: return "total_bodies";
+		case Counter::Entities: return "entities";
+		case Counter::Timers: return "timers";
+		case Counter::GpuMemoryUsed: return "gpu_memory_used";
+		case Counter::GpuMemoryBudget: return "gpu_memory_budget";
+		case Counter::GpuAllocations: return "gpu_allocations";
+		case Counter::FrustumCulled: return "frustum_culled";
+		case Counter::OcclusionRetested: return "occlusion_retested";
+		case Counter::OcclusionCulled: return "occlusion_culled";
+		case Counter::RenderScale: return "render_scale";
+		case Counter::InputLatency: return "input_latency";
+		default: return "unknown";
+	}
+}
+
+void Stats::endFrame(float cpuFrameTime, float gpuFrameTime) {
+	FrameStats& stats = _history[_historyHead];
+	stats = FrameStats{_frame++, cpuFrameTime, gpuFrameTime, _current};
+	_historyHead = (_historyHead + 1) % HISTORY_SIZE;
+	_historyCount = std::min(_historyCount + 1, HISTORY_SIZE);
+
+	if (_dump.is_open())
+		writeDump(stats);
+
+	// Sampled counters keep their values until they are sampled again
+	std::fill(_current.begin(), _current.begin() + static_cast<size_t>(FIRST_SAMPLED_COUNTER), 0);
+}
+
+MaybeError Stats::openDump(const std::string& path) {
+	closeDump();
+	_dump.open(path, std::ios::trunc);
+	if (!_dump.is_open()) {
+		int errorCode = _dump.bad() | _dump.fail() << 1 | _dump.eof() << 2;
+		return new FileError(errorCode, ErrorMessage("Unable to open stats dump at \"{}\"", path));
+	}
+	_dumpJson = path.ends_with(".json");
+	_dumpEmpty = true;
+
+	if (_dumpJson) {
+		_dump << "[\n";
+	} else {
+		_dump << "frame,cpu_frame_ms,gpu_frame_ms";
+		for (size_t i = 0; i < COUNTER_COUNT; i++)
+			_dump << ',' << counterName(static_cast<Counter>(i));
+		_dump << '\n';
+	}
+	return {};
+}
+
+void Stats::closeDump() {
+	if (!_dump.is_open()) return;
+	if (_dumpJson)
+		_dump << "\n]\n";
+	_dump.close();
+}
+
+void Stats::writeDump(const FrameStats& stats) {
+	if (_dumpJson) {
+		if (!_dumpEmpty) _dump << ",\n";
+		_dump << fmt::format("{{\"frame\":{},\"cpu_frame_ms\":{:.4f},\"gpu_frame_ms\":{:.4f}", stats.frame, stats.cpuFrameTime, stats.gpuFrameTime);
+		for (size_t i = 0; i < COUNTER_COUNT; i++)
+			_dump << fmt::format(",\"{}\":{}", counterName(static_cast<Counter>(i)), stats.counters[i]);
+		_dump << '}';
+	} else {
+		_dump << fmt::format("{},{:.4f},{:.4f}", stats.frame, stats.cpuFrameTime, stats.gpuFrameTime);
+		for (size_t i = 0; i < COUNTER_COUNT; i++)
+			_dump << ',' << stats.counters[i];
+		_dump << '\n';
+	}
+	_dumpEmpty = false;
+}
+
+float Stats::frameTimePercentile(float percentile) const {
+	if (_historyCount == 0) return 0.f;
+
+	std::vector<float> times;
+	frameTimeHistory(times);
+	// Nearest-rank percentile
+	const size_t rank = std::clamp<size_t>(std::ceil(percentile / 100.f * times.size()), 1, times.size()) - 1;
+	std::nth_element(times.begin(), times.begin() + rank, times.end());
+	return times[rank];
+}
+
+const FrameStats& Stats::lastFrame() const {
+	return _history[(_historyHead + HISTORY_SIZE - 1) % HISTORY_SIZE];
+}
+
+const FrameStats& Stats::history(size_t i) const {
+	return _history[(_historyHead + HISTORY_SIZE - _historyCount + i) % HISTORY_SIZE];
+}
+
+void Stats::counterHistory(Counter counter, std::vector<float>& out) const {
+	out.resize(_historyCount);
+	for (size_t i = 0; i < _historyCount; i++)
+		out[i] = static_cast<float>(history(i).counters[static_cast<size_t>(counter)]);
+}
+
+void Stats::frameTimeHistory(std::vector<float>& out) const {
+	out.resize(_historyCount);
+	for (size_t i = 0; i < _historyCount; i++)
+		out[i] = history(i).cpuFrameTime;
+}
+
+} // End of namespace Profiling
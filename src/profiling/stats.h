@@ -0,0 +1,122 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "src/error.h"
+#include "src/singleton.h"
+
+namespace Profiling {
+
+enum class Counter: uint8_t {
+	// Reset every frame
+	DrawCalls,
+	PipelineBinds,
+	DescriptorBinds,
+	VertexBufferBinds,
+	Triangles,
+	BytesUploaded,
+	// Instances drawn with each LOD, see MAX_MESH_LODS
+	Lod0Instances,
+	Lod1Instances,
+	Lod2Instances,
+	Lod3Instances,
+	ShadowDrawCalls,
+	// Cascades whose cached static layer was re-rendered
+	ShadowStaticRedraws,
+	PointLights,
+	ParticlesSpawned,
+	// Static geometry moved by defragmentation
+	BytesDefragmented,
+	// World transforms recomputed from a parent's transform
+	TransformsPropagated,
+	// Sampled once per frame
+	ActiveBodies,
+	// Dynamic and kinematic bodies in the simulation that are not active
+	SleepingBodies,
+	StaticBodies,
+	// Created but outside the simulation, pooled bodies among them
+	UnaddedBodies,
+	TotalBodies,
+	Entities,
+	Timers,
+	GpuMemoryUsed,
+	GpuMemoryBudget,
+	GpuAllocations,
+	FrustumCulled,
+	// Rejected by the previous frame's depth pyramid and re-tested
+	OcclusionRetested,
+	// Still occluded after the re-test
+	OcclusionCulled,
+	// Scene resolution relative to the window, in percent
+	RenderScale,
+	// Microseconds from the oldest mouse move first shown in a frame to the frame's present, 0 without one
+	InputLatency,
+
+	Count
+};
+
+constexpr size_t COUNTER_COUNT = static_cast<size_t>(Counter::Count);
+constexpr Counter FIRST_SAMPLED_COUNTER = Counter::ActiveBodies;
+
+const char* counterName(Counter counter);
+
+struct FrameStats {
+	uint64_t frame;
+	float cpuFrameTime;
+	float gpuFrameTime;
+	std::array<uint64_t, COUNTER_COUNT> counters;
+};
+
+/*!
+ * \brief Per-frame engine counters with a rolling history
+ *
+ * Counters are only touched from the main thread. At the end of every frame
+ * the current values are moved into the history and, if a dump file is open,
+ * written out as a CSV row or a JSON object.
+ */
+class Stats: public Singleton<Stats> {
+public:
+	static constexpr size_t HISTORY_SIZE = 512;
+
+	void add(Counter counter, uint64_t value = 1) { _current[static_cast<size_t>(counter)] += value; };
+	void set(Counter counter, uint64_t value) { _current[static_cast<size_t>(counter)] = value; };
+	uint64_t get(Counter counter) const { return _current[static_cast<size_t>(counter)]; };
+
+	// Frame times are in milliseconds
+	void endFrame(float cpuFrameTime, float gpuFrameTime);
+
+	// Format is picked by the extension: ".json" writes a JSON array, anything else is CSV
+	MaybeError openDump(const std::string& path);
+	void closeDump();
+
+	// Percentile (0..100) of the CPU frame time over the history
+	float frameTimePercentile(float percentile) const;
+
+	const FrameStats& lastFrame() const;
+	size_t historySize() const { return _historyCount; };
+	// i = 0 is the oldest frame still in the history
+	const FrameStats& history(size_t i) const;
+	// Values of a single counter in history order, for plotting
+	void counterHistory(Counter counter, std::vector<float>& out) const;
+	void frameTimeHistory(std::vector<float>& out) const;
+private:
+	void writeDump(const FrameStats& stats);
+
+	std::array<uint64_t, COUNTER_COUNT> _current{};
+	std::array<FrameStats, HISTORY_SIZE> _history{};
+	size_t _historyHead = 0;
+	size_t _historyCount = 0;
+	uint64_t _frame = 0;
+
+	std::ofstream _dump;
+	bool _dumpJson = false;
+	bool _dumpEmpty = true;
+};
+
+} // End of namespace Profiling
+
+#define StatsMan Profiling::Stats::instance()
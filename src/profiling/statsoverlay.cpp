@@ -0,0 +1,123 @@
+#include "statsoverlay.h"
+
+#include <imgui.h>
+#include <backends/imgui_impl_glfw.h>
+#include <backends/imgui_impl_vulkan.h>
+
+#include "src/devicesingleton.h"
+#include "src/vk_engine.h"
+#include "src/vk_operations.h"
+#include "src/vmalloc.h"
+#include "stats.h"
+
+namespace Profiling {
+
+tl::expected<delFunc, VulkanError*> StatsOverlay::init(VulkanEngine& engine) {
+	// ImGui only needs a font texture, but the backend asks for a pool it can allocate from freely
+	VkDescriptorPoolSize poolSizes[] = {
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 16 }
+	};
+	VkDescriptorPoolCreateInfo poolInfo = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
+		.maxSets = 16,
+		.poolSizeCount = std::size(poolSizes),
+		.pPoolSizes = poolSizes
+	};
+	auto poolResult = vkcommand::createDescriptorPool(&poolInfo);
+	VK_UNEXPECTED_ERROR(poolResult, "Failed to create descriptor pool for ImGui");
+	_descriptorPool = poolResult.value();
+
+	ImGui::CreateContext();
+	ImGui::GetIO().IniFilename = nullptr;
+	// Installs its callbacks on top of the ones set by Platform::Window, which are still called
+	ImGui_ImplGlfw_InitForVulkan(engine._window->getWindowHandle(), true);
+
+	ImGui_ImplVulkan_InitInfo initInfo = {};
+	initInfo.Instance = engine._instance;
+	initInfo.PhysicalDevice = engine._chosenGPU;
+	initInfo.Device = DeviceRef();
+	initInfo.QueueFamily = engine._graphicsQueueFamily;
+	initInfo.Queue = engine._graphicsQueue;
+	initInfo.DescriptorPool = _descriptorPool;
+	initInfo.RenderPass = engine._presentRenderPass;
+	initInfo.MinImageCount = 2;
+	initInfo.ImageCount = static_cast<uint32_t>(engine._swapchainImages.size());
+	initInfo.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
+	ImGui_ImplVulkan_Init(&initInfo);
+	ImGui_ImplVulkan_CreateFontsTexture();
+
+	_enabled = true;
+	_systems = &engine._systems;
+
+	return [=]() {
+		ImGui_ImplVulkan_Shutdown();
+		ImGui_ImplGlfw_Shutdown();
+		ImGui::DestroyContext();
+		vkDestroyDescriptorPool(DeviceRef(), _descriptorPool, nullptr);
+	};
+}
+
+void StatsOverlay::buildFrame() {
+	if (!_enabled) return;
+
+	ImGui_ImplVulkan_NewFrame();
+	ImGui_ImplGlfw_NewFrame();
+	ImGui::NewFrame();
+
+	ImGui::SetNextWindowPos(ImVec2(10, 10), ImGuiCond_FirstUseEver);
+	ImGui::SetNextWindowBgAlpha(0.75f);
+	if (ImGui::Begin("Stats")) {
+		const FrameStats& last = StatsMan.lastFrame();
+		ImGui::Text("CPU %.2f ms  GPU %.2f ms", last.cpuFrameTime, last.gpuFrameTime);
+		ImGui::Text("p50 %.2f  p95 %.2f  p99 %.2f ms",
+			StatsMan.frameTimePercentile(50.f), StatsMan.frameTimePercentile(95.f), StatsMan.frameTimePercentile(99.f));
+
+		StatsMan.frameTimeHistory(_plotValues);
+		ImGui::PlotLines("##frametime", _plotValues.data(), _plotValues.size(), 0, "Frame time, ms", 0.f, FLT_MAX, ImVec2(0, 60));
+
+		if (ImGui::CollapsingHeader("Counters", ImGuiTreeNodeFlags_DefaultOpen)) {
+			for (size_t i = 0; i < COUNTER_COUNT; i++) {
+				const Counter counter = static_cast<Counter>(i);
+				StatsMan.counterHistory(counter, _plotValues);
+				ImGui::PushID(i);
+				ImGui::PlotLines("##counter", _plotValues.data(), _plotValues.size(), 0, nullptr, 0.f, FLT_MAX, ImVec2(120, 20));
+				ImGui::SameLine();
+				ImGui::Text("%s: %lu", counterName(counter), static_cast<unsigned long>(last.counters[i]));
+				ImGui::PopID();
+			}
+		}
+
+		if (ImGui::CollapsingHeader("Systems")) {
+			for (const Systems::SystemTiming& timing: _systems->lastTimings())
+				ImGui::Text("%s: %.3f ms", timing.name, timing.milliseconds);
+		}
+
+		if (ImGui::CollapsingHeader("Memory")) {
+			const std::vector<HeapBudget> heaps = VMAlloc.getHeapBudgets();
+			for (size_t i = 0; i < heaps.size(); i++) {
+				ImGui::Text("Heap %zu%s: %.1f / %.1f MiB, blocks %.1f MiB (%.1f used)", i, heaps[i].deviceLocal ? " (device)" : "",
+					heaps[i].usage / 1048576.0, heaps[i].budget / 1048576.0, heaps[i].blockBytes / 1048576.0, heaps[i].allocationBytes / 1048576.0);
+			}
+			for (size_t i = static_cast<size_t>(MemoryPool::StaticGeometry); i < static_cast<size_t>(MemoryPool::Count); i++) {
+				const MemoryPool pool = static_cast<MemoryPool>(i);
+				const PoolStats stats = VMAlloc.getPoolStats(pool);
+				ImGui::Text("%s: %u allocations, %.1f / %.1f MiB in %u blocks, %u free ranges", poolName(pool), stats.allocationCount,
+					stats.allocationBytes / 1048576.0, stats.blockBytes / 1048576.0, stats.blockCount, stats.unusedRangeCount);
+			}
+			if (VMAlloc.isDefragmenting())
+				ImGui::Text("Defragmenting static geometry");
+		}
+	}
+	ImGui::End();
+
+	ImGui::Render();
+}
+
+void StatsOverlay::record(VkCommandBuffer cmd) {
+	if (!_enabled) return;
+	ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmd);
+}
+
+} // End of namespace Profiling
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+#include <expected.hpp>
+
+#include <vector>
+
+#include "src/error.h"
+#include "src/deletionqueue.h"
+
+class VulkanEngine;
+
+namespace Systems {
+class Scheduler;
+}
+
+namespace Profiling {
+
+/*!
+ * \brief ImGui window with frame time percentiles and rolling counter graphs
+ *
+ * Drawn as the last thing inside the main render pass.
+ */
+class StatsOverlay {
+public:
+	tl::expected<delFunc, VulkanError*> init(VulkanEngine& engine);
+
+	// Builds the UI for this frame, must be called before recording the command buffer
+	void buildFrame();
+	void record(VkCommandBuffer cmd);
+
+	bool isEnabled() const { return _enabled; };
+private:
+	bool _enabled = false;
+	const Systems::Scheduler* _systems = nullptr;
+	VkDescriptorPool _descriptorPool = VK_NULL_HANDLE;
+	// Reused between frames to avoid reallocating plot data
+	std::vector<float> _plotValues;
+};
+
+} // End of namespace Profiling
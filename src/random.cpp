@@ -3,5 +3,18 @@
 #include "random.h"
 
 float randFloat(float LO, float HI) {
-    return LO + static_cast <float> (rand()) /( static_cast <float> (RAND_MAX/(HI-LO)));;
+    return RandomS.randFloat(LO, HI);
+}
+
+Random::Random() {
+    seed(std::random_device{}());
+}
+
+float Random::randFloat(float LO, float HI) {
+    return std::uniform_real_distribution<float>(LO, HI)(_engine);
+}
+
+void Random::seed(uint32_t value) {
+    _seed = value;
+    _engine.seed(value);
 }
\ No newline at end of file
@@ -1,14 +1,23 @@
 #pragma once
 
+#include <cstdint>
+#include <random>
+
 #include "singleton.h"
 
 float randFloat(float LO, float HI);
 
 class Random: public Singleton<Random> {
 public:
+    Random();
+
     float randFloat(float LO, float HI);
+    // Restarts the sequence, input replays use the seed their recording started with
+    void seed(uint32_t value);
+    uint32_t getSeed() const { return _seed; };
 private:
-    //
+    std::mt19937 _engine;
+    uint32_t _seed;
 };
 
 #define RandomS Random::instance()
@@ -0,0 +1,163 @@
+#include "dynamicresolution.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "src/devicesingleton.h"
+#include "src/material.h"
+#include "src/vk_initializers.h"
+#include "src/vk_operations.h"
+
+namespace Resolution {
+
+struct UpscaleConstants {
+	// Maps the swapchain UV onto the rendered part of the target
+	glm::vec2 uvScale;
+	// Bilinear taps past this would pick up texels that were not rendered this frame
+	glm::vec2 uvMax;
+};
+
+void DynamicResolution::configure(const ScaleSettings& settings) {
+	_settings = settings;
+	_settings.maxScale = std::clamp(_settings.maxScale, 0.1f, 2.f);
+	_settings.minScale = std::clamp(_settings.minScale, 0.1f, _settings.maxScale);
+	_scale = _settings.maxScale;
+}
+
+tl::expected<delFunc, VulkanError*> DynamicResolution::init(VkShaderModule vertexShader, VkShaderModule fragmentShader, VkRenderPass presentPass) {
+
+	VkSamplerCreateInfo samplerInfo = vkinit::createinfo::sampler(VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+	auto samplerResult = vkcommand::createSampler(samplerInfo);
+	VK_UNEXPECTED_ERROR(samplerResult, "Failed to create upscale sampler");
+	_sampler = samplerResult.value();
+
+	VkDescriptorPoolSize poolSize = { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1 };
+	VkDescriptorPoolCreateInfo poolInfo = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.maxSets = 1,
+		.poolSizeCount = 1,
+		.pPoolSizes = &poolSize
+	};
+	auto poolResult = vkcommand::createDescriptorPool(&poolInfo);
+	VK_UNEXPECTED_ERROR(poolResult, "Failed to create descriptor pool for upscaling");
+	_descriptorPool = poolResult.value();
+
+	VkDescriptorSetLayoutBinding binding = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 0);
+	VkDescriptorSetLayoutCreateInfo setInfo = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.bindingCount = 1,
+		.pBindings = &binding
+	};
+	auto layoutResult = vkcommand::createDescriptorSetLayout(&setInfo);
+	VK_UNEXPECTED_ERROR(layoutResult, "Failed to create descriptor set layout for upscaling");
+	_setLayout = layoutResult.value();
+
+	auto setResult = vkcommand::allocateDescriptorSet(_descriptorPool, _setLayout);
+	VK_UNEXPECTED_ERROR(setResult, "Failed to allocate upscale descriptor");
+	_descriptor = setResult.value();
+
+	// Fullscreen triangle, the present pass has no depth attachment
+	PipelineBuilder pipelineBuilder;
+	pipelineBuilder._viewport = { 0.f, 0.f, 1.f, 1.f, 0.f, 1.f };
+	pipelineBuilder._scissor = { .offset = { 0, 0 }, .extent = { 1, 1 } };
+	pipelineBuilder._depthStencil.depthTestEnable = VK_FALSE;
+	pipelineBuilder._depthStencil.depthWriteEnable = VK_FALSE;
+	pipelineBuilder._depthStencil.depthCompareOp = VK_COMPARE_OP_ALWAYS;
+	pipelineBuilder
+		.addVertexShader(vertexShader)
+		.addFragmentShader(fragmentShader);
+
+	std::vector<VkDescriptorSetLayout> setLayouts = { _setLayout };
+	std::vector<VkPushConstantRange> pushConstants { {
+		.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+		.offset = 0,
+		.size = sizeof(UpscaleConstants)
+	} };
+	auto pipeLayoutResult = pipelineBuilder.setLayout(setLayouts, pushConstants);
+	VK_UNEXPECTED_ERROR(pipeLayoutResult, "Failed to create upscale pipeline layout");
+	_pipelineLayout = pipeLayoutResult.value();
+
+	auto pipelineResult = pipelineBuilder.build_pipeline(DeviceRef(), presentPass);
+	VK_UNEXPECTED_ERROR(pipelineResult, "Failed to build upscale pipeline");
+	_pipeline = pipelineResult.value();
+
+	return [=]() {
+		vkDestroyPipeline(DeviceRef(), _pipeline, nullptr);
+		vkDestroyPipelineLayout(DeviceRef(), _pipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(DeviceRef(), _setLayout, nullptr);
+		vkDestroyDescriptorPool(DeviceRef(), _descriptorPool, nullptr);
+		vkDestroySampler(DeviceRef(), _sampler, nullptr);
+	};
+}
+
+VkExtent2D DynamicResolution::getTargetExtent(VkExtent2D windowExtent) const {
+	return {
+		std::max(static_cast<uint32_t>(std::ceil(windowExtent.width * _settings.maxScale)), 1u),
+		std::max(static_cast<uint32_t>(std::ceil(windowExtent.height * _settings.maxScale)), 1u)
+	};
+}
+
+void DynamicResolution::setTarget(VkExtent2D windowExtent, VkImageView colorView) {
+	_windowExtent = windowExtent;
+	_targetExtent = getTargetExtent(windowExtent);
+
+	VkDescriptorImageInfo imageInfo = {
+		.sampler = _sampler,
+		.imageView = colorView,
+		.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+	};
+	VkWriteDescriptorSet write = vkinit::write_descriptor_image(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, _descriptor, &imageInfo, 0);
+	vkUpdateDescriptorSets(DeviceRef(), 1, &write, 0, nullptr);
+}
+
+void DynamicResolution::update(float gpuFrameTime) {
+	if (_settings.targetFrameTime <= 0.f || gpuFrameTime <= 0.f)
+		return;
+
+	// Measurements lag a couple of frames behind and are noisy, react to the trend only
+	_smoothedTime = _smoothedTime == 0.f ? gpuFrameTime : _smoothedTime + (gpuFrameTime - _smoothedTime) * SMOOTHING;
+	const float ratio = _settings.targetFrameTime / _smoothedTime;
+	if (std::abs(ratio - 1.f) < DEADBAND)
+		return;
+
+	// GPU time mostly follows the pixel count, which is the square of the scale
+	const float desired = _scale * std::sqrt(ratio);
+	_scale = std::clamp(_scale + (desired - _scale) * RESPONSE, _settings.minScale, _settings.maxScale);
+}
+
+VkExtent2D DynamicResolution::getRenderExtent() const {
+	return {
+		std::clamp(static_cast<uint32_t>(std::round(_windowExtent.width * _scale)), 1u, _targetExtent.width),
+		std::clamp(static_cast<uint32_t>(std::round(_windowExtent.height * _scale)), 1u, _targetExtent.height)
+	};
+}
+
+glm::vec2 DynamicResolution::getViewportScale() const {
+	const VkExtent2D renderExtent = getRenderExtent();
+	return glm::vec2(renderExtent.width, renderExtent.height) / glm::vec2(_windowExtent.width, _windowExtent.height);
+}
+
+void DynamicResolution::upscale(VkCommandBuffer cmd, VkExtent2D windowExtent) {
+	const VkExtent2D renderExtent = getRenderExtent();
+	const glm::vec2 targetSize = glm::vec2(_targetExtent.width, _targetExtent.height);
+	const UpscaleConstants constants = {
+		.uvScale = glm::vec2(renderExtent.width, renderExtent.height) / targetSize,
+		.uvMax = (glm::vec2(renderExtent.width, renderExtent.height) - 0.5f) / targetSize
+	};
+
+	VkViewport viewport = { 0.f, 0.f, (float)windowExtent.width, (float)windowExtent.height, 0.f, 1.f };
+	VkRect2D scissor = { .offset = { 0, 0 }, .extent = windowExtent };
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipeline);
+	vkCmdSetViewport(cmd, 0, 1, &viewport);
+	vkCmdSetScissor(cmd, 0, 1, &scissor);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineLayout, 0, 1, &_descriptor, 0, nullptr);
+	vkCmdPushConstants(cmd, _pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(UpscaleConstants), &constants);
+	vkCmdDraw(cmd, 3, 1, 0, 0);
+}
+
+} // End of namespace Resolution
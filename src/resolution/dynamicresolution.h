@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+#include <expected.hpp>
+#include <glm/vec2.hpp>
+
+#include "src/deletionqueue.h"
+#include "src/error.h"
+
+namespace Resolution {
+
+struct ScaleSettings {
+	// GPU frame time to hold in milliseconds, 0 keeps the scale at maxScale
+	float targetFrameTime;
+	// Render resolution relative to the window
+	float minScale;
+	float maxScale;
+};
+
+/*!
+ * \brief Renders the scene at a resolution that follows the GPU frame time
+ *
+ * The scene goes into offscreen color and depth targets sized for the largest allowed scale.
+ * Every frame only the top-left part of them matching the current scale is rendered to,
+ * and an upscale pass stretches that part over the swapchain image. The scale is steered
+ * by the GPU duration of finished frames, read back from timestamp queries.
+ */
+class DynamicResolution {
+public:
+	// Scale limits are needed to size the render targets, before any GPU object exists
+	void configure(const ScaleSettings& settings);
+	// Engine-lifetime objects: the upscale pipeline, its sampler and descriptor
+	tl::expected<delFunc, VulkanError*> init(VkShaderModule vertexShader, VkShaderModule fragmentShader, VkRenderPass presentPass);
+	// Has to be called every time the render target gets recreated
+	void setTarget(VkExtent2D windowExtent, VkImageView colorView);
+
+	// Size of the offscreen targets for a window of the given size
+	VkExtent2D getTargetExtent(VkExtent2D windowExtent) const;
+
+	// Takes the GPU time of a finished frame in milliseconds, 0 means there was no measurement
+	void update(float gpuFrameTime);
+
+	float getScale() const { return _scale; };
+	// Part of the offscreen targets rendered to this frame
+	VkExtent2D getRenderExtent() const;
+	// Render extent relative to the window, per axis, for scaling window-sized viewports
+	glm::vec2 getViewportScale() const;
+
+	// Must be recorded inside the present render pass given to init
+	void upscale(VkCommandBuffer cmd, VkExtent2D windowExtent);
+private:
+	// Part of the gap to the desired scale closed per update
+	static constexpr float RESPONSE = 0.25f;
+	// Weight of the newest measurement in the smoothed frame time
+	static constexpr float SMOOTHING = 0.1f;
+	// Frame times this close to the target leave the scale alone
+	static constexpr float DEADBAND = 0.05f;
+
+	ScaleSettings _settings;
+	float _scale = 1.f;
+	float _smoothedTime = 0.f;
+	VkExtent2D _windowExtent = { 1, 1 };
+	VkExtent2D _targetExtent = { 1, 1 };
+
+	VkSampler _sampler;
+	VkDescriptorPool _descriptorPool;
+	VkDescriptorSetLayout _setLayout;
+	VkDescriptorSet _descriptor;
+	VkPipelineLayout _pipelineLayout;
+	VkPipeline _pipeline;
+};
+
+} // End of namespace Resolution
@@ -1,5 +1,7 @@
 #include "scene.h"
 #include "src/error.h"
+#include "src/profiling/profiler.h"
+#include "src/profiling/stats.h"
 #include <optional>
 
 Scene::Scene() {
@@ -30,6 +32,21 @@ Object Scene::getObject(entt::entity id) {
 	return _level.getObject(id);
 }
 
+Snapshot::AssetTable Scene::getAssetTable() {
+	Snapshot::AssetTable table;
+	for (auto& [name, mesh]: _meshes) table.addMesh(name, &mesh);
+	for (auto& [name, material]: _materials) table.addMaterial(name, &material);
+	return table;
+}
+
+MaybeError Scene::saveSnapshot(const std::string& path) {
+	return Snapshot::save(_level, getAssetTable(), path);
+}
+
+tl::expected<std::vector<entt::entity>, Error*> Scene::loadSnapshot(const std::string& path) {
+	return Snapshot::load(_level, getAssetTable(), path);
+}
+
 tl::expected<Object, Error*> Scene::addRenderObject(const std::string &mapName) {
 	auto mat = getMaterial(mapName);
 	auto mesh = getMesh(mapName);
@@ -43,6 +60,69 @@ tl::expected<Object, Error*> Scene::addRenderObject(const std::string &mapName)
     return result;
 }
 
+tl::expected<SpawnTemplate, Error*> Scene::makeSpawnTemplate(const std::string &mapName) {
+	auto mat = getMaterial(mapName);
+	auto mesh = getMesh(mapName);
+	if (!mesh.has_value() | !mat.has_value()) {
+		return tl::unexpected(new Error(ErrorMessage("Couldn't find material or mesh \"{}\" to spawn objects with", mapName)));
+	}
+	return SpawnTemplate{ .mesh = mesh.value(), .material = mat.value() };
+}
+
+tl::expected<std::vector<entt::entity>, Error*> Scene::spawnBatch(const SpawnTemplate &spawn, std::span<const glm::mat4> transforms) {
+	PROFILE_SCOPE("Spawn batch");
+	// Smaller batches only get the subtree built by AddBodiesPrepare, rebuilding the whole broadphase isn't worth it
+	constexpr size_t OPTIMIZE_BROADPHASE_BATCH = 256;
+
+	entt::registry& registry = _level._registry;
+	const size_t count = transforms.size();
+	std::vector<entt::entity> entities(count);
+	registry.create(entities.begin(), entities.end());
+
+	const bool rendered = spawn.mesh != nullptr && spawn.material != nullptr;
+	const bool physical = spawn.shape != nullptr;
+	_level._transforms.reserve(count);
+	registry.storage<TransformComponent>().reserve(registry.storage<TransformComponent>().size() + count);
+	registry.storage<HierarchyComponent>().reserve(registry.storage<HierarchyComponent>().size() + count);
+	if (rendered) registry.storage<RenderObject>().reserve(registry.storage<RenderObject>().size() + count);
+	if (physical) registry.storage<RigidBodyComponent>().reserve(registry.storage<RigidBodyComponent>().size() + count);
+
+	std::vector<RigidBodyComponent*> bodies;
+	if (physical) bodies.reserve(count);
+	for (size_t i = 0; i < count; i++) {
+		const entt::entity entity = entities[i];
+		Object object(&_level, entity);
+		registry.emplace<HierarchyComponent>(entity, object);
+		TransformComponent& transform = registry.emplace<TransformComponent>(entity, object, transforms[i]);
+		if (rendered)
+			registry.emplace<RenderObject>(entity, object, spawn.mesh, spawn.material);
+		if (physical) {
+			bodies.push_back(&registry.emplace<RigidBodyComponent>(entity, object, spawn.shape, watch_ptr<TransformComponent>(&transform), spawn.bodyType, spawn.mass));
+			if (spawn.layer.has_value()) bodies.back()->setLayer(spawn.layer.value());
+		}
+	}
+
+	// A failed batch spawns nothing, destroying the entities also destroys the bodies created so far
+	auto fail = [&](Error* error) {
+		registry.destroy(entities.begin(), entities.end());
+		return tl::unexpected(error);
+	};
+	if (physical && spawn.simulated) {
+		auto result = RigidBodyComponent::createAndAddBatch(bodies);
+		if (result.has_value())
+			return fail(new Error(result.value(), ErrorMessage("Could not add a batch of {} rigid bodies", count)));
+		if (count >= OPTIMIZE_BROADPHASE_BATCH)
+			PhysicsMan.optimizeBroadphase();
+	} else if (physical) {
+		for (RigidBodyComponent* body: bodies) {
+			auto result = body->create();
+			if (result.has_value())
+				return fail(new Error(result.value(), ErrorMessage("Could not create a batch of {} rigid bodies", count)));
+		}
+	}
+	return entities;
+}
+
 Object Scene::addEmptyObject() {
 	Object result = _level.addObject();
     result.addComponent<HierarchyComponent>();
@@ -57,6 +137,17 @@ std::optional<Material*> Scene::getMaterial(const std::string& name) {
 	return &(*it).second;
 }
 
+bool Scene::relocateMeshBuffer(VmaAllocation allocation, VkBuffer buffer) {
+	bool found = false;
+	for (auto& [name, mesh]: _meshes) {
+		if (mesh._vertexBuffer._allocation == allocation) {
+			mesh._vertexBuffer._buffer = buffer;
+			found = true;
+		}
+	}
+	return found;
+}
+
 std::optional<Mesh*> Scene::getMesh(const std::string& name) {
 	auto it = _meshes.find(name);
 	if (it == _meshes.end()) {
@@ -65,26 +156,17 @@ std::optional<Mesh*> Scene::getMesh(const std::string& name) {
 	return &(*it).second;
 }
 
-entityList Scene::getHierarchyOrderedObjects() {
-	SimpleView<HierarchyComponent> hierarchies = _level._registry.view<HierarchyComponent>();
-	entityList result;
-	// Get root ids
-	for (auto &&[entity, hier]: hierarchies.each()) {
-		if (hier._parentId == entt::null) {
-			result.push_back(entity);
-		}
-	}
-	entityList queue = result;
-	for (auto & entity: queue) {
-		Object item = getObject(entity);
-		watch_ptr<HierarchyComponent> itemh = item.getComponentDefault<HierarchyComponent>();
-		entityList newChildren = itemh->allChildren();
-		result.insert(result.end(), newChildren.begin(), newChildren.end());
-	}
-	return result;
+void Scene::composeTransforms() {
+	_level._transforms.composeDirty();
+	StatsMan.add(Profiling::Counter::TransformsPropagated, _level._hierarchy.propagate(_level._registry));
 }
 
 MaybeError Scene::update(float delta) {
-    _timerStorage.update(delta);
+    MaybeMultipleErrors timerErrors = _timerStorage.update(delta);
+    if (timerErrors.has_value()) {
+        // Only the first one is reported
+        for (size_t i = 1; i < timerErrors->size(); i++) delete timerErrors->at(i);
+        return new Error(timerErrors->front(), ErrorMessage("{} timer callbacks failed", timerErrors->size()));
+    }
     return std::nullopt;
 }
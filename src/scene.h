@@ -2,8 +2,10 @@
 
 #include <entt/entt.hpp>
 
+#include <span>
 #include <vector>
 #include <string>
+#include <optional>
 
 #include "deletionqueue.h"
 #include "expected.hpp"
@@ -14,6 +16,8 @@
 #include "vk_textures.h"
 #include "update/update.h"
 #include "src/objects/object.h"
+#include "src/objects/snapshot.h"
+#include "src/objects/spawntemplate.h"
 #include "src/objects/components/collisionphysics.h"
 #include "src/objects/components/rigidbody.h"
 #include "src/physics/dynamiccontroller.h"
@@ -21,6 +25,9 @@
 #include "src/objects/components/hierarchy.h"
 #include "src/objects/components/ssbo.h"
 #include "src/objects/components/camera.h"
+#include "src/objects/components/shadowcaster.h"
+#include "src/objects/components/pointlight.h"
+#include "src/objects/components/particleemitter.h"
 
 class VulkanEngine;
 
@@ -37,19 +44,49 @@ public:
 
 	Object addEmptyObject();
 	tl::expected<Object, Error*> addRenderObject(const std::string &mapName);
+	// Template with the mesh and material named mapName, fill in the shape for rigid bodies
+	tl::expected<SpawnTemplate, Error*> makeSpawnTemplate(const std::string &mapName);
+	// Adds one object per transform with the component pools reserved up front and
+	// the rigid bodies inserted into the physics system as one batch. On error nothing is spawned
+	tl::expected<std::vector<entt::entity>, Error*> spawnBatch(const SpawnTemplate &spawn, std::span<const glm::mat4> transforms);
 
 	std::optional<Mesh*> getMesh(const std::string& name);
+	// Points meshes at the new vertex buffer of a defragmented allocation, false if no mesh uses it
+	bool relocateMeshBuffer(VmaAllocation allocation, VkBuffer buffer);
 
 	Object getObject(entt::entity id);
 
+	// Meshes and materials of the scene by name, for snapshots
+	Snapshot::AssetTable getAssetTable();
+	MaybeError saveSnapshot(const std::string& path);
+	// Adds the snapshot's objects next to the ones already in the scene
+	tl::expected<std::vector<entt::entity>, Error*> loadSnapshot(const std::string& path);
+
+	// Fires right before an object stops being rendered, its components are still there
+	auto onRenderRemoved() { return _level._registry.on_destroy<RenderObject>(); };
 	auto getSimpleRenders() { return _level._registry.view<RenderObject, TransformComponent>(); };
+	// Storages are fetched on the main thread, so systems running elsewhere never create one
+	template<typename Component>
+	entt::storage_for_t<Component>& getStorage() { return _level._registry.storage<Component>(); };
 	SimpleView<Camera> getCameras() { return _level._registry.view<Camera>(); };
 	SimpleView<DynamicCharacterController> getCharacters() { return _level._registry.view<DynamicCharacterController>(); };
 	SimpleView<RigidBodyComponent> getRigidBodies() { return _level._registry.view<RigidBodyComponent>(); };
 	SimpleView<CollisionPhysicsComponent> getCollisions() { return _level._registry.view<CollisionPhysicsComponent>(); };
 	auto getRenders() { return _level._registry.view<RenderObject, TransformComponent, SSBOIndex>(); };
+	auto getPointLights() { return _level._registry.view<PointLight, TransformComponent>(); };
+	auto getParticleEmitters() { return _level._registry.view<ParticleEmitter, TransformComponent>(); };
+
+	// Parents always come before their children, only rebuilt when parenting changes
+	const entityList& getHierarchyOrderedObjects() { return _level._hierarchy.getOrder(_level._registry); };
+	// Rebuilds the matrices of every transform changed since the last call in SIMD batches,
+	// then moves children that inherit their parent's transform
+	void composeTransforms();
 
-	entityList getHierarchyOrderedObjects();
+	// Every scene object carries a hierarchy component
+	size_t objectCount() { return _level._registry.view<HierarchyComponent>().size(); };
+	int queuedTimers() const { return _timerStorage.queuedTimers(); };
+	// Replaces the engine's default ambient light when set
+	std::optional<glm::vec3> getAmbientLight() const { return _ambientLight; };
 
     virtual MaybeError update(float delta) override;
 
@@ -65,6 +102,8 @@ protected:
 	std::unordered_map<std::string, Mesh> _meshes;
 	std::unordered_map<std::string, TextureAsset> _loadedTextures;
 
+	std::optional<glm::vec3> _ambientLight;
+
 	virtual tl::expected<int, Error*> loadMeshes(VulkanEngine* engine) { return 0; };
 
 	virtual tl::expected<int, Error*> loadImages(VulkanEngine* engine) { return 0; };
@@ -0,0 +1,46 @@
+#include "settings.h"
+
+#include <cstdlib>
+#include <string_view>
+
+EngineSettings EngineSettings::fromArgs(int argc, char* argv[]) {
+	EngineSettings settings;
+	for (int i = 1; i < argc; i++) {
+		std::string_view arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+		if (arg == "--trace" && hasValue) {
+			settings.traceOutputPath = argv[++i];
+		} else if (arg == "--stats" && hasValue) {
+			settings.statsOutputPath = argv[++i];
+		} else if (arg == "--stats-overlay") {
+			settings.showStatsOverlay = true;
+		} else if (arg == "--frames" && hasValue) {
+			settings.maxFrames = std::strtoull(argv[++i], nullptr, 10);
+		} else if (arg == "--particles" && hasValue) {
+			settings.particleCapacity = std::strtoul(argv[++i], nullptr, 10);
+		} else if (arg == "--target-frame-time" && hasValue) {
+			settings.targetFrameTime = std::strtof(argv[++i], nullptr);
+		} else if (arg == "--min-render-scale" && hasValue) {
+			settings.minRenderScale = std::strtof(argv[++i], nullptr);
+		} else if (arg == "--max-render-scale" && hasValue) {
+			settings.maxRenderScale = std::strtof(argv[++i], nullptr);
+		} else if (arg == "--defrag-budget" && hasValue) {
+			settings.defragmentBytesPerFrame = std::strtoull(argv[++i], nullptr, 10) << 20;
+		} else if (arg == "--schedule-dump" && hasValue) {
+			settings.scheduleDumpPath = argv[++i];
+		} else if (arg == "--save-snapshot" && hasValue) {
+			settings.snapshotOutputPath = argv[++i];
+		} else if (arg == "--pool-size" && hasValue) {
+			settings.objectPoolSize = std::strtoul(argv[++i], nullptr, 10);
+		} else if (arg == "--pool-limit" && hasValue) {
+			settings.objectPoolLimit = std::strtoul(argv[++i], nullptr, 10);
+		} else if (arg == "--record-input" && hasValue) {
+			settings.inputRecordPath = argv[++i];
+		} else if (arg == "--replay-input" && hasValue) {
+			settings.inputReplayPath = argv[++i];
+		} else if (arg == "--shape-cache" && hasValue) {
+			settings.shapeCachePath = argv[++i];
+		}
+	}
+	return settings;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+struct EngineSettings {
+	// Chrome trace JSON is written here on shutdown when not empty (profiling builds only)
+	std::string traceOutputPath;
+	// Per-frame counters are dumped here when not empty, as JSON for ".json" paths and CSV otherwise
+	std::string statsOutputPath;
+	bool showStatsOverlay = false;
+	// Stop after this many frames, 0 runs until the window is closed
+	uint64_t maxFrames = 0;
+	// Maximum number of GPU particles alive at once, 0 disables the particle system
+	uint32_t particleCapacity = 0;
+	// Dynamic resolution holds the GPU frame time around this many milliseconds, 0 renders at maxRenderScale
+	float targetFrameTime = 0.f;
+	// Bounds of the scene resolution relative to the window
+	float minRenderScale = 0.5f;
+	float maxRenderScale = 1.f;
+	// Static geometry moved per idle frame while defragmenting, 0 disables defragmentation
+	uint64_t defragmentBytesPerFrame = 4ull << 20;
+	// Update systems with their dependencies and first frame timings are written here when not empty
+	std::string scheduleDumpPath;
+	// The scene is saved here as a binary snapshot right after it was built, when not empty
+	std::string snapshotOutputPath;
+	// Objects each ObjectPool of a scene creates up front
+	uint32_t objectPoolSize = 64;
+	// Objects each ObjectPool of a scene may grow to, 0 leaves pools unbounded
+	uint32_t objectPoolLimit = 1024;
+	// Input, frame deltas and the random seed are logged here when not empty
+	std::string inputRecordPath;
+	// Runs from this input log instead of live input and the clock, then exits; takes precedence over recording
+	std::string inputReplayPath;
+	// Collision shapes cooked from meshes are kept here between launches, empty cooks them on every launch
+	std::string shapeCachePath = "shapecache";
+
+	// Recognized options: --trace <path>, --stats <path>, --stats-overlay, --frames <count>, --particles <count>,
+	// --target-frame-time <ms>, --min-render-scale <scale>, --max-render-scale <scale>, --defrag-budget <MiB>,
+	// --schedule-dump <path>, --save-snapshot <path>, --pool-size <count>, --pool-limit <count>, --record-input <path>,
+	// --replay-input <path>, --shape-cache <directory>
+	static EngineSettings fromArgs(int argc, char* argv[]);
+};
@@ -0,0 +1,433 @@
+#include "cascadedshadows.h"
+
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#include "src/devicesingleton.h"
+#include "src/material.h"
+#include "src/vk_initializers.h"
+#include "src/vk_operations.h"
+#include "src/vmalloc.h"
+#include "src/profiling/stats.h"
+
+namespace Shadows {
+
+// Cascades cover the view frustum from NEAR_DISTANCE up to SHADOW_DISTANCE
+constexpr float NEAR_DISTANCE = 0.1f;
+constexpr float SHADOW_DISTANCE = 150.f;
+// Blend between uniform (0) and logarithmic (1) split distances
+constexpr float SPLIT_LAMBDA = 0.8f;
+// Cascades are a bit larger than the frustum slice so snapping never cuts it off
+constexpr float CASCADE_MARGIN = 1.2f;
+// Cascade centers move in steps of this fraction of the slice radius
+constexpr float SNAP_FRACTION = 0.25f;
+// Casters this far behind a cascade (towards the light) still get into it
+constexpr float CASTER_DISTANCE = 100.f;
+constexpr float DEPTH_BIAS_CONSTANT = 1.25f;
+constexpr float DEPTH_BIAS_SLOPE = 1.75f;
+// Receivers are pushed this many texels along their normal before the lookup
+constexpr float NORMAL_OFFSET = 1.5f;
+
+struct ShadowConstants {
+	glm::mat4 viewproj;
+};
+
+tl::expected<delFunc, VulkanError*> CascadedShadows::init(VkShaderModule shadowVertShader, VkDescriptorSetLayout objectLayout) {
+	VkAttachmentDescription depthAttachment = {
+		.flags = 0,
+		.format = FORMAT,
+		.samples = VK_SAMPLE_COUNT_1_BIT,
+		.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
+		.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+		.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+		.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+		.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+		// Static layers are only ever copied from
+		.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+	};
+	VkAttachmentReference depthReference = {
+		.attachment = 0,
+		.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+	};
+	VkSubpassDescription subpass = {
+		.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+		.colorAttachmentCount = 0,
+		.pDepthStencilAttachment = &depthReference
+	};
+	VkSubpassDependency dependencies[2] = {
+		{
+			// The previous copy out of the layer has to finish before it is overwritten
+			.srcSubpass = VK_SUBPASS_EXTERNAL,
+			.dstSubpass = 0,
+			.srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT,
+			.dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+			.srcAccessMask = 0,
+			.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+		},
+		{
+			.srcSubpass = 0,
+			.dstSubpass = VK_SUBPASS_EXTERNAL,
+			.srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+			.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT,
+			.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT
+		}
+	};
+	VkRenderPassCreateInfo passInfo = {
+		.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+		.attachmentCount = 1,
+		.pAttachments = &depthAttachment,
+		.subpassCount = 1,
+		.pSubpasses = &subpass,
+		.dependencyCount = 2,
+		.pDependencies = dependencies
+	};
+	auto passResult = vkcommand::createRenderPass(passInfo);
+	VK_UNEXPECTED_ERROR(passResult, "Failed to create static shadow render pass");
+	_staticPass = passResult.value();
+
+	// Composite pass draws dynamic casters on top of the copied static layer
+	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+	dependencies[0].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	passResult = vkcommand::createRenderPass(passInfo);
+	VK_UNEXPECTED_ERROR(passResult, "Failed to create shadow composite render pass");
+	_compositePass = passResult.value();
+
+	PipelineBuilder pipelineBuilder;
+	pipelineBuilder._viewport = { 0.f, 0.f, (float)RESOLUTION, (float)RESOLUTION, 0.f, 1.f };
+	pipelineBuilder._scissor = { .offset = { 0, 0 }, .extent = { RESOLUTION, RESOLUTION } };
+	pipelineBuilder._colorAttachmentCount = 0;
+	pipelineBuilder._rasterizer.depthBiasEnable = VK_TRUE;
+	pipelineBuilder._rasterizer.depthBiasConstantFactor = DEPTH_BIAS_CONSTANT;
+	pipelineBuilder._rasterizer.depthBiasSlopeFactor = DEPTH_BIAS_SLOPE;
+
+	VertexInputDescription vertexDescription = Vertex::get_vertex_description();
+	pipelineBuilder._vertexInputInfo.pVertexAttributeDescriptions = vertexDescription.attributes.data();
+	pipelineBuilder._vertexInputInfo.vertexAttributeDescriptionCount = vertexDescription.attributes.size();
+	pipelineBuilder._vertexInputInfo.pVertexBindingDescriptions = vertexDescription.bindings.data();
+	pipelineBuilder._vertexInputInfo.vertexBindingDescriptionCount = vertexDescription.bindings.size();
+
+	pipelineBuilder.addVertexShader(shadowVertShader);
+
+	std::vector<VkDescriptorSetLayout> setLayouts = { objectLayout };
+	std::vector<VkPushConstantRange> pushConstants { {
+		.stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+		.offset = 0,
+		.size = sizeof(ShadowConstants)
+	} };
+	auto layoutResult = pipelineBuilder.setLayout(setLayouts, pushConstants);
+	VK_UNEXPECTED_ERROR(layoutResult, "Failed to create shadow pipeline layout");
+	_pipelineLayout = layoutResult.value();
+
+	// Both passes have the same attachment, so one pipeline serves them both
+	auto pipelineResult = pipelineBuilder.build_pipeline(DeviceRef(), _staticPass);
+	VK_UNEXPECTED_ERROR(pipelineResult, "Failed to build shadow pipeline");
+	_pipeline = pipelineResult.value();
+
+	VkImageCreateInfo imageInfo = vkinit::createinfo::image(FORMAT,
+		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VkExtent3D{ RESOLUTION, RESOLUTION, 1 });
+	imageInfo.arrayLayers = SHADOW_CASCADES;
+	auto imageResult = VMAlloc.createImage(VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT), VMA_MEMORY_USAGE_GPU_ONLY, imageInfo);
+	VK_UNEXPECTED_ERROR(imageResult, "Failed to create static shadow map");
+	_staticImage = imageResult.value();
+
+	imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageResult = VMAlloc.createImage(VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT), VMA_MEMORY_USAGE_GPU_ONLY, imageInfo);
+	VK_UNEXPECTED_ERROR(imageResult, "Failed to create shadow map");
+	_shadowImage = imageResult.value();
+
+	VkImageViewCreateInfo viewInfo = vkinit::createinfo::imageView(FORMAT, _shadowImage._image, VK_IMAGE_ASPECT_DEPTH_BIT);
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+	viewInfo.subresourceRange.layerCount = SHADOW_CASCADES;
+	auto viewResult = vkcommand::createImageView(viewInfo);
+	VK_UNEXPECTED_ERROR(viewResult, "Failed to create shadow map view");
+	_shadowArrayView = viewResult.value();
+
+	for (uint32_t i = 0; i < SHADOW_CASCADES; i++) {
+		VkImageViewCreateInfo layerInfo = vkinit::createinfo::imageView(FORMAT, _staticImage._image, VK_IMAGE_ASPECT_DEPTH_BIT);
+		layerInfo.subresourceRange.baseArrayLayer = i;
+		viewResult = vkcommand::createImageView(layerInfo);
+		VK_UNEXPECTED_ERROR(viewResult, "Failed to create static shadow view for cascade {}", i);
+		_staticViews[i] = viewResult.value();
+
+		layerInfo.image = _shadowImage._image;
+		viewResult = vkcommand::createImageView(layerInfo);
+		VK_UNEXPECTED_ERROR(viewResult, "Failed to create shadow view for cascade {}", i);
+		_shadowViews[i] = viewResult.value();
+
+		VkFramebufferCreateInfo framebufferInfo = vkinit::createinfo::framebuffer(_staticPass, { RESOLUTION, RESOLUTION });
+		framebufferInfo.pAttachments = &_staticViews[i];
+		auto framebufferResult = vkcommand::createFramebuffer(framebufferInfo);
+		VK_UNEXPECTED_ERROR(framebufferResult, "Failed to create static shadow framebuffer for cascade {}", i);
+		_staticFramebuffers[i] = framebufferResult.value();
+
+		framebufferInfo.renderPass = _compositePass;
+		framebufferInfo.pAttachments = &_shadowViews[i];
+		framebufferResult = vkcommand::createFramebuffer(framebufferInfo);
+		VK_UNEXPECTED_ERROR(framebufferResult, "Failed to create shadow framebuffer for cascade {}", i);
+		_shadowFramebuffers[i] = framebufferResult.value();
+	}
+
+	// Hardware depth comparison, filtered for 2x2 PCF per tap
+	VkSamplerCreateInfo samplerInfo = vkinit::createinfo::sampler(VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+	samplerInfo.compareEnable = VK_TRUE;
+	samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+	auto samplerResult = vkcommand::createSampler(samplerInfo);
+	VK_UNEXPECTED_ERROR(samplerResult, "Failed to create shadow sampler");
+	_sampler = samplerResult.value();
+
+	return [=]() {
+		vkDestroySampler(DeviceRef(), _sampler, nullptr);
+		for (uint32_t i = 0; i < SHADOW_CASCADES; i++) {
+			vkDestroyFramebuffer(DeviceRef(), _staticFramebuffers[i], nullptr);
+			vkDestroyFramebuffer(DeviceRef(), _shadowFramebuffers[i], nullptr);
+			vkDestroyImageView(DeviceRef(), _staticViews[i], nullptr);
+			vkDestroyImageView(DeviceRef(), _shadowViews[i], nullptr);
+		}
+		vkDestroyImageView(DeviceRef(), _shadowArrayView, nullptr);
+		_shadowImage.destroy();
+		_staticImage.destroy();
+		vkDestroyPipeline(DeviceRef(), _pipeline, nullptr);
+		vkDestroyPipelineLayout(DeviceRef(), _pipelineLayout, nullptr);
+		vkDestroyRenderPass(DeviceRef(), _compositePass, nullptr);
+		vkDestroyRenderPass(DeviceRef(), _staticPass, nullptr);
+	};
+}
+
+void CascadedShadows::update(const GPUCameraData& camera, glm::vec3 lightDirection) {
+	_enabled = true;
+	lightDirection = glm::normalize(lightDirection);
+	if (lightDirection != _lightDirection) {
+		invalidateStatic();
+		_lightDirection = lightDirection;
+	}
+
+	const glm::mat4 invView = glm::inverse(camera.view);
+	const glm::vec3 position = invView[3];
+	const glm::vec3 forward = -glm::vec3(invView[2]);
+	// Squared distance from the view axis to a frustum corner at unit depth
+	const float tanX = 1.f / std::abs(camera.proj[0][0]);
+	const float tanY = 1.f / std::abs(camera.proj[1][1]);
+	const float cornerSquared = tanX * tanX + tanY * tanY;
+
+	const glm::vec3 up = std::abs(lightDirection.y) > 0.99f ? glm::vec3(1.f, 0.f, 0.f) : glm::vec3(0.f, 1.f, 0.f);
+	const glm::mat4 lightRotation = glm::lookAt(glm::vec3(0.f), lightDirection, up);
+
+	float splitNear = NEAR_DISTANCE;
+	for (uint32_t i = 0; i < SHADOW_CASCADES; i++) {
+		const float fraction = float(i + 1) / SHADOW_CASCADES;
+		const float uniformSplit = NEAR_DISTANCE + (SHADOW_DISTANCE - NEAR_DISTANCE) * fraction;
+		const float logSplit = NEAR_DISTANCE * std::pow(SHADOW_DISTANCE / NEAR_DISTANCE, fraction);
+		const float splitFar = glm::mix(uniformSplit, logSplit, SPLIT_LAMBDA);
+
+		// Bounding sphere of the frustum slice, which doesn't change when the camera turns
+		float centerDistance = (splitNear + splitFar) * (1.f + cornerSquared) * 0.5f;
+		float radius;
+		if (centerDistance >= splitFar) {
+			centerDistance = splitFar;
+			radius = splitFar * std::sqrt(cornerSquared);
+		} else {
+			const float depthOffset = splitFar - centerDistance;
+			radius = std::sqrt(depthOffset * depthOffset + splitFar * splitFar * cornerSquared);
+		}
+
+		const float extent = radius * CASCADE_MARGIN;
+		const float texelSize = 2.f * extent / RESOLUTION;
+		// Whole texel steps keep the static layer free of shimmering when it does move
+		const float step = std::max(texelSize, std::floor(radius * SNAP_FRACTION / texelSize) * texelSize);
+		glm::vec3 center = lightRotation * glm::vec4(position + forward * centerDistance, 1.f);
+		center = glm::round(center / step) * step;
+
+		Cascade& cascade = _cascades[i];
+		if (center != cascade.center || extent != cascade.extent)
+			cascade.staticValid = false;
+		cascade.center = center;
+		cascade.extent = extent;
+		cascade.depth = extent + CASTER_DISTANCE;
+		cascade.view = glm::translate(glm::mat4(1.f), -center) * lightRotation;
+		cascade.viewproj = glm::orthoRH_ZO(-extent, extent, -extent, extent, -cascade.depth, extent) * cascade.view;
+		cascade.staticCasters.clear();
+		cascade.dynamicCasters.clear();
+
+		_shaderData.cascadeViewproj[i] = cascade.viewproj;
+		_shaderData.texelSizes[i] = texelSize;
+
+		splitNear = splitFar;
+	}
+	_shaderData.params = glm::vec4(SHADOW_CASCADES, NORMAL_OFFSET, 0.f, 0.f);
+}
+
+void CascadedShadows::disable() {
+	_enabled = false;
+	_shaderData.params.x = 0.f;
+	// Static casters are not tracked while disabled
+	invalidateStatic();
+}
+
+bool CascadedShadows::touches(const Cascade& cascade, glm::vec4 sphere) const {
+	const glm::vec3 center = cascade.view * glm::vec4(glm::vec3(sphere), 1.f);
+	const float radius = sphere.w;
+	return std::abs(center.x) <= cascade.extent + radius
+		&& std::abs(center.y) <= cascade.extent + radius
+		&& center.z - radius <= cascade.depth
+		&& center.z + radius >= -cascade.extent;
+}
+
+void CascadedShadows::addCaster(const Caster& caster, bool isStatic) {
+	if (!_enabled) return;
+
+	for (Cascade& cascade: _cascades) {
+		if (!touches(cascade, caster.sphere))
+			continue;
+		if (isStatic)
+			cascade.staticCasters.push_back(caster);
+		else
+			cascade.dynamicCasters.push_back(caster);
+	}
+}
+
+void CascadedShadows::invalidateStatic(glm::vec4 sphere) {
+	for (Cascade& cascade: _cascades) {
+		if (touches(cascade, sphere))
+			cascade.staticValid = false;
+	}
+}
+
+void CascadedShadows::invalidateStatic() {
+	for (Cascade& cascade: _cascades)
+		cascade.staticValid = false;
+}
+
+void CascadedShadows::transitionShadowLayers(VkCommandBuffer cmd) {
+	if (_layoutReady) return;
+
+	// Lit shaders sample every layer even before anything is rendered into it
+	VkImageMemoryBarrier barrier = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+		.pNext = nullptr,
+		.srcAccessMask = 0,
+		.dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+		.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+		.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = _shadowImage._image,
+		.subresourceRange = {
+			.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+			.baseMipLevel = 0,
+			.levelCount = 1,
+			.baseArrayLayer = 0,
+			.layerCount = SHADOW_CASCADES
+		}
+	};
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	_layoutReady = true;
+}
+
+void CascadedShadows::drawCasters(VkCommandBuffer cmd, const Cascade& cascade, uint32_t cascadeIndex, const std::vector<Caster>& casters) {
+	if (casters.empty()) return;
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipeline);
+	VkViewport viewport = { 0.f, 0.f, (float)RESOLUTION, (float)RESOLUTION, 0.f, 1.f };
+	VkRect2D scissor = { .offset = { 0, 0 }, .extent = { RESOLUTION, RESOLUTION } };
+	vkCmdSetViewport(cmd, 0, 1, &viewport);
+	vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+	ShadowConstants constants = { cascade.viewproj };
+	vkCmdPushConstants(cmd, _pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ShadowConstants), &constants);
+
+	Mesh* lastMesh = nullptr;
+	for (const Caster& caster: casters) {
+		if (caster.mesh != lastMesh) {
+			VkDeviceSize offset = 0;
+			vkCmdBindVertexBuffers(cmd, 0, 1, &caster.mesh->_vertexBuffer._buffer, &offset);
+			lastMesh = caster.mesh;
+		}
+		// Farther cascades have larger texels and take coarser LODs
+		uint32_t firstVertex = 0, vertexCount = caster.mesh->_vertices.size();
+		if (!caster.mesh->_lods.empty()) {
+			const MeshLod& lod = caster.mesh->_lods[std::min<size_t>(cascadeIndex, caster.mesh->_lods.size() - 1)];
+			firstVertex = lod.firstVertex;
+			vertexCount = lod.vertexCount;
+		}
+		vkCmdDraw(cmd, vertexCount, 1, firstVertex, caster.objectIndex);
+	}
+	StatsMan.add(Profiling::Counter::ShadowDrawCalls, casters.size());
+}
+
+void CascadedShadows::record(VkCommandBuffer cmd, VkDescriptorSet objectDescriptor) {
+	transitionShadowLayers(cmd);
+	if (!_enabled) return;
+
+	VkClearValue depthClear;
+	depthClear.depthStencil.depth = 1.f;
+
+	for (uint32_t i = 0; i < SHADOW_CASCADES; i++) {
+		Cascade& cascade = _cascades[i];
+		const bool hasDynamic = !cascade.dynamicCasters.empty();
+		// Sampled layer already holds exactly the static layer
+		if (cascade.staticValid && !hasDynamic && !cascade.hadDynamic)
+			continue;
+
+		if (!cascade.staticValid) {
+			VkRenderPassBeginInfo passInfo = vkinit::renderpass_begin_info(_staticPass, { RESOLUTION, RESOLUTION }, _staticFramebuffers[i]);
+			passInfo.clearValueCount = 1;
+			passInfo.pClearValues = &depthClear;
+			vkCmdBeginRenderPass(cmd, &passInfo, VK_SUBPASS_CONTENTS_INLINE);
+			vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineLayout, 0, 1, &objectDescriptor, 0, nullptr);
+			drawCasters(cmd, cascade, i, cascade.staticCasters);
+			vkCmdEndRenderPass(cmd);
+
+			cascade.staticValid = true;
+			StatsMan.add(Profiling::Counter::ShadowStaticRedraws);
+		}
+
+		// Previous frames might still be sampling the layer
+		VkImageMemoryBarrier barrier = {
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+			.pNext = nullptr,
+			.srcAccessMask = 0,
+			.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+			.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+			.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = _shadowImage._image,
+			.subresourceRange = {
+				.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+				.baseMipLevel = 0,
+				.levelCount = 1,
+				.baseArrayLayer = i,
+				.layerCount = 1
+			}
+		};
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		VkImageCopy copy = {
+			.srcSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, i, 1 },
+			.srcOffset = { 0, 0, 0 },
+			.dstSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, i, 1 },
+			.dstOffset = { 0, 0, 0 },
+			.extent = { RESOLUTION, RESOLUTION, 1 }
+		};
+		vkCmdCopyImage(cmd, _staticImage._image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, _shadowImage._image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
+
+		// Also moves the layer back into the sampled layout when there is nothing dynamic
+		VkRenderPassBeginInfo passInfo = vkinit::renderpass_begin_info(_compositePass, { RESOLUTION, RESOLUTION }, _shadowFramebuffers[i]);
+		vkCmdBeginRenderPass(cmd, &passInfo, VK_SUBPASS_CONTENTS_INLINE);
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineLayout, 0, 1, &objectDescriptor, 0, nullptr);
+		drawCasters(cmd, cascade, i, cascade.dynamicCasters);
+		vkCmdEndRenderPass(cmd);
+
+		cascade.hadDynamic = hasDynamic;
+	}
+}
+
+} // End of namespace Shadows
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vulkan/vulkan_core.h>
+#include <expected.hpp>
+#include <glm/glm.hpp>
+
+#include <array>
+#include <vector>
+
+#include "src/allocstructs.h"
+#include "src/deletionqueue.h"
+#include "src/error.h"
+#include "src/gpustructs.h"
+#include "src/vk_mesh.h"
+
+namespace Shadows {
+
+struct Caster {
+	Mesh* mesh;
+	// Index into the object buffer of the frame
+	uint32_t objectIndex;
+	// World-space bounding sphere
+	glm::vec4 sphere;
+};
+
+/*!
+ * \brief Cascaded sun shadow maps with a cached static layer
+ *
+ * Every cascade has two depth layers. The static one only holds casters that stopped moving
+ * and is re-rendered when the cascade moves or the static set changes. Each frame the static
+ * layer is copied into the sampled one and dynamic casters are drawn on top.
+ *
+ * Cascades are snapped to a coarse light-space grid, so small camera movements keep
+ * the exact same matrices and the static layer stays valid.
+ */
+class CascadedShadows {
+public:
+	static constexpr uint32_t RESOLUTION = 2048;
+	static constexpr VkFormat FORMAT = VK_FORMAT_D32_SFLOAT;
+
+	tl::expected<delFunc, VulkanError*> init(VkShaderModule shadowVertShader, VkDescriptorSetLayout objectLayout);
+
+	// Fits the cascades to the render camera and drops the casters of the previous frame
+	void update(const GPUCameraData& camera, glm::vec3 lightDirection);
+	// Turns shadows off for this frame, e.g. when the scene has no light camera
+	void disable();
+
+	void addCaster(const Caster& caster, bool isStatic);
+	// Marks static layers of the cascades touching the sphere for re-rendering
+	void invalidateStatic(glm::vec4 sphere);
+	void invalidateStatic();
+
+	// Must be recorded outside of a render pass, before anything samples the shadow map
+	void record(VkCommandBuffer cmd, VkDescriptorSet objectDescriptor);
+
+	bool isEnabled() const { return _enabled; };
+	const GPUShadowData& getShaderData() const { return _shaderData; };
+	VkImageView getView() const { return _shadowArrayView; };
+	VkSampler getSampler() const { return _sampler; };
+private:
+	struct Cascade {
+		glm::mat4 viewproj;
+		glm::mat4 view;
+		// Snapped light-space center and half-size the static layer was rendered with
+		glm::vec3 center;
+		float extent;
+		float depth;
+		bool staticValid = false;
+		bool hadDynamic = false;
+		std::vector<Caster> staticCasters;
+		std::vector<Caster> dynamicCasters;
+	};
+
+	bool touches(const Cascade& cascade, glm::vec4 sphere) const;
+	void drawCasters(VkCommandBuffer cmd, const Cascade& cascade, uint32_t cascadeIndex, const std::vector<Caster>& casters);
+	void transitionShadowLayers(VkCommandBuffer cmd);
+
+	std::array<Cascade, SHADOW_CASCADES> _cascades;
+	glm::vec3 _lightDirection{0.f};
+	GPUShadowData _shaderData{};
+	bool _enabled = false;
+	bool _layoutReady = false;
+
+	VkRenderPass _staticPass;
+	VkRenderPass _compositePass;
+	VkPipelineLayout _pipelineLayout;
+	VkPipeline _pipeline;
+	VkSampler _sampler;
+
+	AllocatedImage _staticImage;
+	AllocatedImage _shadowImage;
+	VkImageView _shadowArrayView;
+	std::array<VkImageView, SHADOW_CASCADES> _staticViews;
+	std::array<VkImageView, SHADOW_CASCADES> _shadowViews;
+	std::array<VkFramebuffer, SHADOW_CASCADES> _staticFramebuffers;
+	std::array<VkFramebuffer, SHADOW_CASCADES> _shadowFramebuffers;
+};
+
+} // End of namespace Shadows
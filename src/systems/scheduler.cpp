@@ -0,0 +1,172 @@
+#include "scheduler.h"
+
+#include <fmt/format.h>
+
+#include <fstream>
+#include <thread>
+
+#include "src/profiling/profiler.h"
+
+namespace Systems {
+
+SystemBuilder& SystemBuilder::access(Access access) {
+	_scheduler._systems[_system].accesses.push_back(access);
+	return *this;
+}
+
+SystemBuilder& SystemBuilder::exclusive() {
+	_scheduler._systems[_system].exclusive = true;
+	return *this;
+}
+
+SystemBuilder& SystemBuilder::mainThread() {
+	_scheduler._systems[_system].mainThread = true;
+	return *this;
+}
+
+SystemId Scheduler::addSystem(const char* name, std::function<void(SystemBuilder&)> setup, Callback run) {
+	const SystemId id = _systems.size();
+	_systems.push_back({ .name = name, .run = std::move(run) });
+	SystemBuilder builder(*this, id);
+	setup(builder);
+	return id;
+}
+
+void Scheduler::clear() {
+	_systems.clear();
+	_timings.clear();
+}
+
+bool Scheduler::conflicts(const System& first, const System& second) const {
+	if (first.exclusive || second.exclusive) return true;
+	for (const Access& a: first.accesses) {
+		for (const Access& b: second.accesses) {
+			if (a.id == b.id && (a.write || b.write)) return true;
+		}
+	}
+	return false;
+}
+
+void Scheduler::buildGraph() {
+	const size_t count = _systems.size();
+	_dependents.assign(count, {});
+	_dependencyCounts.assign(count, 0);
+	// Declaration order decides who goes first, so the graph has no cycles
+	for (SystemId later = 0; later < count; later++) {
+		for (SystemId earlier = 0; earlier < later; earlier++) {
+			if (!conflicts(_systems[earlier], _systems[later])) continue;
+			_dependents[earlier].push_back(later);
+			_dependencyCounts[later]++;
+		}
+	}
+}
+
+MaybeError Scheduler::run(float delta) {
+	const size_t count = _systems.size();
+	if (count == 0) return std::nullopt;
+
+	buildGraph();
+	_timings.resize(count);
+	_remaining = std::make_unique<std::atomic<uint32_t>[]>(count);
+	for (SystemId system = 0; system < count; system++) {
+		_remaining[system].store(_dependencyCounts[system], std::memory_order_relaxed);
+		_timings[system] = { _systems[system].name, 0.f };
+	}
+	_unfinished.store(count, std::memory_order_release);
+
+	for (SystemId system = 0; system < count; system++) {
+		if (_dependencyCounts[system] == 0)
+			schedule(system, delta);
+	}
+
+	// The main thread runs its own systems and helps the pool with the rest
+	while (_unfinished.load(std::memory_order_acquire) > 0) {
+		std::optional<SystemId> mainSystem;
+		{
+			std::lock_guard lock(_mainMutex);
+			if (!_mainReady.empty()) {
+				mainSystem = _mainReady.back();
+				_mainReady.pop_back();
+			}
+		}
+		if (mainSystem) {
+			runSystem(*mainSystem, delta);
+		} else if (!WorkerPool.runOne()) {
+			std::this_thread::yield();
+		}
+	}
+
+	std::optional<Error*> error = _error;
+	_error = std::nullopt;
+	return error;
+}
+
+void Scheduler::schedule(SystemId system, float delta) {
+	if (_systems[system].mainThread) {
+		std::lock_guard lock(_mainMutex);
+		_mainReady.push_back(system);
+	} else {
+		WorkerPool.submit([this, system, delta]() { runSystem(system, delta); });
+	}
+}
+
+void Scheduler::runSystem(SystemId system, float delta) {
+	const System& current = _systems[system];
+	const Profiling::Clock::time_point start = Profiling::Clock::now();
+	MaybeError result;
+	{
+		PROFILE_SCOPE(current.name);
+		result = current.run(delta);
+	}
+	_timings[system].milliseconds = std::chrono::duration<float, std::milli>(Profiling::Clock::now() - start).count();
+
+	if (result) {
+		std::lock_guard lock(_errorMutex);
+		if (_error) delete result.value();
+		else _error = new Error(result.value(), ErrorMessage("System \"{}\" failed", current.name));
+	}
+
+	for (SystemId dependent: _dependents[system]) {
+		if (_remaining[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1)
+			schedule(dependent, delta);
+	}
+	_unfinished.fetch_sub(1, std::memory_order_release);
+}
+
+std::string Scheduler::describe() const {
+	std::string result;
+	for (SystemId system = 0; system < _systems.size(); system++) {
+		const System& current = _systems[system];
+		result += fmt::format("{}: {}", system, current.name);
+		if (current.exclusive) result += " [exclusive]";
+		if (current.mainThread) result += " [main thread]";
+		if (system < _timings.size()) result += fmt::format(", {:.3f} ms", _timings[system].milliseconds);
+		result += "\n";
+
+		std::string reads, writes, after;
+		for (const Access& access: current.accesses) {
+			std::string& list = access.write ? writes : reads;
+			list += fmt::format("{}{}", list.empty() ? "" : ", ", access.name);
+		}
+		for (SystemId earlier = 0; earlier < system; earlier++) {
+			if (conflicts(_systems[earlier], current))
+				after += fmt::format("{}{}", after.empty() ? "" : ", ", _systems[earlier].name);
+		}
+		if (!reads.empty()) result += fmt::format("    reads: {}\n", reads);
+		if (!writes.empty()) result += fmt::format("    writes: {}\n", writes);
+		result += fmt::format("    after: {}\n", after.empty() ? "-" : after);
+	}
+	return result;
+}
+
+MaybeError Scheduler::dump(const std::string& path) const {
+	std::ofstream file(path, std::ios::trunc);
+	if (!file.is_open()) {
+		int errorCode = file.bad() | file.fail() << 1 | file.eof() << 2;
+		return new FileError(errorCode, ErrorMessage("Unable to open schedule dump at \"{}\"", path));
+	}
+	file << describe();
+	return std::nullopt;
+}
+
+} // End of namespace Systems
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <entt/entt.hpp>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "src/error.h"
+#include "src/jobs/threadpool.h"
+
+namespace Systems {
+
+using SystemId = uint32_t;
+using AccessId = entt::id_type;
+
+struct Access {
+	AccessId id;
+	std::string_view name;
+	bool write;
+};
+
+class Scheduler;
+
+// Collects what a system touches, passed to the setup callback of Scheduler::addSystem
+class SystemBuilder {
+public:
+	SystemBuilder(Scheduler& scheduler, SystemId system): _scheduler(scheduler), _system(system) {};
+
+	// Components, or any other shared state named by a type (e.g. a manager singleton)
+	template<typename T>
+	SystemBuilder& read() { return access({ entt::type_hash<T>::value(), entt::type_name<T>::value(), false }); };
+	template<typename T>
+	SystemBuilder& write() { return access({ entt::type_hash<T>::value(), entt::type_name<T>::value(), true }); };
+	// Conflicts with every other system, for code that may touch anything
+	SystemBuilder& exclusive();
+	// Always runs on the thread calling Scheduler::run
+	SystemBuilder& mainThread();
+private:
+	SystemBuilder& access(Access access);
+
+	Scheduler& _scheduler;
+	SystemId _system;
+};
+
+struct SystemTiming {
+	const char* name;
+	float milliseconds;
+};
+
+/*!
+ * \brief Runs frame update systems in parallel according to the components they declare
+ *
+ * Every run builds a dependency graph: a system waits for the systems declared before it
+ * that write what it reads or writes, or read what it writes. Systems with no conflicts
+ * between them run at the same time on the worker pool. forEach() spreads a single system
+ * over the pool in chunks.
+ */
+class Scheduler {
+public:
+	using Callback = std::function<MaybeError(float delta)>;
+
+	// System names are never copied, so they must outlive the scheduler (string literals)
+	SystemId addSystem(const char* name, std::function<void(SystemBuilder&)> setup, Callback run);
+	void clear();
+
+	// Runs every system once, returns the first error any of them reported
+	MaybeError run(float delta);
+
+	const std::vector<SystemTiming>& lastTimings() const { return _timings; };
+	// Systems with their accesses, dependencies and the last timings
+	std::string describe() const;
+	MaybeError dump(const std::string& path) const;
+private:
+	friend class SystemBuilder;
+
+	struct System {
+		const char* name;
+		Callback run;
+		std::vector<Access> accesses;
+		bool exclusive = false;
+		bool mainThread = false;
+	};
+
+	bool conflicts(const System& first, const System& second) const;
+	void buildGraph();
+	// Hands the system to the pool, or to the main thread
+	void schedule(SystemId system, float delta);
+	void runSystem(SystemId system, float delta);
+
+	std::vector<System> _systems;
+	std::vector<std::vector<SystemId>> _dependents;
+	std::vector<uint32_t> _dependencyCounts;
+	// Dependencies left before each system may start
+	std::unique_ptr<std::atomic<uint32_t>[]> _remaining;
+	std::atomic<uint32_t> _unfinished{0};
+	std::vector<SystemTiming> _timings;
+
+	// Main thread systems that became ready while the main thread was busy
+	std::mutex _mainMutex;
+	std::vector<SystemId> _mainReady;
+	std::mutex _errorMutex;
+	std::optional<Error*> _error;
+};
+
+/*!
+ * \brief Calls body(entity, component) for every component in the storage, in chunks over the worker pool
+ *
+ * The body must only touch its own entity's data. Returns the first error reported,
+ * the others are dropped.
+ */
+template<typename Component, typename Body>
+MaybeError forEach(entt::storage_for_t<Component>& storage, Body&& body, uint32_t chunkSize = 64) {
+	std::mutex errorMutex;
+	std::optional<Error*> firstError;
+	WorkerPool.parallelFor(storage.size(), chunkSize, [&](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; i++) {
+			const entt::entity entity = storage.data()[i];
+			if (entity == entt::tombstone) continue;
+			MaybeError result = body(entity, storage.get(entity));
+			if (!result) continue;
+			std::lock_guard lock(errorMutex);
+			if (firstError) delete result.value();
+			else firstError = result;
+		}
+	});
+	return firstError;
+}
+
+} // End of namespace Systems
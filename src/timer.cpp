@@ -1,37 +1,190 @@
 #include "timer.h"
 #include <algorithm>
+#include <cmath>
+#include <utility>
+
+void TimerStorage::reserve(size_t count) {
+    _nodes.reserve(count);
+}
+
+TimerHandle TimerStorage::addTimer(Timer& timer) {
+    return add(toTicks(timer.time), 0, TimerCallback(timer.onTimer));
+}
+
+TimerHandle TimerStorage::addTimer(float time, TimerCallback& onTimer) {
+    return add(toTicks(time), 0, TimerCallback(onTimer));
+}
+
+TimerHandle TimerStorage::addTimer(float time, TimerCallback&& onTimer) {
+    return add(toTicks(time), 0, std::move(onTimer));
+}
+
+TimerHandle TimerStorage::addRepeatingTimer(float interval, TimerCallback&& onTimer) {
+    const uint64_t ticks = std::max<uint64_t>(toTicks(interval), 1);
+    return add(ticks, ticks, std::move(onTimer));
+}
+
+bool TimerStorage::isQueued(TimerHandle handle) const {
+    if (handle.index >= _nodes.size()) return false;
+    const Node& node = _nodes[handle.index];
+    return node.generation == handle.generation && (node.list != NO_LIST || node.firing);
+}
+
+bool TimerStorage::cancelTimer(TimerHandle handle) {
+    if (!isQueued(handle)) return false;
+    Node& node = _nodes[handle.index];
+    // A callback cancelling its own timer, fire() frees it once the callback returns
+    if (node.firing) {
+        node.firing = false;
+        return true;
+    }
+    unlink(handle.index);
+    freeNode(handle.index);
+    return true;
+}
 
 MaybeMultipleErrors TimerStorage::update(float delta) {
     std::vector<Error *> errors{};
-    for (auto item = _timers.rbegin(); item != _timers.rend(); item++) {
-        if (item->time < delta) {
-            item->time = 0;
-            std::optional<Error *> error = item->onTimer();
-            if (error) {
-                errors.push_back(error.value());
-            }
-        } else {
-            item->time -= delta;
+    _remainder += delta;
+    uint64_t ticks = static_cast<uint64_t>(_remainder * TICKS_PER_SECOND);
+    _remainder -= static_cast<double>(ticks) / TICKS_PER_SECOND;
+
+    for (; ticks > 0; ticks--) {
+        // Nothing to move or fire, the wheels only have to catch up
+        if (_queued == 0) {
+            _now += ticks;
+            break;
+        }
+        _now++;
+        const uint32_t slot = _now & (SLOTS - 1);
+        if (slot == 0) cascade(1);
+
+        // Due timers move to the expired list first, so callbacks can cancel the ones not fired yet
+        uint32_t index = std::exchange(_lists[slot], NO_NODE);
+        while (index != NO_NODE) {
+            const uint32_t next = _nodes[index].next;
+            _nodes[index].previous = NO_NODE;
+            _nodes[index].list = NO_LIST;
+            link(index, EXPIRED_LIST);
+            index = next;
+        }
+        while (_lists[EXPIRED_LIST] != NO_NODE) {
+            index = _lists[EXPIRED_LIST];
+            unlink(index);
+            fire(index, errors);
         }
     }
-    _timers.erase(
-    std::remove_if(_timers.begin(), _timers.end(),
-        [](const Timer & o) { return o.time <= 0; }),
-    _timers.end());
+
     if (errors.empty())
         return {};
     else 
         return errors;
 }
 
-void TimerStorage::addTimer(Timer& timer) {
-    _timers.push_back(timer);
+TimerHandle TimerStorage::add(uint64_t delay, uint64_t interval, TimerCallback&& callback) {
+    const uint32_t index = allocateNode();
+    Node& node = _nodes[index];
+    node.callback = std::move(callback);
+    // Timers never fire within the tick they were added in
+    node.due = _now + std::max<uint64_t>(delay, 1);
+    node.interval = interval;
+    schedule(index);
+    _queued++;
+    return { index, node.generation };
+}
+
+uint32_t TimerStorage::allocateNode() {
+    if (_freeNodes == NO_NODE) {
+        _nodes.emplace_back();
+        return _nodes.size() - 1;
+    }
+    const uint32_t index = _freeNodes;
+    _freeNodes = _nodes[index].next;
+    _nodes[index].next = NO_NODE;
+    return index;
+}
+
+void TimerStorage::freeNode(uint32_t index) {
+    Node& node = _nodes[index];
+    node.callback = nullptr;
+    node.generation++;
+    node.list = NO_LIST;
+    node.previous = NO_NODE;
+    node.next = _freeNodes;
+    _freeNodes = index;
+    _queued--;
+}
+
+void TimerStorage::schedule(uint32_t index) {
+    const uint64_t due = _nodes[index].due;
+    const uint64_t delta = due - _now;
+    uint32_t level = 0;
+    while (level + 1 < LEVELS && delta >= (uint64_t(1) << ((level + 1) * SLOT_BITS)))
+        level++;
+    const uint32_t slot = (due >> (level * SLOT_BITS)) & (SLOTS - 1);
+    link(index, level * SLOTS + slot);
+}
+
+void TimerStorage::link(uint32_t index, uint32_t list) {
+    Node& node = _nodes[index];
+    node.list = list;
+    node.previous = NO_NODE;
+    node.next = _lists[list];
+    if (node.next != NO_NODE) _nodes[node.next].previous = index;
+    _lists[list] = index;
 }
 
-void TimerStorage::addTimer(float time, std::function<std::optional<Error *> ()>& onTimer) {
-    _timers.push_back({ time, onTimer});
+void TimerStorage::unlink(uint32_t index) {
+    Node& node = _nodes[index];
+    if (node.previous != NO_NODE) _nodes[node.previous].next = node.next;
+    else _lists[node.list] = node.next;
+    if (node.next != NO_NODE) _nodes[node.next].previous = node.previous;
+    node.previous = NO_NODE;
+    node.next = NO_NODE;
+    node.list = NO_LIST;
+}
+
+void TimerStorage::cascade(uint32_t level) {
+    const uint32_t slot = (_now >> (level * SLOT_BITS)) & (SLOTS - 1);
+    // The coarser wheel turns first, its timers may land in this slot
+    if (slot == 0 && level + 1 < LEVELS) cascade(level + 1);
+
+    // Detached as a whole, timers a full turn away land back in the emptied slot
+    uint32_t index = std::exchange(_lists[level * SLOTS + slot], NO_NODE);
+    while (index != NO_NODE) {
+        const uint32_t next = _nodes[index].next;
+        schedule(index);
+        index = next;
+    }
+}
+
+void TimerStorage::fire(uint32_t index, std::vector<Error *>& errors) {
+    _nodes[index].firing = true;
+    // Moved out, callbacks adding timers may reallocate the nodes
+    TimerCallback callback = std::move(_nodes[index].callback);
+    std::optional<Error *> error = callback();
+    if (error) {
+        errors.push_back(error.value());
+    }
+
+    Node& node = _nodes[index];
+    if (node.firing && node.interval > 0) {
+        node.firing = false;
+        node.callback = std::move(callback);
+        node.due += node.interval;
+        // Long frames make repeating timers catch up tick by tick
+        node.due = std::max(node.due, _now + 1);
+        schedule(index);
+    } else {
+        node.firing = false;
+        freeNode(index);
+    }
 }
 
-void TimerStorage::addTimer(float time, std::function<std::optional<Error *> ()>&& onTimer) {
-    _timers.push_back({ time, onTimer});
+uint64_t TimerStorage::toTicks(float seconds) {
+    // Wheels cover 2^32 ticks, about 49 days
+    constexpr uint64_t MAX_TICKS = (uint64_t(1) << (LEVELS * SLOT_BITS)) - 1;
+    if (seconds <= 0.f) return 0;
+    const double ticks = std::ceil(static_cast<double>(seconds) * TICKS_PER_SECOND - 1e-6);
+    return std::min(static_cast<uint64_t>(ticks), MAX_TICKS);
 }
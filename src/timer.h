@@ -1,22 +1,96 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <functional>
 #include <optional>
 #include <vector>
 
 #include "error.h"
 
+using TimerCallback = std::function<std::optional<Error *> ()>;
+
 struct Timer {
     float time;
-    std::function<std::optional<Error *> ()> onTimer;
+    TimerCallback onTimer;
+};
+
+// Refers to a queued timer, stays safe to use after the timer fired or was cancelled
+struct TimerHandle {
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
 };
 
+/*!
+ * \brief Hierarchical timing wheel
+ *
+ * Time is counted in millisecond ticks. Timers due within 256 ticks sit in the slot of
+ * their tick, later ones in coarser wheels of 256 slots each and move down as their time
+ * comes. Adding and cancelling are O(1), an update only looks at the slots of the ticks it
+ * passes. Timers live in a recycled node pool, so updates without anything to fire never
+ * allocate. Callbacks may add and cancel timers, themselves included.
+ */
 class TimerStorage {
 public:
-    int queuedTimers() const { return _timers.size(); };
-    void addTimer(Timer& timer);
-    void addTimer(float time, std::function<std::optional<Error *> ()>& onTimer);
-    void addTimer(float time, std::function<std::optional<Error *> ()>&& onTimer);
+    static constexpr uint32_t TICKS_PER_SECOND = 1000;
+
+    TimerStorage() { _lists.fill(NO_NODE); };
+
+    int queuedTimers() const { return _queued; };
+    // Makes room for count timers, so adding them does not allocate
+    void reserve(size_t count);
+
+    TimerHandle addTimer(Timer& timer);
+    TimerHandle addTimer(float time, TimerCallback& onTimer);
+    TimerHandle addTimer(float time, TimerCallback&& onTimer);
+    // Fires every interval seconds until cancelled, the first time after one interval
+    TimerHandle addRepeatingTimer(float interval, TimerCallback&& onTimer);
+    // False if the timer already fired or was cancelled
+    bool cancelTimer(TimerHandle handle);
+    bool isQueued(TimerHandle handle) const;
+
+    // Fires every timer that ran out, in the order they ran out
     MaybeMultipleErrors update(float delta);
 private:
-    std::vector<Timer> _timers;
+    static constexpr uint32_t SLOT_BITS = 8;
+    static constexpr uint32_t SLOTS = 1 << SLOT_BITS;
+    static constexpr uint32_t LEVELS = 4;
+    // Timers due this tick, waiting for their callback
+    static constexpr uint32_t EXPIRED_LIST = LEVELS * SLOTS;
+    static constexpr uint32_t NO_LIST = UINT32_MAX;
+    static constexpr uint32_t NO_NODE = UINT32_MAX;
+
+    struct Node {
+        TimerCallback callback;
+        uint64_t due;
+        // Ticks between repeats, 0 for one-shot timers
+        uint64_t interval;
+        uint32_t generation = 0;
+        uint32_t previous = NO_NODE;
+        uint32_t next = NO_NODE;
+        uint32_t list = NO_LIST;
+        // Set while the callback runs, cleared if the callback cancels its own timer
+        bool firing = false;
+    };
+
+    TimerHandle add(uint64_t delay, uint64_t interval, TimerCallback&& callback);
+    uint32_t allocateNode();
+    void freeNode(uint32_t index);
+    // Puts the node into the slot its due tick falls into
+    void schedule(uint32_t index);
+    void link(uint32_t index, uint32_t list);
+    void unlink(uint32_t index);
+    // Moves the timers of a coarse slot into finer ones once it comes up
+    void cascade(uint32_t level);
+    void fire(uint32_t index, std::vector<Error *>& errors);
+    static uint64_t toTicks(float seconds);
+
+    std::vector<Node> _nodes;
+    uint32_t _freeNodes = NO_NODE;
+    // Heads of the slot lists of every wheel, then the expired list
+    std::array<uint32_t, LEVELS * SLOTS + 1> _lists;
+    uint64_t _now = 0;
+    // Time not yet worth a whole tick
+    double _remainder = 0.0;
+    int _queued = 0;
 };
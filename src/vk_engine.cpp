@@ -21,10 +21,13 @@
 #include <iostream>
 #include <fstream>
 #include <chrono>
+#include <algorithm>
+#include <cmath>
 
 #include "platform/gamepadconversion.h"
 #include "platform/gamepadman.h"
 #include "events/eventman.h"
+#include "random.h"
 
 #include "devicesingleton.h"
 #include "vk_initializers.h"
@@ -33,6 +36,9 @@
 #include "vmalloc.h"
 #include "vk_engine.h"
 #include "physics/physicsman.h"
+#include "physics/shapecooker.h"
+#include "profiling/profiler.h"
+#include "profiling/stats.h"
 
 constexpr bool bUseValidationLayers = true;
 
@@ -41,28 +47,62 @@ void glfwOnError(int errCode, const char *message) {
 }
 
 std::optional<Error*> VulkanEngine::init() {
+	ProfileMan.setThreadName("Main thread");
+
 	auto init_window = initWindow();
 
 	if (!init_window.has_value()) {
 		return new Error(init_window.error(), ErrorMessage("Unable to create window"));
 	}
 
+	// Render targets of the frame graph are sized after the render scale limits
+	_resolution.configure({
+		.targetFrameTime = _settings.targetFrameTime,
+		.minScale = _settings.minRenderScale,
+		.maxScale = _settings.maxRenderScale
+	});
+
 	auto init_vulkan = initVulkan()
 		.and_then([&](int x) { return initSwapchain(); })
-		.and_then([&](int x) { return initDefaultRenderpass(); })
 		.and_then([&](int x) { return initFramebuffers(); })
+		.and_then([&](int x) { return initResolution(); })
 		.and_then([&](int x) { return initCommands(); })
 		.and_then([&](int x) { return initSyncStructures(); })
 		.and_then([&](int x) { return initDescriptors(); })
 		.and_then([&](int x) { return initPipelines(); })
-		.and_then([&](int x) { return initFrames(); });
+		.and_then([&](int x) { return initCulling(); })
+		.and_then([&](int x) { return initShadows(); })
+		.and_then([&](int x) { return initLighting(); })
+		.and_then([&](int x) { return initParticles(); })
+		.and_then([&](int x) { return initFrames(); })
+		.and_then([&](int x) { return initDepthPyramid(); })
+		.and_then([&](int x) { return initStatsOverlay(); });
 
 	if (!init_vulkan.has_value()) {
 		return new Error(init_vulkan.error(), ErrorMessage("Vulkan structures initialization failed"));
 	}
 
+	// The scene draws random numbers while it is built, so the seed is settled before that
+	if (!_settings.inputReplayPath.empty()) {
+		auto replayResult = _inputReplay.open(_settings.inputReplayPath);
+		if (!replayResult.has_value())
+			return new Error(replayResult.error(), ErrorMessage("Could not load input log"));
+		RandomS.seed(replayResult.value());
+	} else if (!_settings.inputRecordPath.empty()) {
+		// Restarting the sequence makes the logged seed cover every number drawn from here on
+		RandomS.seed(RandomS.getSeed());
+		auto recordResult = _inputRecorder.open(_settings.inputRecordPath, RandomS.getSeed());
+		if (recordResult.has_value())
+			return new Error(recordResult.value(), ErrorMessage("Could not start input log"));
+	}
+
+	// Recorded deltas only reproduce the simulation when physics steps by a fixed amount
+	if (!_settings.inputReplayPath.empty() || !_settings.inputRecordPath.empty())
+		PhysicsMan.setFixedStep(PHYSICS_FIXED_STEP);
+
 	// Call smth from physicsman to init it before scene init
 	PhysicsMan.optimizeBroadphase();
+	ShapeCookerMan.setCacheDirectory(_settings.shapeCachePath);
 
 	auto init_scene = _scene->init(this);
 	
@@ -70,12 +110,31 @@ std::optional<Error*> VulkanEngine::init() {
 		return new Error(init_scene.error(), ErrorMessage("Scene initialization failed"));
 	}
 
+	if (!_settings.snapshotOutputPath.empty()) {
+		auto snapshotResult = _scene->saveSnapshot(_settings.snapshotOutputPath);
+		if (snapshotResult.has_value())
+			return new Error(snapshotResult.value(), ErrorMessage("Could not save scene snapshot"));
+	}
+
+	_scene->onRenderRemoved().connect<&VulkanEngine::forgetRenderObject>(*this);
+
 	// Everything went fine
 	_isInitialized = true;
 
 	// Optimize physics' broadphase after adding a bunch of bodies in scene.init
 	PhysicsMan.optimizeBroadphase();
 
+	auto init_systems = initSystems();
+	if (!init_systems.has_value()) {
+		return new Error(init_systems.error(), ErrorMessage("Update systems initialization failed"));
+	}
+
+	if (!_settings.statsOutputPath.empty()) {
+		auto dumpResult = StatsMan.openDump(_settings.statsOutputPath);
+		if (dumpResult.has_value())
+			return new Error(dumpResult.value(), ErrorMessage("Could not start stats dump"));
+	}
+
 	return std::nullopt;
 }
 
@@ -85,6 +144,7 @@ void VulkanEngine::cleanup() {
 	// Make sure the gpu has stopped doing its things
 	vkDeviceWaitIdle(DeviceRef());
 
+	_scene->onRenderRemoved().disconnect(*this);
 	_scene->flush();
 	_swapchainShutdown.flush();
 	_onEngineShutdown.flush();
@@ -97,6 +157,24 @@ void VulkanEngine::cleanup() {
 
 	//glfwDestroyWindow(_window->getWindowHandle());
 	//glfwTerminate();
+
+	auto inputLogResult = _inputRecorder.close();
+	if (inputLogResult) {
+		std::cerr << "Could not finish input log:\n" << inputLogResult.value()->what() << "\n";
+		delete inputLogResult.value();
+	}
+
+	StatsMan.closeDump();
+
+#ifdef ENGINE_PROFILING
+	if (!_settings.traceOutputPath.empty()) {
+		auto exportResult = ProfileMan.exportChromeTrace(_settings.traceOutputPath);
+		if (exportResult) {
+			std::cerr << "Could not export profiling trace:\n" << exportResult.value()->what() << "\n";
+			delete exportResult.value();
+		}
+	}
+#endif
 }
 
 std::optional<Error*> VulkanEngine::handleResize() {
@@ -114,23 +192,55 @@ std::optional<Error*> VulkanEngine::handleResize() {
 	_swapchainShutdown.flush();
 
 	auto resizeResult = initSwapchain()
-		.and_then([&](int x) { return initFramebuffers(); });
+		.and_then([&](int x) { return initFramebuffers(); })
+		.and_then([&](int x) { return initDepthPyramid(); });
 	
 	if (!resizeResult.has_value()) {
 		return new Error(resizeResult.error(), ErrorMessage("Failed to resize swapchain"));
 	}
 
+	_resolution.setTarget(_windowExtent, _sceneColorView);
+
 	return std::nullopt;
 }
 
 std::optional<Error*> VulkanEngine::draw() {
 	// TODO: check if window is minimized and skip drawing
 	
-	std::optional<VulkanError*> operationResult = thisFrame()._renderFence.wait(UINT64_MAX);
+	std::optional<VulkanError*> operationResult;
+	{
+		PROFILE_SCOPE("Wait for frame fence");
+		operationResult = thisFrame()._renderFence.wait(UINT64_MAX);
+	}
 	if (operationResult) {
 		return new VulkanError(operationResult.value()->getCode(), operationResult.value(), ErrorMessage("Error while waiting for previous frame to finish"));
 	}
 
+	// Queries of this frame are guaranteed to be finished after the fence
+	operationResult = thisFrame()._gpuTimer.collect();
+	if (operationResult) {
+		return new VulkanError(operationResult.value()->getCode(), operationResult.value(), ErrorMessage("Couldn't read GPU timestamps for previous frame"));
+	}
+	_resolution.update(thisFrame()._gpuTimer.lastFrameTime());
+	StatsMan.set(Profiling::Counter::RenderScale, static_cast<uint64_t>(std::round(_resolution.getScale() * 100.f)));
+
+	operationResult = _occlusionCuller.collectStats(thisFrame());
+	if (operationResult) {
+		return new VulkanError(operationResult.value()->getCode(), operationResult.value(), ErrorMessage("Couldn't read culling statistics for previous frame"));
+	}
+
+	// With the other frame done as well the GPU is idle and nothing reads geometry, a good time to compact it
+	if (_settings.defragmentBytesPerFrame > 0 && _frames[(_frameNumber + 1) % FRAME_OVERLAP]._renderFence.isSignaled()) {
+		PROFILE_SCOPE("Defragment");
+		auto defragResult = VMAlloc.defragmentStep(_settings.defragmentBytesPerFrame,
+			[this](std::function<void(VkCommandBuffer cmd)>&& record) { return immediate_submit(std::move(record)); },
+			[this](VmaAllocation allocation, VkBuffer buffer) { return _scene->relocateMeshBuffer(allocation, buffer); });
+		if (!defragResult) {
+			return new VulkanError(defragResult.error()->getCode(), defragResult.error(), ErrorMessage("Failed to defragment static geometry"));
+		}
+		StatsMan.add(Profiling::Counter::BytesDefragmented, defragResult.value());
+	}
+
 	operationResult = thisFrame()._renderFence.reset();
 	if (operationResult) {
 		return new VulkanError(operationResult.value()->getCode(), operationResult.value(), ErrorMessage("Couldn't reset fence for previous frame"));
@@ -142,7 +252,11 @@ std::optional<Error*> VulkanEngine::draw() {
 	}
 
 	// request image from the swapchain
-	auto acquireResult = vkcommand::acquireNextImage(_swapchain, thisFrame()._presentSemaphore);
+	tl::expected<uint32_t, VulkanError*> acquireResult;
+	{
+		PROFILE_SCOPE("Acquire swapchain image");
+		acquireResult = vkcommand::acquireNextImage(_swapchain, thisFrame()._presentSemaphore);
+	}
 	if (!acquireResult) {
 		if (acquireResult.error()->isResizeError()) {
 			auto resizeResult = handleResize();
@@ -153,6 +267,11 @@ std::optional<Error*> VulkanEngine::draw() {
 	}
 	uint32_t swapchainImageIndex = acquireResult.value();
 
+	// Input that came in while waiting for the fence and the swapchain still reaches this frame's camera
+	latchInput();
+
+	_statsOverlay.buildFrame();
+
 	// naming it cmd for shorter writing
 	VkCommandBuffer cmd = thisFrame()._mainCommandBuffer;
 
@@ -164,34 +283,26 @@ std::optional<Error*> VulkanEngine::draw() {
 		return new VulkanError(operationResult.value()->getCode(), operationResult.value(), ErrorMessage("Error while trying to begin command buffer"));
 	}
 
-	VkClearValue clearValue;
-	// can use a changing color here
-	float flash = std::abs(sin(_frameNumber / 120.f));
-	clearValue.color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
-
-	// Clear depth at 1
-	VkClearValue depthClear;
-	depthClear.depthStencil.depth = 1.f;
-
-	// Start the main renderpass. 
-	// We will use the clear color from above, and the framebuffer of the index the swapchain gave us
-	VkRenderPassBeginInfo rpInfo = vkinit::renderpass_begin_info(_renderPass, _windowExtent, _framebuffers[swapchainImageIndex]);
+	thisFrame()._gpuTimer.reset(cmd);
+	// The first zone always spans the whole frame, its duration is what lastFrameTime() reports
+	uint32_t frameZone = thisFrame()._gpuTimer.begin(cmd, "GPU frame");
 
-	// connect clear values
-	rpInfo.clearValueCount = 2;
-
-	VkClearValue clearValues[] = { clearValue, depthClear };
-
-	rpInfo.pClearValues = &clearValues[0];
-	
-	vkCmdBeginRenderPass(cmd, &rpInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-	auto drawResult  = draw_objects(cmd);	
-	if (drawResult) {
-		new VulkanError(drawResult.value()->getCode(), drawResult.value(), ErrorMessage("Failed to draw objects"));
+	auto uploadResult = upload_frame_data();
+	if (!uploadResult) {
+		return new VulkanError(uploadResult.error()->getCode(), uploadResult.error(), ErrorMessage("Failed to upload frame data"));
+	}
+	_frameObjectCount = uploadResult.value();
+
+	// Every pass gets its own GPU zone, barriers between them come from the graph
+	_passError.reset();
+	_frameGraph.execute(cmd, swapchainImageIndex, thisFrame()._gpuTimer);
+	if (_passError) {
+		VulkanError* passError = _passError.value();
+		_passError.reset();
+		return new VulkanError(passError->getCode(), passError, ErrorMessage("Failed to draw objects"));
 	}
 
-	vkCmdEndRenderPass(cmd);
+	thisFrame()._gpuTimer.end(cmd, frameZone);
 	// finalize the command buffer (we can no longer add commands, but it can now be executed)
 	operationResult = vkcommand::endCommandBuffer(cmd);
 	if (operationResult) {
@@ -215,6 +326,7 @@ std::optional<Error*> VulkanEngine::draw() {
 
 	// submit command buffer to the queue and execute it.
 	// _renderFence will now block until the graphic commands finish execution
+	thisFrame()._gpuTimer.markSubmit();
 	operationResult = vkcommand::singleQueueSubmit(_graphicsQueue, submit, thisFrame()._renderFence());
 	if (operationResult) {
 		return new VulkanError(operationResult.value()->getCode(), operationResult.value(), ErrorMessage("Failed to submit command buffer to graphics queue"));
@@ -234,7 +346,14 @@ std::optional<Error*> VulkanEngine::draw() {
 
 	presentInfo.pImageIndices = &swapchainImageIndex;
 
-	operationResult = vkcommand::queuePresent(_graphicsQueue, presentInfo);
+	{
+		PROFILE_SCOPE("Present");
+		operationResult = vkcommand::queuePresent(_graphicsQueue, presentInfo);
+	}
+	StatsMan.set(Profiling::Counter::InputLatency, _shownInputTime
+		? std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - *_shownInputTime).count()
+		: 0);
+	_shownInputTime.reset();
 	if (operationResult) {
 		if (operationResult.value()->isResizeError()) {
 			auto resizeResult = handleResize();
@@ -256,37 +375,83 @@ std::optional<Error*> VulkanEngine::run() {
 	//main loop
 	while (!shouldClose) {
 		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
-		const float deltaSeconds = std::chrono::duration_cast<std::chrono::microseconds>(now - lastTime).count() * 1e-6;
-		_time = std::chrono::duration_cast<std::chrono::microseconds>(now - _start_time).count() * 1e-6;
+		float deltaSeconds = std::chrono::duration_cast<std::chrono::microseconds>(now - lastTime).count() * 1e-6;
+		if (!_settings.inputReplayPath.empty()) {
+			// Recorded frames stand in for both the clock and live input, frames run back to back
+			std::optional<float> replayedDelta = _inputReplay.nextFrame();
+			if (!replayedDelta) break;
+			deltaSeconds = replayedDelta.value();
+			_time += deltaSeconds;
+		} else {
+			_time = std::chrono::duration_cast<std::chrono::microseconds>(now - _start_time).count() * 1e-6;
+		}
+		_frameDelta = deltaSeconds;
+
+		PROFILE_FRAME();
 
-		// Update physics' objects
-		PhysicsMan.update(deltaSeconds);
-		for (auto &&[entity, body]: _scene->getRigidBodies().each()) {
-			body.update(deltaSeconds);
+		if (_inputRecorder.isOpen()) {
+			auto recordResult = _inputRecorder.recordFrame(deltaSeconds);
+			if (recordResult) {
+				return new Error(recordResult.value(), ErrorMessage("Could not log frame input"));
+			}
 		}
-		for (auto &&[entity, character]: _scene->getCharacters().each()) {
-			character.update(deltaSeconds);
+		{
+			// Input polled at the end of the last frame reaches its callbacks before anything updates
+			PROFILE_SCOPE("Dispatch input");
+			// Mouse moves from before the last late latch were already on screen
+			_shownInputTime = EventMan.oldestQueuedTime(Events::kSourceMouse2DAxis, _latchedInputTime);
+			EventMan.dispatchEvents();
 		}
-		for (auto &&[entity, collision]: _scene->getCollisions().each()) {
-			collision.update(deltaSeconds);
+
+		auto updateResult = _systems.run(deltaSeconds);
+		if (updateResult) {
+			return new Error(updateResult.value(), ErrorMessage("Frame update failed"));
+		}
+		if (_frameNumber == 0 && !_settings.scheduleDumpPath.empty()) {
+			auto dumpResult = _systems.dump(_settings.scheduleDumpPath);
+			if (dumpResult) {
+				return new Error(dumpResult.value(), ErrorMessage("Could not dump update schedule"));
+			}
 		}
 
-		_scene->update(deltaSeconds);
+		sampleStats();
 
 		auto drawResult = draw();
 		if (drawResult) {
 			return new Error(drawResult.value(), ErrorMessage("Frame draw failed"));
 		}
 
-		glfwPollEvents();
+		{
+			PROFILE_SCOPE("Poll events");
+			glfwPollEvents();
+			GamepadMan.pollGamepadEvents();
+		}
 		if (glfwWindowShouldClose(_window->getWindowHandle()))
 			shouldClose = true;
+		if (_settings.maxFrames != 0 && static_cast<uint64_t>(_frameNumber) >= _settings.maxFrames)
+			shouldClose = true;
 		lastTime = now;
+
+		// GPU time lags behind by FRAME_OVERLAP frames, it is read back only after the frame fence
+		StatsMan.endFrame(deltaSeconds * 1000.f, thisFrame()._gpuTimer.lastFrameTime());
 	}
 
 	return std::nullopt;
 }
 
+void VulkanEngine::latchInput() {
+	// Replays only ever see recorded input
+	if (!_settings.inputReplayPath.empty()) return;
+
+	PROFILE_SCOPE("Late input latch");
+	glfwPollEvents();
+	GamepadMan.pollGamepadEvents();
+	// Inputs stay queued for the next frame's dispatch, cameras only look ahead at them in upload_frame_data
+	if (!_shownInputTime)
+		_shownInputTime = EventMan.oldestQueuedTime(Events::kSourceMouse2DAxis, _latchedInputTime);
+	_latchedInputTime = std::chrono::steady_clock::now();
+}
+
 Frame& VulkanEngine::thisFrame() {
 	return _frames[_frameNumber % FRAME_OVERLAP];
 }
@@ -337,7 +502,7 @@ tl::expected<int, Error*> VulkanEngine::initVulkan() {
 	auto inst_ret = builder.set_app_name("Example Vulkan Application")
 		.request_validation_layers(bUseValidationLayers)
 		.use_default_debug_messenger()
-		.require_api_version(1, 1, 0)
+		.require_api_version(1, 2, 0)
 		.build();
 	if (!inst_ret.has_value()) {
 		return tl::unexpected(new VulkanError(inst_ret.vk_result(), ErrorMessage("Failed to build a VulkanInstance, error: {}", inst_ret.error().message())));
@@ -354,8 +519,12 @@ tl::expected<int, Error*> VulkanEngine::initVulkan() {
 	// We want a gpu that can write to the GLFW surface and supports vulkan 1.2
 	vkb::PhysicalDeviceSelector selector{ vkb_inst };
 	auto physicalDeviceResult = selector
-		.set_minimum_version(1, 1)
+		.set_minimum_version(1, 2)
 		.set_surface(_surface)
+		// Culling shader passes object indices to draws through firstInstance
+		.set_required_features(VkPhysicalDeviceFeatures{ .drawIndirectFirstInstance = VK_TRUE })
+		// and the number of draws that survived through the batch counts
+		.set_required_features_12(VkPhysicalDeviceVulkan12Features{ .drawIndirectCount = VK_TRUE })
 		.select();
 	if (!physicalDeviceResult.has_value()) {
 		return tl::unexpected(new Error(ErrorMessage(physicalDeviceResult.error().message())));
@@ -402,7 +571,10 @@ tl::expected<int, Error*> VulkanEngine::initVulkan() {
 		.instance = _instance
 	};
 
-	VMAlloc.create(allocatorInfo);
+	auto allocatorResult = VMAlloc.create(allocatorInfo);
+	if (allocatorResult) {
+		return tl::unexpected(new Error(allocatorResult.value(), ErrorMessage("Failed to create memory allocator and pools")));
+	}
 
 	_onEngineShutdown.push_function([&]() {
 		VMAlloc.destroy();
@@ -447,159 +619,134 @@ tl::expected<int, Error*> VulkanEngine::initSwapchain() {
 		vkDestroySwapchainKHR(DeviceRef(), _swapchain, nullptr);
 	});
 
-	//depth image size will match the window
-	VkExtent3D depthImageExtent = {
-		_windowExtent.width,
-		_windowExtent.height,
-		1
-	};
-
 	//hardcoding the depth format to 32 bit float
 	_depthFormat = VK_FORMAT_D32_SFLOAT;
 
-	//the depth image will be a image with the format we selected and Depth Attachment usage flag
-	VkImageCreateInfo dimg_info = vkinit::createinfo::image(_depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, depthImageExtent);
-
-	//for the depth image, we want to allocate it from gpu local memory
-	auto depthResult = VMAlloc.createImage(VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT), VMA_MEMORY_USAGE_GPU_ONLY, dimg_info);
-	VK_UNEXPECTED_ERROR(depthResult, "Unable to create depth image");
-	_depthImage = depthResult.value();
-
-	//build a image-view for the depth image to use for rendering
-	VkImageViewCreateInfo dview_info = vkinit::createinfo::imageView(_depthFormat, _depthImage._image, VK_IMAGE_ASPECT_DEPTH_BIT);
-
-	auto viewResult = vkcommand::createImageView(dview_info);
-	VK_UNEXPECTED_ERROR(viewResult, "Failed to create depth image view");
-	_depthImageView = viewResult.value();
-
-	//add to deletion queues
-	_swapchainShutdown.push_function([=]() {
-		vkDestroyImageView(DeviceRef(), _depthImageView, nullptr);
-		_depthImage.destroy();
-	});
-
 	return 0;
 }
 
-tl::expected<int, Error*> VulkanEngine::initDefaultRenderpass() {
-	// we define an attachment description for our main color image
-	// the attachment is loaded as "clear" when renderpass start
-	// the attachment is stored when renderpass ends
-	// the attachment layout starts as "undefined", and transitions to "Present" so its possible to display it
-	// we dont care about stencil, and dont use multisampling
-
-	VkAttachmentDescription color_attachment = {
-		.format = _swachainImageFormat,
-		.samples = VK_SAMPLE_COUNT_1_BIT,
-		.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-		.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
-		.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-		.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-		.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-		.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
-	};
-
-	VkAttachmentReference color_attachment_ref = {
-		.attachment = 0,
-		.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
-	};
-
-	VkAttachmentDescription depth_attachment = {
-		.flags = 0,
-		.format = _depthFormat,
-		.samples = VK_SAMPLE_COUNT_1_BIT,
-		.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-		.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
-		.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-		.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-		.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-		.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
-	};
-
-	VkAttachmentReference depth_attachment_ref = {
-		.attachment = 1,
-		.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
-	};
-
-	//we are going to create 1 subpass, which is the minimum you can do
-	VkSubpassDescription subpass = {
-		.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
-		.colorAttachmentCount = 1,
-		.pColorAttachments = &color_attachment_ref,
-		.pDepthStencilAttachment = &depth_attachment_ref
-	};
-
-	// dependency, which is from "outside" into the subpass. And we can read or write color
-	VkSubpassDependency dependency = {
-		.srcSubpass = VK_SUBPASS_EXTERNAL,
-		.dstSubpass = 0,
-		.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-		.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-		.srcAccessMask = 0,
-		.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
-	};
+tl::expected<int, Error*> VulkanEngine::initResolution() {
+	auto shaderResult = load_shader_module("../shaders/bin/upscale.vert.spv");
+	if (!shaderResult) {
+		return tl::unexpected(new Error(shaderResult.error(), ErrorMessage("Error when building the upscale vertex shader")));
+	}
+	VkShaderModule vertexShader = shaderResult.value();
 
-	//dependency from outside to the subpass, making this subpass dependent on the previous renderpasses
-	VkSubpassDependency depth_dependency = {
-		.srcSubpass = VK_SUBPASS_EXTERNAL,
-		.dstSubpass = 0,
-		.srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
-		.dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
-		.srcAccessMask = 0,
-		.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
-	};
+	shaderResult = load_shader_module("../shaders/bin/upscale.frag.spv");
+	if (!shaderResult) {
+		vkDestroyShaderModule(DeviceRef(), vertexShader, nullptr);
+		return tl::unexpected(new Error(shaderResult.error(), ErrorMessage("Error when building the upscale fragment shader")));
+	}
+	VkShaderModule fragmentShader = shaderResult.value();
 
-	//array of 2 dependencies, one for color, two for depth
-	VkSubpassDependency dependencies[2] = { dependency, depth_dependency };
+	auto resolutionResult = _resolution.init(vertexShader, fragmentShader, _presentRenderPass);
 
-	//array of 2 attachments, one for the color, and other for depth
-	VkAttachmentDescription attachments[2] = { color_attachment,depth_attachment };
+	vkDestroyShaderModule(DeviceRef(), fragmentShader, nullptr);
+	vkDestroyShaderModule(DeviceRef(), vertexShader, nullptr);
 
-	VkRenderPassCreateInfo render_pass_info = {
-		.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
-		.attachmentCount = 2,
-		.pAttachments = &attachments[0],
-		.subpassCount = 1,
-		.pSubpasses = &subpass,
-		.dependencyCount = 2,
-		.pDependencies = &dependencies[0]
-	};
-	
-	auto passResult = vkcommand::createRenderPass(render_pass_info);
-	VK_UNEXPECTED_ERROR(passResult, "Failed to create default render pass");
-	_renderPass = passResult.value();
+	VK_UNEXPECTED_ERROR(resolutionResult, "Could not create upscale pipeline");
+	_onEngineShutdown.push_function(resolutionResult.value());
 
-	_onEngineShutdown.push_function([=]() {
-		vkDestroyRenderPass(DeviceRef(), _renderPass, nullptr);
-	});
+	_resolution.setTarget(_windowExtent, _sceneColorView);
 
 	return 0;
 }
 
 tl::expected<int, Error*> VulkanEngine::initFramebuffers() {
-	//create the framebuffers for the swapchain images. This will connect the render-pass to the images for rendering
-	VkFramebufferCreateInfo fb_info = vkinit::createinfo::framebuffer(_renderPass, _windowExtent);
-
-	const uint32_t swapchain_imagecount = _swapchainImages.size();
-	_framebuffers = std::vector<VkFramebuffer>(swapchain_imagecount);
+	// Scene targets are big enough for the largest render scale, smaller scales render into a corner
+	_renderTargetExtent = _resolution.getTargetExtent(_windowExtent);
 
-	for (int i = 0; i < swapchain_imagecount; i++) {
-
-		VkImageView attachments[2];
-		attachments[0] = _swapchainImageViews[i];
-		attachments[1] = _depthImageView;
+	// Graph framebuffers reference the swapchain views, so these go after the graph is destroyed
+	_swapchainShutdown.push_function([=]() {
+		for (VkImageView view : _swapchainImageViews)
+			vkDestroyImageView(DeviceRef(), view, nullptr);
+	});
 
-		fb_info.pAttachments = attachments;
-		fb_info.attachmentCount = 2;
-		auto framebufferResult = vkcommand::createFramebuffer(fb_info);
-		VK_UNEXPECTED_ERROR(framebufferResult, "Failed to create framebuffer for a swapchain image {}", i);
-		_framebuffers[i] = framebufferResult.value();
+	_frameGraph.reset();
+	const Graph::ResourceId sceneColor = _frameGraph.createImage("Scene color", _swachainImageFormat, _renderTargetExtent);
+	// Depth is also sampled when building the depth pyramid
+	const Graph::ResourceId sceneDepth = _frameGraph.createImage("Scene depth", _depthFormat, _renderTargetExtent);
+	const Graph::ResourceId swapchain = _frameGraph.importImage("Swapchain", _swachainImageFormat, _windowExtent,
+		_swapchainImages, _swapchainImageViews, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+	// Only the part of the scene targets covered by the current render scale is touched
+	auto renderExtent = [this]() { return _resolution.getRenderExtent(); };
+	auto drawScene = [this](VkCommandBuffer cmd, VkBuffer drawBuffer, uint32_t countOffset) {
+		auto drawResult = draw_objects(cmd, drawBuffer, countOffset);
+		if (!drawResult) return;
+		// Passes can't return errors, later ones of the same frame add nothing
+		if (_passError)
+			delete drawResult.value();
+		else
+			_passError = drawResult;
+	};
 
-		_swapchainShutdown.push_function([=]() {
-			vkDestroyFramebuffer(DeviceRef(), _framebuffers[i], nullptr);
-			vkDestroyImageView(DeviceRef(), _swapchainImageViews[i], nullptr);
-		});
-	}
+	_frameGraph.addPass("Shadows", [this](VkCommandBuffer cmd) {
+		_shadows.record(cmd, thisFrame().objectDescriptor);
+	}).sideEffects();
+
+	_frameGraph.addPass("Light culling", [this](VkCommandBuffer cmd) {
+		_clusteredLights.build(cmd, thisFrame());
+	}).sideEffects();
+
+	_frameGraph.addPass("Early cull", [this](VkCommandBuffer cmd) {
+		_depthPyramid.prepare(cmd);
+		_occlusionCuller.cullEarly(cmd, thisFrame(), _frameObjectCount);
+	}).sideEffects();
+
+	// Collides against last frame's depth pyramid, same as the early cull
+	_frameGraph.addPass("Particles", [this](VkCommandBuffer cmd) {
+		_particles.simulate(cmd, _frameNumber % FRAME_OVERLAP);
+	}).sideEffects();
+
+	// Clears the scene targets and draws whatever was visible last frame
+	const Graph::PassId earlyPass = _frameGraph.addPass("Early pass", [this, drawScene](VkCommandBuffer cmd) {
+		drawScene(cmd, thisFrame().earlyDrawBuffer._buffer, offsetof(GPUDrawBatch, earlyCount));
+	})
+		.color(sceneColor, VkClearColorValue{ { 0.0f, 0.0f, 0.0f, 1.0f } })
+		.depth(sceneDepth, 1.f)
+		.renderArea(renderExtent)
+		.id();
+
+	_frameGraph.addPass("Depth pyramid", [this](VkCommandBuffer cmd) {
+		_depthPyramid.build(cmd, _resolution.getRenderExtent());
+		_pyramidViewproj = _cullViewproj;
+	})
+		.sampled(sceneDepth, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT)
+		.sideEffects();
+
+	_frameGraph.addPass("Late cull", [this](VkCommandBuffer cmd) {
+		_occlusionCuller.cullLate(cmd, thisFrame(), _frameObjectCount);
+	}).sideEffects();
+
+	// Keeps the early pass results and adds objects that were disoccluded this frame
+	const Graph::PassId latePass = _frameGraph.addPass("Late pass", [this, drawScene](VkCommandBuffer cmd) {
+		drawScene(cmd, thisFrame().lateDrawBuffer._buffer, offsetof(GPUDrawBatch, lateCount));
+		_particles.draw(cmd, _resolution.getRenderExtent(), thisFrame().globalDescriptor, pad_uniform_buffer_size(sizeof(GPUSceneData)) * (_frameNumber % FRAME_OVERLAP));
+	})
+		.color(sceneColor)
+		.depth(sceneDepth)
+		.renderArea(renderExtent)
+		.id();
+
+	// The upscale overwrites the whole swapchain image, nothing to clear
+	const Graph::PassId presentPass = _frameGraph.addPass("Upscale", [this](VkCommandBuffer cmd) {
+		_resolution.upscale(cmd, _windowExtent);
+		_statsOverlay.record(cmd);
+	})
+		.sampled(sceneColor, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT)
+		.color(swapchain)
+		.id();
+
+	auto compileResult = _frameGraph.compile();
+	VK_UNEXPECTED_ERROR(compileResult, "Failed to compile frame graph");
+	_swapchainShutdown.push_function(compileResult.value());
+
+	_earlyRenderPass = _frameGraph.getRenderPass(earlyPass);
+	_renderPass = _frameGraph.getRenderPass(latePass);
+	_presentRenderPass = _frameGraph.getRenderPass(presentPass);
+	_sceneColorView = _frameGraph.getView(sceneColor);
+	_depthImageView = _frameGraph.getView(sceneDepth);
 
 	return 0;
 }
@@ -777,6 +924,102 @@ tl::expected<int, Error*> VulkanEngine::initPipelines() {
 	return 0;
 }
 
+tl::expected<int, Error*> VulkanEngine::initCulling() {
+	auto shaderResult = load_shader_module("../shaders/bin/depth_reduce.comp.spv");
+	if (!shaderResult) {
+		return tl::unexpected(new Error(shaderResult.error(), ErrorMessage("Error when building the depth reduction shader")));
+	}
+	VkShaderModule reduceShader = shaderResult.value();
+
+	shaderResult = load_shader_module("../shaders/bin/occlusion_cull.comp.spv");
+	if (!shaderResult) {
+		vkDestroyShaderModule(DeviceRef(), reduceShader, nullptr);
+		return tl::unexpected(new Error(shaderResult.error(), ErrorMessage("Error when building the occlusion culling shader")));
+	}
+	VkShaderModule cullShader = shaderResult.value();
+
+	auto pyramidResult = _depthPyramid.init(reduceShader);
+	auto cullerResult = _occlusionCuller.init(cullShader);
+
+	vkDestroyShaderModule(DeviceRef(), reduceShader, nullptr);
+	vkDestroyShaderModule(DeviceRef(), cullShader, nullptr);
+
+	VK_UNEXPECTED_ERROR(pyramidResult, "Could not create depth pyramid pipeline");
+	_onEngineShutdown.push_function(pyramidResult.value());
+	VK_UNEXPECTED_ERROR(cullerResult, "Could not create occlusion culling pipeline");
+	_onEngineShutdown.push_function(cullerResult.value());
+
+	return 0;
+}
+
+tl::expected<int, Error*> VulkanEngine::initShadows() {
+	auto shaderResult = load_shader_module("../shaders/bin/shadow.vert.spv");
+	if (!shaderResult) {
+		return tl::unexpected(new Error(shaderResult.error(), ErrorMessage("Error when building the shadow vertex shader")));
+	}
+	VkShaderModule shadowShader = shaderResult.value();
+
+	auto shadowResult = _shadows.init(shadowShader, _objectSetLayout);
+
+	vkDestroyShaderModule(DeviceRef(), shadowShader, nullptr);
+
+	VK_UNEXPECTED_ERROR(shadowResult, "Could not create cascaded shadow maps");
+	_onEngineShutdown.push_function(shadowResult.value());
+
+	return 0;
+}
+
+tl::expected<int, Error*> VulkanEngine::initLighting() {
+	auto shaderResult = load_shader_module("../shaders/bin/light_cull.comp.spv");
+	if (!shaderResult) {
+		return tl::unexpected(new Error(shaderResult.error(), ErrorMessage("Error when building the light culling shader")));
+	}
+	VkShaderModule cullShader = shaderResult.value();
+
+	auto lightsResult = _clusteredLights.init(cullShader);
+
+	vkDestroyShaderModule(DeviceRef(), cullShader, nullptr);
+
+	VK_UNEXPECTED_ERROR(lightsResult, "Could not create light culling pipeline");
+	_onEngineShutdown.push_function(lightsResult.value());
+
+	return 0;
+}
+
+tl::expected<int, Error*> VulkanEngine::initParticles() {
+	if (_settings.particleCapacity == 0)
+		return 0;
+
+	const char* shaderPaths[] = {
+		"../shaders/bin/particle_simulate.comp.spv",
+		"../shaders/bin/particle_emit.comp.spv",
+		"../shaders/bin/particle_finalize.comp.spv",
+		"../shaders/bin/particle.vert.spv",
+		"../shaders/bin/particle.frag.spv"
+	};
+	VkShaderModule modules[std::size(shaderPaths)];
+	for (size_t i = 0; i < std::size(shaderPaths); i++) {
+		auto shaderResult = load_shader_module(shaderPaths[i]);
+		if (!shaderResult) {
+			for (size_t loaded = 0; loaded < i; loaded++)
+				vkDestroyShaderModule(DeviceRef(), modules[loaded], nullptr);
+			return tl::unexpected(new Error(shaderResult.error(), ErrorMessage("Error when building particle shader {}", shaderPaths[i])));
+		}
+		modules[i] = shaderResult.value();
+	}
+
+	const Particles::Shaders shaders = { modules[0], modules[1], modules[2], modules[3], modules[4] };
+	auto particlesResult = _particles.init(_settings.particleCapacity, shaders, _renderPass, _globalSetLayout);
+
+	for (VkShaderModule module: modules)
+		vkDestroyShaderModule(DeviceRef(), module, nullptr);
+
+	VK_UNEXPECTED_ERROR(particlesResult, "Could not create particle system");
+	_onEngineShutdown.push_function(particlesResult.value());
+
+	return 0;
+}
+
 tl::expected<VkShaderModule, Error*> VulkanEngine::load_shader_module(const char* filePath) {
 	// Open the file with cursor at the end
 	std::ifstream file(filePath, std::ios::ate | std::ios::binary);
@@ -805,9 +1048,15 @@ tl::expected<VkShaderModule, Error*> VulkanEngine::load_shader_module(const char
 }
 
 tl::expected<int, VulkanError*> VulkanEngine::upload_mesh(Mesh& mesh) {
-	const size_t bufferSize = mesh._vertices.size() * sizeof(Vertex);
+	// Culling shader needs a bounding sphere for every mesh
+	mesh.computeBounds();
+	if (mesh._lods.empty())
+		mesh.generateLods();
+
+	const size_t lodOffset = mesh._vertices.size() * sizeof(Vertex);
+	const size_t bufferSize = lodOffset + mesh._lodVertices.size() * sizeof(Vertex);
 	// allocate vertex buffer
-	auto allocResult = VMAlloc.createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+	auto allocResult = VMAlloc.createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY, MemoryPool::FrameUploads);
 	VK_UNEXPECTED_ERROR(allocResult, "Could not create staging buffer")
 	AllocatedBuffer stagingBuffer = allocResult.value();
 
@@ -816,12 +1065,14 @@ tl::expected<int, VulkanError*> VulkanEngine::upload_mesh(Mesh& mesh) {
 	VK_UNEXPECTED_ERROR(mapResult, "Failed to map staging buffer");
 	void* data = mapResult.value();
 
-	memcpy(data, mesh._vertices.data(), mesh._vertices.size() * sizeof(Vertex));
+	memcpy(data, mesh._vertices.data(), lodOffset);
+	memcpy(static_cast<char*>(data) + lodOffset, mesh._lodVertices.data(), bufferSize - lodOffset);
+	StatsMan.add(Profiling::Counter::BytesUploaded, bufferSize);
 
 	VMAlloc.unmapBuffer(stagingBuffer);
 
 	// allocate vertex buffer
-	auto allocResult2 = VMAlloc.createBuffer(bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+	auto allocResult2 = VMAlloc.createBuffer(bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY, MemoryPool::StaticGeometry);
 	VK_UNEXPECTED_ERROR(allocResult2, "Could not create vertex buffer on GPU")
 	mesh._vertexBuffer = allocResult2.value();
 
@@ -842,14 +1093,64 @@ tl::expected<int, VulkanError*> VulkanEngine::upload_mesh(Mesh& mesh) {
 	return 0;
 }
 
-std::optional<VulkanError*> VulkanEngine::draw_objects(VkCommandBuffer cmd) {
+tl::expected<uint32_t, VulkanError*> VulkanEngine::upload_frame_data() {
+	PROFILE_SCOPE("Upload frame data");
+	{
+		PROFILE_SCOPE("Compose transforms");
+		_scene->composeTransforms();
+	}
 	float framed = (_frameNumber / 120.f);
 
+	// Culling is done for the first render target camera
+	_cullViewproj = glm::mat4(1.f);
+	// Pixels covered by one unit at distance 1, 0 keeps every object at full detail
+	float lodScale = 0.f;
+	// The first light target camera is the sun, it looks along the light direction
+	std::optional<glm::vec3> sunDirection;
+	std::optional<GPUCameraData> renderCamera;
+	tl::expected<void*, VulkanError*> mapResult;
+	for (auto &&[camEntity, camera]: _scene->getCameras().each()) {
+		if (camera.getPurpose() == CameraPurpose::LightTarget && !sunDirection)
+			sunDirection = camera.getRotation();
+		if (camera.getPurpose() != CameraPurpose::RenderTarget || renderCamera)
+			continue;
+
+		// Culling, shadows and drawing all use the late latched view
+		const GPUCameraData cameraData = camera.latched();
+		renderCamera = cameraData;
+		mapResult = VMAlloc.mapBuffer(thisFrame().cameraBuffer);
+		VK_UNEXPECTED_ERROR(mapResult, "Could not map camera buffer");
+
+		memcpy(mapResult.value(), &cameraData, sizeof(GPUCameraData));
+		StatsMan.add(Profiling::Counter::BytesUploaded, sizeof(GPUCameraData));
+
+		VMAlloc.unmapBuffer(thisFrame().cameraBuffer);
+
+		_cullViewproj = cameraData.viewproj;
+		// Projection is flipped on Y for Vulkan, only the magnitude matters here
+		lodScale = std::abs(cameraData.proj[1][1]) * 0.5f * camera.getViewport().y * _resolution.getViewportScale().y;
+	}
+
+	if (renderCamera && sunDirection)
+		_shadows.update(*renderCamera, *sunDirection);
+	else
+		_shadows.disable();
+
 	//_sceneParameters.ambientColor = { sin(framed),0,cos(framed),1 };
-	_sceneParameters.ambientColor = { 0,0,0,1 };
+	if (_shadows.isEnabled()) {
+		_sceneParameters.ambientColor = { 0.35f,0.35f,0.35f,1 };
+		_sceneParameters.sunlightColor = { 1,1,1,1 };
+		_sceneParameters.sunlightDirection = glm::vec4(glm::normalize(*sunDirection), 0.65f);
+	} else {
+		// Without a sun everything stays unlit
+		_sceneParameters.ambientColor = { 1,1,1,1 };
+		_sceneParameters.sunlightDirection = { 0,-1,0,0 };
+	}
+	if (auto ambient = _scene->getAmbientLight())
+		_sceneParameters.ambientColor = glm::vec4(*ambient, 1.f);
 	
-	auto mapResult = VMAlloc.mapBuffer(_sceneParameterBuffer);
-	VK_OPTIONAL_ERROR(mapResult, "Could not map scene data buffer");
+	mapResult = VMAlloc.mapBuffer(_sceneParameterBuffer);
+	VK_UNEXPECTED_ERROR(mapResult, "Could not map scene data buffer");
 	char* sceneData = (char*)mapResult.value();
 
 	int frameIndex = _frameNumber % FRAME_OVERLAP;
@@ -857,46 +1158,207 @@ std::optional<VulkanError*> VulkanEngine::draw_objects(VkCommandBuffer cmd) {
 	sceneData += pad_uniform_buffer_size(sizeof(GPUSceneData)) * frameIndex;
 
 	memcpy(sceneData, &_sceneParameters, sizeof(GPUSceneData));
+	StatsMan.add(Profiling::Counter::BytesUploaded, sizeof(GPUSceneData));
 
 	VMAlloc.unmapBuffer(_sceneParameterBuffer);
-	
+
 	mapResult = VMAlloc.mapBuffer(thisFrame().objectBuffer);
-	VK_OPTIONAL_ERROR(mapResult, "Could not map object buffer");
+	VK_UNEXPECTED_ERROR(mapResult, "Could not map object buffer");
 	
 	GPUObjectData* objectSSBO = (GPUObjectData*)mapResult.value();
 
+	mapResult = VMAlloc.mapBuffer(thisFrame().cullBuffer);
+	VK_UNEXPECTED_ERROR(mapResult, "Could not map culling buffer");
+
+	GPUCullData* cullSSBO = (GPUCullData*)mapResult.value();
+
+	_drawBatches.clear();
+	_batchIndices.clear();
 	int counter = 0;
 	for (auto &&[entity, object, transform]: _scene->getSimpleRenders().each()) {
 		Object renderObject = _scene->getObject(entity);
-		objectSSBO[counter].modelMatrix = transform.getMatrix();
+		glm::mat4 model = transform.getMatrix();
+		objectSSBO[counter].modelMatrix = model;
+
+		// Screen size of the object decides its LOD
+		uint32_t lod = 0;
+		if (lodScale > 0.f && !object.mesh->_lods.empty()) {
+			float scale = std::max({ glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])) });
+			float distance = (_cullViewproj * model * glm::vec4(object.mesh->_boundsCenter, 1.f)).w;
+			if (distance > 0.f)
+				lod = object.mesh->selectLod(lodScale * scale / distance, object.lod);
+		}
+		object.lod = lod;
+		// Meshes that never went through upload_mesh have no LOD table yet
+		const MeshLod meshLod = object.mesh->_lods.empty()
+			? MeshLod{ 0, static_cast<uint32_t>(object.mesh->_vertices.size()), 0.f }
+			: object.mesh->_lods[lod];
+		StatsMan.add(static_cast<Profiling::Counter>(static_cast<size_t>(Profiling::Counter::Lod0Instances) + lod));
+		StatsMan.add(Profiling::Counter::Triangles, meshLod.vertexCount / 3);
+
+		auto [batch, added] = _batchIndices.try_emplace({ object.material, object.mesh }, static_cast<uint32_t>(_batchIndices.size()));
+		if (added)
+			_drawBatches.push_back({ object.material, object.mesh, 0, 0 });
+		_drawBatches[batch->second].objectCount++;
+
+		cullSSBO[counter] = {
+			.sphere = glm::vec4(object.mesh->_boundsCenter, object.mesh->_boundsRadius),
+			.vertexCount = meshLod.vertexCount,
+			.firstVertex = meshLod.firstVertex,
+			.batch = batch->second
+		};
+
+		// Objects that keep still for a while move into the cached static shadow layer
+		watch_ptr<ShadowCaster> caster = renderObject.getComponentDefault<ShadowCaster>();
+		const glm::vec4 localSphere = glm::vec4(object.mesh->_boundsCenter, 1.f);
+		const float worldRadius = object.mesh->_boundsRadius * std::max({ glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])) });
+		if (caster->castsShadow()) {
+			if (caster->update(model)) {
+				// Joining the static set adds the object to the cache, leaving it removes it from where it was cached
+				const glm::mat4& cachedModel = caster->isStatic() ? model : caster->previousModel();
+				_shadows.invalidateStatic(glm::vec4(glm::vec3(cachedModel * localSphere), worldRadius));
+			}
+			_shadows.addCaster({ object.mesh, static_cast<uint32_t>(counter), glm::vec4(glm::vec3(model * localSphere), worldRadius) }, caster->isStatic());
+		}
 		// Remember counter value as a component
 		watch_ptr<SSBOIndex> index = renderObject.addComponent<SSBOIndex>(counter);
 		//index->index = counter;
 		counter++;
 	}
+	StatsMan.add(Profiling::Counter::BytesUploaded, counter * (sizeof(GPUObjectData) + sizeof(GPUCullData)));
 	
+	VMAlloc.unmapBuffer(thisFrame().cullBuffer);
 	VMAlloc.unmapBuffer(thisFrame().objectBuffer);
 
+	// Every batch gets a range as large as its object count, the culling shader fills the
+	// front of it and counts how much it filled
+	mapResult = VMAlloc.mapBuffer(thisFrame().drawBatchBuffer);
+	VK_UNEXPECTED_ERROR(mapResult, "Could not map draw batch buffer");
+
+	GPUDrawBatch* batchSSBO = (GPUDrawBatch*)mapResult.value();
+	uint32_t firstDraw = 0;
+	for (size_t i = 0; i < _drawBatches.size(); i++) {
+		_drawBatches[i].firstDraw = firstDraw;
+		batchSSBO[i] = { .earlyCount = 0, .lateCount = 0, .firstDraw = firstDraw };
+		firstDraw += _drawBatches[i].objectCount;
+	}
+	StatsMan.add(Profiling::Counter::BytesUploaded, _drawBatches.size() * sizeof(GPUDrawBatch));
+
+	VMAlloc.unmapBuffer(thisFrame().drawBatchBuffer);
+
+	mapResult = VMAlloc.mapBuffer(thisFrame().cullParamsBuffer);
+	VK_UNEXPECTED_ERROR(mapResult, "Could not map culling parameters buffer");
+
+	GPUCullParams cullParams = {
+		.viewproj = _cullViewproj,
+		.pyramidViewproj = _pyramidViewproj,
+		.pyramidSize = _depthPyramid.getSize(),
+		.objectCount = static_cast<uint32_t>(counter),
+		.pyramidValid = _depthPyramid.isValid()
+	};
+	memcpy(mapResult.value(), &cullParams, sizeof(GPUCullParams));
+	StatsMan.add(Profiling::Counter::BytesUploaded, sizeof(GPUCullParams));
+
+	VMAlloc.unmapBuffer(thisFrame().cullParamsBuffer);
+
+	mapResult = VMAlloc.mapBuffer(thisFrame().shadowBuffer);
+	VK_UNEXPECTED_ERROR(mapResult, "Could not map shadow buffer");
+
+	memcpy(mapResult.value(), &_shadows.getShaderData(), sizeof(GPUShadowData));
+	StatsMan.add(Profiling::Counter::BytesUploaded, sizeof(GPUShadowData));
+
+	VMAlloc.unmapBuffer(thisFrame().shadowBuffer);
+
+	mapResult = VMAlloc.mapBuffer(thisFrame().lightBuffer);
+	VK_UNEXPECTED_ERROR(mapResult, "Could not map point light buffer");
+
+	GPUPointLight* lightSSBO = (GPUPointLight*)mapResult.value();
+	uint32_t lightCount = 0;
+	// Without a render camera there are no clusters to put lights into
+	if (renderCamera) {
+		for (auto &&[entity, light, transform]: _scene->getPointLights().each()) {
+			if (lightCount == MAX_POINT_LIGHTS)
+				break;
+			lightSSBO[lightCount++] = {
+				.positionRadius = glm::vec4(glm::vec3(transform.getMatrix()[3]), light.radius),
+				.color = glm::vec4(light.color, light.intensity)
+			};
+		}
+	}
+	StatsMan.add(Profiling::Counter::PointLights, lightCount);
+	StatsMan.add(Profiling::Counter::BytesUploaded, lightCount * sizeof(GPUPointLight));
+
+	VMAlloc.unmapBuffer(thisFrame().lightBuffer);
+
+	mapResult = VMAlloc.mapBuffer(thisFrame().clusterParamsBuffer);
+	VK_UNEXPECTED_ERROR(mapResult, "Could not map cluster parameters buffer");
+
+	const GPUClusterParams clusterParams = Lighting::ClusteredLights::makeParams(renderCamera.value_or(GPUCameraData{ glm::mat4(1.f), glm::mat4(1.f), glm::mat4(1.f) }), _resolution.getRenderExtent(), lightCount);
+	memcpy(mapResult.value(), &clusterParams, sizeof(GPUClusterParams));
+	StatsMan.add(Profiling::Counter::BytesUploaded, sizeof(GPUClusterParams));
+
+	VMAlloc.unmapBuffer(thisFrame().clusterParamsBuffer);
+
+	if (_particles.isEnabled()) {
+		std::vector<GPUParticleEmitter> emitters;
+		for (auto &&[entity, emitter, transform]: _scene->getParticleEmitters().each()) {
+			if (emitters.size() == MAX_PARTICLE_EMITTERS)
+				break;
+			emitters.push_back({
+				.position = glm::vec4(glm::vec3(transform.getMatrix()[3]), emitter.spawnRadius),
+				.velocity = glm::vec4(emitter.velocity, emitter.velocitySpread),
+				.color = emitter.color,
+				.lifetime = emitter.lifetime,
+				.size = emitter.size,
+				.budget = emitter.budget,
+				.spawnCount = emitter.takeSpawnCount(_frameDelta)
+			});
+		}
+
+		// Particles collide with the depth pyramid they are simulated against, which is last frame's
+		const GPUParticleParams particleParams = {
+			.depthViewproj = _pyramidViewproj,
+			.inverseDepthViewproj = glm::inverse(_pyramidViewproj),
+			.gravity = glm::vec4(0.f, -9.81f, 0.f, _frameDelta),
+			.collision = glm::vec4(_depthPyramid.isValid() ? 1.f : 0.f, 0.5f, 0.5f, 0.f),
+			.depthSize = _depthPyramid.getSize(),
+			.seed = static_cast<uint32_t>(_frameNumber)
+		};
+		auto particleResult = _particles.upload(frameIndex, emitters, particleParams);
+		if (particleResult)
+			return tl::unexpected(new VulkanError(particleResult.value()->getCode(), particleResult.value(), ErrorMessage("Could not upload particle emitters")));
+	}
+
+	return counter;
+}
+
+std::optional<VulkanError*> VulkanEngine::draw_objects(VkCommandBuffer cmd, VkBuffer drawBuffer, uint32_t countOffset) {
+	PROFILE_SCOPE("Draw objects");
+	int frameIndex = _frameNumber % FRAME_OVERLAP;
+
 	Mesh* lastMesh = nullptr;
 	Material* lastMaterial = nullptr;
+#ifdef ENGINE_PROFILING
+	uint32_t batchZone = UINT32_MAX;
+#endif
 	
-	// for (int i = 0; i < count; i++) {
 	for (auto &&[camEntity, camera]: _scene->getCameras().each()) {
-		auto mapResult = VMAlloc.mapBuffer(thisFrame().cameraBuffer);
-		VK_OPTIONAL_ERROR(mapResult, "Could not map camera buffer");
-		void* data = mapResult.value();
+		if (camera.getPurpose() != CameraPurpose::RenderTarget)
+			continue;
 
-		memcpy(data, &camera(), sizeof(GPUCameraData));
-
-		VMAlloc.unmapBuffer(thisFrame().cameraBuffer);
-
-		for (auto &&[entity, object, transform, SSBO]: _scene->getRenders().each()) {
+		for (auto &&[key, batchIndex]: _batchIndices) {
+			const DrawBatch& batch = _drawBatches[batchIndex];
 			//only bind the pipeline if it doesnt match with the already bound one
-			if (object.material != lastMaterial) {
-
-				vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, object.material->pipeline);
-				lastMaterial = object.material;
-				glm::vec2 cameraViewSize = camera.getViewport();
+			if (batch.material != lastMaterial) {
+#ifdef ENGINE_PROFILING
+				thisFrame()._gpuTimer.end(cmd, batchZone);
+				batchZone = thisFrame()._gpuTimer.begin(cmd, "Material batch");
+#endif
+				vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, batch.material->pipeline);
+				StatsMan.add(Profiling::Counter::PipelineBinds);
+				lastMaterial = batch.material;
+				// Window-sized viewports shrink along with the render scale
+				glm::vec2 cameraViewSize = camera.getViewport() * _resolution.getViewportScale();
 				VkExtent2D cameraExtent = {static_cast<uint32_t>(cameraViewSize.x), static_cast<uint32_t>(cameraViewSize.y)};
 				VkViewport cameraViewport = {
 					0.0f,
@@ -915,39 +1377,45 @@ std::optional<VulkanError*> VulkanEngine::draw_objects(VkCommandBuffer cmd) {
 				vkCmdSetScissor(cmd, 0, 1, &cameraScissor);
 
 				uint32_t uniform_offset = pad_uniform_buffer_size(sizeof(GPUSceneData)) * frameIndex;
-				vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, object.material->pipelineLayout, 0, 1, &thisFrame().globalDescriptor, 1, &uniform_offset);
+				vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, batch.material->pipelineLayout, 0, 1, &thisFrame().globalDescriptor, 1, &uniform_offset);
 			
 				//object data descriptor
-				vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, object.material->pipelineLayout, 1, 1, &thisFrame().objectDescriptor, 0, nullptr);
+				vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, batch.material->pipelineLayout, 1, 1, &thisFrame().objectDescriptor, 0, nullptr);
+				StatsMan.add(Profiling::Counter::DescriptorBinds, 2);
 
-				if (object.material->textureSet != VK_NULL_HANDLE) {
+				if (batch.material->textureSet != VK_NULL_HANDLE) {
 					//texture descriptor
-					vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, object.material->pipelineLayout, 2, 1, &object.material->textureSet, 0, nullptr);
+					vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, batch.material->pipelineLayout, 2, 1, &batch.material->textureSet, 0, nullptr);
+					StatsMan.add(Profiling::Counter::DescriptorBinds);
 
 				}
-			}
 
-			glm::mat4 model = transform.getMatrix();
-			//final render matrix, that we are calculating on the cpu
-			glm::mat4 mesh_matrix = model;
-
-			MeshPushConstants constants;
-			constants.data.x = _time;
-			constants.render_matrix = mesh_matrix;
-
-			//upload the mesh to the gpu via pushconstants
-			vkCmdPushConstants(cmd, object.material->pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(MeshPushConstants), &constants);
+				// Model matrices come from the object buffer, only the time is pushed
+				MeshPushConstants constants;
+				constants.data.x = _time;
+				constants.render_matrix = glm::mat4(1.f);
+				vkCmdPushConstants(cmd, batch.material->pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(MeshPushConstants), &constants);
+			}
 
 			//only bind the mesh if its a different one from last bind
-			if (object.mesh != lastMesh) {
+			if (batch.mesh != lastMesh) {
 				//bind the mesh vertex buffer with offset 0
 				VkDeviceSize offset = 0;
-				vkCmdBindVertexBuffers(cmd, 0, 1, &object.mesh->_vertexBuffer._buffer, &offset);
-				lastMesh = object.mesh;
+				vkCmdBindVertexBuffers(cmd, 0, 1, &batch.mesh->_vertexBuffer._buffer, &offset);
+				StatsMan.add(Profiling::Counter::VertexBufferBinds);
+				lastMesh = batch.mesh;
 			}
-			vkCmdDraw(cmd, object.mesh->_vertices.size(), 1,0 , SSBO.index);
+			// The culling shader packed the visible draws at the front of the batch range and
+			// counted them, first instance of every draw is the SSBO index
+			vkCmdDrawIndirectCount(cmd, drawBuffer, batch.firstDraw * sizeof(VkDrawIndirectCommand),
+				thisFrame().drawBatchBuffer._buffer, batchIndex * sizeof(GPUDrawBatch) + countOffset,
+				batch.objectCount, sizeof(VkDrawIndirectCommand));
+			StatsMan.add(Profiling::Counter::DrawCalls);
 		}
 	}
+#ifdef ENGINE_PROFILING
+	thisFrame()._gpuTimer.end(cmd, batchZone);
+#endif
 	return std::nullopt;
 }
 
@@ -991,20 +1459,21 @@ std::optional<VulkanError*> VulkanEngine::immediate_submit(std::function<void(Vk
 
 tl::expected<int, Error*> VulkanEngine::initDescriptors() {
 
-	// Create a descriptor pool that will hold 10 uniform buffers
+	// Create a descriptor pool that will hold 32 descriptors of each type,
+	// storage buffers get more since every frame's culling set holds seven
 	std::vector<VkDescriptorPoolSize> sizes =
 	{
-		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 10 },
-		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 10 },
-		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 10 },
-		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 10 }
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 32 },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 32 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 64 },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 32 }
 	};
 
 	VkDescriptorPoolCreateInfo pool_info = {
 		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
 		.pNext = nullptr,
 		.flags = 0,
-		.maxSets = 10,
+		.maxSets = 32,
 		.poolSizeCount = (uint32_t)sizes.size(),
 		.pPoolSizes = sizes.data()
 	};
@@ -1016,14 +1485,21 @@ tl::expected<int, Error*> VulkanEngine::initDescriptors() {
 	VkDescriptorSetLayoutBinding cameraBind = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,VK_SHADER_STAGE_VERTEX_BIT,0);
 	VkDescriptorSetLayoutBinding sceneBind = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 1);
 	
-	VkDescriptorSetLayoutBinding bindings[] = { cameraBind,sceneBind };
+	VkDescriptorSetLayoutBinding shadowBind = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 2);
+	VkDescriptorSetLayoutBinding shadowMapBind = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 3);
+	VkDescriptorSetLayoutBinding clusterBind = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 4);
+	VkDescriptorSetLayoutBinding lightsBind = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 5);
+	VkDescriptorSetLayoutBinding lightGridBind = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 6);
+	VkDescriptorSetLayoutBinding lightIndexBind = vkinit::descriptorset_layout_binding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 7);
+	
+	VkDescriptorSetLayoutBinding bindings[] = { cameraBind,sceneBind,shadowBind,shadowMapBind,clusterBind,lightsBind,lightGridBind,lightIndexBind };
 
 	VkDescriptorSetLayoutCreateInfo setinfo = {
 		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
 		.pNext = nullptr,
 
 		.flags = 0,
-		.bindingCount = 2,
+		.bindingCount = std::size(bindings),
 		.pBindings = bindings
 	};
 
@@ -1061,7 +1537,7 @@ tl::expected<int, Error*> VulkanEngine::initDescriptors() {
 
 	const size_t sceneParamBufferSize = FRAME_OVERLAP * pad_uniform_buffer_size(sizeof(GPUSceneData));
 
-	auto createResult = VMAlloc.createBuffer(sceneParamBufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+	auto createResult = VMAlloc.createBuffer(sceneParamBufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, MemoryPool::FrameUploads);
 	VK_UNEXPECTED_ERROR(createResult, "Failed to create a buffer for scene parameters")
 	_sceneParameterBuffer = createResult.value();
 
@@ -1078,18 +1554,129 @@ tl::expected<int, Error*> VulkanEngine::initDescriptors() {
 }
 
 tl::expected<int, Error*> VulkanEngine::initFrames() {
+	// Devices without timestamp support on graphics queues get a disabled GPU timer
+	const float timestampPeriod = _gpuProperties.limits.timestampComputeAndGraphics ? _gpuProperties.limits.timestampPeriod : 0.f;
 	for (int i = 0; i < FRAME_OVERLAP; i++) {
-		auto frameResult = _frames[i].create(_graphicsQueueFamily, _descriptorPool, _globalSetLayout, _objectSetLayout, _sceneParameterBuffer);
+		auto frameResult = _frames[i].create(_graphicsQueueFamily, _descriptorPool, _globalSetLayout, _objectSetLayout, _occlusionCuller.getSetLayout(), _clusteredLights.getSetLayout(), _sceneParameterBuffer, timestampPeriod);
 		VK_UNEXPECTED_ERROR(frameResult, "Could not create frame {}", i);
 
 		_onEngineShutdown.push_function(frameResult.value().destroySync);
 		_onEngineShutdown.push_function(frameResult.value().destroyCommands);
 		_onEngineShutdown.push_function(frameResult.value().destroyDescriptors);
+		_onEngineShutdown.push_function(frameResult.value().destroyQueries);
+		_onEngineShutdown.push_function(frameResult.value().destroyCulling);
+		_onEngineShutdown.push_function(frameResult.value().destroyLighting);
+
+		_frames[i].updateShadowDescriptor(_shadows.getView(), _shadows.getSampler());
 	}	
 
 	return 0;
 }
 
+tl::expected<int, Error*> VulkanEngine::initDepthPyramid() {
+	// Pyramid follows the depth image, so it is recreated together with the swapchain
+	auto pyramidResult = _depthPyramid.create(_renderTargetExtent, _depthImageView);
+	VK_UNEXPECTED_ERROR(pyramidResult, "Could not create depth pyramid");
+	_swapchainShutdown.push_function(pyramidResult.value());
+
+	for (int i = 0; i < FRAME_OVERLAP; i++) {
+		_frames[i].updatePyramidDescriptor(_depthPyramid.getView(), _depthPyramid.getSampler());
+	}
+	_particles.updateDepthDescriptor(_depthPyramid.getView(), _depthPyramid.getSampler());
+
+	return 0;
+}
+
+tl::expected<int, Error*> VulkanEngine::initStatsOverlay() {
+	if (!_settings.showStatsOverlay)
+		return 0;
+
+	auto overlayResult = _statsOverlay.init(*this);
+	VK_UNEXPECTED_ERROR(overlayResult, "Could not initialize stats overlay");
+	_onEngineShutdown.push_function(overlayResult.value());
+
+	return 0;
+}
+
+void VulkanEngine::forgetRenderObject(entt::registry& registry, entt::entity entity) {
+	ShadowCaster* caster = registry.try_get<ShadowCaster>(entity);
+	if (caster == nullptr) return;
+	if (caster->castsShadow() && caster->isStatic()) {
+		const RenderObject& object = registry.get<RenderObject>(entity);
+		const glm::mat4& model = caster->lastModel();
+		const float worldRadius = object.mesh->_boundsRadius * std::max({ glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])) });
+		_shadows.invalidateStatic(glm::vec4(glm::vec3(model * glm::vec4(object.mesh->_boundsCenter, 1.f)), worldRadius));
+	}
+	caster->reset();
+}
+
+tl::expected<int, Error*> VulkanEngine::initSystems() {
+	auto& characters = _scene->getStorage<DynamicCharacterController>();
+	auto& collisions = _scene->getStorage<CollisionPhysicsComponent>();
+
+	// Contact callbacks only run after the step, so the step itself conflicts with physics users alone
+	_systems.addSystem("Physics update",
+		[](Systems::SystemBuilder& builder) { builder.write<Physics::PhysicsManager>(); },
+		[](float delta) -> MaybeError {
+			PhysicsMan.update(delta);
+			return std::nullopt;
+		});
+	// Contact callbacks run scene code, e.g. they add components and schedule removals
+	_systems.addSystem("Contact callbacks",
+		[](Systems::SystemBuilder& builder) { builder.exclusive().mainThread(); },
+		[](float delta) -> MaybeError {
+			PhysicsMan.dispatchContacts();
+			return std::nullopt;
+		});
+	// Jolt locks bodies on its own, so body interface calls outside the step only count as reads.
+	// Only bodies Jolt reports as active are copied, sleeping ones cost nothing
+	_systems.addSystem("Rigid bodies sync",
+		[](Systems::SystemBuilder& builder) {
+			builder.read<Physics::PhysicsManager>().write<RigidBodyComponent>().write<TransformComponent>();
+		},
+		[](float delta) -> MaybeError {
+			PhysicsMan.removeScheduled();
+			PhysicsMan.syncTransforms();
+			return std::nullopt;
+		});
+	_systems.addSystem("Characters update",
+		[](Systems::SystemBuilder& builder) {
+			builder.read<Physics::PhysicsManager>().write<DynamicCharacterController>().write<TransformComponent>();
+		},
+		[&characters](float delta) {
+			return Systems::forEach<DynamicCharacterController>(characters, [delta](entt::entity, DynamicCharacterController& character) { return character.update(delta); });
+		});
+	_systems.addSystem("Collisions update",
+		[](Systems::SystemBuilder& builder) {
+			builder.read<Physics::PhysicsManager>().write<CollisionPhysicsComponent>().read<TransformComponent>();
+		},
+		[&collisions](float delta) {
+			return Systems::forEach<CollisionPhysicsComponent>(collisions, [delta](entt::entity, CollisionPhysicsComponent& collision) { return collision.update(delta); });
+		});
+	// Scenes are free to touch anything, including GLFW
+	_systems.addSystem("Scene update",
+		[](Systems::SystemBuilder& builder) { builder.exclusive().mainThread(); },
+		[this](float delta) { return _scene->update(delta); });
+
+	return 0;
+}
+
+void VulkanEngine::sampleStats() {
+	Physics::BodyStats bodies = PhysicsMan.getBodyStats();
+	StatsMan.set(Profiling::Counter::ActiveBodies, bodies.active);
+	StatsMan.set(Profiling::Counter::SleepingBodies, bodies.sleeping);
+	StatsMan.set(Profiling::Counter::StaticBodies, bodies.staticBodies);
+	StatsMan.set(Profiling::Counter::UnaddedBodies, bodies.unadded);
+	StatsMan.set(Profiling::Counter::TotalBodies, bodies.total);
+	StatsMan.set(Profiling::Counter::Entities, _scene->objectCount());
+	StatsMan.set(Profiling::Counter::Timers, _scene->queuedTimers());
+
+	MemoryBudget memory = VMAlloc.getBudget();
+	StatsMan.set(Profiling::Counter::GpuMemoryUsed, memory.usage);
+	StatsMan.set(Profiling::Counter::GpuMemoryBudget, memory.budget);
+	StatsMan.set(Profiling::Counter::GpuAllocations, VMAlloc.getAllocationCount());
+}
+
 tl::expected<VkDescriptorSet, VulkanError*> VulkanEngine::addSingleTextureDescriptor(VkImageView textureView) {
 	VkDescriptorSetAllocateInfo allocInfo = {
 		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
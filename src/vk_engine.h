@@ -13,6 +13,7 @@
 
 #include <vector>
 #include <functional>
+#include <map>
 #include <optional>
 
 #include "platform/window.h"
@@ -24,6 +25,17 @@
 #include "gpustructs.h"
 #include "frame.h"
 #include "scene.h"
+#include "settings.h"
+#include "profiling/statsoverlay.h"
+#include "culling/depthpyramid.h"
+#include "culling/occlusionculler.h"
+#include "shadows/cascadedshadows.h"
+#include "lighting/clusteredlights.h"
+#include "particles/particlesystem.h"
+#include "resolution/dynamicresolution.h"
+#include "graph/rendergraph.h"
+#include "systems/scheduler.h"
+#include "events/inputlog.h"
 
 struct UploadContext {
 	Fence _uploadFence;
@@ -31,13 +43,26 @@ struct UploadContext {
 	VkCommandBuffer _commandBuffer;
 };
 
+// Objects with the same material and mesh, drawn with a single vkCmdDrawIndirectCount
+struct DrawBatch {
+	Material* material;
+	Mesh* mesh;
+	// Offset of the batch in the draw buffers, in draws
+	uint32_t firstDraw;
+	uint32_t objectCount;
+};
+
 constexpr unsigned int FRAME_OVERLAP = 2;
+// Physics step of recorded and replayed runs, see PhysicsManager::setFixedStep
+constexpr float PHYSICS_FIXED_STEP = 1.f / 60.f;
 
 class VulkanEngine {
 public:
 	bool _isInitialized{ false };
 	int _frameNumber {0};
-	float _time;
+	float _time = 0.f;
+	// Seconds since the previous frame, for simulations that run on the GPU
+	float _frameDelta = 0.f;
 	std::chrono::steady_clock::time_point _start_time;
 
 	VkExtent2D _windowExtent{ 1280 , 1040 };
@@ -56,13 +81,17 @@ public:
 	VkQueue _graphicsQueue;
 	uint32_t _graphicsQueueFamily;
 	
+	// Passes of the frame graph, recreated with the swapchain. Pipelines built against
+	// them stay valid since the attachment formats never change
+	VkRenderPass _earlyRenderPass;
 	VkRenderPass _renderPass;
+	// Upscales the scene onto a swapchain image and draws the overlay
+	VkRenderPass _presentRenderPass;
 
 	VkSurfaceKHR _surface;
 	VkSwapchainKHR _swapchain;
 	VkFormat _swachainImageFormat;
 
-	std::vector<VkFramebuffer> _framebuffers;
 	std::vector<VkImage> _swapchainImages;
 	std::vector<VkImageView> _swapchainImageViews;	
 
@@ -72,9 +101,23 @@ public:
 	
 	VmaAllocator _allocator; //vma lib allocator
 
+	// Declares the passes of a frame, owns the scene targets and records the barriers between passes
+	Graph::RenderGraph _frameGraph;
+	// Number of objects uploaded this frame, read by the culling passes
+	uint32_t _frameObjectCount = 0;
+	// First error of a pass callback this frame, draw() returns it once the graph was recorded
+	MaybeVulkanError _passError;
+	// Batches of this frame in upload order, indices match the GPUDrawBatch buffer
+	std::vector<DrawBatch> _drawBatches;
+	// Batch index of every material and mesh pair, iterated to draw batches grouped by material
+	std::map<std::pair<Material*, Mesh*>, uint32_t> _batchIndices;
+
+	// Offscreen scene targets owned by the frame graph, sized for the largest render scale
+	VkExtent2D _renderTargetExtent;
+	VkImageView _sceneColorView;
+
 	//depth resources
 	VkImageView _depthImageView;
-	AllocatedImage _depthImage;
 
 	GPUSceneData _sceneParameters;
 	AllocatedBuffer _sceneParameterBuffer;
@@ -90,6 +133,33 @@ public:
 
 	Scene* _scene;
 
+	EngineSettings _settings;
+
+	Profiling::StatsOverlay _statsOverlay;
+
+	Culling::DepthPyramid _depthPyramid;
+	Culling::OcclusionCuller _occlusionCuller;
+	// Camera used for culling this frame and the one the depth pyramid was built with
+	glm::mat4 _cullViewproj{1.f};
+	glm::mat4 _pyramidViewproj{1.f};
+
+	Shadows::CascadedShadows _shadows;
+	Lighting::ClusteredLights _clusteredLights;
+	Particles::ParticleSystem _particles;
+	Resolution::DynamicResolution _resolution;
+
+	// Per-frame simulation and scene updates, run in parallel where their components allow
+	Systems::Scheduler _systems;
+
+	// Reproducible runs, see --record-input and --replay-input
+	Events::InputRecorder _inputRecorder;
+	Events::InputReplay _inputReplay;
+
+	// Mouse moves queued before this were already shown through a late latched camera
+	std::chrono::steady_clock::time_point _latchedInputTime;
+	// Oldest mouse move the current frame shows for the first time, for the input latency stat
+	std::optional<std::chrono::steady_clock::time_point> _shownInputTime;
+
 	UploadContext _uploadContext;
 	//initializes everything in the engine
 	std::optional<Error*> init();
@@ -102,8 +172,15 @@ public:
 
 	Frame& thisFrame();
 
-	//our draw function
-	MaybeVulkanError draw_objects(VkCommandBuffer cmd);
+	// Polls input right before recording, so the render camera can use it
+	void latchInput();
+
+	// Draws every batch with the draws and counts the culling shader wrote, countOffset
+	// picks the early or late count of GPUDrawBatch
+	MaybeVulkanError draw_objects(VkCommandBuffer cmd, VkBuffer drawBuffer, uint32_t countOffset);
+
+	// Fills scene, object, camera and culling buffers of the current frame, returns the object count
+	tl::expected<uint32_t, VulkanError*> upload_frame_data();
 
 	size_t pad_uniform_buffer_size(size_t originalSize);
 
@@ -111,6 +188,8 @@ public:
 
 	void setScene(Scene* scene) { _scene = scene; };
 
+	void setSettings(const EngineSettings& settings) { _settings = settings; };
+
 	tl::expected<VkDescriptorSet, VulkanError*> addSingleTextureDescriptor(VkImageView textureView);
 
 	tl::expected<int, VulkanError*> upload_mesh(Mesh& mesh);
@@ -126,8 +205,9 @@ private:
 
 	tl::expected<int, Error*> initSwapchain();
 
-	tl::expected<int, Error*> initDefaultRenderpass();
+	tl::expected<int, Error*> initResolution();
 
+	// Declares and compiles the frame graph for the current swapchain
 	tl::expected<int, Error*> initFramebuffers();
 
 	tl::expected<int, Error*> initCommands();
@@ -140,8 +220,29 @@ private:
 
 	tl::expected<int, Error*> initDescriptors();
 
+	tl::expected<int, Error*> initCulling();
+
+	tl::expected<int, Error*> initShadows();
+
+	tl::expected<int, Error*> initLighting();
+
+	tl::expected<int, Error*> initParticles();
+
 	tl::expected<int, Error*> initFrames();
 
+	tl::expected<int, Error*> initDepthPyramid();
+
+	tl::expected<int, Error*> initStatsOverlay();
+
+	// Registers the frame update systems, needs the scene to be initialized
+	tl::expected<int, Error*> initSystems();
+
+	// Redraws the static shadow layer without an object that stops being rendered
+	void forgetRenderObject(entt::registry& registry, entt::entity entity);
+
+	// Samples the per-frame gauges (bodies, entities, timers, memory) into the stats registry
+	void sampleStats();
+
 	tl::expected<int, Error*> loadScene(Scene& scene);
 
 	tl::expected<VkShaderModule, Error*> load_shader_module(const char* filePath);
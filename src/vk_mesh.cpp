@@ -1,8 +1,20 @@
 ﻿#include <tiny_obj_loader.h>
 
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+
+#include <glm/glm.hpp>
 
 #include "vk_mesh.h"
+#include "meshes/simplifier.h"
+
+// Meshes smaller than this are cheap enough to always draw at full detail
+constexpr size_t MIN_LOD_TRIANGLES = 64;
+// LOD is switched once its error covers less than this many pixels
+constexpr float LOD_PIXEL_ERROR = 1.f;
+// Fraction of the pixel error an object has to shrink past before a coarser LOD is picked
+constexpr float LOD_HYSTERESIS = 0.25f;
 
 VertexInputDescription Vertex::get_vertex_description() {
 	VertexInputDescription description;
@@ -123,4 +135,67 @@ tl::expected<Mesh, Error*> meshFromOBJ(const char* fileName) {
 	}
 
 	return result;
-}
\ No newline at end of file
+}
+
+void Mesh::computeBounds() {
+	if (_vertices.empty()) return;
+
+	// Center of the AABB is good enough for a culling sphere
+	glm::vec3 min = _vertices[0].position, max = _vertices[0].position;
+	for (const Vertex& vertex: _vertices) {
+		min = glm::min(min, vertex.position);
+		max = glm::max(max, vertex.position);
+	}
+	_boundsCenter = (min + max) * 0.5f;
+
+	float radiusSquared = 0.f;
+	for (const Vertex& vertex: _vertices) {
+		glm::vec3 offset = vertex.position - _boundsCenter;
+		radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+	}
+	_boundsRadius = std::sqrt(radiusSquared);
+}
+
+void Mesh::generateLods(uint32_t lodCount) {
+	_lodVertices.clear();
+	_lods = { MeshLod{ 0, static_cast<uint32_t>(_vertices.size()), 0.f } };
+
+	size_t triangles = _vertices.size() / 3;
+	if (triangles < MIN_LOD_TRIANGLES) return;
+
+	MeshSimplifier simplifier(_vertices);
+	for (uint32_t i = 1; i < std::min(lodCount, MAX_MESH_LODS); i++) {
+		// Every LOD halves the triangle count of the previous one
+		std::vector<Vertex> lod = simplifier.simplify(triangles / 2);
+		size_t lodTriangles = lod.size() / 3;
+		// Not worth another LOD if the simplifier got stuck
+		if (lodTriangles == 0 || lodTriangles > triangles * 3 / 4) break;
+
+		_lods.push_back({
+			.firstVertex = static_cast<uint32_t>(_vertices.size() + _lodVertices.size()),
+			.vertexCount = static_cast<uint32_t>(lod.size()),
+			.error = simplifier.error()
+		});
+		_lodVertices.insert(_lodVertices.end(), lod.begin(), lod.end());
+		triangles = lodTriangles;
+	}
+}
+
+uint32_t Mesh::selectLod(float pixelsPerUnit, uint32_t currentLod) const {
+	if (_lods.size() < 2) return 0;
+	currentLod = std::min<uint32_t>(currentLod, _lods.size() - 1);
+
+	// Coarsest LOD that still looks the same
+	uint32_t lod = 0;
+	for (uint32_t i = 1; i < _lods.size(); i++) {
+		if (_lods[i].error * pixelsPerUnit <= LOD_PIXEL_ERROR) lod = i;
+	}
+	// Refining happens right away, coarsening needs some margin so objects near the threshold don't flicker
+	if (lod <= currentLod) return lod;
+
+	uint32_t coarser = currentLod;
+	for (uint32_t i = currentLod + 1; i <= lod; i++) {
+		if (_lods[i].error * pixelsPerUnit <= LOD_PIXEL_ERROR * (1.f - LOD_HYSTERESIS)) coarser = i;
+	}
+	return coarser;
+}
@@ -23,10 +23,33 @@ struct Vertex {
 	static VertexInputDescription get_vertex_description();
 }; 
 
+constexpr uint32_t MAX_MESH_LODS = 4;
+
+struct MeshLod {
+	// Vertex range inside the mesh vertex buffer
+	uint32_t firstVertex;
+	uint32_t vertexCount;
+	// Object-space distance the LOD may deviate from the full-detail mesh
+	float error;
+};
+
 struct Mesh {
 	std::vector<Vertex> _vertices;
+	// Simplified versions of _vertices, uploaded right after them into the same buffer
+	std::vector<Vertex> _lodVertices;
+	// LOD 0 is always _vertices, the rest are ordered from finest to coarsest
+	std::vector<MeshLod> _lods;
 
 	AllocatedBuffer _vertexBuffer;
+
+	// Object-space bounding sphere, used for culling
+	glm::vec3 _boundsCenter{0.f};
+	float _boundsRadius = 0.f;
+
+	void computeBounds();
+	void generateLods(uint32_t lodCount = MAX_MESH_LODS);
+	// pixelsPerUnit is the on-screen size of one object-space unit, currentLod is the LOD picked last frame
+	uint32_t selectLod(float pixelsPerUnit, uint32_t currentLod) const;
 };
 
 tl::expected<Mesh, Error*> meshFromOBJ(const char* filename);
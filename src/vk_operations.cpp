@@ -194,6 +194,15 @@ tl::expected<VkImageView, VulkanError*> createImageView(const VkImageViewCreateI
 	return result;
 }
 
+tl::expected<VkImage, VulkanError*> createImage(const VkImageCreateInfo& pCreateInfo) {
+	VkImage result;
+	VkResult imageResult = vkCreateImage(DeviceRef(), &pCreateInfo, nullptr, &result);
+
+	VK_CHECK_OOM(imageResult);
+
+	return result;
+}
+
 tl::expected<VkPipeline, VulkanError*> createGraphicsPipeline(VkPipelineCache pipelineCache, const VkGraphicsPipelineCreateInfo& pCreateInfo) {
 	VkPipeline result;
 	VkResult pipeResult = vkCreateGraphicsPipelines(DeviceRef(), pipelineCache, 1, &pCreateInfo, nullptr, &result);
@@ -205,6 +214,17 @@ tl::expected<VkPipeline, VulkanError*> createGraphicsPipeline(VkPipelineCache pi
 	return result;
 }
 
+tl::expected<VkPipeline, VulkanError*> createComputePipeline(VkPipelineCache pipelineCache, const VkComputePipelineCreateInfo& pCreateInfo) {
+	VkPipeline result;
+	VkResult pipeResult = vkCreateComputePipelines(DeviceRef(), pipelineCache, 1, &pCreateInfo, nullptr, &result);
+	VK_CHECK_OOM(pipeResult);
+	if (pipeResult == VK_ERROR_INVALID_SHADER_NV) {
+		return tl::unexpected(new VulkanError(pipeResult, ErrorMessage("Failed to create compute pipeline: invalid shaders")));
+	}
+
+	return result;
+}
+
 tl::expected<VkShaderModule, VulkanError*> createShaderModule(const VkShaderModuleCreateInfo& pCreateInfo) {
 	VkShaderModule result;
 	VkResult createResult = vkCreateShaderModule(DeviceRef(), &pCreateInfo, nullptr, &result); 
@@ -300,4 +320,27 @@ std::optional<VulkanError*> queuePresent(VkQueue queue, const VkPresentInfoKHR&
 	return std::nullopt;
 }
 
+tl::expected<VkQueryPool, VulkanError*> createQueryPool(const VkQueryPoolCreateInfo& pCreateInfo) {
+	VkQueryPool result;
+	VkResult createPoolResult = vkCreateQueryPool(DeviceRef(), &pCreateInfo, nullptr, &result);
+	VK_CHECK_OOM(createPoolResult);
+	return result;
+}
+
+tl::expected<bool, VulkanError*> getQueryPoolResults(VkQueryPool queryPool, uint32_t firstQuery, uint32_t queryCount, size_t dataSize, void* pData, VkDeviceSize stride, VkQueryResultFlags flags) {
+	VkResult queryResult = vkGetQueryPoolResults(DeviceRef(), queryPool, firstQuery, queryCount, dataSize, pData, stride, flags);
+
+	switch (queryResult) {
+		case VK_SUCCESS: return true;
+		case VK_NOT_READY: return false;
+		case VK_ERROR_OUT_OF_HOST_MEMORY:
+		case VK_ERROR_OUT_OF_DEVICE_MEMORY:
+			return tl::unexpected(new VulkanError(queryResult, ErrorMessage("Out-of-memory (TODO: probably recoverable)")));
+		case VK_ERROR_DEVICE_LOST:
+			return tl::unexpected(new VulkanError(queryResult, ErrorMessage("Device unavailable")));
+		default:
+			return tl::unexpected(new VulkanError(queryResult, ErrorMessage("Unknown Vulkan error")));
+	}
+}
+
 }; // End of namespace vkcommand
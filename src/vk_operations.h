@@ -34,10 +34,15 @@ namespace vkcommand {
 
     tl::expected<VkImageView, VulkanError*> createImageView(const VkImageViewCreateInfo& pCreateInfo);
 
+    // Image without memory, for binding to memory allocated separately
+    tl::expected<VkImage, VulkanError*> createImage(const VkImageCreateInfo& pCreateInfo);
+
     tl::expected<VkPipeline, VulkanError*> createGraphicsPipeline(VkPipelineCache pipelineCache, const VkGraphicsPipelineCreateInfo& pCreateInfo);
 
     tl::expected<VkShaderModule, VulkanError*> createShaderModule(const VkShaderModuleCreateInfo& pCreateInfo);
 
+    tl::expected<VkPipeline, VulkanError*> createComputePipeline(VkPipelineCache pipelineCache, const VkComputePipelineCreateInfo& pCreateInfo);
+
     tl::expected<VkPipelineLayout, VulkanError*> createPipelineLayout(const VkPipelineLayoutCreateInfo& pCreateInfo);
 
     tl::expected<VkSemaphore, VulkanError*> createSemaphore(const VkSemaphoreCreateInfo& pCreateInfo);
@@ -55,4 +60,9 @@ namespace vkcommand {
     std::optional<VulkanError*> resetCommandBuffer(VkCommandBuffer commandBuffer, VkCommandBufferResetFlags flags);
 
     std::optional<VulkanError*> queuePresent(VkQueue queue, const VkPresentInfoKHR& pPresentInfo);
+
+    tl::expected<VkQueryPool, VulkanError*> createQueryPool(const VkQueryPoolCreateInfo& pCreateInfo);
+
+    // Returns false if some of the requested queries are not available yet
+    tl::expected<bool, VulkanError*> getQueryPoolResults(VkQueryPool queryPool, uint32_t firstQuery, uint32_t queryCount, size_t dataSize, void* pData, VkDeviceSize stride, VkQueryResultFlags flags);
 }
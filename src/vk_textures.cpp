@@ -11,6 +11,7 @@
 
 #include "vk_initializers.h"
 #include "vmalloc.h"
+#include "profiling/stats.h"
 #include "vk_textures.h"
 
 
@@ -28,7 +29,7 @@ tl::expected<AllocatedImage, Error*> vkutil::load_image_from_file(VulkanEngine&
 
 	VkFormat image_format = VK_FORMAT_R8G8B8A8_SRGB;
 
-	auto bufferResult = VMAlloc.createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+	auto bufferResult = VMAlloc.createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY, MemoryPool::FrameUploads);
 	VK_UNEXPECTED_ERROR(bufferResult, "Could not create texture buffer")
 
 	AllocatedBuffer stagingBuffer = bufferResult.value();
@@ -38,6 +39,7 @@ tl::expected<AllocatedImage, Error*> vkutil::load_image_from_file(VulkanEngine&
 	void* data = mapResult.value();
 
 	memcpy(data, pixel_ptr, static_cast<size_t>(imageSize));
+	StatsMan.add(Profiling::Counter::BytesUploaded, imageSize);
 
 	VMAlloc.unmapBuffer(stagingBuffer);
 
@@ -56,7 +58,7 @@ tl::expected<AllocatedImage, Error*> vkutil::load_image_from_file(VulkanEngine&
 	VmaAllocationCreateInfo dimg_allocinfo = { .usage = VMA_MEMORY_USAGE_GPU_ONLY };
 
 	//allocate and create the image
-	auto imageResult = VMAlloc.createImage(0, VMA_MEMORY_USAGE_GPU_ONLY, dimg_info);
+	auto imageResult = VMAlloc.createImage(0, VMA_MEMORY_USAGE_GPU_ONLY, dimg_info, MemoryPool::StreamingTextures);
 	VK_UNEXPECTED_ERROR(imageResult, "Failed to create image for a texture");
 	newImage = imageResult.value();
 	
@@ -1,9 +1,21 @@
 #include "vmalloc.h"
 #include "expected.hpp"
 #include "src/allocstructs.h"
+#include "src/devicesingleton.h"
 #include "src/error.h"
+#include "src/vk_initializers.h"
 #include <vulkan/vulkan_core.h>
 
+const char* poolName(MemoryPool pool) {
+	switch (pool) {
+		case MemoryPool::Default: return "default";
+		case MemoryPool::StaticGeometry: return "static geometry";
+		case MemoryPool::StreamingTextures: return "streaming textures";
+		case MemoryPool::FrameUploads: return "frame uploads";
+		default: return "unknown";
+	}
+}
+
 MaybeVulkanError VMAllocator::create(VmaAllocatorCreateInfo& createInfo) {
     VkResult createResult = vmaCreateAllocator(&createInfo, &_allocator);
 
@@ -11,10 +23,78 @@ MaybeVulkanError VMAllocator::create(VmaAllocatorCreateInfo& createInfo) {
         return new VulkanError(createResult, ErrorMessage("Failed to create VMA library allocator"));
     }
 
-    return std::nullopt;
+	// Memory types are picked with a representative resource of every class
+	VkBufferCreateInfo geometryInfo = {
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.size = 1024,
+		.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT
+	};
+	VmaAllocationCreateInfo gpuInfo = { .usage = VMA_MEMORY_USAGE_GPU_ONLY };
+	uint32_t memoryType;
+	VkResult findResult = vmaFindMemoryTypeIndexForBufferInfo(_allocator, &geometryInfo, &gpuInfo, &memoryType);
+	if (findResult != VK_SUCCESS) {
+		return new VulkanError(findResult, ErrorMessage("No memory type for static geometry"));
+	}
+	auto poolResult = createPool(MemoryPool::StaticGeometry, memoryType, GEOMETRY_BLOCK_SIZE);
+	if (poolResult)
+		return poolResult;
+
+	VkImageCreateInfo textureInfo = vkinit::createinfo::image(VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, { 1024, 1024, 1 });
+	findResult = vmaFindMemoryTypeIndexForImageInfo(_allocator, &textureInfo, &gpuInfo, &memoryType);
+	if (findResult != VK_SUCCESS) {
+		return new VulkanError(findResult, ErrorMessage("No memory type for streaming textures"));
+	}
+	poolResult = createPool(MemoryPool::StreamingTextures, memoryType, TEXTURE_BLOCK_SIZE);
+	if (poolResult)
+		return poolResult;
+
+	VkBufferCreateInfo uploadInfo = {
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.size = 1024,
+		.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+	};
+	VmaAllocationCreateInfo hostInfo = { .usage = VMA_MEMORY_USAGE_CPU_TO_GPU };
+	findResult = vmaFindMemoryTypeIndexForBufferInfo(_allocator, &uploadInfo, &hostInfo, &memoryType);
+	if (findResult != VK_SUCCESS) {
+		return new VulkanError(findResult, ErrorMessage("No memory type for frame uploads"));
+	}
+	return createPool(MemoryPool::FrameUploads, memoryType, UPLOAD_BLOCK_SIZE);
 }
 
-tl::expected<AllocatedBuffer, VulkanError*> VMAllocator::createBuffer(size_t allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage) {
+MaybeVulkanError VMAllocator::createPool(MemoryPool pool, uint32_t memoryTypeIndex, VkDeviceSize blockSize) {
+	VmaPoolCreateInfo poolInfo = {
+		.memoryTypeIndex = memoryTypeIndex,
+		.blockSize = blockSize
+	};
+
+	VkResult poolResult = vmaCreatePool(_allocator, &poolInfo, &_pools[static_cast<size_t>(pool)]);
+	if (poolResult != VK_SUCCESS) {
+		return new VulkanError(poolResult, ErrorMessage("Failed to create {} memory pool", poolName(pool)));
+	}
+
+	vmaSetPoolName(_allocator, _pools[static_cast<size_t>(pool)], poolName(pool));
+	return std::nullopt;
+}
+
+std::string VMAllocator::describePool(MemoryPool pool) {
+	std::string result;
+	if (pool != MemoryPool::Default) {
+		const PoolStats stats = getPoolStats(pool);
+		result = fmt::format("{} pool: {} blocks, {} of {} bytes in {} allocations, {} free ranges; ",
+			poolName(pool), stats.blockCount, stats.allocationBytes, stats.blockBytes, stats.allocationCount, stats.unusedRangeCount);
+	}
+
+	const std::vector<HeapBudget> heaps = getHeapBudgets();
+	for (size_t i = 0; i < heaps.size(); i++)
+		result += fmt::format("heap {}{}: {} of {} bytes; ", i, heaps[i].deviceLocal ? " (device local)" : "", heaps[i].usage, heaps[i].budget);
+	return result;
+}
+
+tl::expected<AllocatedBuffer, VulkanError*> VMAllocator::createBuffer(size_t allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage, MemoryPool pool) {
+	// Defragmentation copies geometry into a new buffer
+	if (pool == MemoryPool::StaticGeometry)
+		usage |= VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+
     VkBufferCreateInfo bufferInfo = {};
 	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 	bufferInfo.pNext = nullptr;
@@ -25,6 +105,7 @@ tl::expected<AllocatedBuffer, VulkanError*> VMAllocator::createBuffer(size_t all
 	//let the VMA library know that this data should be writeable by CPU, but also readable by GPU
 	VmaAllocationCreateInfo vmaallocInfo = {};
 	vmaallocInfo.usage = memoryUsage;
+	vmaallocInfo.pool = _pools[static_cast<size_t>(pool)];
 
 	AllocatedBuffer newBuffer;
     VkResult createResult = vmaCreateBuffer(_allocator, &bufferInfo, &vmaallocInfo,
@@ -34,20 +115,33 @@ tl::expected<AllocatedBuffer, VulkanError*> VMAllocator::createBuffer(size_t all
 
 	if (createResult < 0) {
 		return tl::unexpected(new VulkanError(createResult, 
-		ErrorMessage("Failed to create buffer with size {}; usage flags {}, {}", allocSize, usage, (int)memoryUsage)));
+		ErrorMessage("Failed to create buffer with size {}; usage flags {}, {}; {}", allocSize, usage, (int)memoryUsage, describePool(pool))));
 	}
 
+	if (pool == MemoryPool::StaticGeometry)
+		_relocatable[newBuffer._allocation] = { newBuffer._buffer, allocSize, usage };
+
 	// fmt::println("Creating buffer at {}", (void*)(newBuffer._allocation));
 
     return newBuffer;
 }
 
 void VMAllocator::destroy() {
+	if (_defragmentation != VK_NULL_HANDLE)
+		finishDefragmentation();
+
+	for (VmaPool& pool : _pools) {
+		if (pool != VK_NULL_HANDLE)
+			vmaDestroyPool(_allocator, pool);
+		pool = VK_NULL_HANDLE;
+	}
+
     vmaDestroyAllocator(_allocator);
 }
 
 void VMAllocator::destroyBuffer(AllocatedBuffer& buffer) {
 	// fmt::println("Destroying buffer at {}", (void*)(buffer._allocation));
+	_relocatable.erase(buffer._allocation);
     vmaDestroyBuffer(_allocator, buffer._buffer, buffer._allocation);
 }
 
@@ -66,19 +160,20 @@ tl::expected<void*, VulkanError*> VMAllocator::mapBuffer(AllocatedBuffer& buffer
     return result;
 }
 
-tl::expected<AllocatedImage, VulkanError*> VMAllocator::createImage(VkMemoryPropertyFlags flags, VmaMemoryUsage memoryUsage, VkImageCreateInfo& imgInfo) {
+tl::expected<AllocatedImage, VulkanError*> VMAllocator::createImage(VkMemoryPropertyFlags flags, VmaMemoryUsage memoryUsage, VkImageCreateInfo& imgInfo, MemoryPool pool) {
     AllocatedImage result;
 
 	VmaAllocationCreateInfo dimg_allocinfo = {
 	    .usage = memoryUsage,
 	    .requiredFlags = flags,
+	    .pool = _pools[static_cast<size_t>(pool)]
     };
 
 	//allocate and create the image
 	VkResult depthImageResult = vmaCreateImage(_allocator, &imgInfo, &dimg_allocinfo, &result._image, &result._allocation, &result._allocInfo);
 
 	if (depthImageResult < 0) { // VMA docs state that fail returns "negative error code" and nothing else...
-		return tl::unexpected(new VulkanError(depthImageResult, ErrorMessage("Failed to create depth image")));
+		return tl::unexpected(new VulkanError(depthImageResult, ErrorMessage("Failed to create image {}x{}; {}", imgInfo.extent.width, imgInfo.extent.height, describePool(pool))));
 	}
 
 	// fmt::println("Creating image at {}", (void*)(result._allocation));
@@ -86,6 +181,209 @@ tl::expected<AllocatedImage, VulkanError*> VMAllocator::createImage(VkMemoryProp
     return result;
 }
 
+tl::expected<VmaAllocation, VulkanError*> VMAllocator::allocateMemory(const VkMemoryRequirements& requirements, VmaMemoryUsage memoryUsage) {
+	VmaAllocationCreateInfo allocInfo = {
+	    .usage = memoryUsage,
+	};
+
+	VmaAllocation allocation;
+	VkResult allocResult = vmaAllocateMemory(_allocator, &requirements, &allocInfo, &allocation, nullptr);
+
+	if (allocResult < 0) {
+		return tl::unexpected(new VulkanError(allocResult, ErrorMessage("Failed to allocate {} bytes of memory", requirements.size)));
+	}
+
+	return allocation;
+}
+
+MaybeVulkanError VMAllocator::bindImageMemory(VmaAllocation allocation, VkDeviceSize offset, VkImage image) {
+	VkResult bindResult = vmaBindImageMemory2(_allocator, allocation, offset, image, nullptr);
+
+	if (bindResult < 0) {
+		return new VulkanError(bindResult, ErrorMessage("Failed to bind image memory at offset {}", offset));
+	}
+
+	return std::nullopt;
+}
+
+void VMAllocator::freeMemory(VmaAllocation allocation) {
+	vmaFreeMemory(_allocator, allocation);
+}
+
+MemoryBudget VMAllocator::getBudget() {
+	const VkPhysicalDeviceMemoryProperties* memoryProperties;
+	vmaGetMemoryProperties(_allocator, &memoryProperties);
+
+	VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+	vmaGetHeapBudgets(_allocator, budgets);
+
+	MemoryBudget result{0, 0};
+	for (uint32_t i = 0; i < memoryProperties->memoryHeapCount; i++) {
+		result.usage += budgets[i].usage;
+		result.budget += budgets[i].budget;
+	}
+	return result;
+}
+
+std::vector<HeapBudget> VMAllocator::getHeapBudgets() {
+	const VkPhysicalDeviceMemoryProperties* memoryProperties;
+	vmaGetMemoryProperties(_allocator, &memoryProperties);
+
+	VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+	vmaGetHeapBudgets(_allocator, budgets);
+
+	std::vector<HeapBudget> result(memoryProperties->memoryHeapCount);
+	for (uint32_t i = 0; i < memoryProperties->memoryHeapCount; i++) {
+		result[i] = {
+			.usage = budgets[i].usage,
+			.budget = budgets[i].budget,
+			.blockBytes = budgets[i].statistics.blockBytes,
+			.allocationBytes = budgets[i].statistics.allocationBytes,
+			.deviceLocal = (memoryProperties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0
+		};
+	}
+	return result;
+}
+
+PoolStats VMAllocator::getPoolStats(MemoryPool pool) {
+	const VmaPool vmaPool = _pools[static_cast<size_t>(pool)];
+	if (vmaPool == VK_NULL_HANDLE)
+		return {};
+
+	VmaDetailedStatistics stats;
+	vmaCalculatePoolStatistics(_allocator, vmaPool, &stats);
+	return {
+		.blockCount = stats.statistics.blockCount,
+		.allocationCount = stats.statistics.allocationCount,
+		.blockBytes = stats.statistics.blockBytes,
+		.allocationBytes = stats.statistics.allocationBytes,
+		.unusedRangeCount = stats.unusedRangeCount
+	};
+}
+
+uint32_t VMAllocator::getAllocationCount() {
+	VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+	vmaGetHeapBudgets(_allocator, budgets);
+
+	const VkPhysicalDeviceMemoryProperties* memoryProperties;
+	vmaGetMemoryProperties(_allocator, &memoryProperties);
+
+	uint32_t result = 0;
+	for (uint32_t i = 0; i < memoryProperties->memoryHeapCount; i++)
+		result += budgets[i].statistics.allocationCount;
+	return result;
+}
+
+tl::expected<VkDeviceSize, VulkanError*> VMAllocator::defragmentStep(VkDeviceSize maxBytes, const SubmitCopies& submit, const RelocateBuffer& relocate) {
+	const VmaPool geometryPool = _pools[static_cast<size_t>(MemoryPool::StaticGeometry)];
+
+	if (_defragmentation == VK_NULL_HANDLE) {
+		// One trailing free range per block is just unused space, anything more is a hole
+		const PoolStats stats = getPoolStats(MemoryPool::StaticGeometry);
+		if (stats.unusedRangeCount <= stats.blockCount)
+			return 0;
+
+		VmaDefragmentationInfo defragInfo = {
+			.flags = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_FAST_BIT,
+			.pool = geometryPool,
+			.maxBytesPerPass = maxBytes
+		};
+		VkResult beginResult = vmaBeginDefragmentation(_allocator, &defragInfo, &_defragmentation);
+		if (beginResult != VK_SUCCESS) {
+			return tl::unexpected(new VulkanError(beginResult, ErrorMessage("Failed to start defragmentation; {}", describePool(MemoryPool::StaticGeometry))));
+		}
+	}
+
+	VmaDefragmentationPassMoveInfo pass;
+	VkResult passResult = vmaBeginDefragmentationPass(_allocator, _defragmentation, &pass);
+	if (passResult == VK_SUCCESS) {
+		// Nothing left to move
+		finishDefragmentation();
+		return 0;
+	}
+	if (passResult != VK_INCOMPLETE) {
+		finishDefragmentation();
+		return tl::unexpected(new VulkanError(passResult, ErrorMessage("Failed to start defragmentation pass")));
+	}
+
+	struct Copy {
+		uint32_t move;
+		VkBuffer source;
+		VkBuffer destination;
+		VkDeviceSize size;
+	};
+	std::vector<Copy> copies;
+	for (uint32_t i = 0; i < pass.moveCount; i++) {
+		VmaDefragmentationMove& move = pass.pMoves[i];
+		auto relocatable = _relocatable.find(move.srcAllocation);
+		if (relocatable == _relocatable.end()) {
+			move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+			continue;
+		}
+
+		VkBufferCreateInfo bufferInfo = {
+			.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+			.size = relocatable->second.size,
+			.usage = relocatable->second.usage
+		};
+		VkBuffer newBuffer;
+		if (vkCreateBuffer(DeviceRef(), &bufferInfo, nullptr, &newBuffer) != VK_SUCCESS) {
+			move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+			continue;
+		}
+		if (vmaBindBufferMemory(_allocator, move.dstTmpAllocation, newBuffer) != VK_SUCCESS) {
+			vkDestroyBuffer(DeviceRef(), newBuffer, nullptr);
+			move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+			continue;
+		}
+
+		copies.push_back({ i, relocatable->second.buffer, newBuffer, relocatable->second.size });
+	}
+
+	if (!copies.empty()) {
+		auto submitResult = submit([&](VkCommandBuffer cmd) {
+			for (const Copy& copy : copies) {
+				VkBufferCopy region = { .srcOffset = 0, .dstOffset = 0, .size = copy.size };
+				vkCmdCopyBuffer(cmd, copy.source, copy.destination, 1, &region);
+			}
+		});
+		if (submitResult) {
+			for (const Copy& copy : copies) {
+				vkDestroyBuffer(DeviceRef(), copy.destination, nullptr);
+				pass.pMoves[copy.move].operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+			}
+			vmaEndDefragmentationPass(_allocator, _defragmentation, &pass);
+			finishDefragmentation();
+			return tl::unexpected(new VulkanError(submitResult.value()->getCode(), submitResult.value(), ErrorMessage("Failed to copy defragmented buffers")));
+		}
+	}
+
+	VkDeviceSize movedBytes = 0;
+	for (const Copy& copy : copies) {
+		VmaDefragmentationMove& move = pass.pMoves[copy.move];
+		if (!relocate(move.srcAllocation, copy.destination)) {
+			vkDestroyBuffer(DeviceRef(), copy.destination, nullptr);
+			move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+			continue;
+		}
+
+		// The allocation takes over the new place once the pass ends
+		vkDestroyBuffer(DeviceRef(), copy.source, nullptr);
+		_relocatable[move.srcAllocation].buffer = copy.destination;
+		movedBytes += copy.size;
+	}
+
+	if (vmaEndDefragmentationPass(_allocator, _defragmentation, &pass) == VK_SUCCESS)
+		finishDefragmentation();
+
+	return movedBytes;
+}
+
+void VMAllocator::finishDefragmentation() {
+	vmaEndDefragmentation(_allocator, _defragmentation, nullptr);
+	_defragmentation = VK_NULL_HANDLE;
+}
+
 void VMAllocator::destroyImage(AllocatedImage image) {
 	// fmt::println("Destroying image at {}", (void*)(image._allocation));
 	vmaDestroyImage(_allocator, image._image, image._allocation);
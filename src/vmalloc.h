@@ -1,24 +1,117 @@
 #pragma once
 
+#include <array>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #include "allocstructs.h"
 #include "error.h"
 #include "expected.hpp"
 #include "singleton.h"
 
+struct MemoryBudget {
+    VkDeviceSize usage;
+    VkDeviceSize budget;
+};
+
+struct HeapBudget {
+    VkDeviceSize usage;
+    VkDeviceSize budget;
+    // Bytes of VkDeviceMemory blocks VMA holds in this heap and the part taken by allocations
+    VkDeviceSize blockBytes;
+    VkDeviceSize allocationBytes;
+    bool deviceLocal;
+};
+
+// Resource classes that get a VMA pool of their own
+enum class MemoryPool: uint8_t {
+    // VMA's general allocator
+    Default,
+    // Vertex data uploaded once and kept around, defragmented while the GPU is idle
+    StaticGeometry,
+    // Sampled textures loaded at runtime
+    StreamingTextures,
+    // Host-visible staging and per-frame buffers
+    FrameUploads,
+
+    Count
+};
+
+struct PoolStats {
+    uint32_t blockCount;
+    uint32_t allocationCount;
+    VkDeviceSize blockBytes;
+    VkDeviceSize allocationBytes;
+    // Free ranges between allocations, more than one per block means the pool is fragmented
+    uint32_t unusedRangeCount;
+};
+
+const char* poolName(MemoryPool pool);
+
 class VMAllocator: public Singleton<VMAllocator> {
 public:
+    // Gets the new buffer of a moved allocation, returns false if nobody uses the allocation and the move should be skipped
+    using RelocateBuffer = std::function<bool(VmaAllocation allocation, VkBuffer newBuffer)>;
+    // Records the copies and waits for them to finish
+    using SubmitCopies = std::function<MaybeVulkanError(std::function<void(VkCommandBuffer cmd)>&& record)>;
+
     MaybeVulkanError create(VmaAllocatorCreateInfo& createInfo);
     void destroy();
 
-    tl::expected<AllocatedBuffer, VulkanError*> createBuffer(size_t allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage);
-    tl::expected<AllocatedImage, VulkanError*> createImage(VkMemoryPropertyFlags flags, VmaMemoryUsage memoryUsage, VkImageCreateInfo& imgInfo);
+    tl::expected<AllocatedBuffer, VulkanError*> createBuffer(size_t allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage, MemoryPool pool = MemoryPool::Default);
+    // memoryUsage and flags are ignored outside of the default pool, the pool's memory type is used instead
+    tl::expected<AllocatedImage, VulkanError*> createImage(VkMemoryPropertyFlags flags, VmaMemoryUsage memoryUsage, VkImageCreateInfo& imgInfo, MemoryPool pool = MemoryPool::Default);
     tl::expected<void*, VulkanError*> mapBuffer(AllocatedBuffer& buffer);
 
+    // Raw memory for images placed by hand, several of them may share it
+    tl::expected<VmaAllocation, VulkanError*> allocateMemory(const VkMemoryRequirements& requirements, VmaMemoryUsage memoryUsage);
+    MaybeVulkanError bindImageMemory(VmaAllocation allocation, VkDeviceSize offset, VkImage image);
+    void freeMemory(VmaAllocation allocation);
+
     void destroyBuffer(AllocatedBuffer& buffer);
     void destroyImage(AllocatedImage image);
     void unmapBuffer(AllocatedBuffer& buffer);
+
+    // Summed over all memory heaps
+    MemoryBudget getBudget();
+    std::vector<HeapBudget> getHeapBudgets();
+    // Walks every allocation of the pool, not meant for the default pool
+    PoolStats getPoolStats(MemoryPool pool);
+    uint32_t getAllocationCount();
+
+    /*!
+     * \brief Runs one incremental pass of StaticGeometry defragmentation
+     *
+     * A pass starts only once the pool has holes between allocations and moves at most maxBytes.
+     * Moved buffers are recreated and copied over; their VmaAllocation stays the same, only the
+     * VkBuffer changes. The GPU must not be using the pool while this runs.
+     * Returns the number of bytes moved
+     */
+    tl::expected<VkDeviceSize, VulkanError*> defragmentStep(VkDeviceSize maxBytes, const SubmitCopies& submit, const RelocateBuffer& relocate);
+    bool isDefragmenting() const { return _defragmentation != VK_NULL_HANDLE; };
 private:
+    // Buffers that defragmentation may move, it has to be able to recreate them
+    struct RelocatableBuffer {
+        VkBuffer buffer;
+        VkDeviceSize size;
+        VkBufferUsageFlags usage;
+    };
+
+    static constexpr VkDeviceSize GEOMETRY_BLOCK_SIZE = 64ull << 20;
+    static constexpr VkDeviceSize TEXTURE_BLOCK_SIZE = 128ull << 20;
+    static constexpr VkDeviceSize UPLOAD_BLOCK_SIZE = 64ull << 20;
+
+    MaybeVulkanError createPool(MemoryPool pool, uint32_t memoryTypeIndex, VkDeviceSize blockSize);
+    // Pool and heap usage for allocation failure reports
+    std::string describePool(MemoryPool pool);
+    void finishDefragmentation();
+
     VmaAllocator _allocator;
+    std::array<VmaPool, static_cast<size_t>(MemoryPool::Count)> _pools{};
+    std::unordered_map<VmaAllocation, RelocatableBuffer> _relocatable;
+    VmaDefragmentationContext _defragmentation = VK_NULL_HANDLE;
 };
 
 #define VMAlloc VMAllocator::instance()